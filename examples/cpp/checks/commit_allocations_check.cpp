@@ -0,0 +1,402 @@
+// File commit_allocations_check.cpp
+//
+// Check that a steady-state queue commit makes no heap allocations.
+//
+// Global operator new is replaced with the one that counts allocations while counting is enabled.
+// The same queue is committed many times, first to warm up the reused buffers, then with counting enabled.
+// The check is done for C12.18 against an emulated meter, and for C12.22 in sessionless and session modes
+// against a C12.22 server protocol that runs within the channel.
+// The program returns zero if all checks pass.
+
+#include <MCORE/MCOREExtern.h>
+#include <MCOM/MCOM.h>
+#include <new>
+
+using namespace std;
+
+   static bool s_countAllocations = false;
+   static unsigned s_numberOfAllocations = 0;
+
+   static void* DoAllocate(size_t size)
+   {
+      if ( s_countAllocations )
+         ++s_numberOfAllocations;
+      void* result = malloc(size != 0 ? size : 1);
+      if ( result == NULL )
+         throw std::bad_alloc();
+      return result;
+   }
+
+void* operator new(size_t size)
+{
+   return DoAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+   return DoAllocate(size);
+}
+
+void operator delete(void* p) M_NO_THROW
+{
+   free(p);
+}
+
+void operator delete[](void* p) M_NO_THROW
+{
+   free(p);
+}
+
+   const unsigned TABLE_SIZE = 100;
+   const unsigned NUMBER_OF_WARMUP_COMMITS = 10;
+   const unsigned NUMBER_OF_COMMITS = 1000;
+
+   static void DoBuildTableReadResponse(char* data, unsigned& size)
+   {
+      MToBigEndianUINT16(TABLE_SIZE, data + size);
+      size += 2;
+      for ( unsigned i = 0; i < TABLE_SIZE; ++i )
+         data[size + i] = static_cast<char>(i);
+      data[size + TABLE_SIZE] = static_cast<char>(MProtocolC12::StaticCalculateChecksumFromBuffer(data + size, TABLE_SIZE));
+      size += TABLE_SIZE + 1;
+   }
+
+   // Emulated C12.18 meter that acknowledges every packet, and responds with a table of TABLE_SIZE bytes to every table read
+   //
+   class EmulatedMeterC1218 : public MChannel
+   {
+   public:
+
+      EmulatedMeterC1218()
+      :
+         m_incomingSize(0),
+         m_outgoingPosition(0),
+         m_outgoingSize(0),
+         m_toggle(false)
+      {
+      }
+
+      virtual void Disconnect()
+      {
+      }
+
+      virtual void FlushOutputBuffer(unsigned)
+      {
+      }
+
+      virtual bool IsConnected() const
+      {
+         return true;
+      }
+
+      virtual MStdString GetMediaIdentification() const
+      {
+         return "EmulatedMeterC1218";
+      }
+
+   protected:
+
+      virtual unsigned DoWrite(const char* buff, unsigned size)
+      {
+         for ( unsigned i = 0; i < size; ++i )
+         {
+            if ( m_incomingSize == 0 && buff[i] != '\xEE' ) // skip acknowledgements
+               continue;
+            m_incoming[m_incomingSize++] = buff[i];
+            if ( m_incomingSize >= 6 && m_incomingSize == 8u + MFromBigEndianUINT16(m_incoming + 4) )
+            {
+               DoRespond();
+               m_incomingSize = 0;
+            }
+         }
+         return size;
+      }
+
+      virtual unsigned DoRead(char* buff, unsigned size, unsigned)
+      {
+         unsigned result = m_outgoingSize - m_outgoingPosition;
+         if ( result > size )
+            result = size;
+         memcpy(buff, m_outgoing + m_outgoingPosition, result);
+         m_outgoingPosition += result;
+         return result;
+      }
+
+   private:
+
+      void DoRespond()
+      {
+         char data [ TABLE_SIZE + 8 ];
+         unsigned size = 0;
+         data[size++] = '\0'; // OK
+         if ( m_incoming[6] == '\x30' )
+            DoBuildTableReadResponse(data, size);
+
+         m_outgoing[0] = '\x06'; // acknowledge the request
+         char* packet = m_outgoing + 1;
+         packet[0] = '\xEE';
+         packet[1] = '\0';
+         packet[2] = m_toggle ? '\x20' : '\0';
+         packet[3] = '\0';
+         m_toggle = !m_toggle;
+         MToBigEndianUINT16(size, packet + 4);
+         memcpy(packet + 6, data, size);
+         Muint16 crc = MProtocolC12::StaticCalculateCRC16FromBuffer(packet, size + 6);
+         memcpy(packet + 6 + size, &crc, 2);
+         m_outgoingPosition = 0;
+         m_outgoingSize = size + 9;
+      }
+
+      char m_incoming [ 1024 ];
+      unsigned m_incomingSize;
+      char m_outgoing [ 1024 ];
+      unsigned m_outgoingPosition;
+      unsigned m_outgoingSize;
+      bool m_toggle;
+   };
+
+   // Channel of the C12.22 server protocol, the incoming APDU is given, and the outgoing one is collected
+   //
+   class ServerChannelC1222 : public MChannel
+   {
+   public:
+
+      ServerChannelC1222()
+      :
+         m_incomingPosition(0)
+      {
+      }
+
+      virtual void Disconnect()
+      {
+      }
+
+      virtual void FlushOutputBuffer(unsigned)
+      {
+      }
+
+      virtual bool IsConnected() const
+      {
+         return true;
+      }
+
+      virtual MStdString GetMediaIdentification() const
+      {
+         return "ServerChannelC1222";
+      }
+
+   public:
+
+      MByteString m_incoming;
+      unsigned m_incomingPosition;
+      MByteString m_outgoing;
+
+   protected:
+
+      virtual void DoClearInputBuffer()
+      {
+         m_incomingPosition = static_cast<unsigned>(m_incoming.size());
+      }
+
+      virtual unsigned DoWrite(const char* buff, unsigned size)
+      {
+         m_outgoing.append(buff, size);
+         return size;
+      }
+
+      virtual unsigned DoRead(char* buff, unsigned size, unsigned)
+      {
+         unsigned result = static_cast<unsigned>(m_incoming.size()) - m_incomingPosition;
+         if ( result > size )
+            result = size;
+         memcpy(buff, m_incoming.data() + m_incomingPosition, result);
+         m_incomingPosition += result;
+         return result;
+      }
+
+      virtual bool DoIsReadTimeoutInstant() const
+      {
+         return true;
+      }
+   };
+
+   // Emulated C12.22 meter, responds with a table of TABLE_SIZE bytes to every table read
+   //
+   class EmulatedMeterC1222 : public MProtocolC1222
+   {
+   public:
+
+      explicit EmulatedMeterC1222(ServerChannelC1222* channel)
+      :
+         MProtocolC1222(channel, false)
+      {
+         SetTurnAroundDelay(0);
+      }
+
+      void Serve()
+      {
+         ServerStart();
+         SetSecurityMode(GetIncomingSecurityMode());
+         ProcessIncomingEPSEM();
+         for ( ;; )
+         {
+            if ( ReceiveServiceLength() == 0 )
+               break;
+            const char command = static_cast<char>(m_applicationLayerReader.ReadByte());
+            m_applicationLayerReader.SetReadPosition(m_applicationLayerReader.GetEndPosition()); // ignore the request data
+            if ( command == '\x30' )
+            {
+               char data [ TABLE_SIZE + 4 ];
+               unsigned size = 0;
+               DoBuildTableReadResponse(data, size);
+               DoSendServiceWithData('\0', data, size);
+            }
+            else if ( command == '\x50' ) // logon, respond with session idle timeout
+               DoSendServiceWithData('\0', "\x00\x3C", 2);
+            else
+               SendService('\0');
+         }
+         ServerEnd();
+      }
+   };
+
+   // Client channel, where every written APDU is served by the emulated C12.22 meter
+   //
+   class EmulatedMeterChannelC1222 : public MChannel
+   {
+   public:
+
+      EmulatedMeterChannelC1222()
+      :
+         m_incomingPosition(0),
+         m_serverChannel(),
+         m_server(&m_serverChannel)
+      {
+      }
+
+      virtual void Disconnect()
+      {
+      }
+
+      virtual void FlushOutputBuffer(unsigned)
+      {
+      }
+
+      virtual bool IsConnected() const
+      {
+         return true;
+      }
+
+      virtual MStdString GetMediaIdentification() const
+      {
+         return "EmulatedMeterChannelC1222";
+      }
+
+   protected:
+
+      virtual void DoClearInputBuffer()
+      {
+         m_incomingPosition = static_cast<unsigned>(m_incoming.size());
+      }
+
+      virtual unsigned DoWrite(const char* buff, unsigned size)
+      {
+         MValueSavior<bool> countAllocationsSavior(&s_countAllocations, false); // the meter side is not checked
+         m_serverChannel.m_incoming.assign(buff, size);
+         m_serverChannel.m_incomingPosition = 0;
+         m_serverChannel.m_outgoing.clear();
+         m_server.Serve();
+         m_incoming = m_serverChannel.m_outgoing;
+         m_incomingPosition = 0;
+         return size;
+      }
+
+      virtual unsigned DoRead(char* buff, unsigned size, unsigned)
+      {
+         unsigned result = static_cast<unsigned>(m_incoming.size()) - m_incomingPosition;
+         if ( result > size )
+            result = size;
+         memcpy(buff, m_incoming.data() + m_incomingPosition, result);
+         m_incomingPosition += result;
+         return result;
+      }
+
+      virtual bool DoIsReadTimeoutInstant() const
+      {
+         return true;
+      }
+
+   private:
+
+      MByteString m_incoming;
+      unsigned m_incomingPosition;
+      ServerChannelC1222 m_serverChannel;
+      EmulatedMeterC1222 m_server;
+   };
+
+   // Session is not started for C12.18, as its emulated meter does not handle session establishment
+   //
+   static bool DoCheck(MProtocolC12& protocol, const char* name, bool startSession)
+   {
+      try
+      {
+         protocol.SetTurnAroundDelay(0);
+         if ( startSession )
+            protocol.QStartSession();
+         protocol.QTableRead(1, TABLE_SIZE, -1);
+         protocol.QTableRead(2, TABLE_SIZE, -1);
+         if ( startSession )
+            protocol.QEndSession();
+         for ( unsigned i = 0; i < NUMBER_OF_WARMUP_COMMITS; ++i )
+         {
+            protocol.QCommit();
+            protocol.QResetResponses();
+         }
+
+         s_numberOfAllocations = 0;
+         s_countAllocations = true;
+         for ( unsigned i = 0; i < NUMBER_OF_COMMITS; ++i )
+         {
+            protocol.QResetResponses();
+            protocol.QCommit();
+         }
+         s_countAllocations = false;
+
+         if ( protocol.QGetTableData(1).size() != TABLE_SIZE || protocol.QGetTableData(2).size() != TABLE_SIZE )
+         {
+            fprintf(stderr, "%s: unexpected table size\n", name);
+            return false;
+         }
+         if ( s_numberOfAllocations != 0 )
+         {
+            fprintf(stderr, "%s: %u allocations made by %u commits\n", name, s_numberOfAllocations, NUMBER_OF_COMMITS);
+            return false;
+         }
+      }
+      catch ( MException& ex )
+      {
+         s_countAllocations = false;
+         fprintf(stderr, "%s: %s\n", name, ex.AsString().c_str());
+         return false;
+      }
+      printf("%s: OK\n", name);
+      return true;
+   }
+
+int main()
+{
+   bool ok = true;
+
+   MProtocolC1218 protocolC1218(M_NEW EmulatedMeterC1218, true);
+   ok = DoCheck(protocolC1218, "C12.18", false) && ok;
+
+   MProtocolC1222 sessionlessC1222(M_NEW EmulatedMeterChannelC1222, true);
+   sessionlessC1222.SetSessionless(true);
+   ok = DoCheck(sessionlessC1222, "C12.22 sessionless", true) && ok;
+
+   MProtocolC1222 sessionC1222(M_NEW EmulatedMeterChannelC1222, true);
+   sessionC1222.SetSessionless(false);
+   ok = DoCheck(sessionC1222, "C12.22 session", true) && ok;
+
+   return ok ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+// File log_file_check.cpp
+//
+// Check of the monitor log file and its page index, for every combination of page compression and obfuscation.
+//
+// A log is written with many messages of one code, followed by a single message of another code.
+// Then a page in the middle of the log is damaged, and the message with the other code is searched for.
+// The damaged page can only be passed over if the page index is used, otherwise reading it fails.
+// Also, all messages are read back through a fresh log to verify they survive the round trip.
+// The program returns zero if all checks pass.
+
+#include <MCORE/MCOREExtern.h>
+#include <MCOM/MCOM.h>
+#include <MCOM/LogFileWriter.h>
+#include <MCOM/LogFileReader.h>
+
+using namespace std;
+
+   const unsigned COMMON_CODE = MMonitor::MessageChannelByteTx;
+   const unsigned RARE_CODE = MMonitor::MessageChannelByteRx;
+   const unsigned NUMBER_OF_COMMON_MESSAGES = 20000;
+
+   static const char* DoGetName(bool compress, bool obfuscate)
+   {
+      if ( compress )
+         return obfuscate ? "compressed and obfuscated" : "compressed";
+      return obfuscate ? "obfuscated" : "plain";
+   }
+
+   static void DoDeleteFileIfExists(const MStdString& fileName)
+   {
+      if ( MUtilities::IsPathExisting(fileName) )
+         MUtilities::DeleteFile(fileName);
+   }
+
+   static void DoWriteLog(const MStdString& fileName, bool compress, bool obfuscate)
+   {
+      DoDeleteFileIfExists(fileName);
+      DoDeleteFileIfExists(MLogFile::GetIndexFileName(fileName));
+      MLogFileWriter writer;
+      writer.SetCompress(compress);
+      writer.SetObfuscate(obfuscate);
+      writer.Open(fileName);
+      for ( unsigned i = 0; i < NUMBER_OF_COMMON_MESSAGES; ++i )
+      {
+         const MByteString message = MGetStdString("Message %u of the check, repeated to fill many pages", i);
+         MLogFile::PacketHeader header(static_cast<unsigned>(message.size()), COMMON_CODE);
+         header.m_timeStamp = i;
+         writer.WriteMessage(header, message.data());
+      }
+      const MByteString message("Rare message");
+      MLogFile::PacketHeader header(static_cast<unsigned>(message.size()), RARE_CODE);
+      header.m_timeStamp = NUMBER_OF_COMMON_MESSAGES;
+      writer.WriteMessage(header, message.data());
+      writer.Close();
+   }
+
+   static unsigned DoCountMessages(const MStdString& fileName)
+   {
+      MLogFileReader reader(fileName);
+      unsigned count = 0;
+      for ( ;; )
+      {
+         const MLogFile::PacketHeader& header = reader.ReadPacketHeader();
+         if ( reader.EndOfFile() )
+            break;
+         if ( header.m_code == COMMON_CODE || header.m_code == RARE_CODE )
+            ++count;
+         reader.SkipPacketBody();
+      }
+      return count;
+   }
+
+   static void DoDamageMiddlePage(const MStdString& fileName)
+   {
+      MStreamFile file(fileName, MStreamFile::FlagReadWrite);
+      const unsigned numberOfPages = file.GetSize() / MLogFile::PAGE_TOTAL_SIZE;
+      if ( numberOfPages < 4 )
+      {
+         MException::Throw("Log is expected to have more pages");
+         M_ENSURED_ASSERT(0);
+      }
+      const unsigned position = numberOfPages / 2 * MLogFile::PAGE_TOTAL_SIZE + MLogFile::PAGE_TOTAL_SIZE / 2; // the middle of the page body
+      char bytes [ 4 ];
+      file.SetPosition(position);
+      file.ReadBytes(bytes, sizeof(bytes));
+      for ( unsigned i = 0; i < sizeof(bytes); ++i )
+         bytes[i] = static_cast<char>(~bytes[i]);
+      file.SetPosition(position);
+      file.WriteBytes(bytes, sizeof(bytes));
+      file.Close();
+   }
+
+   static bool DoCheck(bool compress, bool obfuscate)
+   {
+      const MStdString fileName = MUtilities::GetTempDirectory() + "log_file_check.mon";
+      const char* name = DoGetName(compress, obfuscate);
+      try
+      {
+         DoWriteLog(fileName, compress, obfuscate);
+
+         const unsigned count = DoCountMessages(fileName);
+         if ( count != NUMBER_OF_COMMON_MESSAGES + 1 )
+         {
+            fprintf(stderr, "%s log: %u messages read back, %u expected\n", name, count, NUMBER_OF_COMMON_MESSAGES + 1);
+            return false;
+         }
+
+         DoDamageMiddlePage(fileName);
+         MLogFileReader reader(fileName);
+         if ( !reader.SeekCode(RARE_CODE) )
+         {
+            fprintf(stderr, "%s log: message not found with the page index\n", name);
+            return false;
+         }
+      }
+      catch ( MException& ex )
+      {
+         fprintf(stderr, "%s log: %s\n", name, ex.AsString().c_str());
+         return false;
+      }
+      DoDeleteFileIfExists(fileName);
+      DoDeleteFileIfExists(MLogFile::GetIndexFileName(fileName));
+      printf("%s log: OK\n", name);
+      return true;
+   }
+
+int main()
+{
+   bool ok = true;
+   for ( int compress = 0; compress < 2; ++compress )
+      for ( int obfuscate = 0; obfuscate < 2; ++obfuscate )
+         ok = DoCheck(compress != 0, obfuscate != 0) && ok;
+   return ok ? 0 : 1;
+}
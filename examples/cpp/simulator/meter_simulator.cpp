@@ -0,0 +1,1215 @@
+// File meter_simulator.cpp
+//
+// Simulator of many ANSI C12.19 devices behind one process, for load testing of C12.18 and C12.22 clients.
+//
+// The simulator serves table reads from configurable table images over TCP, UDP or in-process loopback channel.
+// Each session is served as a different device, the serial number in ST1 and the identification in ST5
+// are made unique for every simulated device. Responses can be delayed and failed randomly.
+// Every TCP connection is served by a thread of its own, and every UDP peer address and port by a device of its own.
+// Optionally, the simulator runs its own clients against itself, which is the way to benchmark
+// the client protocol stack alone when loopback transport is used.
+// The number of served requests per second is reported every second.
+
+#include <MCORE/MCOREExtern.h>
+#include <MCOM/MCOM.h>
+#include <signal.h>
+
+using namespace std;
+
+   enum TransportEnum
+   {
+      TransportTcp,
+      TransportUdp,
+      TransportLoopback
+   };
+
+   enum LatencyDistributionEnum
+   {
+      LatencyFixed,
+      LatencyUniform,
+      LatencyExponential
+   };
+
+   // Settings of the simulator, given in the command line
+   //
+   struct Settings
+   {
+      bool m_isC1222;
+      TransportEnum m_transport;
+      unsigned m_port;
+      unsigned m_meters;
+      unsigned m_threads;
+      unsigned m_clients;
+      unsigned m_duration;
+      unsigned m_latency;
+      LatencyDistributionEnum m_latencyDistribution;
+      double m_errorRate;
+      bool m_verbose;
+   };
+
+   // Counters of the simulator, updated by many threads
+   //
+   struct Statistics
+   {
+      MInterlocked m_requests;
+      MInterlocked m_errorsInjected;
+      MInterlocked m_sessions;
+      MInterlocked m_sessionsFailed;
+      MInterlocked m_clientSessions;
+      MInterlocked m_clientSessionsFailed;
+      MInterlocked m_nextMeter;
+   };
+
+   typedef std::map<unsigned, MByteString>
+      TableImages;
+
+   static Settings s_settings;
+   static Statistics s_statistics;
+   static TableImages s_tables;
+   static volatile sig_atomic_t s_isStopped = 0;
+   static volatile bool s_areServersStopped = false; // set once the clients finish, so their last sessions are served
+
+   static const char s_loopbackNamePrefix[] = "SIMULATOR";
+
+   static void DoInterruptHandler(int)
+   {
+      s_isStopped = 1;
+   }
+
+   static void DoReportError(const char* where, MException& ex)
+   {
+      if ( s_settings.m_verbose )
+         cerr << "### " << where << ": " << ex.AsString() << endl;
+   }
+
+   static void DoSetDefaultTables()
+   {
+      // ST0 general configuration, short but valid header
+      s_tables[0] = MUtilities::HexStringToBytes("0200000000000000000000000000000000000000");
+      // ST1 general manufacturer identification
+      s_tables[1].assign("SIM METER   \x01\x00\x01\x00                ", 32);
+      // ST5 device identification
+      s_tables[5].assign("                    ", 20);
+      // ST52 clock
+      s_tables[52] = MUtilities::HexStringToBytes("1A0A120C000000");
+   }
+
+   // Load table images from text file with lines NUMBER=HEX, empty lines and lines that start with # are ignored
+   //
+   static void DoLoadTables(const MStdString& fileName)
+   {
+      MStreamFile file(fileName, MStreamFile::FlagReadOnly | MStreamFile::FlagText);
+      MStdString line;
+      while ( file.ReadOneLine(line) )
+      {
+         MAlgorithm::InplaceTrim(line);
+         if ( line.empty() || line[0] == '#' )
+            continue;
+         MStdString::size_type pos = line.find('=');
+         if ( pos == MStdString::npos )
+         {
+            MException::ThrowBadFileFormat(fileName);
+            M_ENSURED_ASSERT(0);
+         }
+         MStdString number = line.substr(0, pos);
+         MAlgorithm::InplaceTrim(number);
+         s_tables[MToUnsigned(number)] = MUtilities::HexStringToBytes(line.substr(pos + 1));
+      }
+   }
+
+   // Part of the device behavior that does not depend on the protocol
+   //
+   class SimulatedMeter
+   {
+   public:
+
+      SimulatedMeter(bool isC1222)
+      :
+         m_isC1222(isC1222),
+         m_isInSession(false),
+         m_isDelayDeferred(false),
+         m_meter(0),
+         m_randomState(0),
+         m_deferredDelay(0)
+      {
+         NextMeter();
+      }
+
+      // Whether logon was done, and neither logoff nor terminate followed
+      //
+      bool IsInSession() const
+      {
+         return m_isInSession;
+      }
+
+      // When deferred, the response latency is accumulated rather than slept,
+      // and the server delays sending of the response by \ref TakeDeferredDelay
+      //
+      void SetDelayDeferred(bool deferred)
+      {
+         m_isDelayDeferred = deferred;
+      }
+
+      // Return the response latency in milliseconds accumulated since the previous call
+      //
+      unsigned TakeDeferredDelay()
+      {
+         const unsigned result = m_deferredDelay;
+         m_deferredDelay = 0;
+         return result;
+      }
+
+      // Switch to the next simulated device, done at the start of every session
+      //
+      void NextMeter()
+      {
+         m_meter = static_cast<unsigned>(++s_statistics.m_nextMeter) % s_settings.m_meters;
+         m_randomState = 0x9E3779B9u ^ (m_meter * 0x85EBCA6Bu);
+         if ( m_randomState == 0 )
+            m_randomState = 1;
+      }
+
+      // Make the response for the given request, return response code
+      //
+      char Respond(char command, const MByteString& request, MByteString& response)
+      {
+         ++s_statistics.m_requests;
+         DoDelay();
+         response.clear();
+         if ( s_settings.m_errorRate > 0.0 && DoRandom() < s_settings.m_errorRate )
+         {
+            ++s_statistics.m_errorsInjected;
+            return MEC12NokResponse::RESPONSE_BSY;
+         }
+
+         switch ( static_cast<Muint8>(command) )
+         {
+         case 0x20: // identify
+            response.assign("\x00\x01\x00\x00", 4); // C12.18, version 1, revision 0, end of features
+            return MEC12NokResponse::RESPONSE_OK;
+         case 0x60: // negotiate, accept what is asked
+         case 0x61:
+            if ( request.size() < 3 )
+               return MEC12NokResponse::RESPONSE_ERR;
+            response = request;
+            return MEC12NokResponse::RESPONSE_OK;
+         case 0x50: // logon
+            m_isInSession = true;
+            if ( m_isC1222 ) // C12.22 logon responds with session idle timeout
+               response = request.size() >= 14 ? request.substr(12, 2) : MByteString("\x00\x00", 2);
+            return MEC12NokResponse::RESPONSE_OK;
+         case 0x30: // full read
+            if ( request.size() < 2 )
+               return MEC12NokResponse::RESPONSE_ERR;
+            return DoRespondRead(MFromBigEndianUINT16(request.data()), 0, UINT_MAX, response);
+         case 0x3F: // partial read offset
+            if ( request.size() < 7 )
+               return MEC12NokResponse::RESPONSE_ERR;
+            return DoRespondRead(MFromBigEndianUINT16(request.data()), MFromBigEndianUINT24(request.data() + 2), MFromBigEndianUINT16(request.data() + 5), response);
+         case 0x21: // terminate
+         case 0x52: // logoff
+            m_isInSession = false;
+            return MEC12NokResponse::RESPONSE_OK;
+         case 0x51: // security
+         case 0x70: // wait
+         case 0x40: // full write, accepted and ignored
+         case 0x4F: // partial write offset, accepted and ignored
+            return MEC12NokResponse::RESPONSE_OK;
+         default:
+            return MEC12NokResponse::RESPONSE_SNS;
+         }
+      }
+
+   private:
+
+      char DoRespondRead(unsigned number, unsigned offset, unsigned count, MByteString& response)
+      {
+         TableImages::const_iterator it = s_tables.find(number);
+         if ( it == s_tables.end() || offset > it->second.size() )
+            return MEC12NokResponse::RESPONSE_IAR;
+         MByteString data = it->second;
+         DoPersonalize(number, data);
+         if ( count > data.size() - offset )
+         {
+            if ( count != UINT_MAX )
+               return MEC12NokResponse::RESPONSE_IAR;
+            count = static_cast<unsigned>(data.size() - offset);
+         }
+
+         char header [ 2 ];
+         MToBigEndianUINT16(count, header);
+         response.assign(header, 2);
+         response.append(data, offset, count);
+         response += static_cast<char>(MProtocolC12::StaticCalculateChecksumFromBuffer(data.data() + offset, count));
+         return MEC12NokResponse::RESPONSE_OK;
+      }
+
+      // Make the tables that identify the device unique
+      //
+      void DoPersonalize(unsigned number, MByteString& data) const
+      {
+         if ( number == 1 && data.size() >= 32 ) // MFG_SERIAL_NUMBER
+         {
+            const MStdString serial = MGetStdString("%016u", m_meter);
+            data.replace(16, 16, serial);
+         }
+         else if ( number == 5 && data.size() >= 20 ) // IDENTIFICATION
+         {
+            const MStdString identification = MGetStdString("SIMULATOR%011u", m_meter);
+            data.replace(0, 20, identification);
+         }
+      }
+
+      void DoDelay()
+      {
+         if ( s_settings.m_latency == 0 )
+            return;
+         double delay = s_settings.m_latency;
+         switch ( s_settings.m_latencyDistribution )
+         {
+         case LatencyUniform:
+            delay *= 2.0 * DoRandom();
+            break;
+         case LatencyExponential:
+            delay *= -log(1.0 - DoRandom());
+            break;
+         default:
+            break;
+         }
+         if ( m_isDelayDeferred )
+            m_deferredDelay += static_cast<unsigned>(delay + 0.5);
+         else
+            MUtilities::Sleep(static_cast<unsigned>(delay + 0.5));
+      }
+
+      double DoRandom() // xorshift32, uniform in range 0 to 1, excluding 1
+      {
+         m_randomState ^= m_randomState << 13;
+         m_randomState ^= m_randomState >> 17;
+         m_randomState ^= m_randomState << 5;
+         return m_randomState / 4294967296.0;
+      }
+
+   private:
+
+      bool m_isC1222;
+      bool m_isInSession;
+      bool m_isDelayDeferred;
+      unsigned m_meter;
+      Muint32 m_randomState;
+      unsigned m_deferredDelay;
+   };
+
+   class SimulatedMeterC1218 : public MProtocolC1218
+   {
+   public:
+
+      SimulatedMeterC1218(MChannel* channel, bool channelIsOwned)
+      :
+         MProtocolC1218(channel, channelIsOwned),
+         m_meter(false)
+      {
+      }
+
+      // Serve one request, return false if the session is terminated
+      //
+      bool ServeRequest()
+      {
+         ServerStart();
+         M_ASSERT(m_applicationLayerIncoming.GetTotalSize() > 0);
+         const char command = *m_applicationLayerIncoming.GetTotalPtr();
+         const MByteString request(m_applicationLayerIncoming.GetTotalPtr() + 1, m_applicationLayerIncoming.GetTotalSize() - 1);
+         if ( command == '\x20' ) // identify starts the session
+            m_meter.NextMeter();
+         MByteString response;
+         const char code = m_meter.Respond(command, request, response);
+         ServerEnd(code, response);
+         return command != '\x21' || code != MEC12NokResponse::RESPONSE_OK;
+      }
+
+   private:
+
+      SimulatedMeter m_meter;
+   };
+
+   class SimulatedMeterC1222 : public MProtocolC1222
+   {
+   public:
+
+      SimulatedMeterC1222(MChannel* channel, bool channelIsOwned)
+      :
+         MProtocolC1222(channel, channelIsOwned),
+         m_meter(true)
+      {
+      }
+
+      // Serve one request APDU with all services in it, return false if the session is ended.
+      // A sessionless request is a session by itself.
+      //
+      bool ServeRequest()
+      {
+         ServerStart();
+         SetSecurityMode(GetIncomingSecurityMode()); // respond the same way the client asks
+         ProcessIncomingEPSEM();
+         if ( !m_meter.IsInSession() )
+            m_meter.NextMeter();
+         MByteString response;
+         for ( ;; )
+         {
+            const unsigned length = ReceiveServiceLength();
+            if ( length == 0 )
+               break;
+            const char command = static_cast<char>(m_applicationLayerReader.ReadByte());
+            MByteString request;
+            m_applicationLayerReader.ReadRemainingBytes(request);
+            const char code = m_meter.Respond(command, request, response);
+            if ( response.empty() )
+               SendService(code);
+            else
+               SendServiceWithData(code, response);
+         }
+         ServerEnd();
+         return m_meter.IsInSession();
+      }
+
+      SimulatedMeter& GetMeter()
+      {
+         return m_meter;
+      }
+
+   private:
+
+      SimulatedMeter m_meter;
+   };
+
+   static MProtocol* DoCreateSimulatedMeter(MChannel* channel, bool channelIsOwned)
+   {
+      MProtocolC12* result;
+      if ( s_settings.m_isC1222 )
+         result = M_NEW SimulatedMeterC1222(channel, channelIsOwned);
+      else
+         result = M_NEW SimulatedMeterC1218(channel, channelIsOwned);
+      result->SetTurnAroundDelay(0); // the latency is simulated separately
+      return result;
+   }
+
+   static bool DoServeRequest(MProtocol* protocol)
+   {
+      if ( s_settings.m_isC1222 )
+         return static_cast<SimulatedMeterC1222*>(protocol)->ServeRequest();
+      return static_cast<SimulatedMeterC1218*>(protocol)->ServeRequest();
+   }
+
+   // Serve requests until the client closes the connection, an error happens, or the simulator stops.
+   // C12.18 connection ends with terminate, while C12.22 connection can have many sessions, or sessionless requests.
+   //
+   static void DoServeConnection(MProtocol* protocol)
+   {
+      try
+      {
+         while ( !s_areServersStopped )
+         {
+            if ( !DoServeRequest(protocol) )
+            {
+               ++s_statistics.m_sessions;
+               if ( !s_settings.m_isC1222 )
+                  break;
+            }
+         }
+      }
+      catch ( MEChannelDisconnectedUnexpectedly& )
+      {
+         // client is done with the connection
+      }
+      catch ( MException& ex )
+      {
+         ++s_statistics.m_sessionsFailed;
+         DoReportError("Session", ex);
+      }
+   }
+
+   // Thread of the simulator that can be deleted through the base class
+   //
+   class SimulatorThread : public MThreadWorker
+   {
+   public:
+
+      virtual ~SimulatorThread()
+      {
+      }
+   };
+
+   // Server of a single TCP connection
+   //
+   class TcpConnectionThread : public SimulatorThread
+   {
+   public:
+
+      TcpConnectionThread(MProtocol* protocol)
+      :
+         m_protocol(protocol)
+      {
+      }
+
+      virtual ~TcpConnectionThread()
+      {
+         WaitUntilFinished(false);
+      }
+
+   private:
+
+      virtual void Run()
+      {
+         DoServeConnection(m_protocol.get());
+      }
+
+   private:
+
+      MUniquePtr<MProtocol> m_protocol;
+   };
+
+   // Every accepted TCP connection is served by a thread of its own,
+   // so the number of simultaneous sessions is not limited by the number of accepting threads
+   //
+   class TcpConnectionFactory : public MChannelSocketListener::ConnectionFactory
+   {
+   public:
+
+      virtual ~TcpConnectionFactory()
+      {
+         Stop();
+      }
+
+      // Wait until all connections are served, called after the listener is stopped
+      //
+      void Stop()
+      {
+         MCriticalSection::Locker lock(m_lock);
+         for ( ThreadList::iterator it = m_threads.begin(); it != m_threads.end(); ++it )
+            delete *it;
+         m_threads.clear();
+      }
+
+      virtual MProtocol* CreateProtocol(MChannelSocket* channel)
+      {
+         channel->GetSocket().SetNoDelay(true); // small C12.18 packets and acknowledgements shall not wait
+         return DoCreateSimulatedMeter(channel, false);
+      }
+
+      virtual void HandleProtocol(MProtocol* protocol)
+      {
+         MUniquePtr<TcpConnectionThread> thread(M_NEW TcpConnectionThread(protocol));
+         MCriticalSection::Locker lock(m_lock);
+         DoDeleteFinishedThreads();
+         thread->Start();
+         m_threads.push_back(thread.release());
+      }
+
+      virtual void HandleError(MException& ex)
+      {
+         DoReportError("Listener", ex);
+      }
+
+   private:
+
+      typedef std::list<TcpConnectionThread*>
+         ThreadList;
+
+      void DoDeleteFinishedThreads()
+      {
+         ThreadList::iterator it = m_threads.begin();
+         while ( it != m_threads.end() )
+         {
+            if ( (*it)->IsRunning() )
+               ++it;
+            else
+            {
+               delete *it;
+               it = m_threads.erase(it);
+            }
+         }
+      }
+
+   private:
+
+      MCriticalSection m_lock;
+      ThreadList m_threads;
+   };
+
+   // Channel of a single UDP peer. The received datagram is given to it as the input,
+   // and the bytes written by the protocol are collected into the response datagram.
+   //
+   class UdpPeerChannel : public MChannel
+   {
+   public:
+
+      UdpPeerChannel()
+      :
+         m_input(NULL),
+         m_inputSize(0)
+      {
+      }
+
+      virtual ~UdpPeerChannel()
+      {
+      }
+
+      void SetDatagram(const char* datagram, unsigned size)
+      {
+         m_unreadBuffer.clear();
+         m_input = datagram;
+         m_inputSize = size;
+         m_output.clear();
+      }
+
+      MByteString& AccessResponse()
+      {
+         return m_output;
+      }
+
+      virtual void Disconnect()
+      {
+      }
+
+      virtual void FlushOutputBuffer(unsigned)
+      {
+      }
+
+      virtual bool IsConnected() const
+      {
+         return true;
+      }
+
+      virtual MStdString GetMediaIdentification() const
+      {
+         return MStdString("UDP", 3);
+      }
+
+   protected:
+
+      virtual void DoClearInputBuffer()
+      {
+         m_inputSize = 0;
+      }
+
+      virtual unsigned DoWrite(const char* buf, unsigned len)
+      {
+         m_output.append(buf, len);
+         return len;
+      }
+
+      virtual unsigned DoRead(char* buf, unsigned len, unsigned)
+      {
+         if ( len > m_inputSize )
+            len = m_inputSize;
+         memcpy(buf, m_input, len);
+         m_input += len;
+         m_inputSize -= len;
+         return len;
+      }
+
+      virtual bool DoIsReadTimeoutInstant() const
+      {
+         return true; // nothing more comes until the next datagram
+      }
+
+   private:
+
+      const char* m_input;
+      unsigned m_inputSize;
+      MByteString m_output;
+   };
+
+   // Device served to one UDP peer, which is an address and a port
+   //
+   struct UdpSession
+   {
+      UdpSession()
+      :
+         m_channel(),
+         m_meter(&m_channel, false),
+         m_users(0),
+         m_lastUsedTick(0)
+      {
+         m_meter.SetTurnAroundDelay(0);
+         m_meter.GetMeter().SetDelayDeferred(true); // the latency delays the response, not the receiving thread
+      }
+
+      MCriticalSection m_lock; // serializes the datagrams of the peer
+      UdpPeerChannel m_channel;
+      SimulatedMeterC1222 m_meter;
+      unsigned m_users;        // guarded by the lock of the session map
+      Muint64 m_lastUsedTick;  // guarded by the lock of the session map
+   };
+
+   // Sender of UDP responses, which are held for the simulated latency without blocking the receiving threads
+   //
+   class UdpSenderThread : public MThreadWorker
+   {
+   public:
+
+      UdpSenderThread()
+      :
+         m_wakeUp(false, false)
+      {
+      }
+
+      virtual ~UdpSenderThread()
+      {
+         WaitUntilFinished(false);
+      }
+
+      // Send the response to the peer through the given socket, now or after the given delay in milliseconds.
+      // The response bytes are taken away.
+      //
+      void Send(MStreamSocketUdp& socket, const sockaddr_storage& address, socklen_t addressLength, MByteString& response, unsigned delay)
+      {
+         if ( delay == 0 )
+         {
+            DoSend(socket, address, addressLength, response);
+            return;
+         }
+         bool isFirst;
+         {
+            MCriticalSection::Locker lock(m_lock);
+            DatagramQueue::iterator it = m_queue.insert(DatagramQueue::value_type(MTimer::GetTickCount64() + delay, Datagram()));
+            Datagram& datagram = it->second;
+            datagram.m_socket = &socket;
+            datagram.m_address = address;
+            datagram.m_addressLength = addressLength;
+            datagram.m_bytes.swap(response);
+            isFirst = it == m_queue.begin();
+         }
+         if ( isFirst )
+            m_wakeUp.Set();
+      }
+
+   private:
+
+      struct Datagram
+      {
+         MStreamSocketUdp* m_socket;
+         sockaddr_storage m_address;
+         socklen_t m_addressLength;
+         MByteString m_bytes;
+      };
+
+      typedef std::multimap<Muint64, Datagram>
+         DatagramQueue;
+
+      static void DoSend(MStreamSocketUdp& socket, const sockaddr_storage& address, socklen_t addressLength, const MByteString& bytes)
+      {
+         try
+         {
+            socket.SendTo(bytes.data(), static_cast<unsigned>(bytes.size()), 0, reinterpret_cast<const sockaddr*>(&address), addressLength);
+         }
+         catch ( MException& ex )
+         {
+            DoReportError("UDP send", ex);
+         }
+      }
+
+      virtual void Run()
+      {
+         Datagram datagram;
+         while ( !s_areServersStopped )
+         {
+            bool isDue = false;
+            long timeout = 250; // check for stop
+            {
+               MCriticalSection::Locker lock(m_lock);
+               if ( !m_queue.empty() )
+               {
+                  const Muint64 now = MTimer::GetTickCount64();
+                  DatagramQueue::iterator it = m_queue.begin();
+                  if ( it->first <= now )
+                  {
+                     datagram = it->second;
+                     m_queue.erase(it);
+                     isDue = true;
+                  }
+                  else if ( it->first - now < static_cast<Muint64>(timeout) )
+                     timeout = static_cast<long>(it->first - now);
+               }
+            }
+            if ( isDue )
+               DoSend(*datagram.m_socket, datagram.m_address, datagram.m_addressLength, datagram.m_bytes);
+            else
+               m_wakeUp.LockWithTimeout(timeout);
+         }
+      }
+
+   private:
+
+      MCriticalSection m_lock;
+      MEvent m_wakeUp;
+      DatagramQueue m_queue;
+   };
+
+   class UdpServer;
+
+   // Thread that receives UDP datagrams from its socket, and serves them
+   //
+   class UdpReceiverThread : public MThreadWorker
+   {
+   public:
+
+      UdpReceiverThread(UdpServer* server)
+      :
+         m_server(server)
+      {
+      }
+
+      virtual ~UdpReceiverThread()
+      {
+         WaitUntilFinished(false);
+      }
+
+      MStreamSocketUdp& GetSocket()
+      {
+         return m_socket;
+      }
+
+   private:
+
+      virtual void Run();
+
+   private:
+
+      UdpServer* m_server;
+      MStreamSocketUdp m_socket;
+   };
+
+   // Server of UDP datagrams, C12.22 only.
+   //
+   // Every peer address and port is served as a separate device with its own protocol state,
+   // so the sessions of different peers do not interleave. The device is forgotten once its session ends,
+   // or when the peer is silent for too long. Like in MChannelSocketListener, on platforms that support SO_REUSEPORT
+   // every receiving thread has its own socket bound into the port, otherwise a single thread receives all datagrams.
+   // The latency of responses is simulated by the sender thread, which never delays receiving.
+   //
+   class UdpServer
+   {
+   public:
+
+      UdpServer()
+      :
+         m_nextExpiryTick(0)
+      {
+      }
+
+      ~UdpServer()
+      {
+         Stop();
+      }
+
+      void Start()
+      {
+         const bool reusePort = MStreamSocketUdp::IsReusePortSupported() && s_settings.m_threads > 1;
+         const unsigned count = reusePort ? s_settings.m_threads : 1;
+         m_sender.reset(M_NEW UdpSenderThread);
+         for ( unsigned i = 0; i < count; ++i )
+         {
+            UdpReceiverThread* thread = M_NEW UdpReceiverThread(this);
+            m_receivers.push_back(thread);
+            if ( reusePort )
+               thread->GetSocket().BindShared(s_settings.m_port);
+            else
+               thread->GetSocket().Bind(s_settings.m_port);
+         }
+         m_sender->Start();
+         for ( std::vector<UdpReceiverThread*>::iterator it = m_receivers.begin(); it != m_receivers.end(); ++it )
+            (*it)->Start();
+      }
+
+      // Wait for the threads to see the stop, and forget all devices
+      //
+      void Stop()
+      {
+         for ( std::vector<UdpReceiverThread*>::iterator it = m_receivers.begin(); it != m_receivers.end(); ++it )
+            (*it)->WaitUntilFinished(false);
+         m_sender.reset(); // delayed responses refer to the sockets of receivers
+         for ( std::vector<UdpReceiverThread*>::iterator it = m_receivers.begin(); it != m_receivers.end(); ++it )
+            delete *it;
+         m_receivers.clear();
+         for ( SessionMap::iterator it = m_sessions.begin(); it != m_sessions.end(); ++it )
+            delete it->second;
+         m_sessions.clear();
+      }
+
+      // Serve the datagram received by the given socket from the given peer
+      //
+      void ServeDatagram(MStreamSocketUdp& socket, const char* datagram, unsigned size, const sockaddr_storage& address, socklen_t addressLength)
+      {
+         const MByteString key(reinterpret_cast<const char*>(&address), addressLength);
+         UdpSession* session = DoAcquireSession(key);
+         MByteString response;
+         unsigned delay;
+         bool isInSession;
+         {
+            MCriticalSection::Locker lock(session->m_lock);
+            session->m_channel.SetDatagram(datagram, size);
+            try
+            {
+               if ( !session->m_meter.ServeRequest() )
+                  ++s_statistics.m_sessions;
+            }
+            catch ( MException& ex )
+            {
+               ++s_statistics.m_sessionsFailed;
+               DoReportError("UDP request", ex);
+            }
+            response.swap(session->m_channel.AccessResponse());
+            delay = session->m_meter.GetMeter().TakeDeferredDelay();
+            isInSession = session->m_meter.GetMeter().IsInSession();
+         }
+         DoReleaseSession(key, session, isInSession);
+         if ( !response.empty() )
+            m_sender->Send(socket, address, addressLength, response, delay);
+      }
+
+   private:
+
+      typedef std::map<MByteString, UdpSession*>
+         SessionMap;
+
+      enum
+      {
+         SESSION_IDLE_TIMEOUT = 60000 // milliseconds of silence after which the device forgets its peer
+      };
+
+      UdpSession* DoAcquireSession(const MByteString& key)
+      {
+         MCriticalSection::Locker lock(m_sessionsLock);
+         UdpSession*& session = m_sessions[key];
+         if ( session == NULL )
+            session = M_NEW UdpSession;
+         ++session->m_users;
+         return session;
+      }
+
+      // The device that is not in session has nothing to remember, the next request from the peer starts anew
+      //
+      void DoReleaseSession(const MByteString& key, UdpSession* session, bool isInSession)
+      {
+         const Muint64 now = MTimer::GetTickCount64();
+         MCriticalSection::Locker lock(m_sessionsLock);
+         session->m_lastUsedTick = now;
+         if ( --session->m_users == 0 && !isInSession )
+         {
+            m_sessions.erase(key);
+            delete session;
+         }
+         if ( now >= m_nextExpiryTick ) // once a second, forget the peers that went silent in the middle of the session
+         {
+            m_nextExpiryTick = now + 1000;
+            SessionMap::iterator it = m_sessions.begin();
+            while ( it != m_sessions.end() )
+            {
+               if ( it->second->m_users == 0 && now - it->second->m_lastUsedTick > SESSION_IDLE_TIMEOUT )
+               {
+                  delete it->second;
+                  m_sessions.erase(it++);
+               }
+               else
+                  ++it;
+            }
+         }
+      }
+
+   private:
+
+      MCriticalSection m_sessionsLock;
+      SessionMap m_sessions;
+      Muint64 m_nextExpiryTick;
+      MUniquePtr<UdpSenderThread> m_sender;
+      std::vector<UdpReceiverThread*> m_receivers;
+   };
+
+   void UdpReceiverThread::Run()
+   {
+      char datagram [ MStreamSocketUdp::MAXIMUM_DATAGRAM_SIZE ];
+      while ( !s_areServersStopped )
+      {
+         try
+         {
+            if ( !m_socket.WaitToReceive(250) ) // check for stop
+               continue;
+            sockaddr_storage address;
+            memset(&address, 0, sizeof(address)); // the address is a key of the session map
+            socklen_t addressLength = sizeof(address);
+            const unsigned size = m_socket.RecvFrom(datagram, sizeof(datagram), 0, reinterpret_cast<sockaddr*>(&address), &addressLength);
+            m_server->ServeDatagram(m_socket, datagram, size, address, addressLength);
+         }
+         catch ( MException& ex )
+         {
+            DoReportError("UDP receive", ex);
+         }
+      }
+   }
+
+   static MStdString DoGetLoopbackName(unsigned index)
+   {
+      return MGetStdString("%s%u", s_loopbackNamePrefix, index);
+   }
+
+   // Server side of a loopback pair, serves one connection after another
+   //
+   class LoopbackServerThread : public SimulatorThread
+   {
+   public:
+
+      LoopbackServerThread(unsigned index)
+      :
+         m_index(index)
+      {
+      }
+
+      virtual ~LoopbackServerThread()
+      {
+         WaitUntilFinished(false);
+      }
+
+   private:
+
+      virtual void Run()
+      {
+         MChannelLoopback channel;
+         channel.SetLoopbackName(DoGetLoopbackName(m_index));
+         MUniquePtr<MProtocol> meter(DoCreateSimulatedMeter(&channel, false));
+         while ( !s_areServersStopped )
+         {
+            channel.Connect();
+            bool isPaired = false;
+            while ( !isPaired && !s_areServersStopped ) // do not start reading until the client comes
+               isPaired = channel.WaitUntilPaired(250); // check for stop
+            if ( isPaired )
+               DoServeConnection(meter.get());
+            channel.Disconnect();
+         }
+      }
+
+   private:
+
+      unsigned m_index;
+   };
+
+   // Client that reads all simulated tables in a loop, used for benchmarking of the client stack
+   //
+   class ClientThread : public SimulatorThread
+   {
+   public:
+
+      ClientThread(unsigned index)
+      :
+         m_index(index)
+      {
+      }
+
+      virtual ~ClientThread()
+      {
+         WaitUntilFinished(false);
+      }
+
+   private:
+
+      virtual void Run()
+      {
+         MUniquePtr<MChannel> channel;
+         switch ( s_settings.m_transport )
+         {
+         case TransportLoopback:
+            {
+               MChannelLoopback* loopback = M_NEW MChannelLoopback;
+               channel.reset(loopback);
+               loopback->SetLoopbackName(DoGetLoopbackName(m_index));
+            }
+            break;
+         case TransportUdp:
+            {
+               MChannelSocketUdp* udp = M_NEW MChannelSocketUdp;
+               channel.reset(udp);
+               udp->SetPeerAddress("127.0.0.1");
+               udp->SetPeerPort(s_settings.m_port);
+            }
+            break;
+         default:
+            {
+               MChannelSocket* tcp = M_NEW MChannelSocket;
+               channel.reset(tcp);
+               tcp->SetPeerAddress("127.0.0.1");
+               tcp->SetPeerPort(s_settings.m_port);
+            }
+            break;
+         }
+
+         MUniquePtr<MProtocolC12> protocol;
+         if ( s_settings.m_isC1222 )
+         {
+            MProtocolC1222* c1222 = M_NEW MProtocolC1222(channel.get(), false);
+            protocol.reset(c1222);
+            c1222->SetResponseTimeout(1); // a lost datagram is retried in a second, and the stop is not delayed for minutes
+         }
+         else
+            protocol.reset(M_NEW MProtocolC1218(channel.get(), false));
+         protocol->SetTurnAroundDelay(0); // measure the client stack, not its sleeps
+
+         while ( !s_isStopped )
+         {
+            try
+            {
+               protocol->QConnect();
+               protocol->QStartSession();
+               int id = 0;
+               for ( TableImages::const_iterator it = s_tables.begin(); it != s_tables.end(); ++it )
+                  protocol->QTableRead(it->first, 0, id++);
+               protocol->QEndSession();
+               protocol->QDisconnect();
+               protocol->QCommit();
+               ++s_statistics.m_clientSessions;
+            }
+            catch ( MException& ex )
+            {
+               ++s_statistics.m_clientSessionsFailed;
+               DoReportError("Client", ex);
+               protocol->Disconnect();
+            }
+         }
+      }
+
+   private:
+
+      unsigned m_index;
+   };
+
+int main(int argc, char** argv)
+{
+   MStdString protocolName = "C12.18";
+   MStdString transportName = "tcp";
+   MStdString latencyDistributionName = "fixed";
+   MStdString tablesFileName;
+   s_settings.m_port = 1153;
+   s_settings.m_meters = 10000;
+   s_settings.m_threads = 4;
+   s_settings.m_clients = 0;
+   s_settings.m_duration = 0;
+   s_settings.m_latency = 0;
+   s_settings.m_errorRate = 0.0;
+   s_settings.m_verbose = false;
+
+   MCommandLineParser cmd;
+   cmd.SetDescription("Simulator of many ANSI C12.19 devices for load testing of C12.18 and C12.22 clients");
+   cmd.DeclareNamedString('p', "protocol", "C12.18|C12.22", "Protocol served by the simulated devices", protocolName);
+   cmd.DeclareNamedString('t', "transport", "tcp|udp|loopback", "Transport, UDP is for C12.22 only", transportName);
+   cmd.DeclareNamedUnsignedInt('o', "port", "port", "TCP or UDP port to listen to", s_settings.m_port);
+   cmd.DeclareNamedUnsignedInt('m', "meters", "count", "Number of simulated devices", s_settings.m_meters);
+   cmd.DeclareNamedUnsignedInt('n', "threads", "count", "Number of threads that accept TCP connections or receive UDP datagrams", s_settings.m_threads);
+   cmd.DeclareNamedUnsignedInt('c', "clients", "count", "Number of built-in client threads, required for loopback", s_settings.m_clients);
+   cmd.DeclareNamedUnsignedInt('d', "duration", "seconds", "How long to run, zero to run until Ctrl-C", s_settings.m_duration);
+   cmd.DeclareNamedUnsignedInt('l', "latency", "milliseconds", "Mean response latency", s_settings.m_latency);
+   cmd.DeclareNamedString('D', "latency-distribution", "fixed|uniform|exponential", "Distribution of response latency", latencyDistributionName);
+   cmd.DeclareNamedDouble('e', "error-rate", "fraction", "Fraction of requests answered with BSY error, 0 to 1", s_settings.m_errorRate);
+   cmd.DeclareNamedString('f', "tables", "file", "Table images, lines NUMBER=HEX", tablesFileName);
+   cmd.DeclareFlag('v', "verbose", "Report every error", s_settings.m_verbose);
+   int result = cmd.Process(argc, argv);
+   if ( result != 0 )
+      return result;
+
+   try
+   {
+      s_settings.m_isC1222 = protocolName.find("22") != MStdString::npos;
+      const MStdString transport = MStr::ToLower(transportName);
+      if ( transport == "tcp" )
+         s_settings.m_transport = TransportTcp;
+      else if ( transport == "udp" && s_settings.m_isC1222 )
+         s_settings.m_transport = TransportUdp;
+      else if ( transport == "loopback" && s_settings.m_clients > 0 )
+         s_settings.m_transport = TransportLoopback;
+      else
+      {
+         MException::Throw("Unsupported transport, or no clients given for loopback");
+         M_ENSURED_ASSERT(0);
+      }
+      const MStdString distribution = MStr::ToLower(latencyDistributionName);
+      if ( distribution == "uniform" )
+         s_settings.m_latencyDistribution = LatencyUniform;
+      else if ( distribution == "exponential" )
+         s_settings.m_latencyDistribution = LatencyExponential;
+      else
+         s_settings.m_latencyDistribution = LatencyFixed;
+      MENumberOutOfRange::CheckNamedRange(0.0, 1.0, s_settings.m_errorRate, "error-rate");
+      MENumberOutOfRange::CheckInteger(1, INT_MAX, int(s_settings.m_meters), "meters");
+
+      if ( tablesFileName.empty() )
+         DoSetDefaultTables();
+      else
+         DoLoadTables(tablesFileName);
+
+      signal(SIGINT, DoInterruptHandler);
+
+      TcpConnectionFactory factory;
+      MChannelSocketListener listener(&factory);
+      UdpServer udpServer;
+      std::vector<SimulatorThread*> threads;
+      for ( unsigned i = 0; i < s_settings.m_clients; ++i ) // clients go first, so at exit they finish their sessions before servers stop
+         threads.push_back(M_NEW ClientThread(i));
+      switch ( s_settings.m_transport )
+      {
+      case TransportTcp:
+         listener.SetPort(s_settings.m_port);
+         listener.SetThreadCount(s_settings.m_threads);
+         listener.Start();
+         break;
+      case TransportUdp:
+         udpServer.Start();
+         break;
+      default:
+         for ( unsigned i = 0; i < s_settings.m_clients; ++i )
+            threads.push_back(M_NEW LoopbackServerThread(i));
+         break;
+      }
+      for ( std::vector<SimulatorThread*>::iterator it = threads.begin(); it != threads.end(); ++it )
+         (*it)->Start();
+
+      cout << "Simulating " << s_settings.m_meters << (s_settings.m_isC1222 ? " C12.22" : " C12.18") << " devices over " << transport
+           << ". Press Ctrl-C to stop." << endl;
+      int previousRequests = 0;
+      Muint64 startTime = MTimer::GetTickCount64();
+      for ( unsigned second = 1; !s_isStopped && (s_settings.m_duration == 0 || second <= s_settings.m_duration); ++second )
+      {
+         MUtilities::Sleep(1000);
+         const int requests = s_statistics.m_requests;
+         cout << "requests/s: " << (requests - previousRequests)
+              << ", sessions: " << int(s_statistics.m_sessions)
+              << ", failed sessions: " << int(s_statistics.m_sessionsFailed)
+              << ", injected errors: " << int(s_statistics.m_errorsInjected);
+         if ( s_settings.m_clients > 0 )
+            cout << ", client sessions: " << int(s_statistics.m_clientSessions)
+                 << ", client failures: " << int(s_statistics.m_clientSessionsFailed);
+         cout << endl;
+         previousRequests = requests;
+      }
+      s_isStopped = 1;
+
+      const double seconds = double(MTimer::GetTickCount64() - startTime) / 1000.0;
+      for ( unsigned i = 0; i < threads.size(); ++i )
+      {
+         if ( i == s_settings.m_clients )
+            s_areServersStopped = true;
+         delete threads[i]; // wait for every thread to finish
+      }
+      s_areServersStopped = true;
+      listener.Stop();
+      factory.Stop();
+      udpServer.Stop();
+
+      cout << "Total requests: " << int(s_statistics.m_requests)
+           << ", average requests/s: " << MMath::Round(double(int(s_statistics.m_requests)) / seconds, 1) << endl;
+   }
+   catch ( MException& ex )
+   {
+      cerr << "ERROR: " << ex.AsString() << endl;
+      return EXIT_FAILURE;
+   }
+   return EXIT_SUCCESS;
+}
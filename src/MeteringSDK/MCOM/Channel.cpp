@@ -4,6 +4,7 @@
 #include "Channel.h"
 #include "MCOMExceptions.h"
 #include "MCOMFactory.h"
+#include "SessionTrace.h"
 
 M_START_PROPERTIES(Channel)
    M_OBJECT_PROPERTY_PERSISTENT_BOOL     (Channel, AutoAnswer,             false)
@@ -25,6 +26,9 @@ M_START_PROPERTIES(Channel)
 M_START_METHODS(Channel)
    M_OBJECT_SERVICE                      (Channel, WriteBytes,                        ST_X_constMByteStringA)
    M_OBJECT_SERVICE                      (Channel, WriteByte,                         ST_X_byte)
+   M_OBJECT_SERVICE                      (Channel, BeginWriteCoalescing,              ST_X)
+   M_OBJECT_SERVICE                      (Channel, EndWriteCoalescing,                ST_X)
+   M_OBJECT_SERVICE                      (Channel, FlushCoalescedWrites,              ST_X)
    M_OBJECT_SERVICE                      (Channel, ReadByte,                          ST_byte_X)
    M_OBJECT_SERVICE                      (Channel, Unread,                            ST_X_constMVariantA)
    M_OBJECT_SERVICE                      (Channel, ReadBytes,                         ST_MByteString_X_unsigned)
@@ -57,7 +61,9 @@ MChannel::MChannel()
    m_cancelCommunication(0),
    m_countBytesSent(0u),
    m_countBytesReceived(0u),
-   m_unreadBuffer()
+   m_unreadBuffer(),
+   m_writeStaging(),
+   m_writeCoalescingLevel(0)
 {
    M_SET_PERSISTENT_PROPERTIES_TO_DEFAULT(Channel);
 }
@@ -211,6 +217,9 @@ unsigned MChannel::DoReadCancellable(char* buf, unsigned size, unsigned timeout,
 {
    unsigned result = 0;
 
+   if ( !m_writeStaging.empty() ) // reading is a turnaround point, send everything the party shall have
+      DoWriteStagedBytes(false);
+
    if ( (int)timeout < 0 )
       timeout = INT_MAX; // the below code works with signed integers
 
@@ -249,6 +258,8 @@ unsigned MChannel::DoReadCancellable(char* buf, unsigned size, unsigned timeout,
          break;
       }
       CheckIfOperationIsCancelled();
+      if ( DoIsReadTimeoutInstant() )
+         break;
 
       remainingTimeout = endTime - MUtilities::GetTickCount();
       if ( (int)remainingTimeout <= 0 )
@@ -272,6 +283,9 @@ unsigned MChannel::ReadWithTimeout(char* buf, unsigned size, unsigned timeout)
 {
    CheckIfConnected();
    CheckIfOperationIsCancelled();
+   #if !M_NO_MCOM_SESSION_TRACE
+      MSessionTraceSpan span("channel", "Read");
+   #endif
 
    unsigned actualSize = 0;
    if ( size != 0 )
@@ -313,6 +327,10 @@ unsigned MChannel::ReadWithTimeout(char* buf, unsigned size, unsigned timeout)
          }
       }
    }
+   #if !M_NO_MCOM_SESSION_TRACE
+      if ( actualSize == size ) // partial read is a timeout
+         span.SetSucceeded();
+   #endif
    return actualSize;
 }
 
@@ -382,6 +400,8 @@ void MChannel::DoInitChannel()
    m_cancelCommunicationGuard = 0;
 
    m_unreadBuffer.clear();
+   m_writeStaging.clear();
+   m_writeCoalescingLevel = 0;
 
    #if !M_NO_MCOM_MONITOR
       if ( m_monitor != NULL ) // don't check for m_monitor->IsListening here!
@@ -407,88 +427,169 @@ void MChannel::ClearInputUntilSilence(unsigned milliseconds)
       ;
 }
 
+   // Portion of bytes requested from the channel at once by read-until services.
+   // Bytes received past the terminator are returned into the unread buffer.
+   //
+   const unsigned s_readAheadChunkSize = 256u;
+
+   // Find the first occurrence of the given byte sequence within the range, return end if there is none.
+   //
+   inline const char* DoFindSequence(const char* it, const char* itEnd, const char* sequence, unsigned sequenceSize)
+   {
+      M_ASSERT(sequenceSize > 0);
+      const char first = *sequence;
+      while ( unsigned(itEnd - it) >= sequenceSize )
+      {
+         const char* found = static_cast<const char*>(memchr(it, first, unsigned(itEnd - it) - sequenceSize + 1));
+         if ( found == NULL )
+            break;
+         if ( memcmp(found + 1, sequence + 1, sequenceSize - 1) == 0 )
+            return found;
+         it = found + 1;
+      }
+      return itEnd;
+   }
+
 MByteString MChannel::ReadBytesUntil(const MByteString& terminatingString)
 {
    MByteString result;
-   if ( !terminatingString.empty() ) // otherwise return immediately
+   const unsigned terminatingSize = unsigned(terminatingString.size());
+   if ( terminatingSize != 0 ) // otherwise return immediately
    {
-      result = ReadBytes(unsigned(terminatingString.size()));
-
-      MChannel::ReadTimeoutSavior timeoutSavior(this, m_intercharacterTimeout);
-      const char finisher = *terminatingString.begin();
-      if ( terminatingString.size() == 1 ) // a usual case, handle it efficiently
+      CheckIfConnected();
+      CheckIfOperationIsCancelled();
+      #if !M_NO_MCOM_SESSION_TRACE
+         MSessionTraceSpan span("channel", "ReadUntil");
+      #endif
+
+      const char* const terminating = terminatingString.data();
+      unsigned endTime = MUtilities::GetTickCount() + m_readTimeout;
+      unsigned timeout = m_readTimeout;
+      size_t searchPos = 0;
+      for ( ;; )
       {
-         for ( ;; )
+         DoReadAheadOrThrow(result, timeout, endTime);
+         const char* begin = result.data();
+         const char* end = begin + result.size();
+         const char* found = DoFindSequence(begin + searchPos, end, terminating, terminatingSize);
+         if ( found != end )
          {
-            if ( *result.rbegin() == finisher )
-               return result;
-            result += static_cast<char>(ReadByte());
+            DoUnreadSurplus(result, unsigned(found - begin) + terminatingSize);
+            #if !M_NO_MCOM_SESSION_TRACE
+               span.SetSucceeded();
+            #endif
+            break;
          }
+         if ( result.size() >= terminatingSize ) // terminator can still start within the last bytes read
+            searchPos = result.size() - terminatingSize + 1;
       }
-      else if ( terminatingString.find(finisher, 1) == MByteString::npos ) // if there is no finisher repeated in string
+   }
+   return result;
+}
+
+MByteString MChannel::ReadBytesUntilAnyByte(const char* finisher, unsigned finisherSize, unsigned headerSize, unsigned footerSize)
+{
+   M_ASSERT(finisherSize > 0);
+
+   CheckIfConnected();
+   CheckIfOperationIsCancelled();
+   #if !M_NO_MCOM_SESSION_TRACE
+      MSessionTraceSpan span("channel", "ReadUntil");
+   #endif
+
+   bool isFinisher [ 256 ];
+   memset(isFinisher, 0, sizeof(isFinisher));
+   for ( unsigned i = 0; i < finisherSize; ++i )
+      isFinisher[static_cast<Muint8>(finisher[i])] = true;
+
+   MByteString result;
+   unsigned endTime = MUtilities::GetTickCount() + m_readTimeout;
+   unsigned timeout = m_readTimeout;
+   size_t searchPos = headerSize;
+   size_t totalSize = 0; // becomes nonzero when the finisher is found
+   do
+   {
+      DoReadAheadOrThrow(result, timeout, endTime);
+      if ( totalSize == 0 && result.size() > searchPos )
       {
-         const unsigned footerSize = (unsigned)terminatingString.size() - 1;
-         const char* const terminatingRemainder = terminatingString.data() + 1; // help the compiler figure out it does not change in the loop
-         do
+         const char* begin = result.data();
+         const char* end = begin + result.size();
+         const char* it = begin + searchPos;
+         if ( finisherSize == 1 )
          {
-            result += ReadBytesUntilAnyByte(&finisher, 1, 0, footerSize);
-         } while ( memcmp(result.data() + result.size() - footerSize, terminatingRemainder, footerSize) != 0 );
-      }
-      else // rare complex case, do it simple, but inefficiently
-      {
-#ifdef M_USE_USTL
-         while ( result.substr(result.size() - terminatingString.size(), terminatingString.size()).compare(terminatingString) != 0 )
-            result += static_cast<char>(ReadByte());
-#else
-         while ( result.compare(result.size() - terminatingString.size(), terminatingString.size(), terminatingString) != 0 )
-            result += static_cast<char>(ReadByte());
-#endif
+            it = static_cast<const char*>(memchr(it, *finisher, unsigned(end - it)));
+            if ( it == NULL )
+               it = end;
+         }
+         else
+         {
+            for ( ; it != end && !isFinisher[static_cast<Muint8>(*it)]; ++it )
+               ;
+         }
+         if ( it != end )
+            totalSize = size_t(it - begin) + 1 + footerSize;
+         else
+            searchPos = result.size();
       }
-   }
+   } while ( totalSize == 0 || result.size() < totalSize );
+
+   DoUnreadSurplus(result, unsigned(totalSize));
+   #if !M_NO_MCOM_SESSION_TRACE
+      span.SetSucceeded();
+   #endif
    return result;
 }
 
-   inline bool DoExistIn(char ch, const char* finisher, unsigned finisherSize)
+void MChannel::DoReadAheadOrThrow(MByteString& buffer, unsigned& timeout, unsigned endTime)
+{
+   const size_t oldSize = buffer.size();
+   buffer.resize(oldSize + s_readAheadChunkSize);
+   char* buff = const_cast<char*>(buffer.data()) + oldSize;
+
+   unsigned size;
+   if ( !m_unreadBuffer.empty() ) // serve bytes returned to the channel first, without waiting for more
    {
-      const char* it = finisher;
-      const char* itEnd = it + finisherSize;
-      for ( ; it != itEnd; ++it )
-         if ( *it == ch )
-            return true;
-      return false;
+      size = M_64_CAST(unsigned, m_unreadBuffer.size()) < s_readAheadChunkSize ? M_64_CAST(unsigned, m_unreadBuffer.size()) : s_readAheadChunkSize;
+      memcpy(buff, m_unreadBuffer.data(), size);
+      m_unreadBuffer.erase((size_t)0, (size_t)size);
    }
+   else
+      size = DoReadCancellable(buff, DoIsReadAheadAllowed() ? s_readAheadChunkSize : 1u, timeout, true);
+   buffer.resize(oldSize + size);
 
-MByteString MChannel::ReadBytesUntilAnyByte(const char* finisher, unsigned finisherSize, unsigned headerSize, unsigned footerSize)
-{
-   MByteString result;
+   if ( size == 0 )
+   {
+      MEChannelReadTimeout::Throw(M_64_CAST(unsigned, oldSize));
+      M_ENSURED_ASSERT(0);
+   }
 
-   result = ReadBytes(headerSize + footerSize + 1);
-   MChannel::ReadTimeoutSavior timeoutSavior(this, m_intercharacterTimeout);
-   if ( footerSize == 0 )
+   if ( m_intercharacterTimeout != 0 ) // regular timeout handling with intercharacter watch
+      timeout = m_intercharacterTimeout;
+   else // read timeout is responsible for the whole sequence
    {
-      while ( DoExistIn(*result.rbegin(), finisher, finisherSize) )
-         result += static_cast<char>(ReadByte());
+      int timeDiff = int(endTime - MUtilities::GetTickCount());
+      timeout = (timeDiff <= 0) ? 0u : unsigned(timeDiff);
    }
-   else
+}
+
+void MChannel::DoUnreadSurplus(MByteString& buffer, unsigned size)
+{
+   M_ASSERT(size <= buffer.size());
+   if ( buffer.size() > size )
    {
-      ++footerSize; // make footer size include finisher char
-      for ( ;; )
-      {
-         MByteString::const_iterator itEnd = result.end();
-         for ( MByteString::const_iterator it = itEnd - footerSize; it != itEnd; ++it )
-         {
-            if ( DoExistIn(*it, finisher, finisherSize) )
-            {
-               unsigned remainingBytes = footerSize - unsigned(itEnd - it);
-               if ( remainingBytes > 0 )
-                  result += ReadBytes(remainingBytes);
-               return result;
-            }
-         }
-         result += ReadBytes(footerSize);
-      }
+      m_unreadBuffer.insert((size_t)0, buffer.data() + size, buffer.size() - size);
+      buffer.resize(size);
    }
-   return result;
+}
+
+bool MChannel::DoIsReadAheadAllowed() const
+{
+   return true;
+}
+
+bool MChannel::DoIsReadTimeoutInstant() const
+{
+   return false;
 }
 
 void MChannel::WriteBytes(const MByteString &buf)
@@ -541,12 +642,107 @@ M_NORETURN_FUNC void MChannel::DoThrowCharactersNotEchoed()
 }
 
 void MChannel::WriteBuffer(const char* buf, unsigned len)
+{
+   Fragment fragment = { buf, len };
+   WriteBuffers(&fragment, 1);
+}
+
+void MChannel::WriteBuffers(const Fragment* fragments, unsigned count)
 {
    CheckIfConnected();
+   if ( m_writeCoalescingLevel > 0 )
+   {
+      for ( unsigned i = 0; i < count; ++i )
+         m_writeStaging.append(fragments[i].m_buffer, fragments[i].m_size);
+      if ( m_writeStaging.size() >= WRITE_COALESCING_LIMIT )
+         DoWriteStagedBytes(true); // the message continues
+   }
+   else
+   {
+      #if !M_NO_MCOM_SESSION_TRACE
+         MSessionTraceSpan span("channel", "Write");
+      #endif
+      DoWriteFragments(fragments, count, false);
+      #if !M_NO_MCOM_SESSION_TRACE
+         span.SetSucceeded();
+      #endif
+   }
+}
+
+void MChannel::BeginWriteCoalescing()
+{
+   CheckIfConnected();
+   ++m_writeCoalescingLevel;
+}
 
-   unsigned actualLen = DoWrite(buf, len);
-   if ( actualLen > 0 )
-      DoNotifyByteTX(buf, actualLen);
+void MChannel::EndWriteCoalescing()
+{
+   M_ASSERT(m_writeCoalescingLevel > 0);
+   if ( m_writeCoalescingLevel > 0 && --m_writeCoalescingLevel == 0 )
+      FlushCoalescedWrites();
+}
+
+void MChannel::FlushCoalescedWrites()
+{
+   if ( !m_writeStaging.empty() )
+   {
+      CheckIfConnected();
+      DoWriteStagedBytes(false);
+   }
+}
+
+void MChannel::DoWriteStagedBytes(bool more)
+{
+   #if !M_NO_MCOM_SESSION_TRACE
+      MSessionTraceSpan span("channel", "WriteCoalesced"); // staging the bytes is not traced, only sending them
+   #endif
+   MByteString staging;
+   staging.swap(m_writeStaging); // echo handling reads from the channel, make sure it sees no staged bytes
+   Fragment fragment = { staging.data(), static_cast<unsigned>(staging.size()) };
+   DoWriteFragments(&fragment, 1, more);
+   staging.clear();
+   staging.swap(m_writeStaging); // keep the allocated buffer for the bytes staged next
+   #if !M_NO_MCOM_SESSION_TRACE
+      span.SetSucceeded();
+   #endif
+}
+
+unsigned MChannel::DoWriteBuffers(const Fragment* fragments, unsigned count, bool)
+{
+   if ( count == 1 )
+      return DoWrite(fragments->m_buffer, fragments->m_size);
+
+   MByteString buffer;
+   for ( unsigned i = 0; i < count; ++i )
+      buffer.append(fragments[i].m_buffer, fragments[i].m_size);
+   return DoWrite(buffer.data(), M_64_CAST(unsigned, buffer.size()));
+}
+
+void MChannel::DoWriteFragments(const Fragment* fragments, unsigned count, bool more)
+{
+   if ( m_echo && count > 1 ) // echo is verified against one contiguous buffer
+   {
+      MByteString buffer;
+      for ( unsigned i = 0; i < count; ++i )
+         buffer.append(fragments[i].m_buffer, fragments[i].m_size);
+      Fragment fragment = { buffer.data(), static_cast<unsigned>(buffer.size()) };
+      DoWriteFragments(&fragment, 1, more);
+      return;
+   }
+
+   unsigned len = 0;
+   for ( unsigned i = 0; i < count; ++i )
+      len += fragments[i].m_size;
+
+   unsigned actualLen = (count == 1 && !more) ? DoWrite(fragments->m_buffer, len) : DoWriteBuffers(fragments, count, more);
+   unsigned notifyLen = actualLen;
+   for ( unsigned i = 0; i < count && notifyLen > 0; ++i )
+   {
+      unsigned fragmentLen = fragments[i].m_size < notifyLen ? fragments[i].m_size : notifyLen;
+      if ( fragmentLen > 0 )
+         DoNotifyByteTX(fragments[i].m_buffer, fragmentLen);
+      notifyLen -= fragmentLen;
+   }
 
    if ( actualLen != len )
    {
@@ -557,6 +753,8 @@ void MChannel::WriteBuffer(const char* buf, unsigned len)
 
    if ( m_echo ) // read the written characters back
    {
+      M_ASSERT(count == 1);
+      const char* buf = fragments->m_buffer;
       const unsigned echoBuffLen = 256;
       char echoBuff [ echoBuffLen ];
       for ( unsigned i = 0; ; )
@@ -584,6 +782,9 @@ void MChannel::WriteBuffer(const char* buf, unsigned len)
 
 void MChannel::Sleep(unsigned milliseconds)
 {
+   #if !M_NO_MCOM_SESSION_TRACE
+      MSessionTraceSpan span("channel", "Sleep");
+   #endif
    if ( milliseconds <= CANCEL_COMMUNICATION_CHECK_OPTIMUM_INTERVAL )
    {
       MUtilities::Sleep(milliseconds);
@@ -612,6 +813,9 @@ void MChannel::Sleep(unsigned milliseconds)
          nextTimeMark += CANCEL_COMMUNICATION_CHECK_OPTIMUM_INTERVAL;
       }
    }
+   #if !M_NO_MCOM_SESSION_TRACE
+      span.SetSucceeded();
+   #endif
 }
 
 void MChannel::DoClearInputBuffer()
@@ -22,11 +22,20 @@ public: // Constants:
 
    enum
    {
-      CANCEL_COMMUNICATION_CHECK_OPTIMUM_INTERVAL = 1000 ///< How often in milliseconds to check for the communication to cancel.
+      CANCEL_COMMUNICATION_CHECK_OPTIMUM_INTERVAL = 1000, ///< How often in milliseconds to check for the communication to cancel.
+      WRITE_COALESCING_LIMIT = 0x4000                     ///< Number of staged bytes at which the coalesced output is sent even before flush.
    };
 
 public:  // Types
 
+   /// Fragment of data given to \ref WriteBuffers, an equivalent of the system iovec structure.
+   ///
+   struct Fragment
+   {
+      const char* m_buffer; ///< Pointer to the first byte of the fragment.
+      unsigned m_size;      ///< Number of bytes in the fragment.
+   };
+
    /// Uninterruptible communication C++ wrapper.
    ///
    class UninterruptibleCommunication
@@ -265,6 +274,47 @@ public: // Destructor and services
    ///
    void WriteBuffer(const char* buf, unsigned len);
 
+   /// Writes several fragments of data to the channel as one sequence of bytes.
+   ///
+   /// This is a gathering variant of WriteBuffer, which allows sending a message assembled
+   /// from several buffers, such as a header and a body, without copying them together.
+   /// Socket channels send all fragments with a single system call, so the message
+   /// goes out in one segment when it fits.
+   ///
+   /// \pre The channel is open, otherwise the operation fails
+   /// with an exception. The fragments are initialized correctly,
+   /// otherwise the behavior is undefined.
+   ///
+   /// \param fragments Array of fragments to write, in order.
+   /// \param count Number of elements in the array.
+   ///
+   void WriteBuffers(const Fragment* fragments, unsigned count);
+
+   /// Start staging the written bytes in the channel instead of sending them immediately.
+   ///
+   /// This allows a protocol to send several small writes, such as an acknowledgement
+   /// followed by a packet, within a single write operation. The staged bytes are sent
+   /// at \ref FlushCoalescedWrites, at the outermost \ref EndWriteCoalescing,
+   /// and always before the channel reads anything, as reading is the turnaround point
+   /// at which the other party shall have the whole message.
+   /// The matching pairs of Begin and End calls can be nested.
+   ///
+   /// \pre The channel is open, otherwise the operation fails with an exception.
+   ///
+   void BeginWriteCoalescing();
+
+   /// End staging the written bytes that was started by \ref BeginWriteCoalescing.
+   ///
+   /// When this call matches the outermost BeginWriteCoalescing, all staged bytes are sent.
+   ///
+   void EndWriteCoalescing();
+
+   /// Send the bytes staged since \ref BeginWriteCoalescing, if there are any.
+   ///
+   /// The channel continues to stage the bytes written after this call.
+   ///
+   void FlushCoalescedWrites();
+
    /// Read a single byte from the channel.
    ///
    /// \pre The channel is open, otherwise the
@@ -317,6 +367,9 @@ public: // Destructor and services
 
    /// Read bytes from the channel until a specified sequence is read.
    ///
+   /// Bytes are requested from the channel in chunks, and those received past
+   /// the terminating sequence are kept by the channel for the next read operation.
+   ///
    /// \pre The channel is open, otherwise the operation fails with an exception.
    ///
    /// \seeprop{GetIntercharacterTimeout,IntercharacterTimeout} - the number of
@@ -324,7 +377,11 @@ public: // Destructor and services
    ///
    MByteString ReadBytesUntil(const MByteString& terminatingString);
 
-   /// Read bytes from the channel until a specified sequence is read.
+   /// Read bytes from the channel until any of the given finisher bytes is read, plus the footer.
+   ///
+   /// The finisher is looked for only after the first headerSize bytes,
+   /// and footerSize bytes that follow the finisher are also read.
+   /// Bytes received past the footer are kept by the channel for the next read operation.
    ///
    /// \pre The channel is open, otherwise the operation fails with an exception.
    ///
@@ -893,9 +950,45 @@ protected: // Methods:
    virtual void DoClearInputBuffer();
 
    virtual unsigned DoWrite(const char* buf, unsigned len) = 0;
+
+   // Write the given fragments with a single operation, return the number of bytes written.
+   // The default implementation writes a single fragment as is, and concatenates several fragments.
+   // Parameter more is a hint that the message continues in the next write.
+   //
+   virtual unsigned DoWriteBuffers(const Fragment* fragments, unsigned count, bool more);
+
+   // Write the fragments through the medium, notify the monitor, and handle echo.
+   //
+   void DoWriteFragments(const Fragment* fragments, unsigned count, bool more);
+
+   // Write all bytes staged by write coalescing.
+   //
+   void DoWriteStagedBytes(bool more);
    virtual unsigned DoRead(char* buf, unsigned len, unsigned timeout) = 0;
    unsigned DoReadCancellable(char* buf, unsigned size, unsigned timeout, bool sendToMonitor);
 
+   // Whether DoRead returns as soon as any bytes are available, rather than waiting
+   // for the whole requested size or for the intercharacter timeout to expire.
+   // When true, read-until services request bytes in chunks and return the surplus
+   // past the terminator into the unread buffer, otherwise they read byte by byte.
+   //
+   virtual bool DoIsReadAheadAllowed() const;
+
+   // Whether the read timeout elapses at once after DoRead returns no bytes, as no bytes can come in the current state.
+   // Such channels return zero from DoRead without waiting, and the read does not poll them until the timeout expires.
+   // By default, bytes can come any time, and the read lasts for the whole timeout.
+   //
+   virtual bool DoIsReadTimeoutInstant() const;
+
+   // Append the next chunk of available bytes to the buffer, or throw read timeout if none arrive.
+   // Timeout is updated for the next read according to intercharacter timeout handling.
+   //
+   void DoReadAheadOrThrow(MByteString& buffer, unsigned& timeout, unsigned endTime);
+
+   // Shrink the buffer to the given size, returning the extra bytes read into the unread buffer.
+   //
+   void DoUnreadSurplus(MByteString& buffer, unsigned size);
+
    void DoInitChannel();
 
 protected: // Attributes:
@@ -970,6 +1063,14 @@ protected: // Attributes:
    //
    MByteString m_unreadBuffer;
 
+   // Bytes written while write coalescing is active, and not yet sent.
+   //
+   MByteString m_writeStaging;
+
+   // Nesting level of BeginWriteCoalescing calls, zero if the written bytes are sent immediately.
+   //
+   int m_writeCoalescingLevel;
+
    M_DECLARE_CLASS(Channel)
 
 /// \endcond SHOW_INTERNAL
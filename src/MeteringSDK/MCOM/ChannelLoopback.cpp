@@ -0,0 +1,364 @@
+// File MCOM/ChannelLoopback.cpp
+
+#include "MCOMExtern.h"
+#include "ChannelLoopback.h"
+#include "MCOMExceptions.h"
+#include "SessionTrace.h"
+#include <MCORE/MEvent.h>
+#include <MCORE/MTimer.h>
+
+#if !M_NO_MCOM_CHANNEL_LOOPBACK
+
+   // Memory link between two loopback channels, sides zero and one
+   //
+   class MChannelLoopbackLink
+   {
+   public: // Types:
+
+      enum SideStateEnum
+      {
+         SideNotConnected,
+         SideConnected,
+         SideDisconnected
+      };
+
+      // Bytes written by one side, not yet read by the other
+      //
+      struct Packet
+      {
+         Muint64 m_deliveryTick;
+         MByteString m_bytes;
+      };
+      typedef std::deque<Packet>
+         PacketQueue;
+
+   public: // Constructor:
+
+      MChannelLoopbackLink(const MStdString& name)
+      :
+         m_name(name),
+         m_referenceCount(1)
+      {
+         for ( unsigned side = 0; side < 2; ++side )
+         {
+            m_state[side] = SideNotConnected;
+            m_frontOffset[side] = 0;
+            m_transferEndTick[side] = 0;
+         }
+         m_state[0] = SideConnected;
+      }
+
+   public: // Methods:
+
+      // Copy the bytes that are due for delivery into the buffer.
+      // When nothing is due, adjust the wake up tick to the time the next packet is due.
+      //
+      unsigned TakeBytes(unsigned side, char* buf, unsigned len, Muint64 now, Muint64& wakeUpTick)
+      {
+         PacketQueue& queue = m_queues[side];
+         unsigned result = 0;
+         while ( result < len && !queue.empty() )
+         {
+            Packet& packet = queue.front();
+            if ( packet.m_deliveryTick > now )
+            {
+               if ( result == 0 && packet.m_deliveryTick < wakeUpTick )
+                  wakeUpTick = packet.m_deliveryTick;
+               break;
+            }
+            size_t& offset = m_frontOffset[side];
+            unsigned size = static_cast<unsigned>(packet.m_bytes.size() - offset);
+            if ( size > len - result )
+               size = len - result;
+            memcpy(buf + result, packet.m_bytes.data() + offset, size);
+            result += size;
+            offset += size;
+            if ( offset == packet.m_bytes.size() )
+            {
+               queue.pop_front();
+               offset = 0;
+            }
+         }
+         return result;
+      }
+
+      void ClearBytes(unsigned side)
+      {
+         m_queues[side].clear();
+         m_frontOffset[side] = 0;
+      }
+
+   public: // Attributes:
+
+      // Guards everything in the link, except the events
+      //
+      MCriticalSection m_lock;
+
+      // Signaled when bytes arrive for the corresponding side
+      //
+      MEvent m_dataEvent[2];
+
+      // Bytes to be read by the corresponding side
+      //
+      PacketQueue m_queues[2];
+
+      // Number of bytes already read from the front packet of the corresponding queue
+      //
+      size_t m_frontOffset[2];
+
+      // When the transfer of bytes into the corresponding side ends, bandwidth emulation
+      //
+      Muint64 m_transferEndTick[2];
+
+      // State of each side
+      //
+      SideStateEnum m_state[2];
+
+      // Name of the link, a key in the registry of links that wait for the second side
+      //
+      MStdString m_name;
+
+      // How many channels refer to this link
+      //
+      unsigned m_referenceCount;
+   };
+
+   typedef std::map<MStdString, MChannelLoopbackLink*>
+      LoopbackLinkMap;
+
+   // Links that have side zero connected, and side one not yet
+   //
+   static LoopbackLinkMap s_waitingLinks;
+   static MCriticalSection s_waitingLinksLock;
+
+   // Seed of loss generator, the same at every connect so the runs are repeatable
+   //
+   static const Muint32 s_lossRandomSeed = 0x9E3779B9u;
+
+   static const double s_defaultLossProbability = 0.0;
+
+M_START_PROPERTIES(ChannelLoopback)
+   M_OBJECT_PROPERTY_PERSISTENT_STRING  (ChannelLoopback, LoopbackName,     "LOOPBACK", ST_constMStdStringA_X, ST_X_constMStdStringA)
+   M_OBJECT_PROPERTY_PERSISTENT_UINT    (ChannelLoopback, Latency,          0)
+   M_OBJECT_PROPERTY_PERSISTENT_UINT    (ChannelLoopback, Bandwidth,        0)
+   M_OBJECT_PROPERTY_PERSISTENT_DOUBLE  (ChannelLoopback, LossProbability,  s_defaultLossProbability)
+   M_OBJECT_PROPERTY_READONLY_BOOL_EXACT(ChannelLoopback, IsPaired)
+M_START_METHODS(ChannelLoopback)
+   M_OBJECT_SERVICE                     (ChannelLoopback, WaitUntilPaired, ST_bool_X_unsigned)
+M_END_CLASS_TYPED(ChannelLoopback, Channel, "CHANNEL_LOOPBACK")
+
+MChannelLoopback::MChannelLoopback()
+:
+   MChannel(),
+   m_link(NULL),
+   m_side(0),
+   m_loopbackName(),
+   m_latency(0),
+   m_bandwidth(0),
+   m_lossProbability(0.0),
+   m_lossRandomState(s_lossRandomSeed)
+{
+   M_SET_PERSISTENT_PROPERTIES_TO_DEFAULT(ChannelLoopback);
+}
+
+MChannelLoopback::~MChannelLoopback()
+{
+   Disconnect();
+}
+
+void MChannelLoopback::SetLossProbability(double probability)
+{
+   MENumberOutOfRange::CheckNamedRange(0.0, 1.0, probability, M_OPT_STR("LOSS_PROBABILITY"));
+   m_lossProbability = probability;
+}
+
+void MChannelLoopback::Connect()
+{
+   #if !M_NO_MCOM_SESSION_TRACE
+      MSessionTraceSpan span("channel", "Connect");
+   #endif
+   MChannel::Connect();
+
+   M_ASSERT(m_link == NULL);
+   m_lossRandomState = s_lossRandomSeed;
+
+   MCriticalSection::Locker locker(s_waitingLinksLock);
+   LoopbackLinkMap::iterator it = s_waitingLinks.find(m_loopbackName);
+   if ( it != s_waitingLinks.end() )
+   {
+      m_link = it->second;
+      m_side = 1;
+      s_waitingLinks.erase(it);
+
+      MCriticalSection::Locker linkLocker(m_link->m_lock);
+      m_link->m_state[1] = MChannelLoopbackLink::SideConnected;
+      ++m_link->m_referenceCount;
+      m_link->m_dataEvent[0].Set(); // wake up the first side if it waits until paired
+   }
+   else
+   {
+      m_link = M_NEW MChannelLoopbackLink(m_loopbackName);
+      m_side = 0;
+      s_waitingLinks.insert(LoopbackLinkMap::value_type(m_loopbackName, m_link));
+   }
+
+   DoNotifyConnect();
+   #if !M_NO_MCOM_SESSION_TRACE
+      span.SetSucceeded(); // the peer is connected
+   #endif
+}
+
+void MChannelLoopback::Disconnect()
+{
+   m_unreadBuffer.clear();
+   if ( m_link != NULL )
+   {
+      MChannelLoopbackLink* link = m_link;
+      m_link = NULL;
+
+      bool deleteLink;
+      {
+         MCriticalSection::Locker locker(s_waitingLinksLock);
+         LoopbackLinkMap::iterator it = s_waitingLinks.find(link->m_name);
+         if ( it != s_waitingLinks.end() && it->second == link ) // peer never came
+            s_waitingLinks.erase(it);
+
+         MCriticalSection::Locker linkLocker(link->m_lock);
+         link->m_state[m_side] = MChannelLoopbackLink::SideDisconnected;
+         link->ClearBytes(m_side);
+         deleteLink = --link->m_referenceCount == 0;
+         if ( !deleteLink )
+            link->m_dataEvent[1 - m_side].Set(); // wake up the peer reader so it sees the disconnect
+      }
+      if ( deleteLink )
+         delete link;
+
+      DoNotifyDisconnect();
+   }
+}
+
+bool MChannelLoopback::IsConnected() const
+{
+   return m_link != NULL;
+}
+
+bool MChannelLoopback::IsPaired() const
+{
+   if ( m_link == NULL )
+      return false;
+   MCriticalSection::Locker locker(m_link->m_lock);
+   return m_link->m_state[1 - m_side] == MChannelLoopbackLink::SideConnected;
+}
+
+bool MChannelLoopback::WaitUntilPaired(unsigned timeout)
+{
+   CheckIfConnected();
+
+   Muint64 now = MTimer::GetTickCount64();
+   const Muint64 endTick = now + timeout;
+   for ( ;; )
+   {
+      {
+         MCriticalSection::Locker locker(m_link->m_lock);
+         if ( m_link->m_state[1 - m_side] != MChannelLoopbackLink::SideNotConnected ) // the peer came, possibly left already
+            return true;
+      }
+      if ( now >= endTick )
+         return false;
+      m_link->m_dataEvent[m_side].LockWithTimeout(static_cast<long>(endTick - now));
+      now = MTimer::GetTickCount64();
+   }
+}
+
+void MChannelLoopback::FlushOutputBuffer(unsigned)
+{
+}
+
+MStdString MChannelLoopback::GetMediaIdentification() const
+{
+   MStdString result("LOOPBACK:", 9);
+   result += m_loopbackName;
+   return result;
+}
+
+void MChannelLoopback::DoClearInputBuffer()
+{
+   m_unreadBuffer.clear();
+   if ( m_link != NULL )
+   {
+      MCriticalSection::Locker locker(m_link->m_lock);
+      m_link->ClearBytes(m_side);
+   }
+}
+
+unsigned MChannelLoopback::DoWrite(const char* buf, unsigned len)
+{
+   CheckIfConnected();
+
+   if ( m_lossProbability > 0.0 ) // xorshift32, repeatable sequence
+   {
+      m_lossRandomState ^= m_lossRandomState << 13;
+      m_lossRandomState ^= m_lossRandomState >> 17;
+      m_lossRandomState ^= m_lossRandomState << 5;
+      if ( m_lossRandomState / 4294967296.0 < m_lossProbability )
+         return len; // lost on the way
+   }
+
+   const unsigned peer = 1 - m_side;
+   {
+      MCriticalSection::Locker locker(m_link->m_lock);
+      if ( m_link->m_state[peer] == MChannelLoopbackLink::SideDisconnected )
+         return len; // nobody is listening, like a half closed socket
+
+      Muint64 deliveryTick = 0;
+      if ( m_bandwidth != 0 || m_latency != 0 )
+      {
+         deliveryTick = MTimer::GetTickCount64();
+         if ( m_bandwidth != 0 )
+         {
+            if ( deliveryTick < m_link->m_transferEndTick[peer] )
+               deliveryTick = m_link->m_transferEndTick[peer];
+            deliveryTick += (static_cast<Muint64>(len) * 1000u + m_bandwidth - 1) / m_bandwidth;
+            m_link->m_transferEndTick[peer] = deliveryTick;
+         }
+         deliveryTick += m_latency;
+      }
+
+      MChannelLoopbackLink::PacketQueue& queue = m_link->m_queues[peer];
+      queue.push_back(MChannelLoopbackLink::Packet());
+      MChannelLoopbackLink::Packet& packet = queue.back();
+      packet.m_deliveryTick = deliveryTick;
+      packet.m_bytes.assign(buf, len);
+   }
+   m_link->m_dataEvent[peer].Set();
+   return len;
+}
+
+unsigned MChannelLoopback::DoRead(char* buf, unsigned len, unsigned timeout)
+{
+   CheckIfConnected();
+
+   Muint64 now = MTimer::GetTickCount64();
+   const Muint64 endTick = now + timeout;
+   for ( ;; )
+   {
+      Muint64 wakeUpTick = endTick;
+      {
+         MCriticalSection::Locker locker(m_link->m_lock);
+         const unsigned result = m_link->TakeBytes(m_side, buf, len, now, wakeUpTick);
+         if ( result > 0 )
+            return result;
+         if ( m_link->m_state[1 - m_side] == MChannelLoopbackLink::SideDisconnected && m_link->m_queues[m_side].empty() )
+         {
+            MEChannelDisconnectedUnexpectedly::Throw(); // like a socket closed by peer
+            M_ENSURED_ASSERT(0);
+         }
+      }
+      if ( now >= endTick )
+         return 0;
+      m_link->m_dataEvent[m_side].LockWithTimeout(static_cast<long>(wakeUpTick - now));
+      now = MTimer::GetTickCount64();
+   }
+}
+
+#endif // !M_NO_MCOM_CHANNEL_LOOPBACK
@@ -0,0 +1,203 @@
+#ifndef MCOM_CHANNELLOOPBACK_H
+#define MCOM_CHANNELLOOPBACK_H
+/// \addtogroup MCOM
+///@{
+/// \file MCOM/ChannelLoopback.h
+
+#include <MCOM/MCOMDefs.h>
+#include <MCOM/Channel.h>
+
+#if !M_NO_MCOM_CHANNEL_LOOPBACK
+
+class MChannelLoopbackLink;
+
+/// In-process channel that talks to its peer loopback channel through memory queues.
+///
+/// Two loopback channels with the same \refprop{GetLoopbackName,LoopbackName} become
+/// a connected pair once both of them are connected: whatever is written into one of them
+/// is read from the other one. This way, a client protocol and a server protocol can talk
+/// to each other within a single process without involving any operating system I/O,
+/// which is the way to measure the overhead of the protocol stack alone.
+/// Bytes written before the peer connects are kept until the peer reads them.
+/// Once the peer disconnects, and all its bytes are read, the read throws MEChannelDisconnectedUnexpectedly,
+/// the same way a socket channel does when the connection is closed by peer.
+///
+/// Optionally, the channel can emulate a slow or unreliable medium.
+/// \refprop{GetLatency,Latency}, \refprop{GetBandwidth,Bandwidth} and \refprop{GetLossProbability,LossProbability}
+/// apply to the bytes written by the channel that has them set.
+/// The losses are pseudo-random, but the sequence is repeated at every connect,
+/// so benchmark runs are deterministic.
+///
+/// The channel can be created by MCOMFactory with the type name "CHANNEL_LOOPBACK", for example:
+/// \code
+///     client = MCOMFactory.CreateProtocol("TYPE=CHANNEL_LOOPBACK;LOOPBACK_NAME=bench", "PROTOCOL_ANSI_C12_18")
+///     server = MCOMFactory.CreateProtocol("TYPE=CHANNEL_LOOPBACK;LOOPBACK_NAME=bench", "PROTOCOL_ANSI_C12_18")
+/// \endcode
+///
+class MCOM_CLASS MChannelLoopback : public MChannel
+{
+public: // Constructor, destructor:
+
+   /// Construct the loopback channel.
+   ///
+   MChannelLoopback();
+
+   /// Destructor, disconnects the channel.
+   ///
+   virtual ~MChannelLoopback();
+
+public: // Services:
+
+   /// Connect the channel, and pair it with the peer that has the same loopback name.
+   ///
+   /// If there is no such peer yet, the channel is connected, and it will get paired
+   /// when the peer connects. Only two channels can be paired, the third channel
+   /// with the same name will start a new pair.
+   ///
+   virtual void Connect();
+
+   /// Disconnect the channel from its peer, and discard the bytes that were not read.
+   ///
+   virtual void Disconnect();
+
+   /// Whether the channel is connected.
+   ///
+   virtual bool IsConnected() const;
+
+   /// There is no output buffer in loopback channel, this call does nothing.
+   ///
+   virtual void FlushOutputBuffer(unsigned numberOfCharsInBuffer = UINT_MAX);
+
+   /// Return a string that identifies the media through which this channel is talking.
+   ///
+   /// For loopback channel this is LOOPBACK string followed by the loopback name.
+   ///
+   virtual MStdString GetMediaIdentification() const;
+
+public: // Property handling routines:
+
+   ///@{
+   /// Name that identifies a pair of loopback channels.
+   ///
+   /// \default_value "LOOPBACK"
+   ///
+   const MStdString& GetLoopbackName() const
+   {
+      return m_loopbackName;
+   }
+   void SetLoopbackName(const MStdString& name)
+   {
+      m_loopbackName = name;
+   }
+   ///@}
+
+   ///@{
+   /// Emulated delay in milliseconds after which the written bytes become available to the peer.
+   ///
+   /// \default_value 0, no delay.
+   ///
+   unsigned GetLatency() const
+   {
+      return m_latency;
+   }
+   void SetLatency(unsigned milliseconds)
+   {
+      m_latency = milliseconds;
+   }
+   ///@}
+
+   ///@{
+   /// Emulated bandwidth of the medium in bytes per second, zero means unlimited.
+   ///
+   /// When nonzero, the written bytes become available to the peer after the time it takes to transfer them,
+   /// counted since the previous written bytes are transferred.
+   ///
+   /// \default_value 0, unlimited.
+   ///
+   unsigned GetBandwidth() const
+   {
+      return m_bandwidth;
+   }
+   void SetBandwidth(unsigned bytesPerSecond)
+   {
+      m_bandwidth = bytesPerSecond;
+   }
+   ///@}
+
+   ///@{
+   /// Probability in range 0 to 1 that a single write is lost, never delivered to the peer.
+   ///
+   /// \default_value 0, no losses.
+   ///
+   double GetLossProbability() const
+   {
+      return m_lossProbability;
+   }
+   void SetLossProbability(double probability);
+   ///@}
+
+   /// Whether the peer channel is connected to this channel.
+   ///
+   bool IsPaired() const;
+
+   /// Wait until the peer channel connects to this channel.
+   ///
+   /// This is how the side that connects first, typically a server, learns that the client came,
+   /// without polling \ref IsPaired.
+   ///
+   /// \param timeout
+   ///    Time to wait in milliseconds.
+   ///
+   /// \return True if the peer has connected, even if it has disconnected since then.
+   ///    False if the timeout expired before the peer came.
+   ///
+   /// \pre The channel is connected, otherwise an exception is thrown.
+   ///
+   bool WaitUntilPaired(unsigned timeout);
+
+protected: // Methods:
+/// \cond SHOW_INTERNAL
+
+   virtual void DoClearInputBuffer();
+   virtual unsigned DoWrite(const char* buf, unsigned len);
+   virtual unsigned DoRead(char* buf, unsigned len, unsigned timeout);
+
+private: // Attributes:
+
+   // Link shared with the peer, NULL when the channel is not connected
+   //
+   MChannelLoopbackLink* m_link;
+
+   // Index of this channel within the link, zero or one
+   //
+   unsigned m_side;
+
+   // Name that identifies a pair of channels
+   //
+   MStdString m_loopbackName;
+
+   // Emulated latency in milliseconds
+   //
+   unsigned m_latency;
+
+   // Emulated bandwidth in bytes per second, or zero
+   //
+   unsigned m_bandwidth;
+
+   // Probability of loss of a single write
+   //
+   double m_lossProbability;
+
+   // State of the pseudo-random generator of losses
+   //
+   Muint32 m_lossRandomState;
+
+/// \endcond SHOW_INTERNAL
+
+   M_DECLARE_CLASS(ChannelLoopback)
+};
+
+#endif // !M_NO_MCOM_CHANNEL_LOOPBACK
+
+///@}
+#endif
@@ -3,6 +3,7 @@
 #include "MCOMExtern.h"
 #include "ChannelModem.h"
 #include "MCOMExceptions.h"
+#include "SessionTrace.h"
 #include <MCORE/MTimer.h>
 
 #if !M_NO_MCOM_CHANNEL_MODEM
@@ -120,6 +121,9 @@ M_NORETURN_FUNC void MChannelModem::DoThrowModemResponseError(MChannelModem::MMo
 
 void MChannelModem::Connect()
 {
+   #if !M_NO_MCOM_SESSION_TRACE
+      MSessionTraceSpan span("channel", "Connect");
+   #endif
    m_modemResponse.clear();
    MChannel::Connect();
 
@@ -168,6 +172,9 @@ void MChannelModem::Connect()
       }
    }
    m_connectCalled = true;
+   #if !M_NO_MCOM_SESSION_TRACE
+      span.SetSucceeded(); // the peer is connected
+   #endif
 }
 
 void MChannelModem::DoAdjustModemAfterConnect()
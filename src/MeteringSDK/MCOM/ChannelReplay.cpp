@@ -0,0 +1,272 @@
+// File MCOM/ChannelReplay.cpp
+
+#include "MCOMExtern.h"
+#include "ChannelReplay.h"
+#include "MCOMExceptions.h"
+#include "LogFileReader.h"
+#include "Monitor.h"
+#include "SessionTrace.h"
+#include <MCORE/MTimer.h>
+
+#if !M_NO_MCOM_CHANNEL_REPLAY
+
+M_START_PROPERTIES(ChannelReplay)
+   M_OBJECT_PROPERTY_PERSISTENT_STRING  (ChannelReplay, FileName,      "", ST_constMStdStringA_X, ST_X_constMStdStringA)
+   M_OBJECT_PROPERTY_PERSISTENT_BOOL    (ChannelReplay, RecordedPace,  false)
+   M_OBJECT_PROPERTY_PERSISTENT_BOOL    (ChannelReplay, VerifyWrites,  true)
+   M_OBJECT_PROPERTY_READONLY_UINT      (ChannelReplay, SessionCount)
+   M_OBJECT_PROPERTY_READONLY_BOOL_EXACT(ChannelReplay, IsSessionComplete)
+M_START_METHODS(ChannelReplay)
+   M_OBJECT_SERVICE                     (ChannelReplay, LoadSessions,  ST_unsigned_X)
+M_END_CLASS_TYPED(ChannelReplay, Channel, "CHANNEL_REPLAY")
+
+MChannelReplay::MChannelReplay()
+:
+   MChannel(),
+   m_fileName(),
+   m_recordedPace(false),
+   m_verifyWrites(true),
+   m_sessions(),
+   m_nextSession(0),
+   m_session(NULL),
+   m_chunkIndex(0),
+   m_chunkOffset(0),
+   m_chunkDueTick(0)
+{
+   M_SET_PERSISTENT_PROPERTIES_TO_DEFAULT(ChannelReplay);
+}
+
+MChannelReplay::~MChannelReplay()
+{
+   Disconnect();
+}
+
+void MChannelReplay::SetFileName(const MStdString& fileName)
+{
+   if ( m_fileName != fileName )
+   {
+      if ( IsConnected() ) // the session being replayed would be discarded
+      {
+         MException::ThrowCallOutOfSequence();
+         M_ENSURED_ASSERT(0);
+      }
+      m_fileName = fileName;
+      m_sessions.clear();
+      m_nextSession = 0;
+   }
+}
+
+unsigned MChannelReplay::LoadSessions()
+{
+   if ( IsConnected() ) // the session being replayed would be discarded
+   {
+      MException::ThrowCallOutOfSequence();
+      M_ENSURED_ASSERT(0);
+   }
+
+   std::vector<Session> sessions;
+   Muint32 previousTimeStamp = 0;
+
+   MLogFileReader reader(m_fileName);
+   const MLogFileReader::PositionType firstPosition = reader.GetPosition();
+   for ( bool isFirst = true; ; isFirst = false )
+   {
+      const MLogFile::PacketHeader& header = reader.ReadPacketHeader();
+      if ( reader.EndOfFile() || (!isFirst && reader.GetPosition() == firstPosition) ) // the latter is when the ring of pages is full
+         break;
+      const unsigned length = header.GetPacketBodyLength();
+      if ( header.m_code == MMonitor::MessageChannelConnect )
+      {
+         if ( sessions.empty() || !sessions.back().empty() )
+            sessions.push_back(Session());
+         previousTimeStamp = header.m_timeStamp;
+      }
+      else if ( length > 0 && (header.m_code == MMonitor::MessageChannelByteRx || header.m_code == MMonitor::MessageChannelByteTx) )
+      {
+         if ( sessions.empty() ) // there was no connect message in the beginning of the file
+         {
+            sessions.push_back(Session());
+            previousTimeStamp = header.m_timeStamp;
+         }
+         Session& session = sessions.back();
+         session.push_back(Chunk());
+         Chunk& chunk = session.back();
+         chunk.m_delay = header.m_timeStamp - previousTimeStamp; // unsigned arithmetic handles the tick wrap
+         chunk.m_isTransmitted = header.m_code == MMonitor::MessageChannelByteTx;
+         chunk.m_bytes.resize(length);
+         reader.ReadPacketBody(&chunk.m_bytes[0]);
+         previousTimeStamp = header.m_timeStamp;
+         continue;
+      }
+      reader.SkipPacketBody();
+   }
+   if ( !sessions.empty() && sessions.back().empty() )
+      sessions.pop_back();
+
+   if ( sessions.empty() )
+   {
+      MException::ThrowBadFileFormat(m_fileName); // no bytes to replay
+      M_ENSURED_ASSERT(0);
+   }
+   m_sessions.swap(sessions);
+   m_nextSession = 0;
+   return GetSessionCount();
+}
+
+void MChannelReplay::Connect()
+{
+   #if !M_NO_MCOM_SESSION_TRACE
+      MSessionTraceSpan span("channel", "Connect");
+   #endif
+   MChannel::Connect();
+
+   if ( m_sessions.empty() )
+      LoadSessions();
+   if ( m_nextSession >= m_sessions.size() )
+      m_nextSession = 0;
+   m_session = &m_sessions[m_nextSession++];
+   m_chunkIndex = 0;
+   m_chunkOffset = 0;
+   m_chunkDueTick = m_recordedPace ? MTimer::GetTickCount64() + m_session->front().m_delay : 0;
+
+   DoNotifyConnect();
+   #if !M_NO_MCOM_SESSION_TRACE
+      span.SetSucceeded(); // the peer is connected
+   #endif
+}
+
+void MChannelReplay::Disconnect()
+{
+   m_unreadBuffer.clear();
+   if ( m_session != NULL )
+   {
+      m_session = NULL;
+      DoNotifyDisconnect();
+   }
+}
+
+bool MChannelReplay::IsConnected() const
+{
+   return m_session != NULL;
+}
+
+bool MChannelReplay::IsSessionComplete() const
+{
+   return m_session != NULL && m_chunkIndex >= m_session->size();
+}
+
+void MChannelReplay::FlushOutputBuffer(unsigned)
+{
+}
+
+MStdString MChannelReplay::GetMediaIdentification() const
+{
+   MStdString result("REPLAY:", 7);
+   result += m_fileName;
+   return result;
+}
+
+void MChannelReplay::DoNextChunk()
+{
+   M_ASSERT(m_session != NULL && m_chunkIndex < m_session->size());
+   ++m_chunkIndex;
+   m_chunkOffset = 0;
+   if ( m_recordedPace && m_chunkIndex < m_session->size() )
+      m_chunkDueTick = MTimer::GetTickCount64() + (*m_session)[m_chunkIndex].m_delay;
+}
+
+void MChannelReplay::DoClearInputBuffer()
+{
+   m_unreadBuffer.clear();
+   if ( m_session != NULL )
+   {
+      const Muint64 now = m_recordedPace ? MTimer::GetTickCount64() : 0;
+      while ( m_chunkIndex < m_session->size() && !(*m_session)[m_chunkIndex].m_isTransmitted && m_chunkDueTick <= now )
+         DoNextChunk(); // discard what has arrived
+   }
+}
+
+unsigned MChannelReplay::DoWrite(const char* buf, unsigned len)
+{
+   CheckIfConnected();
+
+   unsigned remaining = len;
+   while ( remaining > 0 )
+   {
+      if ( m_chunkIndex >= m_session->size() )
+      {
+         if ( m_verifyWrites )
+         {
+            MCOMException::Throw(MException::ErrorCommunication, M_CODE_STR(M_ERR_PROTOCOL_IMPLEMENTATION_MISMATCH, M_I("Replayed session diverged, bytes are written past the end of the recording")));
+            M_ENSURED_ASSERT(0);
+         }
+         break; // ignore the extra bytes
+      }
+      const Chunk& chunk = (*m_session)[m_chunkIndex];
+      if ( !chunk.m_isTransmitted ) // the protocol did not read these, skip them
+      {
+         DoNextChunk();
+         continue;
+      }
+      unsigned size = static_cast<unsigned>(chunk.m_bytes.size()) - m_chunkOffset;
+      if ( size > remaining )
+         size = remaining;
+      if ( m_verifyWrites && memcmp(buf, chunk.m_bytes.data() + m_chunkOffset, size) != 0 )
+      {
+         MCOMException::Throw(MException::ErrorCommunication, M_CODE_STR_P1(M_ERR_PROTOCOL_IMPLEMENTATION_MISMATCH, M_I("Replayed session diverged, written bytes differ from the recording in chunk %u"), m_chunkIndex));
+         M_ENSURED_ASSERT(0);
+      }
+      buf += size;
+      remaining -= size;
+      m_chunkOffset += size;
+      if ( m_chunkOffset == chunk.m_bytes.size() )
+         DoNextChunk();
+   }
+   return len;
+}
+
+unsigned MChannelReplay::DoRead(char* buf, unsigned len, unsigned timeout)
+{
+   CheckIfConnected();
+
+   if ( m_chunkIndex < m_session->size() && !(*m_session)[m_chunkIndex].m_isTransmitted )
+   {
+      if ( m_recordedPace )
+      {
+         const Muint64 now = MTimer::GetTickCount64();
+         if ( m_chunkDueTick > now )
+         {
+            const Muint64 wait = m_chunkDueTick - now;
+            if ( wait > timeout )
+            {
+               MUtilities::Sleep(timeout);
+               return 0;
+            }
+            MUtilities::Sleep(static_cast<unsigned>(wait));
+         }
+      }
+
+      const Chunk& chunk = (*m_session)[m_chunkIndex];
+      unsigned size = static_cast<unsigned>(chunk.m_bytes.size()) - m_chunkOffset;
+      if ( size > len )
+         size = len;
+      memcpy(buf, chunk.m_bytes.data() + m_chunkOffset, size);
+      m_chunkOffset += size;
+      if ( m_chunkOffset == chunk.m_bytes.size() )
+         DoNextChunk();
+      return size;
+   }
+
+   // Nothing will come until the protocol writes what is recorded, or the recording has ended
+   if ( m_recordedPace )
+      MUtilities::Sleep(timeout);
+   return 0;
+}
+
+bool MChannelReplay::DoIsReadTimeoutInstant() const
+{
+   // When replaying fast, DoRead returns no bytes only when nothing will come, so there is no use polling it until the timeout
+   return !m_recordedPace;
+}
+
+#endif // !M_NO_MCOM_CHANNEL_REPLAY
@@ -0,0 +1,233 @@
+#ifndef MCOM_CHANNELREPLAY_H
+#define MCOM_CHANNELREPLAY_H
+/// \addtogroup MCOM
+///@{
+/// \file MCOM/ChannelReplay.h
+
+#include <MCOM/MCOMDefs.h>
+#include <MCOM/Channel.h>
+
+#if !M_NO_MCOM_CHANNEL_REPLAY
+
+/// Channel that replays a communication session recorded by MMonitorFile.
+///
+/// The channel takes the bytes received and transmitted by the recorded channel,
+/// \ref MMonitor::MessageChannelByteRx "MessageChannelByteRx" and \ref MMonitor::MessageChannelByteTx "MessageChannelByteTx"
+/// messages of the monitor file given by \refprop{GetFileName,FileName}.
+/// The received bytes are given back to the protocol that reads the channel,
+/// while the bytes written by the protocol are compared with the recorded transmitted bytes.
+/// The recording is replayed strictly in order: the received bytes become available only after
+/// all bytes transmitted before them in the recording are written, so the protocol sees
+/// the same request-response sequence as the one recorded.
+/// The received bytes still unread when the protocol writes are skipped, as if they were ignored.
+///
+/// The monitor file is loaded once, at the first connect. Every \ref MMonitor::MessageChannelConnect "MessageChannelConnect" message
+/// starts a new recorded session, and every subsequent connect of the channel takes the next recorded session,
+/// starting from the first session after the last one is taken. This way, the replay of the same log
+/// can be repeated as many times as necessary without touching the file system,
+/// which makes the channel suitable for benchmarking of the protocol stack with the real captured traffic.
+///
+/// By default, the bytes are replayed as fast as possible, and read timeouts elapse instantly.
+/// When \refprop{GetRecordedPace,RecordedPace} is true, the received bytes come with the delays
+/// recorded in the file, and the timeouts take their real time.
+///
+/// Only the protocols that send the same bytes in the same circumstances can be replayed.
+/// For example, ANSI C12.18 can be replayed, while ANSI C12.22 cannot, as every request
+/// has its own invocation identifier, which the recorded response does not match.
+///
+/// The channel can be created by MCOMFactory with the type name "CHANNEL_REPLAY", for example:
+/// \code
+///     protocol = MCOMFactory.CreateProtocol("TYPE=CHANNEL_REPLAY;FILE_NAME=session.mon", "PROTOCOL_ANSI_C12_18")
+/// \endcode
+///
+class MCOM_CLASS MChannelReplay : public MChannel
+{
+public: // Types:
+
+   /// Recorded chunk of bytes.
+   ///
+   struct Chunk
+   {
+      /// Recorded bytes.
+      ///
+      MByteString m_bytes;
+
+      /// Milliseconds elapsed in the recording from the previous chunk to this one.
+      ///
+      unsigned m_delay;
+
+      /// Whether this chunk was transmitted, written to the channel, as opposed to received.
+      ///
+      bool m_isTransmitted;
+   };
+
+   /// Recorded session, all chunks between connect and disconnect of the recorded channel.
+   ///
+   typedef std::vector<Chunk>
+      Session;
+
+public: // Constructor, destructor:
+
+   /// Construct the replay channel.
+   ///
+   MChannelReplay();
+
+   /// Destructor, disconnects the channel.
+   ///
+   virtual ~MChannelReplay();
+
+public: // Services:
+
+   /// Connect the channel, and start replaying the next recorded session.
+   ///
+   /// \pre The file given by \refprop{GetFileName,FileName} is a readable monitor file
+   ///      with at least one received or transmitted byte, otherwise an exception is thrown.
+   ///
+   virtual void Connect();
+
+   /// Disconnect the channel, the rest of the session is not replayed.
+   ///
+   virtual void Disconnect();
+
+   /// Whether the channel is connected.
+   ///
+   virtual bool IsConnected() const;
+
+   /// There is no output buffer in replay channel, this call does nothing.
+   ///
+   virtual void FlushOutputBuffer(unsigned numberOfCharsInBuffer = UINT_MAX);
+
+   /// Return a string that identifies the media through which this channel is talking.
+   ///
+   /// For replay channel this is REPLAY string followed by the file name.
+   ///
+   virtual MStdString GetMediaIdentification() const;
+
+public: // Property handling routines:
+
+   ///@{
+   /// Name of the monitor file to replay.
+   ///
+   /// Changing the file name discards the sessions loaded from the previous file.
+   ///
+   /// \default_value "" (empty string)
+   ///
+   const MStdString& GetFileName() const
+   {
+      return m_fileName;
+   }
+   void SetFileName(const MStdString& fileName);
+   ///@}
+
+   ///@{
+   /// Whether to replay the received bytes with the delays they have in the recording.
+   ///
+   /// \default_value false, replay as fast as possible.
+   ///
+   bool GetRecordedPace() const
+   {
+      return m_recordedPace;
+   }
+   void SetRecordedPace(bool yes)
+   {
+      m_recordedPace = yes;
+   }
+   ///@}
+
+   ///@{
+   /// Whether to verify that the bytes written to the channel match the recorded transmitted bytes.
+   ///
+   /// When true, a write that differs from the recording throws an exception.
+   /// When false, the written bytes are only counted.
+   ///
+   /// \default_value true
+   ///
+   bool GetVerifyWrites() const
+   {
+      return m_verifyWrites;
+   }
+   void SetVerifyWrites(bool yes)
+   {
+      m_verifyWrites = yes;
+   }
+   ///@}
+
+   /// Number of sessions found in the file, zero if the file is not yet loaded.
+   ///
+   unsigned GetSessionCount() const
+   {
+      return static_cast<unsigned>(m_sessions.size());
+   }
+
+   /// Whether all chunks of the current session were read and written.
+   ///
+   bool IsSessionComplete() const;
+
+   /// Load the sessions from the file given, return the number of sessions found.
+   ///
+   /// This is done by Connect if the sessions are not loaded yet,
+   /// but it can be called separately so the file reading is not part of the replay.
+   ///
+   unsigned LoadSessions();
+
+protected: // Methods:
+/// \cond SHOW_INTERNAL
+
+   virtual void DoClearInputBuffer();
+   virtual unsigned DoWrite(const char* buf, unsigned len);
+   virtual unsigned DoRead(char* buf, unsigned len, unsigned timeout);
+   virtual bool DoIsReadTimeoutInstant() const;
+
+private: // Methods:
+
+   // Move to the next chunk of the session, and start timing it if it is received
+   //
+   void DoNextChunk();
+
+private: // Attributes:
+
+   // Name of the monitor file
+   //
+   MStdString m_fileName;
+
+   // Whether to replay at the recorded pace
+   //
+   bool m_recordedPace;
+
+   // Whether to verify the written bytes
+   //
+   bool m_verifyWrites;
+
+   // Sessions loaded from the file
+   //
+   std::vector<Session> m_sessions;
+
+   // Index of the session to be taken at the next connect
+   //
+   unsigned m_nextSession;
+
+   // Session being replayed, NULL when the channel is not connected
+   //
+   const Session* m_session;
+
+   // Current chunk of the session
+   //
+   unsigned m_chunkIndex;
+
+   // Number of bytes of the current chunk that are already read or written
+   //
+   unsigned m_chunkOffset;
+
+   // Tick count when the current chunk becomes available, recorded pace only
+   //
+   Muint64 m_chunkDueTick;
+
+/// \endcond SHOW_INTERNAL
+
+   M_DECLARE_CLASS(ChannelReplay)
+};
+
+#endif // !M_NO_MCOM_CHANNEL_REPLAY
+
+///@}
+#endif
@@ -3,6 +3,7 @@
 #include "MCOMExtern.h"
 #include "ChannelSerialPort.h"
 #include "MCOMExceptions.h"
+#include "SessionTrace.h"
 
 #if !M_NO_SERIAL_PORT
 
@@ -61,9 +62,15 @@ void MChannelSerialPort::FlushOutputBuffer(unsigned numberOfCharsInBuffer)
 
 void MChannelSerialPort::Connect()
 {
+   #if !M_NO_MCOM_SESSION_TRACE
+      MSessionTraceSpan span("channel", "Connect");
+   #endif
    MChannel::Connect();
    DoConnect();
    DoNotifyConnect();
+   #if !M_NO_MCOM_SESSION_TRACE
+      span.SetSucceeded(); // the peer is connected
+   #endif
 }
 
 void MChannelSerialPort::DoConnect()
@@ -124,6 +131,15 @@ unsigned MChannelSerialPort::DoRead(char* buf, unsigned size, unsigned timeout)
    return m_port.Read(buf, size);
 }
 
+bool MChannelSerialPort::DoIsReadAheadAllowed() const
+{
+#if (M_OS & M_OS_WINDOWS) != 0
+   return false; // read interval timeout makes Windows port wait for the whole chunk
+#else
+   return true;
+#endif
+}
+
 bool MChannelSerialPort::IsConnected() const
 {
    return m_port.IsOpen();
@@ -480,6 +480,7 @@ protected: // Services:
 
    virtual unsigned DoWrite(const char* buf, unsigned len);
    virtual unsigned DoRead(char* buf, unsigned numberToRead, unsigned timeout);
+   virtual bool DoIsReadAheadAllowed() const;
 
 protected: // Attributes:
 
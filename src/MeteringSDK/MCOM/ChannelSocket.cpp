@@ -3,6 +3,7 @@
 #include "MCOMExtern.h"
 #include "ChannelSocket.h"
 #include "MCOMExceptions.h"
+#include "SessionTrace.h"
 #include <MCORE/MEvent.h>
 #include <MCORE/MTimer.h>
 
@@ -287,6 +288,9 @@ void MChannelSocket::SetHandlePeerDisconnect(bool yes)
 
 void MChannelSocket::Connect()
 {
+   #if !M_NO_MCOM_SESSION_TRACE
+      MSessionTraceSpan span("channel", "Connect");
+   #endif
 #if !M_NO_MCOM_HANDLE_PEER_DISCONNECT
    m_closedByBackgroundHandler = false;
 #endif
@@ -336,6 +340,9 @@ void MChannelSocket::Connect()
    if ( m_handlePeerDisconnect )
       MChannelSocketBackgroundHandler::Register(this);
 #endif
+   #if !M_NO_MCOM_SESSION_TRACE
+      span.SetSucceeded(); // the peer is connected
+   #endif
 }
 
 void MChannelSocket::WaitForNextIncomingConnection(bool)
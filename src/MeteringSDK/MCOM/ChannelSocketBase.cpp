@@ -192,6 +192,38 @@ unsigned MChannelSocketBase::DoWrite(const char* buf, unsigned len)
    return len;
 }
 
+unsigned MChannelSocketBase::DoWriteBuffers(const Fragment* fragments, unsigned count, bool more)
+{
+   const unsigned maximumGroupSize = 16u;
+   MStreamSocketBase::Fragment socketFragments [ maximumGroupSize ];
+   unsigned len = 0;
+   try
+   {
+#if !M_NO_MCOM_HANDLE_PEER_DISCONNECT
+      MCriticalSection::Locker channelLocker(m_channelOperationCriticalSection);
+#endif
+      while ( count > 0 )
+      {
+         unsigned groupSize = count < maximumGroupSize ? count : maximumGroupSize;
+         for ( unsigned i = 0; i < groupSize; ++i )
+         {
+            socketFragments[i].m_buffer = fragments[i].m_buffer;
+            socketFragments[i].m_size = fragments[i].m_size;
+            len += fragments[i].m_size;
+         }
+         fragments += groupSize;
+         count -= groupSize;
+         m_socketPtr->WriteBuffers(socketFragments, groupSize, more || count > 0);
+      }
+   }
+   catch ( MException& ex )
+   {
+      DoHandleExceptionAndRethrow(ex);
+      M_ENSURED_ASSERT(0);
+   }
+   return len;
+}
+
 unsigned MChannelSocketBase::DoRead(char* buff, unsigned size, unsigned timeout)
 {
    unsigned result = 0u;
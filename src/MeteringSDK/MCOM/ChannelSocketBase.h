@@ -376,6 +376,7 @@ protected: // Methods:
    virtual void DoClearInputBuffer();
 
    virtual unsigned DoWrite(const char* buf, unsigned len);
+   virtual unsigned DoWriteBuffers(const Fragment* fragments, unsigned count, bool more);
    virtual unsigned DoRead(char* buf, unsigned numberToRead, unsigned timeout);
 
    // Translates socket codes to channel codes, if necessary.
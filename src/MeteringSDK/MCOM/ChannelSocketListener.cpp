@@ -0,0 +1,170 @@
+// File MCOM/ChannelSocketListener.cpp
+
+#include "MCOMExtern.h"
+#include "ChannelSocketListener.h"
+#include "Protocol.h"
+#include "MCOMExceptions.h"
+#include <MCORE/MThreadWorker.h>
+
+#if !M_NO_MCOM_CHANNEL_SOCKET_LISTENER
+
+   // How often the accepting threads check if the listener is stopped, milliseconds
+   //
+   static const unsigned s_acceptPollMilliseconds = 250;
+
+   // Accepting thread of the listener
+   //
+   class MChannelSocketListenerThread : public MThreadWorker
+   {
+   public: // Constructor, destructor:
+
+      MChannelSocketListenerThread(MChannelSocketListener* listener)
+      :
+         MThreadWorker(),
+         m_listener(listener),
+         m_socket()
+      {
+      }
+
+      virtual ~MChannelSocketListenerThread()
+      {
+         WaitUntilFinished(false); // do not throw
+      }
+
+   public: // Methods:
+
+      // Listening socket of this thread, open when SO_REUSEPORT is supported
+      //
+      MStreamSocket& GetSocket()
+      {
+         return m_socket;
+      }
+
+   private:
+
+      virtual void Run()
+      {
+         while ( !m_listener->m_stopEvent.LockWithTimeout(0) )
+         {
+            try
+            {
+               MStreamSocket socket;
+               bool accepted;
+               if ( m_socket.IsOpen() )
+                  accepted = m_socket.TimedAccept(socket, s_acceptPollMilliseconds);
+               else
+               {
+                  MCriticalSection::Locker locker(m_listener->m_sharedSocketLock);
+                  accepted = m_listener->m_sharedSocket.TimedAccept(socket, s_acceptPollMilliseconds);
+               }
+               if ( accepted )
+                  m_listener->DoHandleConnection(socket); // outside of the lock
+            }
+            catch ( MException& ex )
+            {
+               m_listener->m_factory->HandleError(ex);
+               m_listener->m_stopEvent.LockWithTimeout(s_acceptPollMilliseconds); // do not spin if the error persists
+            }
+         }
+      }
+
+   private: // Attributes:
+
+      MChannelSocketListener* m_listener;
+      MStreamSocket m_socket;
+   };
+
+MChannelSocketListener::MChannelSocketListener(ConnectionFactory* factory)
+:
+   m_factory(factory),
+   m_port(1153),
+   m_address(),
+   m_backlog(DEFAULT_BACKLOG),
+   m_threadCount(DEFAULT_THREAD_COUNT),
+   m_threads(),
+   m_sharedSocket(),
+   m_sharedSocketLock(),
+   m_stopEvent(false, true) // manual clear
+{
+   M_ASSERT(m_factory != NULL);
+}
+
+MChannelSocketListener::~MChannelSocketListener()
+{
+   try
+   {
+      Stop();
+   }
+   catch ( ... )
+   {
+      M_ASSERT(0); // report in debug, ignore in release
+   }
+}
+
+void MChannelSocketListener::SetThreadCount(unsigned count)
+{
+   MENumberOutOfRange::CheckInteger(1, 1024, int(count), M_OPT_STR("ThreadCount"));
+   m_threadCount = count;
+}
+
+void MChannelSocketListener::Start()
+{
+   if ( IsListening() )
+   {
+      MException::ThrowCallOutOfSequence(); // listener is already started
+      M_ENSURED_ASSERT(0);
+   }
+
+   m_stopEvent.Clear();
+   try
+   {
+      const bool reusePort = MStreamSocket::IsReusePortSupported() && m_threadCount > 1;
+      if ( !reusePort )
+      {
+         m_sharedSocket.Bind(m_port, m_address);
+         m_sharedSocket.Listen(m_backlog);
+      }
+      for ( unsigned i = 0; i < m_threadCount; ++i )
+      {
+         MChannelSocketListenerThread* thread = M_NEW MChannelSocketListenerThread(this);
+         m_threads.push_back(thread);
+         if ( reusePort )
+         {
+            thread->GetSocket().BindShared(m_port, m_address);
+            thread->GetSocket().Listen(m_backlog);
+         }
+      }
+      for ( std::vector<MChannelSocketListenerThread*>::iterator it = m_threads.begin(); it != m_threads.end(); ++it )
+         (*it)->Start();
+   }
+   catch ( ... )
+   {
+      Stop();
+      throw;
+   }
+}
+
+void MChannelSocketListener::Stop()
+{
+   m_stopEvent.Set();
+   for ( std::vector<MChannelSocketListenerThread*>::iterator it = m_threads.begin(); it != m_threads.end(); ++it )
+      delete *it; // waits for the thread to finish, and closes its socket
+   m_threads.clear();
+   m_sharedSocket.Close();
+}
+
+void MChannelSocketListener::DoHandleConnection(MStreamSocket& socket)
+{
+   MUniquePtr<MChannelSocket> channel(M_NEW MChannelSocket);
+   channel->SetSocket(socket); // swap the accepted socket into the channel
+   MProtocol* protocol = m_factory->CreateProtocol(channel.get());
+   if ( protocol != NULL )
+   {
+      M_ASSERT(protocol->GetChannel() == channel.get());
+      protocol->SetIsChannelOwned(true);
+      channel.release();
+      m_factory->HandleProtocol(protocol);
+   }
+}
+
+#endif // !M_NO_MCOM_CHANNEL_SOCKET_LISTENER
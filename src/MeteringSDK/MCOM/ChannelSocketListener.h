@@ -0,0 +1,260 @@
+#ifndef MCOM_CHANNELSOCKETLISTENER_H
+#define MCOM_CHANNELSOCKETLISTENER_H
+/// \addtogroup MCOM
+///@{
+/// \file MCOM/ChannelSocketListener.h
+
+#include <MCOM/ChannelSocket.h>
+#include <MCORE/MEvent.h>
+
+#if !M_NO_MCOM_CHANNEL_SOCKET_LISTENER
+
+class MChannelSocketListenerThread;
+
+/// Server of many simultaneous incoming socket connections.
+///
+/// Different from MChannelSocketCallback, which handles one incoming connection at a time,
+/// the listener accepts connections in many threads, and hands each of them to a user supplied
+/// \ref MChannelSocketListener::ConnectionFactory "connection factory". This is the way to serve
+/// a large number of devices that call in at about the same time, such as after a scheduled wake-up.
+///
+/// On platforms that support SO_REUSEPORT, every accepting thread has its own listening socket
+/// bound into the same port, and the operating system distributes the incoming connections among them.
+/// On other platforms, all threads share a single listening socket.
+///
+/// A typical usage:
+/// \code
+///     class MyFactory : public MChannelSocketListener::ConnectionFactory
+///     {
+///         virtual MProtocol* CreateProtocol(MChannelSocket* channel)
+///         {
+///             return M_NEW MProtocolC1222(channel);
+///         }
+///         virtual void HandleProtocol(MProtocol* protocol)
+///         {
+///             ... queue the session commands and QCommit(true), or pass to a worker ...
+///         }
+///     };
+///
+///     MyFactory factory;
+///     MChannelSocketListener listener(&factory);
+///     listener.SetPort(1153);
+///     listener.Start();
+///     ... serve ...
+///     listener.Stop();
+/// \endcode
+///
+class MCOM_CLASS MChannelSocketListener
+{
+   friend class MChannelSocketListenerThread;
+
+public: // Types:
+
+   /// Per-connection factory, implemented by the user.
+   ///
+   /// The methods of the factory are called by the accepting threads, possibly concurrently.
+   ///
+   class ConnectionFactory
+   {
+   public: // Methods:
+
+      /// Virtual destructor of the class.
+      ///
+      virtual ~ConnectionFactory()
+      {
+      }
+
+      /// Create a protocol that will serve a new incoming connection.
+      ///
+      /// \param channel
+      ///    Socket channel that is already connected to the peer.
+      ///    One should not call Connect for this channel, but the channel properties can be changed here.
+      ///
+      /// \return New protocol that uses the given channel. The protocol will own the channel.
+      ///    When NULL is returned, the connection is refused, and the channel is closed and deleted.
+      ///
+      virtual MProtocol* CreateProtocol(MChannelSocket* channel) = 0;
+
+      /// Take the protocol created by CreateProtocol for serving the connection.
+      ///
+      /// The factory becomes the owner of the protocol, and it shall delete the protocol when done.
+      /// As this is called by an accepting thread, a long communication done here
+      /// will delay accepting of other connections by this thread.
+      ///
+      virtual void HandleProtocol(MProtocol* protocol) = 0;
+
+      /// Handle an error that happened while accepting or creating a connection.
+      ///
+      /// The accepting thread continues after this call, unless the listener is stopped.
+      /// The default implementation does nothing.
+      ///
+      virtual void HandleError(MException& ex)
+      {
+         M_USED_VARIABLE(ex);
+      }
+   };
+
+   enum
+   {
+      /// Default number of accepting threads.
+      ///
+      DEFAULT_THREAD_COUNT = 4,
+
+      /// Default backlog of pending connections for every listening socket.
+      ///
+      DEFAULT_BACKLOG = 128
+   };
+
+public: // Constructor, destructor:
+
+   /// Create the listener with the given connection factory.
+   ///
+   /// \param factory
+   ///    Connection factory, which shall exist while the listener is running.
+   ///
+   explicit MChannelSocketListener(ConnectionFactory* factory);
+
+   /// Destructor, stops the listener if it is running.
+   ///
+   virtual ~MChannelSocketListener();
+
+public: // Properties:
+
+   ///@{
+   /// Port to listen to.
+   ///
+   /// \default_value 1153, same as MChannelSocket auto answer port.
+   ///
+   unsigned GetPort() const
+   {
+      return m_port;
+   }
+   void SetPort(unsigned port)
+   {
+      m_port = port;
+   }
+   ///@}
+
+   ///@{
+   /// Local address to listen to, empty string means all interfaces.
+   ///
+   /// \default_value "" (empty string)
+   ///
+   const MStdString& GetAddress() const
+   {
+      return m_address;
+   }
+   void SetAddress(const MStdString& address)
+   {
+      m_address = address;
+   }
+   ///@}
+
+   ///@{
+   /// Maximum length of the queue of pending connections, for every listening socket.
+   ///
+   /// The operating system can silently limit this value.
+   ///
+   /// \default_value DEFAULT_BACKLOG, 128
+   ///
+   unsigned GetBacklog() const
+   {
+      return m_backlog;
+   }
+   void SetBacklog(unsigned backlog)
+   {
+      m_backlog = backlog;
+   }
+   ///@}
+
+   ///@{
+   /// Number of threads that accept incoming connections.
+   ///
+   /// \default_value DEFAULT_THREAD_COUNT, 4
+   ///
+   unsigned GetThreadCount() const
+   {
+      return m_threadCount;
+   }
+   void SetThreadCount(unsigned count);
+   ///@}
+
+   /// Whether the listener is started.
+   ///
+   bool IsListening() const
+   {
+      return !m_threads.empty();
+   }
+
+   /// Connection factory given at construction.
+   ///
+   ConnectionFactory* GetFactory() const
+   {
+      return m_factory;
+   }
+
+public: // Methods:
+
+   /// Bind the listening sockets and start the accepting threads.
+   ///
+   /// \pre The listener is not started, and the port can be bound,
+   ///      otherwise an exception is thrown.
+   ///
+   void Start();
+
+   /// Stop accepting the connections, wait for the accepting threads to finish, and close the listening sockets.
+   ///
+   /// The connections that were already handed to the factory are not affected.
+   /// If the listener is not started, nothing is done.
+   ///
+   void Stop();
+
+private: // Methods:
+
+   // Wrap the accepted socket into a channel, and pass it to the factory
+   //
+   void DoHandleConnection(MStreamSocket& socket);
+
+private: // Attributes:
+
+   // User supplied connection factory
+   //
+   ConnectionFactory* m_factory;
+
+   // Listening port
+   //
+   unsigned m_port;
+
+   // Listening address
+   //
+   MStdString m_address;
+
+   // Backlog of every listening socket
+   //
+   unsigned m_backlog;
+
+   // How many accepting threads to start
+   //
+   unsigned m_threadCount;
+
+   // Accepting threads, each owns a listening socket, or they share one
+   //
+   std::vector<MChannelSocketListenerThread*> m_threads;
+
+   // Listening socket shared by all threads, when SO_REUSEPORT is not supported
+   //
+   MStreamSocket m_sharedSocket;
+
+   // Serializes accepting on the shared socket
+   //
+   MCriticalSection m_sharedSocketLock;
+
+   // Manual event that tells the accepting threads to exit
+   //
+   MEvent m_stopEvent;
+};
+
+#endif // !M_NO_MCOM_CHANNEL_SOCKET_LISTENER
+
+///@}
+#endif
@@ -3,6 +3,7 @@
 #include "MCOMExtern.h"
 #include "ChannelSocketUdp.h"
 #include "MCOMExceptions.h"
+#include "SessionTrace.h"
 
 #if !M_NO_MCOM_CHANNEL_SOCKET_UDP
 
@@ -48,6 +49,9 @@ void MChannelSocketUdp::SetSocket(MStreamSocketBase& other)
 
 void MChannelSocketUdp::Connect()
 {
+   #if !M_NO_MCOM_SESSION_TRACE
+      MSessionTraceSpan span("channel", "Connect");
+   #endif
    MChannelSocketBase::Connect();
    if ( m_isAutoAnswer )
       WaitForNextIncomingConnection();
@@ -56,6 +60,9 @@ void MChannelSocketUdp::Connect()
       m_socket.Connect(m_peerPort, m_peerAddress);
       DoNotifyConnect();
    }
+   #if !M_NO_MCOM_SESSION_TRACE
+      span.SetSucceeded(); // the peer is connected
+   #endif
 }
 
 void MChannelSocketUdp::WaitForNextIncomingConnection(bool)
@@ -15,6 +15,25 @@ MCommunicationCommand::~MCommunicationCommand()
 {
 }
 
+#if !M_NO_RVALUE_REFERENCES
+MCommunicationCommand& MCommunicationCommand::operator=(MCommunicationCommand&& other)
+{
+   if ( &other != this )
+   {
+      m_id = other.m_id;
+      m_type = other.m_type;
+      m_number = std::move(other.m_number);
+      m_request = std::move(other.m_request);
+      m_response = std::move(other.m_response);
+      m_offset = other.m_offset;
+      m_length = other.m_length;
+      m_littleEndian = other.m_littleEndian;
+      m_responsePresent = other.m_responsePresent;
+   }
+   return *this;
+}
+#endif
+
 MCommunicationCommand* MCommunicationCommand::New(CommandType type)
 {
    MCommunicationCommand* command = M_NEW MCommunicationCommand; // with all data uninitialized
@@ -52,6 +71,25 @@ void MCommunicationCommand::AppendResponse(const MByteString& response)
     m_responsePresent = true;
 }
 
+#if !M_NO_RVALUE_REFERENCES
+void MCommunicationCommand::SetResponse(MByteString&& response)
+{
+    M_ASSERT((m_type & FeatureResponsePresent) != 0);
+    m_response = std::move(response);
+    m_responsePresent = true;
+}
+
+void MCommunicationCommand::AppendResponse(MByteString&& response)
+{
+    M_ASSERT((m_type & FeatureResponsePresent) != 0);
+    if ( m_response.empty() ) // typical case of the first piece of the response, take it without copying
+       m_response = std::move(response);
+    else
+       m_response += response;
+    m_responsePresent = true;
+}
+#endif
+
 #if !M_NO_PROGRESS_MONITOR
 double MCommunicationCommand::GetProgressWeight() const M_NO_THROW
 {
@@ -102,26 +140,96 @@ double MCommunicationCommand::GetProgressWeight() const M_NO_THROW
 
 MCommunicationQueue::MCommunicationQueue()
 :
-   MCommunicationQueueVectorType()
+   MCommunicationQueueVectorType(),
+   m_freeCommands()
 {
 }
 
 MCommunicationQueue::~MCommunicationQueue()
 {
-   clear();
+   for ( iterator it = begin(); it != end(); ++it )
+      delete *it;
+   for ( iterator it = m_freeCommands.begin(); it != m_freeCommands.end(); ++it )
+      delete *it;
+}
+
+MCommunicationCommand* MCommunicationQueue::NewCommand(MCommunicationCommand::CommandType type)
+{
+   if ( m_freeCommands.empty() )
+      return MCommunicationCommand::New(type);
+   MCommunicationCommand* command = m_freeCommands.back();
+   m_freeCommands.pop_back();
+   command->m_type = type;
+   return command;
+}
+
+MCommunicationCommand* MCommunicationQueue::NewClone(const MCommunicationCommand& other)
+{
+   if ( m_freeCommands.empty() )
+      return other.NewClone();
+   MCommunicationCommand* command = m_freeCommands.back();
+   m_freeCommands.pop_back();
+   try
+   {
+      command->m_number = other.m_number;
+      command->m_request = other.m_request; // buffers of the recycled command are reused
+      command->m_response = other.m_response;
+   }
+   catch ( ... )
+   {
+      delete command;
+      throw;
+   }
+   command->m_id = other.m_id;
+   command->m_type = other.m_type;
+   command->m_offset = other.m_offset;
+   command->m_length = other.m_length;
+   command->m_littleEndian = other.m_littleEndian;
+   command->m_responsePresent = other.m_responsePresent;
+   return command;
+}
+
+void MCommunicationQueue::DoRecycle(MCommunicationCommand* command) M_NO_THROW
+{
+   // Bring the command to the state of a new one, but keep the buffers
+   command->m_id = -1;
+#if M_DEBUG
+   command->m_type = (MCommunicationCommand::CommandType)UINT_MAX;
+   command->m_offset = INT_MIN;
+   command->m_length = INT_MIN;
+   command->m_littleEndian = false;
+#endif
+   command->m_number = MCOMNumber();
+   command->m_request.clear();
+   command->m_response.clear();
+   command->m_responsePresent = false;
+   try
+   {
+      m_freeCommands.push_back(command);
+   }
+   catch ( ... )
+   {
+      delete command; // no memory to keep it
+   }
+}
+
+void MCommunicationQueue::ResetResponses()
+{
+   for ( iterator it = begin(); it != end(); ++it )
+      (*it)->ResetResponse();
 }
 
 void MCommunicationQueue::clear()
 {
    for ( iterator it = begin(); it != end(); ++it )
-      delete *it;
+      DoRecycle(*it);
    MCommunicationQueueVectorType::clear();
 }
 
 void MCommunicationQueue::erase(MCommunicationQueueVectorType::iterator it, MCommunicationQueueVectorType::iterator itEnd)
 {
    for ( iterator i = it; i != itEnd; ++i )
-      delete *i;
+      DoRecycle(*i);
    MCommunicationQueueVectorType::erase(it, itEnd);
 }
 
@@ -148,6 +256,19 @@ void MCommunicationQueue::push_back(MCommunicationCommand* command)
       }
    }
 
+   // Compare numbers of commands, integer numbers are compared directly rather than through generic variant comparison
+   //
+   inline bool DoIsSameNumber(MCOMNumberConstRef number1, MCOMNumberConstRef number2)
+   {
+   #if !M_NO_VARIANT
+      unsigned value1;
+      unsigned value2;
+      if ( number1.GetUnsignedIfInteger(value1) && number2.GetUnsignedIfInteger(value2) )
+         return value1 == value2;
+   #endif
+      return number1 == number2;
+   }
+
 MCommunicationCommand* MCommunicationQueue::GetResponseCommandNoThrow(MCommunicationCommand::CommandType type, MCOMNumberConstRef number, int id)
 {
    reverse_iterator it = rbegin(); // go from the end of the queue, this shall be more efficient as the results are usually at the tail
@@ -157,8 +278,8 @@ MCommunicationCommand* MCommunicationQueue::GetResponseCommandNoThrow(MCommunica
       MCommunicationCommand* command = *it;
       if ( DoGetGeneralizedCommand(type) == DoGetGeneralizedCommand(command->GetCommandType()) &&
            ((type & MCommunicationCommand::FeatureResponsePresent) != 0) &&
-           ((type & MCommunicationCommand::FeatureNumberPresent) == 0 || command->GetNumber() == number) &&
-            command->m_id == id )
+            command->m_id == id &&
+           ((type & MCommunicationCommand::FeatureNumberPresent) == 0 || DoIsSameNumber(command->GetNumber(), number)) )
       {
          return command; // done, found.
       }
@@ -90,6 +90,28 @@ private:
 
 public: // Constructor and destructor:
 
+#if !M_NO_RVALUE_REFERENCES
+   // Move constructor, the request and the response of the other command are taken without copying.
+   //
+   MCommunicationCommand(MCommunicationCommand&& other)
+   :
+      m_id(other.m_id),
+      m_type(other.m_type),
+      m_number(std::move(other.m_number)),
+      m_request(std::move(other.m_request)),
+      m_response(std::move(other.m_response)),
+      m_offset(other.m_offset),
+      m_length(other.m_length),
+      m_littleEndian(other.m_littleEndian),
+      m_responsePresent(other.m_responsePresent)
+   {
+   }
+
+   // Move assignment, the request and the response of the other command are taken without copying.
+   //
+   MCommunicationCommand& operator=(MCommunicationCommand&& other);
+#endif
+
    // Constructing static method that creates a command with no parameters.
    //
    static MCommunicationCommand* New(CommandType type);
@@ -139,10 +161,30 @@ public: // Properties:
       M_ASSERT((m_type & FeatureRequestPresent) != 0);
       m_request = request;
    }
+#if !M_NO_RVALUE_REFERENCES
+   void SetRequest(MByteString&& request)
+   {
+      M_ASSERT((m_type & FeatureRequestPresent) != 0);
+      m_request = std::move(request);
+   }
+#endif
 
    const MByteString& GetResponse() const;
+
+   // Discard the response, but keep its buffer, so the command can be committed again
+   //
+   void ResetResponse()
+   {
+      m_response.clear();
+      m_responsePresent = false;
+   }
+
    void SetResponse(const MByteString& response);
    void AppendResponse(const MByteString& response);
+#if !M_NO_RVALUE_REFERENCES
+   void SetResponse(MByteString&& response);
+   void AppendResponse(MByteString&& response);
+#endif
 
    int GetOffset() const
    {
@@ -247,6 +289,9 @@ typedef MCOM_TEMPLATE_CLASS std::vector<MCommunicationCommand*>
 // Command queue used by the protocol.
 // The command queue owns their polymorphic objects.
 //
+// Commands removed from the queue are not deleted, but kept for reuse by NewCommand,
+// so rebuilding queues of similar size does not allocate commands and their request buffers.
+//
 class MCOM_CLASS MCommunicationQueue : public MCommunicationQueueVectorType
 {
 public:
@@ -254,12 +299,41 @@ public:
    MCommunicationQueue();
    ~MCommunicationQueue();
 
+   // Create a command with no parameters, possibly reusing one removed from this queue earlier.
+   // The command is owned by the caller until it is added to the queue.
+   //
+   MCommunicationCommand* NewCommand(MCommunicationCommand::CommandType type);
+
+   // Create a copy of the given command, possibly reusing one removed from this queue earlier.
+   // The command is owned by the caller until it is added to the queue.
+   //
+   MCommunicationCommand* NewClone(const MCommunicationCommand& other);
+
    MCommunicationCommand* GetResponseCommandNoThrow(MCommunicationCommand::CommandType type, MCOMNumberConstRef number, int id = -1);
    MCommunicationCommand* GetResponseCommand(MCommunicationCommand::CommandType type, MCOMNumberConstRef number, int id = -1);
 
+   // Discard the responses of all commands, so the queue can be committed again
+   //
+   void ResetResponses();
+
    void push_back(MCommunicationCommand* command);
    void clear();
    void erase(MCommunicationQueueVectorType::iterator it, MCommunicationQueueVectorType::iterator itEnd);
+
+private:
+
+   // Keep the command for reuse by NewCommand
+   //
+   void DoRecycle(MCommunicationCommand* command) M_NO_THROW;
+
+   MCommunicationQueue(const MCommunicationQueue&);
+   MCommunicationQueue& operator=(const MCommunicationQueue&);
+
+private: // Data:
+
+   // Commands removed from the queue, ready for reuse
+   //
+   MCommunicationQueueVectorType m_freeCommands;
 };
 
 #endif // !M_NO_MCOM_COMMAND_QUEUE
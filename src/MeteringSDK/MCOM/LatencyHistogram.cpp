@@ -0,0 +1,84 @@
+// File MCOM/LatencyHistogram.cpp
+
+#include "MCOMExtern.h"
+#include "LatencyHistogram.h"
+
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+
+void MLatencyHistogram::Clear()
+{
+   memset(m_buckets, 0, sizeof(m_buckets));
+   m_count = 0;
+   m_minimum = 0;
+   m_maximum = 0;
+   m_sum = 0.0;
+}
+
+void MLatencyHistogram::Merge(const MLatencyHistogram& other)
+{
+   if ( other.m_count == 0 )
+      return;
+   for ( unsigned i = 0; i < NUMBER_OF_BUCKETS; ++i )
+      m_buckets[i] += other.m_buckets[i];
+   if ( m_count == 0 || other.m_minimum < m_minimum )
+      m_minimum = other.m_minimum;
+   if ( other.m_maximum > m_maximum )
+      m_maximum = other.m_maximum;
+   m_count += other.m_count;
+   m_sum += other.m_sum;
+}
+
+unsigned MLatencyHistogram::GetPercentile(double percent) const
+{
+   if ( m_count == 0 )
+      return 0u;
+   double target = percent * m_count / 100.0;
+   Muint64 cumulative = 0;
+   for ( unsigned i = 0; i < NUMBER_OF_BUCKETS; ++i )
+   {
+      cumulative += m_buckets[i];
+      if ( cumulative != 0 && double(cumulative) >= target )
+      {
+         const unsigned bound = GetBucketUpperBound(i);
+         return bound < m_maximum ? bound : m_maximum; // no latency is bigger than the maximum
+      }
+   }
+   return m_maximum;
+}
+
+unsigned MLatencyHistogram::GetBucketLowerBound(unsigned index)
+{
+   M_ASSERT(index < NUMBER_OF_BUCKETS);
+   if ( index < 2 * SUB_BUCKET_COUNT )
+      return index;
+   const unsigned shift = index / SUB_BUCKET_COUNT - 1;
+   return (SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT) << shift;
+}
+
+unsigned MLatencyHistogram::GetBucketUpperBound(unsigned index)
+{
+   M_ASSERT(index < NUMBER_OF_BUCKETS);
+   if ( index < 2 * SUB_BUCKET_COUNT )
+      return index;
+   const unsigned shift = index / SUB_BUCKET_COUNT - 1;
+   return GetBucketLowerBound(index) + (1u << shift) - 1;
+}
+
+#if !M_NO_VARIANT
+MVariant MLatencyHistogram::AsVariant() const
+{
+   MVariant result(MVariant::VAR_MAP);
+   for ( unsigned i = 0; i < NUMBER_OF_BUCKETS; ++i )
+      if ( m_buckets[i] != 0 )
+         result.SetItem(MVariant(GetBucketUpperBound(i)), MVariant(m_buckets[i]));
+   return result;
+}
+#endif
+
+MStdString MLatencyHistogram::AsString() const
+{
+   return MGetStdString("count %u, minimum %u, median %u, 90%% %u, 99%% %u, 99.9%% %u, maximum %u",
+                        m_count, m_minimum, GetPercentile(50.0), GetPercentile(90.0), GetPercentile(99.0), GetPercentile(99.9), m_maximum);
+}
+
+#endif // !M_NO_MCOM_LATENCY_HISTOGRAMS
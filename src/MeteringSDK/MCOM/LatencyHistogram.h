@@ -0,0 +1,172 @@
+#ifndef MCOM_LATENCYHISTOGRAM_H
+#define MCOM_LATENCYHISTOGRAM_H
+/// \addtogroup MCOM
+///@{
+/// \file MCOM/LatencyHistogram.h
+
+#include <MCOM/MCOMDefs.h>
+
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+
+/// Histogram of latencies in milliseconds with logarithmic buckets.
+///
+/// Latencies below 32 milliseconds have a bucket per millisecond,
+/// and every next power of two is split into 16 buckets of equal width,
+/// so the error of a value taken from the histogram is within 1/16 of the value.
+/// Adding a latency is a few arithmetic operations, no memory allocation takes place,
+/// and histograms collected separately can be merged with no loss.
+///
+/// Latencies bigger than \ref MAXIMUM_LATENCY, about four and a half hours,
+/// are accounted as the maximum latency.
+///
+class MCOM_CLASS MLatencyHistogram
+{
+public: // Constants:
+
+   enum
+   {
+      SUB_BUCKET_BITS = 4,                              ///< Number of bits that define the precision, 16 buckets per power of two.
+      SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS,          ///< Number of buckets in every power of two.
+      MAXIMUM_LATENCY_BITS = 24,                        ///< Number of bits in the biggest latency accounted exactly.
+      MAXIMUM_LATENCY = (1 << MAXIMUM_LATENCY_BITS) - 1, ///< Biggest latency accounted, bigger ones are accounted as this one.
+      NUMBER_OF_BUCKETS = (MAXIMUM_LATENCY_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT ///< Total number of buckets in the histogram.
+   };
+
+public: // Constructor:
+
+   /// Constructor that creates an empty histogram.
+   ///
+   MLatencyHistogram()
+   {
+      Clear();
+   }
+
+public: // Services:
+
+   /// Make the histogram empty.
+   ///
+   void Clear();
+
+   /// Account the given latency in milliseconds.
+   ///
+   void Add(unsigned latency)
+   {
+      if ( latency > MAXIMUM_LATENCY )
+         latency = MAXIMUM_LATENCY;
+      ++m_buckets[GetBucketIndex(latency)];
+      ++m_count;
+      m_sum += latency;
+      if ( m_count == 1 || latency < m_minimum )
+         m_minimum = latency;
+      if ( latency > m_maximum )
+         m_maximum = latency;
+   }
+
+   /// Add all latencies accounted by the given histogram to this histogram.
+   ///
+   void Merge(const MLatencyHistogram& other);
+
+   /// Number of latencies accounted.
+   ///
+   unsigned GetCount() const
+   {
+      return m_count;
+   }
+
+   /// Smallest latency accounted, or zero if there are none.
+   ///
+   unsigned GetMinimum() const
+   {
+      return m_minimum;
+   }
+
+   /// Biggest latency accounted, or zero if there are none.
+   ///
+   unsigned GetMaximum() const
+   {
+      return m_maximum;
+   }
+
+   /// Average of the latencies accounted, or zero if there are none.
+   ///
+   unsigned GetAverage() const
+   {
+      return m_count != 0 ? unsigned(m_sum / m_count) : 0u;
+   }
+
+   /// Latency at the given percentile.
+   ///
+   /// The value returned is such that the given percent of the latencies accounted are not bigger than it,
+   /// within the precision of the bucket. It is zero if there are no latencies accounted.
+   ///
+   /// \param percent Percentile in range 0 to 100, such as 50 for median, or 99.9.
+   ///
+   unsigned GetPercentile(double percent) const;
+
+   /// Number of latencies accounted in the bucket with the given index.
+   ///
+   /// \pre The index shall be smaller than \ref NUMBER_OF_BUCKETS, there is a debug check.
+   ///
+   unsigned GetBucketCount(unsigned index) const
+   {
+      M_ASSERT(index < NUMBER_OF_BUCKETS);
+      return m_buckets[index];
+   }
+
+   /// Index of the bucket to which the given latency belongs.
+   ///
+   /// \pre The latency shall not be bigger than \ref MAXIMUM_LATENCY, there is a debug check.
+   ///
+   static unsigned GetBucketIndex(unsigned latency)
+   {
+      M_ASSERT(latency <= MAXIMUM_LATENCY);
+      if ( latency < 2 * SUB_BUCKET_COUNT )
+         return latency;
+      unsigned shift = 0;
+      for ( unsigned v = latency >> (SUB_BUCKET_BITS + 1); v != 0; v >>= 1 )
+         ++shift;
+      return (shift + 1) * SUB_BUCKET_COUNT + (latency >> shift) - SUB_BUCKET_COUNT;
+   }
+
+   /// Smallest latency that belongs to the bucket with the given index.
+   ///
+   static unsigned GetBucketLowerBound(unsigned index);
+
+   /// Biggest latency that belongs to the bucket with the given index.
+   ///
+   static unsigned GetBucketUpperBound(unsigned index);
+
+#if !M_NO_VARIANT
+   /// Histogram as a map, where the keys are upper bounds of nonempty buckets, and the values are their counts.
+   ///
+   MVariant AsVariant() const;
+#endif
+
+   /// Short human readable summary of the histogram, count, minimum, percentiles and maximum.
+   ///
+   MStdString AsString() const;
+
+private: // Data:
+
+   // Counts of latencies in every bucket
+   //
+   Muint32 m_buckets [ NUMBER_OF_BUCKETS ];
+
+   // Number of latencies accounted
+   //
+   unsigned m_count;
+
+   // Smallest and biggest latencies accounted
+   //
+   unsigned m_minimum;
+   unsigned m_maximum;
+
+   // Sum of latencies accounted, for average
+   //
+   double m_sum;
+};
+
+#endif // !M_NO_MCOM_LATENCY_HISTOGRAMS
+
+///@}
+#endif
@@ -4,26 +4,35 @@
 #include "MCOMExceptions.h"
 #include "LogFile.h"
 #include "MonitorFile.h"
+#include <MCORE/MLzCodec.h>
 
 #if !M_NO_MCOM_MONITOR && !M_NO_MULTITHREADING && !M_NO_FILESYSTEM
 
    const Muint32 NIL = (Muint32)-1;
 
    M_COMPILED_ASSERT(sizeof(MLogFile::LogFilePage) == MLogFile::PAGE_TOTAL_SIZE); // check the alignment, constant
+   M_COMPILED_ASSERT(sizeof(MLogFile::PageSummary) == MLogFile::INDEX_RECORD_SIZE);
+
+   // Bit of the code within the page summary mask
+   //
+   inline unsigned DoGetCodeBit(unsigned code)
+   {
+      return (code >= 0x20 && code < 0x5F) ? code - 0x20 : 63;
+   }
 
 void MLogFile::LogFilePage::OnceBeforeWrite()
 {
    Muint32 checksum = m_signature;
    Muint32* body = &m_lastPageIndex; // start from the first byte
    Muint32* bodyEnd = &m_checksum; // checksum is not included
-   if ( m_signature == (Muint32)MLogFile::PAGE_HEADER_SIGNATURE )
+   if ( !IsObfuscated() )
    {
+      M_ASSERT(m_signature == (Muint32)MLogFile::PAGE_HEADER_SIGNATURE || m_signature == (Muint32)MLogFile::PAGE_COMPRESSED_HEADER_SIGNATURE);
       for ( ; body != bodyEnd; ++body )
          checksum += *body;
    }
    else
    {
-      M_ASSERT(m_signature == (Muint32)MLogFile::PAGE_OBFUSCATED_HEADER_SIGNATURE);
       for ( ; body != bodyEnd; ++body )
       {
          *body ^= MLogFile::PAGE_OBFUSCATED_HEADER_SIGNATURE;
@@ -38,12 +47,12 @@ bool MLogFile::LogFilePage::OnceAfterRead()
    Muint32 checksum = m_signature;
    Muint32* body = &m_lastPageIndex; // start from the first byte
    Muint32* bodyEnd = &m_checksum; // checksum is not included
-   if ( m_signature == (Muint32)MLogFile::PAGE_HEADER_SIGNATURE )
+   if ( m_signature == (Muint32)MLogFile::PAGE_HEADER_SIGNATURE || m_signature == (Muint32)MLogFile::PAGE_COMPRESSED_HEADER_SIGNATURE )
    {
       for ( ; body != bodyEnd; ++body )
          checksum += *body;
    }
-   else if ( m_signature == (Muint32)MLogFile::PAGE_OBFUSCATED_HEADER_SIGNATURE )
+   else if ( IsObfuscated() )
    {
       for ( ; body != bodyEnd; ++body )
       {
@@ -54,14 +63,35 @@ bool MLogFile::LogFilePage::OnceAfterRead()
    else
       return false;
 
-   if ( !(m_firstMessageOffset == NIL || m_firstMessageOffset < PAGE_BODY_SIZE) )
+   if ( !(m_firstMessageOffset == NIL || m_firstMessageOffset < (IsCompressed() ? unsigned(PAGE_EXPANDED_BODY_SIZE) : unsigned(PAGE_BODY_SIZE))) )
       return false;
    return m_checksum == checksum;
 }
 
+void MLogFile::PageSummary::Add(Muint32 timeStamp, unsigned code)
+{
+   if ( IsEmpty() )
+      m_firstTimeStamp = timeStamp;
+   m_lastTimeStamp = timeStamp;
+   const unsigned bit = DoGetCodeBit(code);
+   if ( bit < 32 )
+      m_codesLow |= 1u << bit;
+   else
+      m_codesHigh |= 1u << (bit - 32);
+}
+
+bool MLogFile::PageSummary::MayHaveCode(unsigned code) const
+{
+   const unsigned bit = DoGetCodeBit(code);
+   if ( bit < 32 )
+      return (m_codesLow & (1u << bit)) != 0;
+   return (m_codesHigh & (1u << (bit - 32))) != 0;
+}
+
 MLogFile::MLogFile()
 :
    m_file(),
+   m_indexFile(),
    m_fileName(),
    m_openWarnings(),
    m_pageCounter(),
@@ -70,8 +100,12 @@ MLogFile::MLogFile()
    m_currentPageIndex(0),
    m_pageBodyPtr(NULL),
    m_page(),
+   m_pageBody(m_page.m_body),
+   m_pageBodyEnd(m_page.m_body + PAGE_BODY_SIZE),
+   m_expandedBody(),
    m_listener(NULL),
-   m_obfuscate(false)
+   m_obfuscate(false),
+   m_compress(false)
 {
 }
 
@@ -174,6 +208,7 @@ bool MLogFile::DoOpen(const MStdString& fileName, bool readonly)
 
 void MLogFile::Close() M_NO_THROW
 {
+   m_indexFile.Close();
    m_file.Close();
 }
 
@@ -190,9 +225,37 @@ void MLogFile::DoReadPage(unsigned index)
       M_ENSURED_ASSERT(0);
    }
 
-   m_obfuscate = (m_page.m_signature == (unsigned)PAGE_OBFUSCATED_HEADER_SIGNATURE);
+   m_obfuscate = m_page.IsObfuscated();
+   m_compress = m_page.IsCompressed();
+   if ( m_compress )
+   {
+      Muint16 sizes [ 2 ]; // compressed size, decompressed size
+      memcpy(sizes, m_page.m_body, COMPRESSED_BODY_PREFIX_SIZE);
+      unsigned expandedSize = 0;
+      DoReserveExpandedBody();
+      if ( sizes[0] > PAGE_BODY_SIZE - COMPRESSED_BODY_PREFIX_SIZE || sizes[1] > PAGE_EXPANDED_BODY_SIZE ||
+           !MLzCodec::DecompressBuffer(m_page.m_body + COMPRESSED_BODY_PREFIX_SIZE, sizes[0], &m_expandedBody[0], sizes[1], expandedSize) ||
+           expandedSize != sizes[1] || (m_page.m_firstMessageOffset != NIL && m_page.m_firstMessageOffset >= expandedSize) )
+      {
+         MException::ThrowBadFileFormat(m_fileName);
+         M_ENSURED_ASSERT(0);
+      }
+      m_pageBody = &m_expandedBody[0];
+      m_pageBodyEnd = m_pageBody + expandedSize;
+   }
+   else
+   {
+      m_pageBody = m_page.m_body;
+      m_pageBodyEnd = m_pageBody + PAGE_BODY_SIZE;
+   }
    m_currentPageIndex = index;
-   m_pageBodyPtr = (char*)m_page.m_body;
+   m_pageBodyPtr = m_pageBody;
+}
+
+void MLogFile::DoReserveExpandedBody()
+{
+   if ( m_expandedBody.empty() )
+      m_expandedBody.resize(PAGE_EXPANDED_BODY_SIZE + PACKET_HEADER_SIZE); // header of the last packet can be peeked past the body
 }
 
 #endif // !M_NO_MCOM_MONITOR
@@ -20,11 +20,19 @@ public: // Constants:
    {
       PAGE_HEADER_SIGNATURE         = 0xA2EBBAED,    ///< Monitor file header and page header signature (also tells about version).
       PAGE_OBFUSCATED_HEADER_SIGNATURE = 0xA2EBBAEC, ///< Monitor file header and page header signature that tells the page contents are obfuscated (also tells about version).
+      PAGE_COMPRESSED_HEADER_SIGNATURE = 0xA2EBBAEE, ///< Page header signature that tells the page contents are compressed.
+      PAGE_COMPRESSED_OBFUSCATED_HEADER_SIGNATURE = 0xA2EBBAEF, ///< Page header signature that tells the page contents are compressed and obfuscated.
       PAGE_TOTAL_SIZE               = 0x1000,  ///< Total page size, shall be efficient for most architectures.
       PAGE_HEADER_SIZE              = 16,      ///< Page header size.
       PAGE_FOOTER_SIZE              = 4,       ///< Page footer size.
       PAGE_BODY_SIZE                = PAGE_TOTAL_SIZE - PAGE_HEADER_SIZE - PAGE_FOOTER_SIZE, ///< Body size of the page.
       PACKET_HEADER_SIZE            = 10,      ///< Size of the packet header.
+      SESSION_PREFIX_SIZE           = 6,       ///< Size of the session identifier and message code that start the body of a session packet.
+      PAGE_EXPANDED_BODY_SIZE       = 0xF000,  ///< Maximum size of the body of a compressed page after it is decompressed.
+      COMPRESSED_BODY_PREFIX_SIZE   = 4,       ///< Size of the compressed and decompressed sizes that start the body of a compressed page.
+      INDEX_HEADER_SIGNATURE        = 0xA2EB1DE7, ///< Signature at the start of the page index file.
+      INDEX_HEADER_SIZE             = 8,       ///< Size of the page index file header, signature and size of a page summary.
+      INDEX_RECORD_SIZE             = 20,      ///< Size of a page summary within the page index file.
       NUMBER_OF_PAGES_LIMIT         = 0xFFFF   ///< Still limit the number of pages in the file with no size limit, the file size is about 100 megabytes.
    };
 
@@ -66,6 +74,10 @@ public: // Types:
       /// Each message starts with the message code, then the timestamp, then the size, and then the body.
       /// Unused message body is filled with zeros (there is no message code zero).
       ///
+      /// The body of a compressed page starts with two 16-bit sizes, one of the compressed data that follows,
+      /// and another of the stream of messages it decompresses into by MLzCodec, at most PAGE_EXPANDED_BODY_SIZE.
+      /// The first message offset of a compressed page is the offset within the decompressed stream.
+      ///
       char m_body [ PAGE_BODY_SIZE ];
 
       /// Checksum, sum of all quadruples of bytes in the page excluding the checksum itself.
@@ -76,6 +88,20 @@ public: // Types:
 
    public: // Services:
 
+      /// Whether the page contents are compressed.
+      ///
+      bool IsCompressed() const
+      {
+         return m_signature == (Muint32)PAGE_COMPRESSED_HEADER_SIGNATURE || m_signature == (Muint32)PAGE_COMPRESSED_OBFUSCATED_HEADER_SIGNATURE;
+      }
+
+      /// Whether the page contents are obfuscated.
+      ///
+      bool IsObfuscated() const
+      {
+         return m_signature == (Muint32)PAGE_OBFUSCATED_HEADER_SIGNATURE || m_signature == (Muint32)PAGE_COMPRESSED_OBFUSCATED_HEADER_SIGNATURE;
+      }
+
       /// Update packet so it is ready to be written.
       /// Possibly obfuscate and calculate and update checksum.
       ///
@@ -140,6 +166,72 @@ public: // Types:
       }
    };
 
+   /// Summary of the messages that start on a page, as stored in the page index file.
+   ///
+   /// The page index file has the name of the log file with ".idx" appended.
+   /// It is written by MLogFileWriter together with every page, and used by MLogFileReader
+   /// to seek the file without reading all of its pages. The summary is valid
+   /// only if its page counter equals the counter of the page in the log file,
+   /// otherwise the reader makes the summary from the page itself.
+   ///
+   struct PageSummary
+   {
+   public: // Data:
+
+      /// Counter of the page at the time the summary was written, see LogFilePage::m_pageCounter.
+      ///
+      Muint32 m_pageCounter;
+
+      /// Time stamp of the first message that starts on the page.
+      ///
+      Muint32 m_firstTimeStamp;
+
+      /// Time stamp of the last message that starts on the page.
+      ///
+      Muint32 m_lastTimeStamp;
+
+      /// Bit mask of the codes of the messages that start on the page, lower 32 bits.
+      /// Code 0x20 is bit zero, code 0x5E is bit 62, and all other codes share bit 63.
+      /// Messages of sessions are accounted by their own codes.
+      ///
+      Muint32 m_codesLow;
+
+      /// Bit mask of the codes of the messages that start on the page, upper 32 bits.
+      ///
+      Muint32 m_codesHigh;
+
+   public: // Services:
+
+      /// Make the summary of a page with no messages.
+      ///
+      void Clear()
+      {
+         m_pageCounter = 0;
+         m_firstTimeStamp = 0;
+         m_lastTimeStamp = 0;
+         m_codesLow = 0;
+         m_codesHigh = 0;
+      }
+
+      /// Whether no message starts on the page.
+      ///
+      bool IsEmpty() const
+      {
+         return m_codesLow == 0 && m_codesHigh == 0;
+      }
+
+      /// Account the message with the given time stamp and code.
+      ///
+      void Add(Muint32 timeStamp, unsigned code);
+
+      /// Whether a message with the given code can start on the page.
+      ///
+      /// This can be a false positive for codes outside of range 0x20 to 0x5E,
+      /// but a negative answer is always exact.
+      ///
+      bool MayHaveCode(unsigned code) const;
+   };
+
 protected: // Constructors:
 
    /// Constructor that creates an uninitialized log file object.
@@ -203,12 +295,35 @@ public: // Services (property getters and setters):
    }
    /// @}
 
+   /// @{
+   /// Whether to compress the pages of the monitor file, so the file of the same size holds more history.
+   /// The option takes effect starting from the next page written,
+   /// and when an existing file is open, the option is taken from its last page.
+   /// Compressed and uncompressed pages are read transparently.
+   ///
+   bool GetCompress() const
+   {
+      return m_compress;
+   }
+   void SetCompress(bool yes)
+   {
+      m_compress = yes;
+   }
+   /// @}
+
 public: // Services:
 
    /// Close the file, if it was open.
    ///
    virtual void Close() M_NO_THROW;
 
+   /// Name of the page index file of the log file with the given name.
+   ///
+   static MStdString GetIndexFileName(const MStdString& fileName)
+   {
+      return fileName + ".idx";
+   }
+
 protected: // Services:
 /// \cond SHOW_INTERNAL
 
@@ -231,12 +346,20 @@ protected: // Services:
    //
    void DoReadPage(unsigned index);
 
+   // Prepare the buffer for the decompressed body of the page.
+   //
+   void DoReserveExpandedBody();
+
 protected: // Data members:
 
    // File handle.
    //
    MStreamFile m_file;
 
+   // Page index file handle, not open if there is no index
+   //
+   MStreamFile m_indexFile;
+
    // File or directory name where the logging needs to be done.
    // This parameter is specified by the user.
    // If the directory is specified, the file name will be constructed from the attach string.
@@ -276,10 +399,25 @@ protected: // Data members:
    //
    LogFilePage m_page;
 
+   // Stream of messages of the current page, the page body itself, or the decompressed body of a compressed page
+   //
+   char* m_pageBody;
+
+   // End of the stream of messages of the current page.
+   // If we are writing, this is where the page is full.
+   //
+   char* m_pageBodyEnd;
+
+   // Buffer for the decompressed body of a compressed page, empty until the first compressed page
+   //
+   MByteString m_expandedBody;
+
    MMonitorFile* m_listener;
 
    bool m_obfuscate;
 
+   bool m_compress;
+
 /// \endcond SHOW_INTERNAL
 };
 
@@ -0,0 +1,464 @@
+// File MCOM/LogFileMappedReader.cpp
+
+#include "MCOMExtern.h"
+#include "MCOMExceptions.h"
+#include "LogFileMappedReader.h"
+#include "Monitor.h"
+#include <MCORE/MThreadWorker.h>
+
+#if !M_NO_MCOM_LOG_FILE_MAPPED_READER
+
+#if (M_OS & M_OS_POSIX) != 0
+   #include <sys/mman.h>
+#endif
+#include <MCORE/MLzCodec.h>
+
+   const Muint32 NIL = (Muint32)-1;
+
+   enum PageState
+   {
+      PAGE_STATE_UNKNOWN = 0,
+      PAGE_STATE_GOOD    = 1,
+      PAGE_STATE_BAD     = 2
+   };
+
+   class MLogFileMappedReaderVerifier : public MThreadWorker
+   {
+   public:
+
+      MLogFileMappedReaderVerifier(MLogFileMappedReader* reader, unsigned firstPage, unsigned step)
+      :
+         MThreadWorker(),
+         m_reader(reader),
+         m_firstPage(firstPage),
+         m_step(step)
+      {
+      }
+
+      virtual ~MLogFileMappedReaderVerifier()
+      {
+      }
+
+   protected:
+
+      virtual void Run()
+      {
+         MByteString expandedBody; // scratch buffer of this thread, reused for every compressed page
+         bool isExpanded;
+         const unsigned numberOfPages = m_reader->GetNumberOfPages();
+         for ( unsigned i = m_firstPage; i < numberOfPages; i += m_step )
+            m_reader->DoVerifyPage(i, expandedBody, isExpanded);
+      }
+
+   private:
+
+      MLogFileMappedReader* m_reader;
+      unsigned m_firstPage;
+      unsigned m_step;
+   };
+
+MLogFileMappedReader::MLogFileMappedReader()
+:
+   m_fileName(),
+   m_data(NULL),
+   m_size(0),
+   m_numberOfPages(0),
+   m_pageStates(),
+   m_lastPageIndex(0),
+   m_firstPageIndex(0),
+   m_firstOffset(0),
+   m_currentExpandedBody(0),
+   m_pageIndex(0),
+   m_body(NULL),
+   m_bodySize(0),
+   m_offset(0),
+   m_endOfFile(true),
+   m_spanBuffer()
+{
+}
+
+MLogFileMappedReader::MLogFileMappedReader(const MStdString& fileName)
+:
+   m_fileName(),
+   m_data(NULL),
+   m_size(0),
+   m_numberOfPages(0),
+   m_pageStates(),
+   m_lastPageIndex(0),
+   m_firstPageIndex(0),
+   m_firstOffset(0),
+   m_currentExpandedBody(0),
+   m_pageIndex(0),
+   m_body(NULL),
+   m_bodySize(0),
+   m_offset(0),
+   m_endOfFile(true),
+   m_spanBuffer()
+{
+   Open(fileName);
+}
+
+MLogFileMappedReader::~MLogFileMappedReader() M_NO_THROW
+{
+   Close();
+}
+
+void MLogFileMappedReader::Open(const MStdString& fileName)
+{
+   Close();
+   m_fileName = fileName;
+
+   // Map the file copy-on-write, so the obfuscated pages can be restored in place
+   //
+   #if (M_OS & M_OS_WINDOWS) != 0
+      #if M_UNICODE
+         HANDLE file = ::CreateFile(MToWideString(fileName).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, 0);
+      #else
+         HANDLE file = ::CreateFile(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, 0);
+      #endif
+      if ( file == INVALID_HANDLE_VALUE )
+      {
+         MESystemError::ThrowFileNotOpen(fileName);
+         M_ENSURED_ASSERT(0);
+      }
+      m_size = static_cast<size_t>(::GetFileSize(file, NULL));
+      if ( m_size >= MLogFile::PAGE_TOTAL_SIZE )
+      {
+         HANDLE mapping = ::CreateFileMapping(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+         if ( mapping != NULL )
+         {
+            m_data = static_cast<char*>(::MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+            ::CloseHandle(mapping); // the view holds the mapping
+         }
+         if ( m_data == NULL )
+         {
+            ::CloseHandle(file);
+            MESystemError::ThrowLastSystemError();
+            M_ENSURED_ASSERT(0);
+         }
+      }
+      ::CloseHandle(file);
+   #elif (M_OS & M_OS_POSIX) != 0
+      int file = ::open(fileName.c_str(), O_RDONLY);
+      if ( file == -1 )
+      {
+         MESystemError::ThrowFileNotOpen(fileName);
+         M_ENSURED_ASSERT(0);
+      }
+      struct stat st;
+      if ( ::fstat(file, &st) == 0 )
+         m_size = static_cast<size_t>(st.st_size);
+      if ( m_size >= MLogFile::PAGE_TOTAL_SIZE )
+      {
+         void* data = ::mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+         if ( data == MAP_FAILED )
+         {
+            ::close(file);
+            MESystemError::ThrowLastSystemError();
+            M_ENSURED_ASSERT(0);
+         }
+         m_data = static_cast<char*>(data);
+      }
+      ::close(file); // the mapping holds the file
+   #else
+      #error "Implement file mapping for this OS"
+   #endif
+
+   if ( m_data == NULL ) // not a single page
+   {
+      MException::ThrowBadFileFormat(fileName);
+      M_ENSURED_ASSERT(0);
+   }
+   m_numberOfPages = static_cast<unsigned>(m_size / MLogFile::PAGE_TOTAL_SIZE);
+   if ( m_numberOfPages > MLogFile::NUMBER_OF_PAGES_LIMIT + 1 )
+      m_numberOfPages = MLogFile::NUMBER_OF_PAGES_LIMIT + 1;
+   m_pageStates.assign(m_numberOfPages, char(PAGE_STATE_UNKNOWN));
+
+   try
+   {
+      // Find the last page the same way as MLogFile does
+      //
+      MLogFile::LogFilePage* page = DoGetPage(0);
+      if ( page->m_lastPageIndex != NIL ) // if the file was closed normally when written
+      {
+         m_lastPageIndex = page->m_lastPageIndex;
+         if ( m_lastPageIndex >= m_numberOfPages )
+         {
+            MException::ThrowBadFileFormat(fileName);
+            M_ENSURED_ASSERT(0);
+         }
+      }
+      else
+      {
+         Muint32 pageCounter = page->m_pageCounter;
+         m_lastPageIndex = m_numberOfPages - 1;
+         for ( unsigned i = 1; i < m_numberOfPages; ++i )
+         {
+            if ( ++pageCounter != DoGetPage(i)->m_pageCounter ) // if the proper ascending sequence of pages is interrupted...
+            {
+               m_lastPageIndex = i - 1;
+               break;
+            }
+         }
+      }
+
+      // Find the first page with a message start, the same way as MLogFileReader does
+      //
+      for ( m_firstPageIndex = m_lastPageIndex + 1; ; ++m_firstPageIndex )
+      {
+         if ( m_firstPageIndex >= m_numberOfPages )
+            m_firstPageIndex = 0u;
+         page = DoGetPage(m_firstPageIndex);
+         if ( page->m_firstMessageOffset != NIL ) // if there was a message on this page
+            break;
+         if ( m_firstPageIndex == m_lastPageIndex ) // we have looped through all pages and no message start...
+         {
+            MException::ThrowBadFileFormat(fileName);
+            M_ENSURED_ASSERT(0);
+         }
+      }
+      m_firstOffset = page->m_firstMessageOffset;
+   }
+   catch ( ... )
+   {
+      Close();
+      throw;
+   }
+   Reset();
+}
+
+void MLogFileMappedReader::Close() M_NO_THROW
+{
+   if ( m_data != NULL )
+   {
+      #if (M_OS & M_OS_WINDOWS) != 0
+         ::UnmapViewOfFile(m_data);
+      #else
+         ::munmap(m_data, m_size);
+      #endif
+      m_data = NULL;
+   }
+   m_size = 0;
+   m_numberOfPages = 0;
+   m_pageStates.clear();
+   m_expandedBodies[0].clear();
+   m_expandedBodies[1].clear();
+   m_body = NULL;
+   m_bodySize = 0;
+   m_endOfFile = true;
+   m_spanBuffer.clear();
+}
+
+void MLogFileMappedReader::Reset()
+{
+   M_ASSERT(IsOpen());
+   DoEnterPage(m_firstPageIndex, m_firstOffset);
+   m_endOfFile = false;
+}
+
+bool MLogFileMappedReader::ReadPacket(Packet& packet)
+{
+   M_ASSERT(IsOpen());
+   if ( m_endOfFile )
+      return false;
+
+   MLogFile::PacketHeader header;
+   DoReadBytes((char*)&header, MLogFile::PACKET_HEADER_SIZE);
+   if ( header.m_length < MLogFile::PACKET_HEADER_SIZE || Muint64(header.m_length) > Muint64(m_numberOfPages) * MLogFile::PAGE_EXPANDED_BODY_SIZE ) // end of file, or a broken packet
+   {
+      m_endOfFile = true;
+      return false;
+   }
+   unsigned length = header.m_length - MLogFile::PACKET_HEADER_SIZE;
+   Muint32 sessionId = 0;
+   if ( header.m_code == MMonitor::MESSAGE_SESSION_PACKET && length >= MLogFile::SESSION_PREFIX_SIZE )
+   {
+      char prefix [ MLogFile::SESSION_PREFIX_SIZE ];
+      DoReadBytes(prefix, MLogFile::SESSION_PREFIX_SIZE);
+      memcpy(&sessionId, prefix, sizeof(Muint32));
+      memcpy(&header.m_code, prefix + sizeof(Muint32), sizeof(Muint16));
+      header.m_length -= MLogFile::SESSION_PREFIX_SIZE;
+      length -= MLogFile::SESSION_PREFIX_SIZE;
+   }
+
+   const char* body = m_body + m_offset;
+   if ( length <= m_bodySize - m_offset ) // the body is within the page, no copy
+      m_offset += length;
+   else
+   {
+      m_spanBuffer.resize(length);
+      DoReadBytes(&m_spanBuffer[0], length);
+      body = m_spanBuffer.data();
+   }
+
+   if ( m_offset == m_bodySize ) // the next packet starts on the next page
+      DoNextPage();
+   if ( m_pageIndex == m_firstPageIndex && m_offset == m_firstOffset ) // went around all pages of a file that was not closed properly
+      m_endOfFile = true;
+
+   packet.m_header = header;
+   packet.m_body = body;
+   packet.m_bodyLength = length;
+   packet.m_sessionId = sessionId;
+   return true;
+}
+
+unsigned MLogFileMappedReader::VerifyPages(unsigned numberOfThreads)
+{
+   M_ASSERT(IsOpen());
+   if ( numberOfThreads == 0 )
+      numberOfThreads = static_cast<unsigned>(MUtilities::GetNumberOfProcessors());
+   if ( numberOfThreads > m_numberOfPages )
+      numberOfThreads = m_numberOfPages;
+
+   if ( numberOfThreads > 1 )
+   {
+      std::vector<MLogFileMappedReaderVerifier*> verifiers;
+      try
+      {
+         for ( unsigned i = 0; i < numberOfThreads; ++i )
+         {
+            verifiers.push_back(M_NEW MLogFileMappedReaderVerifier(this, i, numberOfThreads));
+            verifiers.back()->Start();
+         }
+      }
+      catch ( ... )
+      {
+         for ( unsigned j = 0; j < verifiers.size(); ++j )
+         {
+            verifiers[j]->WaitUntilFinished(false);
+            delete verifiers[j];
+         }
+         throw;
+      }
+      for ( unsigned j = 0; j < verifiers.size(); ++j )
+      {
+         verifiers[j]->WaitUntilFinished(false);
+         delete verifiers[j];
+      }
+   }
+
+   unsigned badPages = 0;
+   MByteString expandedBody;
+   bool isExpanded;
+   for ( unsigned i = 0; i < m_numberOfPages; ++i ) // with one thread, this does all the work
+      if ( !DoVerifyPage(i, expandedBody, isExpanded) )
+         ++badPages;
+   return badPages;
+}
+
+bool MLogFileMappedReader::DoExpandPage(const MLogFile::LogFilePage* page, MByteString& expandedBody) M_NO_THROW
+{
+   Muint16 sizes [ 2 ]; // compressed size, decompressed size
+   memcpy(sizes, page->m_body, MLogFile::COMPRESSED_BODY_PREFIX_SIZE);
+   if ( sizes[0] > MLogFile::PAGE_BODY_SIZE - MLogFile::COMPRESSED_BODY_PREFIX_SIZE || sizes[1] > MLogFile::PAGE_EXPANDED_BODY_SIZE ||
+        (page->m_firstMessageOffset != NIL && page->m_firstMessageOffset >= sizes[1]) )
+   {
+      return false;
+   }
+   try
+   {
+      unsigned expandedSize = 0;
+      expandedBody.resize(sizes[1]);
+      return MLzCodec::DecompressBuffer(page->m_body + MLogFile::COMPRESSED_BODY_PREFIX_SIZE, sizes[0], sizes[1] == 0 ? NULL : &expandedBody[0], sizes[1], expandedSize) && expandedSize == sizes[1];
+   }
+   catch ( ... ) // out of memory is a bad page too, this is not to throw from a worker thread
+   {
+      return false;
+   }
+}
+
+bool MLogFileMappedReader::DoVerifyPage(unsigned index, MByteString& expandedBody, bool& isExpanded) M_NO_THROW
+{
+   M_ASSERT(index < m_numberOfPages);
+   isExpanded = false;
+   char& state = m_pageStates[index];
+   if ( state == PAGE_STATE_UNKNOWN )
+   {
+      MLogFile::LogFilePage* page = reinterpret_cast<MLogFile::LogFilePage*>(m_data + size_t(index) * MLogFile::PAGE_TOTAL_SIZE);
+      bool good = page->OnceAfterRead(); // obfuscated page is restored in place
+      if ( good && page->IsCompressed() )
+      {
+         good = DoExpandPage(page, expandedBody);
+         isExpanded = good;
+      }
+      state = good ? char(PAGE_STATE_GOOD) : char(PAGE_STATE_BAD);
+   }
+   return state == PAGE_STATE_GOOD;
+}
+
+MLogFile::LogFilePage* MLogFileMappedReader::DoGetPage(unsigned index, MByteString& expandedBody, bool& isExpanded)
+{
+   if ( !DoVerifyPage(index, expandedBody, isExpanded) )
+   {
+      MException::ThrowBadFileFormat(m_fileName);
+      M_ENSURED_ASSERT(0);
+   }
+   return reinterpret_cast<MLogFile::LogFilePage*>(m_data + size_t(index) * MLogFile::PAGE_TOTAL_SIZE);
+}
+
+MLogFile::LogFilePage* MLogFileMappedReader::DoGetPage(unsigned index)
+{
+   bool isExpanded;
+   return DoGetPage(index, m_expandedBodies[m_currentExpandedBody ^ 1u], isExpanded); // the buffer not in use by the current page
+}
+
+void MLogFileMappedReader::DoNextPage()
+{
+   unsigned nextIndex = m_pageIndex + 1;
+   if ( nextIndex == m_numberOfPages ) // we have to start from the zero page
+      nextIndex = 0;
+   DoEnterPage(nextIndex, 0);
+}
+
+void MLogFileMappedReader::DoEnterPage(unsigned index, unsigned offset)
+{
+   // Decompress into the buffer of the page before the current one, as the current page can hold the body of the last packet
+   //
+   MByteString& expandedBody = m_expandedBodies[m_currentExpandedBody ^ 1u];
+   bool isExpanded;
+   MLogFile::LogFilePage* page = DoGetPage(index, expandedBody, isExpanded);
+   if ( page->IsCompressed() )
+   {
+      if ( !isExpanded && !DoExpandPage(page, expandedBody) ) // the page was verified before, and its body was not kept
+      {
+         MException::ThrowBadFileFormat(m_fileName);
+         M_ENSURED_ASSERT(0);
+      }
+      m_currentExpandedBody ^= 1u;
+      m_body = expandedBody.data();
+      m_bodySize = M_64_CAST(unsigned, expandedBody.size());
+   }
+   else
+   {
+      m_body = page->m_body;
+      m_bodySize = MLogFile::PAGE_BODY_SIZE;
+   }
+   m_pageIndex = index;
+   m_offset = offset;
+}
+
+void MLogFileMappedReader::DoReadBytes(char* buffer, unsigned length)
+{
+   for ( ;; )
+   {
+      unsigned remainingLen = m_bodySize - m_offset;
+      if ( remainingLen >= length ) // if the remaining bytes are in the current page
+         break;
+      if ( remainingLen > 0 )
+      {
+         if ( buffer != NULL ) // if it is not skipping the bytes
+         {
+            memcpy(buffer, m_body + m_offset, remainingLen);
+            buffer += remainingLen;
+         }
+         length -= remainingLen;
+      }
+      DoNextPage();
+   }
+   if ( buffer != NULL ) // if it is not skipping the bytes
+      memcpy(buffer, m_body + m_offset, length);
+   m_offset += length;
+}
+
+#endif // !M_NO_MCOM_LOG_FILE_MAPPED_READER
@@ -0,0 +1,237 @@
+#ifndef MCOM_LOGFILEMAPPEDREADER_H
+#define MCOM_LOGFILEMAPPEDREADER_H
+/// \addtogroup MCOM
+///@{
+/// \file MCOM/LogFileMappedReader.h
+
+#include <MCOM/LogFile.h>
+#include <MCORE/MNonCopyable.h>
+
+#if !M_NO_MCOM_LOG_FILE_MAPPED_READER
+
+/// Reader of monitor log files that maps the whole file into memory, and gives packets without copying them.
+///
+/// Unlike MLogFileReader, which reads every page into its own buffer and copies every packet
+/// into the buffer of the caller, this reader gives the packet body as a pointer into the mapped file.
+/// Only the bodies of packets that span page boundaries are assembled into an internal buffer,
+/// as the page headers and footers are interleaved with the bytes of such packets.
+/// This makes the reader suitable for offline analysis of large amounts of logs.
+///
+/// Pages are verified lazily, at the time the reader enters the page, so only the pages
+/// actually read are touched. Alternatively, all pages can be verified at once
+/// by several threads with \ref VerifyPages.
+/// The file is mapped copy-on-write, so pages of obfuscated files are restored in place
+/// without changing the file itself, while pages of the plain files are never copied.
+/// Compressed pages are decompressed when they are verified, and again when the reader enters them,
+/// and only the bodies of the current page and of the page before it are kept, so the memory taken does not grow with the file.
+///
+/// Typical use:
+/// \code
+///     MLogFileMappedReader reader("session.mon");
+///     MLogFileMappedReader::Packet packet;
+///     while ( reader.ReadPacket(packet) )
+///     {
+///         ... use packet.m_header.m_code and packet.m_body of packet.m_bodyLength bytes ...
+///     }
+/// \endcode
+///
+class MCOM_CLASS MLogFileMappedReader : private MNonCopyable
+{
+public: // Types:
+
+   /// Packet given by the reader.
+   ///
+   /// The packets written by MMonitorFileSession are unwrapped, the same way as by MLogFileReader.
+   ///
+   struct Packet
+   {
+      /// Header of the packet, with the code and the length of the original message for session packets.
+      ///
+      MLogFile::PacketHeader m_header;
+
+      /// Body of the packet.
+      ///
+      /// This points into the mapped file, and it is valid until the reader is closed,
+      /// unless the packet spans a page boundary or it is on a compressed page,
+      /// in which case the body is valid only until the next \ref ReadPacket.
+      ///
+      const char* m_body;
+
+      /// Length of the body in bytes.
+      ///
+      unsigned m_bodyLength;
+
+      /// Session identifier of the packet, or zero for packets written by a monitor directly, not through MMonitorFileSession.
+      ///
+      unsigned m_sessionId;
+   };
+
+public: // Constructor and destructor:
+
+   /// Constructor that creates a reader with no file.
+   ///
+   MLogFileMappedReader();
+
+   /// Constructor that maps an existing log file with the given file name.
+   ///
+   /// \pre The file shall be a valid monitor log file, or an exception is thrown.
+   ///
+   explicit MLogFileMappedReader(const MStdString& fileName);
+
+   /// Destructor, unmaps the file.
+   ///
+   ~MLogFileMappedReader() M_NO_THROW;
+
+public: // Services:
+
+   /// Map an existing file to read, and position the reader at its first packet.
+   ///
+   /// \pre The file shall be a valid monitor log file, the mapping has to be achievable
+   /// by the operating system, or an exception is thrown.
+   ///
+   void Open(const MStdString& fileName);
+
+   /// Unmap the file, if it was open. All packet bodies given by the reader become invalid.
+   ///
+   void Close() M_NO_THROW;
+
+   /// Whether the file is open.
+   ///
+   bool IsOpen() const
+   {
+      return m_data != NULL;
+   }
+
+   /// Name of the file given to Open.
+   ///
+   const MStdString& GetFileName() const
+   {
+      return m_fileName;
+   }
+
+   /// Number of pages in the file.
+   ///
+   unsigned GetNumberOfPages() const
+   {
+      return m_numberOfPages;
+   }
+
+   /// Position the reader at the first packet of the file.
+   ///
+   /// \pre The file has to be open, there is an assertion.
+   ///
+   void Reset();
+
+   /// Read the packet at the current position, and advance to the next one.
+   ///
+   /// \return True if the packet is read, false at the end of the file, in which case the packet is not changed.
+   ///
+   /// \pre The file has to be open, there is an assertion.
+   /// If a page with the packet is corrupt, a bad file format exception is thrown.
+   ///
+   bool ReadPacket(Packet& packet);
+
+   /// Verify all pages of the file that were not verified yet, using the given number of threads.
+   ///
+   /// Corrupt pages are not reported by this call, but \ref ReadPacket throws an exception when it reaches one.
+   ///
+   /// \param numberOfThreads
+   ///     Number of threads to verify pages, zero to use the number of processors.
+   ///
+   /// \return The number of corrupt pages in the file.
+   ///
+   /// \pre The file has to be open, there is an assertion.
+   /// There shall be enough resources to start the threads, or a system error is thrown.
+   ///
+   unsigned VerifyPages(unsigned numberOfThreads = 0);
+
+private: // Services:
+
+   // Decompress the body of the compressed page into the buffer given, and return whether the page is good.
+   //
+   static bool DoExpandPage(const MLogFile::LogFilePage* page, MByteString& expandedBody) M_NO_THROW;
+
+   // Verify the page with the given index, if it is not verified already, and return whether it is good.
+   // The compressed page is decompressed into the buffer given, and isExpanded tells whether this was done by this call.
+   // This can be called for different pages by many threads at once, each with its own buffer.
+   //
+   bool DoVerifyPage(unsigned index, MByteString& expandedBody, bool& isExpanded) M_NO_THROW;
+
+   // Get the verified page with the given index, or throw bad file format exception.
+   // The buffer and the flag are the same as in DoVerifyPage, and the second variant uses the buffer not taken by the current page.
+   //
+   MLogFile::LogFilePage* DoGetPage(unsigned index, MByteString& expandedBody, bool& isExpanded);
+   MLogFile::LogFilePage* DoGetPage(unsigned index);
+
+   // Copy the given number of bytes from the current position, advancing to the next pages if necessary.
+   // If the buffer is NULL, the bytes are skipped.
+   //
+   void DoReadBytes(char* buffer, unsigned length);
+
+   // Go to the start of the next page in the ring of pages.
+   //
+   void DoNextPage();
+
+   // Make the page with the given index current, and position at the given offset within its stream of messages.
+   //
+   void DoEnterPage(unsigned index, unsigned offset);
+
+private: // Data:
+
+   // Name of the file
+   //
+   MStdString m_fileName;
+
+   // Start of the mapped file, NULL if the file is not open
+   //
+   char* m_data;
+
+   // Size of the mapping in bytes
+   //
+   size_t m_size;
+
+   // Number of pages in the mapping
+   //
+   unsigned m_numberOfPages;
+
+   // State of every page, whether it is verified, and the result
+   //
+   std::vector<char> m_pageStates;
+
+   // Index of the page where the last message is written
+   //
+   unsigned m_lastPageIndex;
+
+   // Page and offset within the page body of the first packet
+   //
+   unsigned m_firstPageIndex;
+   unsigned m_firstOffset;
+
+   // Decompressed bodies of the current page and of the page before it, if they are compressed,
+   // and the index of the one that belongs to the current page
+   //
+   MByteString m_expandedBodies [ 2 ];
+   unsigned m_currentExpandedBody;
+
+   // Current page, its stream of messages, and offset within it
+   //
+   unsigned m_pageIndex;
+   const char* m_body;
+   unsigned m_bodySize;
+   unsigned m_offset;
+
+   // Whether the end of file is reached
+   //
+   bool m_endOfFile;
+
+   // Body of the last packet read, if it spans the page boundary
+   //
+   MByteString m_spanBuffer;
+
+   friend class MLogFileMappedReaderVerifier;
+};
+
+#endif // !M_NO_MCOM_LOG_FILE_MAPPED_READER
+
+///@}
+#endif
@@ -3,6 +3,7 @@
 #include "MCOMExtern.h"
 #include "MCOMExceptions.h"
 #include "LogFileReader.h"
+#include "Monitor.h"
 
 #if !M_NO_MCOM_MONITOR && !M_NO_MULTITHREADING && !M_NO_FILESYSTEM
 
@@ -17,6 +18,7 @@ void MLogFileReader::Open(const MStdString& fileName)
    m_firstPosition = 0;
    Close();
    DoOpen(fileName, true); // return value is ignored, not used: as the file is read-only we cannot repair it
+   DoOpenIndex();
    for ( m_currentPageIndex = m_lastPageIndex + 1; ; ++m_currentPageIndex )
    {
       if ( m_currentPageIndex >= m_numberOfPages )
@@ -30,14 +32,35 @@ void MLogFileReader::Open(const MStdString& fileName)
          M_ENSURED_ASSERT(0);
       }
    }
-   m_pageBodyPtr = m_page.m_body + m_page.m_firstMessageOffset;
+   m_pageBodyPtr = m_pageBody + m_page.m_firstMessageOffset;
    m_position = m_firstPosition = DoGetPosition();
 }
 
 const MLogFile::PacketHeader& MLogFileReader::ReadPacketHeader()
 {
-   m_position = DoGetPosition();
-   DoReadBytes((char*)&m_header, PACKET_HEADER_SIZE); 
+   for ( ;; )
+   {
+      m_position = DoGetPosition();
+      DoReadBytes((char*)&m_header, PACKET_HEADER_SIZE); 
+      m_sessionId = 0;
+      if ( m_header.m_code == MMonitor::MESSAGE_SESSION_PACKET && m_header.m_length >= PACKET_HEADER_SIZE + SESSION_PREFIX_SIZE )
+      {
+         char prefix [ SESSION_PREFIX_SIZE ];
+         DoReadBytes(prefix, SESSION_PREFIX_SIZE);
+         memcpy(&m_sessionId, prefix, sizeof(Muint32));
+         memcpy(&m_header.m_code, prefix + sizeof(Muint32), sizeof(Muint16));
+         m_header.m_length -= SESSION_PREFIX_SIZE;
+      }
+      if ( m_sessionFilter == 0 || m_sessionFilter == m_sessionId || EndOfFile() )
+         break;
+      SkipPacketBody();
+      if ( DoGetPosition() == m_firstPosition ) // went around all pages of a file that was not closed properly
+      {
+         m_header.m_length = 0; // report end of file
+         m_sessionId = 0;
+         break;
+      }
+   }
    return m_header;
 }
 
@@ -65,17 +88,236 @@ void MLogFileReader::SetPosition(PositionType ptr)
       DoReadPage(pageIndex);
       M_ASSERT(pageIndex == m_currentPageIndex);
    }
-   m_pageBodyPtr = (char*)&m_page + unsigned(ptr >> POSITION_OFFSET_SHIFT);
+   m_pageBodyPtr = m_pageBody + (unsigned(ptr >> POSITION_OFFSET_SHIFT) - PAGE_HEADER_SIZE);
+}
+
+bool MLogFileReader::SeekTimeStamp(Muint32 timeStamp)
+{
+   M_ASSERT(IsOpen());
+
+   Muint32 timeBase;
+   unsigned code;
+   SetPosition(m_firstPosition);
+   if ( !DoScanPacket(timeBase, code) ) // no packets in the file
+   {
+      m_header.m_length = 0;
+      return false;
+   }
+   const Muint32 timeOffset = timeStamp - timeBase; // unsigned arithmetic handles the tick wrap
+   if ( static_cast<Mint32>(timeOffset) <= 0 ) // the time is at or before the first packet
+   {
+      DoSetFoundPosition(m_firstPosition);
+      return true;
+   }
+
+   // Binary search for the first page with the last time stamp no earlier than the one given.
+   // Pages on which no message starts belong to the page that follows them.
+   //
+   const unsigned count = DoGetNumberOfLogicalPages();
+   unsigned found = count;
+   unsigned lo = 0;
+   unsigned hi = count;
+   PageSummary summary;
+   while ( lo < hi )
+   {
+      unsigned mid = lo + (hi - lo) / 2;
+      for ( ; mid < hi; ++mid )
+      {
+         DoGetPageSummary(DoGetPhysicalPageIndex(mid), summary);
+         if ( !summary.IsEmpty() )
+            break;
+      }
+      if ( mid == hi ) // all pages starting from the middle are empty
+         hi = lo + (hi - lo) / 2;
+      else if ( Muint32(summary.m_lastTimeStamp - timeBase) >= timeOffset )
+         hi = found = mid;
+      else
+         lo = mid + 1;
+   }
+
+   // Scan the page found, and in case the summary was not exact, the pages after it
+   //
+   for ( ; found < count; ++found )
+   {
+      const unsigned index = DoGetPhysicalPageIndex(found);
+      PositionType position;
+      bool endOfFile = false;
+      if ( DoGetFirstMessagePosition(index, position) && DoSeekOnPage(index, position, true, 0, timeBase, timeOffset, endOfFile) )
+         return true;
+      if ( endOfFile )
+         break;
+   }
+   m_header.m_length = 0; // all packets are earlier
+   return false;
+}
+
+bool MLogFileReader::SeekCode(unsigned code)
+{
+   M_ASSERT(IsOpen());
+
+   // Rest of the current page first, then the pages that can have the code
+   //
+   bool endOfFile = false;
+   const unsigned currentIndex = m_currentPageIndex;
+   if ( DoIsPositionOnPage(currentIndex) && DoSeekOnPage(currentIndex, DoGetPosition(), false, code, 0, 0, endOfFile) )
+      return true;
+   if ( !endOfFile && currentIndex != m_lastPageIndex )
+   {
+      const unsigned count = DoGetNumberOfLogicalPages();
+      const unsigned firstPage = m_firstPosition & POSITION_PAGE_MASK;
+      unsigned logicalIndex = (currentIndex + m_numberOfPages - firstPage) % m_numberOfPages + 1;
+      PageSummary summary;
+      for ( ; logicalIndex < count; ++logicalIndex )
+      {
+         const unsigned index = DoGetPhysicalPageIndex(logicalIndex);
+         DoGetPageSummary(index, summary);
+         if ( !summary.MayHaveCode(code) )
+            continue;
+         PositionType position;
+         if ( DoGetFirstMessagePosition(index, position) && DoSeekOnPage(index, position, false, code, 0, 0, endOfFile) )
+            return true;
+         if ( endOfFile )
+            break;
+      }
+   }
+   m_header.m_length = 0; // no more packets with such code
+   return false;
+}
+
+void MLogFileReader::DoOpenIndex() M_NO_THROW
+{
+   try
+   {
+      const MStdString indexFileName = GetIndexFileName(m_fileName);
+      if ( MUtilities::IsPathExisting(indexFileName) )
+      {
+         m_indexFile.Open(indexFileName, MStreamFile::FlagReadOnly, MStreamFile::SharingAllowAll);
+         Muint32 header [ 2 ];
+         if ( m_indexFile.ReadAvailableBytes((char*)header, INDEX_HEADER_SIZE) != INDEX_HEADER_SIZE ||
+              header[0] != Muint32(INDEX_HEADER_SIGNATURE) || header[1] != Muint32(INDEX_RECORD_SIZE) )
+         {
+            m_indexFile.Close(); // unknown format, pages will be read instead
+         }
+      }
+   }
+   catch ( ... ) // the log is read without the index
+   {
+      m_indexFile.Close();
+   }
+}
+
+Muint32 MLogFileReader::DoReadPageCounter(unsigned index)
+{
+   Muint32 header [ PAGE_HEADER_SIZE / sizeof(Muint32) ]; // signature, last page index, page counter, first message offset
+   m_file.SetPosition(long(index * PAGE_TOTAL_SIZE));
+   if ( m_file.ReadAvailableBytes((char*)header, PAGE_HEADER_SIZE) != PAGE_HEADER_SIZE )
+      return 0;
+   if ( header[0] == Muint32(PAGE_OBFUSCATED_HEADER_SIGNATURE) || header[0] == Muint32(PAGE_COMPRESSED_OBFUSCATED_HEADER_SIGNATURE) ) // both are obfuscated with the same key
+      return header[2] ^ Muint32(PAGE_OBFUSCATED_HEADER_SIGNATURE);
+   return header[2];
+}
+
+void MLogFileReader::DoGetPageSummary(unsigned index, PageSummary& summary)
+{
+   if ( m_indexFile.IsOpen() )
+   {
+      try
+      {
+         m_indexFile.SetPosition(long(INDEX_HEADER_SIZE + index * INDEX_RECORD_SIZE));
+         if ( m_indexFile.ReadAvailableBytes((char*)&summary, INDEX_RECORD_SIZE) == INDEX_RECORD_SIZE &&
+              summary.m_pageCounter != 0 && summary.m_pageCounter == DoReadPageCounter(index) )
+         {
+            return; // the summary was written together with the page
+         }
+      }
+      catch ( ... ) // the log is read without the index
+      {
+         m_indexFile.Close();
+      }
+   }
+
+   summary.Clear();
+   PositionType position;
+   if ( DoGetFirstMessagePosition(index, position) )
+   {
+      Muint32 timeStamp;
+      unsigned code;
+      while ( DoIsPositionOnPage(index) && DoScanPacket(timeStamp, code) )
+      {
+         summary.Add(timeStamp, code);
+         if ( DoGetPosition() == m_firstPosition ) // went around all pages
+            break;
+      }
+   }
+}
+
+bool MLogFileReader::DoGetFirstMessagePosition(unsigned index, PositionType& position)
+{
+   DoReadPage(index);
+   if ( m_page.m_firstMessageOffset == NIL )
+      return false;
+   m_pageBodyPtr = m_pageBody + m_page.m_firstMessageOffset;
+   position = DoGetPosition();
+   return true;
+}
+
+bool MLogFileReader::DoScanPacket(Muint32& timeStamp, unsigned& code)
+{
+   PacketHeader header;
+   DoReadBytes((char*)&header, PACKET_HEADER_SIZE);
+   if ( header.m_length < PACKET_HEADER_SIZE ) // end of file, or a broken packet
+      return false;
+   timeStamp = header.m_timeStamp;
+   code = header.m_code;
+   unsigned length = header.m_length - PACKET_HEADER_SIZE;
+   if ( header.m_code == MMonitor::MESSAGE_SESSION_PACKET && length >= SESSION_PREFIX_SIZE )
+   {
+      char prefix [ SESSION_PREFIX_SIZE ];
+      DoReadBytes(prefix, SESSION_PREFIX_SIZE);
+      Muint16 sessionCode;
+      memcpy(&sessionCode, prefix + sizeof(Muint32), sizeof(Muint16));
+      code = sessionCode;
+      length -= SESSION_PREFIX_SIZE;
+   }
+   if ( length > 0 )
+      DoReadBytes(NULL, length);
+   return true;
+}
+
+bool MLogFileReader::DoSeekOnPage(unsigned index, PositionType from, bool byTime, unsigned code, Muint32 timeBase, Muint32 timeOffset, bool& endOfFile)
+{
+   SetPosition(from);
+   while ( DoIsPositionOnPage(index) )
+   {
+      const PositionType position = DoGetPosition();
+      Muint32 packetTimeStamp;
+      unsigned packetCode;
+      if ( !DoScanPacket(packetTimeStamp, packetCode) )
+      {
+         endOfFile = true;
+         return false;
+      }
+      if ( byTime ? Muint32(packetTimeStamp - timeBase) >= timeOffset : packetCode == code )
+      {
+         DoSetFoundPosition(position);
+         return true;
+      }
+      if ( DoGetPosition() == m_firstPosition ) // went around all pages of a file that was not closed properly
+      {
+         endOfFile = true;
+         return false;
+      }
+   }
+   return false;
 }
 
 void MLogFileReader::DoReadBytes(char* buff, unsigned length)
 {
    M_ASSERT(length > 0);
-   const char* const pageEnd = m_page.m_body + sizeof(m_page.m_body);
-   M_ASSERT(m_pageBodyPtr >= m_page.m_body && m_pageBodyPtr <= pageEnd);
+   M_ASSERT(m_pageBodyPtr >= m_pageBody && m_pageBodyPtr <= m_pageBodyEnd);
    for ( ;; )
    {
-      unsigned remainingLen = unsigned(pageEnd - m_pageBodyPtr);
+      unsigned remainingLen = unsigned(m_pageBodyEnd - m_pageBodyPtr); // the end is different for every compressed page
       if ( remainingLen >= length ) // if the remaining buffer will fit in the current page
          break;
       if ( remainingLen > 0 )
@@ -92,7 +334,7 @@ void MLogFileReader::DoReadBytes(char* buff, unsigned length)
       if ( nextIndex == m_numberOfPages ) // we have to start from the zero page
          nextIndex = 0;
       DoReadPage(nextIndex);
-      M_ASSERT(m_pageBodyPtr == m_page.m_body);
+      M_ASSERT(m_pageBodyPtr == m_pageBody);
    }
    if ( buff != NULL ) // if it is not skipping the bytes
       memcpy(buff, m_pageBodyPtr, length);
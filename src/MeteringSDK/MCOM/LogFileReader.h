@@ -64,8 +64,10 @@ public: // Constructor and destructor:
    ///
    MLogFileReader()
    :
-      MLogFile()
+      MLogFile(),
       // no need to initialize m_position or m_header
+      m_sessionId(0),
+      m_sessionFilter(0)
    {
    }
 
@@ -76,8 +78,10 @@ public: // Constructor and destructor:
    ///
    explicit MLogFileReader(const MStdString& fileName)
    :
-      MLogFile()
+      MLogFile(),
       // no need to initialize m_position or m_header
+      m_sessionId(0),
+      m_sessionFilter(0)
    {
       Open(fileName);
    }
@@ -119,10 +123,38 @@ public: // Services:
 
    /// Read the packet header of the current packet.
    ///
+   /// A packet written by MMonitorFileSession is unwrapped, so the header has the code
+   /// and the length of the original message, and \ref GetPacketSessionId tells its session.
+   /// When \ref GetSessionFilter is not zero, the packets of the other sessions are skipped.
+   ///
    /// \pre It shall not be an end of file condition, or there is an assertion.
    ///
    const MLogFile::PacketHeader& ReadPacketHeader();
 
+   /// Session identifier of the packet read last by \ref ReadPacketHeader.
+   ///
+   /// This is zero for packets written by a monitor directly, not through MMonitorFileSession.
+   ///
+   unsigned GetPacketSessionId() const
+   {
+      return m_sessionId;
+   }
+
+   ///@{
+   /// Session, which packets are returned by \ref ReadPacketHeader, zero for all packets.
+   ///
+   /// When a session is given, all other packets are skipped, including those written not through a session.
+   ///
+   unsigned GetSessionFilter() const
+   {
+      return m_sessionFilter;
+   }
+   void SetSessionFilter(unsigned sessionId)
+   {
+      m_sessionFilter = sessionId;
+   }
+   ///@}
+
    /// Get the length of the packet body after the reader was read successfully.
    ///
    /// \pre It shall not be an end of file condition, or there is an assertion.
@@ -169,6 +201,99 @@ public: // Services:
    ///
    void SetPosition(PositionType ptr);
 
+   /// Position the reader at the first packet with the time stamp equal to or later than the one given.
+   ///
+   /// Time stamps are tick counts in milliseconds, which are compared relative to the time stamp
+   /// of the first packet in the file, so the tick counter wrap is handled properly.
+   /// If the time given precedes the first packet, the reader is positioned at the first packet.
+   /// The pages are located with the page index file written together with the log,
+   /// and in case it is absent or out of date, by reading the pages themselves,
+   /// at most a logarithmic number of pages in either case.
+   ///
+   /// \return True if such packet is found, and the next \ref ReadPacketHeader will return it.
+   ///       False if all packets are earlier than the time given, in which case \ref EndOfFile is true.
+   ///
+   /// \pre The file has to be open. Also, any file read error can be raised.
+   ///
+   bool SeekTimeStamp(Muint32 timeStamp);
+
+   /// Position the reader at the next packet with the given code, starting from the current position.
+   ///
+   /// Packets of sessions are looked up by their own codes. The session filter is not applied by this call,
+   /// but it is applied by the subsequent \ref ReadPacketHeader, which can skip the packet found.
+   /// The pages which have no packets with such code according to the page index file are not read.
+   ///
+   /// \return True if such packet is found, and the next \ref ReadPacketHeader will return it.
+   ///       False if there are no such packets, in which case \ref EndOfFile is true.
+   ///
+   /// \pre The file has to be open. Also, any file read error can be raised.
+   ///
+   bool SeekCode(unsigned code);
+
+private: // Services:
+
+   // Open the page index file of the log, if it is present and valid.
+   //
+   void DoOpenIndex() M_NO_THROW;
+
+   // Read the page counter from the header of the page with the given index, without reading the whole page.
+   // Return zero if the page cannot be read.
+   //
+   Muint32 DoReadPageCounter(unsigned index);
+
+   // Get the summary of the messages that start on the page with the given index.
+   // The summary is taken from the page index file if it is valid for the page, otherwise the page is read.
+   //
+   void DoGetPageSummary(unsigned index, PageSummary& summary);
+
+   // Read the page with the given index, and get the position of the first message on it.
+   // Return false if no message starts on the page.
+   //
+   bool DoGetFirstMessagePosition(unsigned index, PositionType& position);
+
+   // Whether the current position is the start of a message on the page with the given index.
+   //
+   bool DoIsPositionOnPage(unsigned index) const
+   {
+      return m_currentPageIndex == index && m_pageBodyPtr < m_pageBodyEnd;
+   }
+
+   // Read the packet at the current position, and return its time stamp and code, the original code for session packets.
+   // Return false if the end of the file is reached.
+   //
+   bool DoScanPacket(Muint32& timeStamp, unsigned& code);
+
+   // Look for the packet that starts on the given page at or after the given position,
+   // and either has the given code, or the time stamp offset relative to the time base no less than the one given.
+   // If found, position the reader at the packet and return true.
+   // Return false if no such packet starts on the page, with endOfFile set to true if there are no more packets.
+   //
+   bool DoSeekOnPage(unsigned index, PositionType from, bool byTime, unsigned code, Muint32 timeBase, Muint32 timeOffset, bool& endOfFile);
+
+   // Number of pages in the ring of pages from the first position to the last page.
+   //
+   unsigned DoGetNumberOfLogicalPages() const
+   {
+      const unsigned firstPage = m_firstPosition & POSITION_PAGE_MASK;
+      return (m_lastPageIndex + m_numberOfPages - firstPage) % m_numberOfPages + 1;
+   }
+
+   // Physical index of the page which is the given number of pages from the page of the first position.
+   //
+   unsigned DoGetPhysicalPageIndex(unsigned logicalIndex) const
+   {
+      return ((m_firstPosition & POSITION_PAGE_MASK) + logicalIndex) % m_numberOfPages;
+   }
+
+   // Position the reader at the packet found
+   //
+   void DoSetFoundPosition(PositionType position)
+   {
+      SetPosition(position);
+      m_position = position;
+      m_header.m_length = Muint32(-1); // this is to prevent end of file condition
+   }
+
 private: // Services:
 
    // Read the bytes from the current position within the page into the buffer.
@@ -186,7 +311,7 @@ private: // Services:
    PositionType DoGetPosition() const
    {
       M_ASSERT(m_currentPageIndex <= NUMBER_OF_PAGES_LIMIT); // this is the precondition in the writer
-      Muint32 posOnPage = static_cast<Muint32>((const char*)m_pageBodyPtr - (const char*)&m_page);
+      Muint32 posOnPage = static_cast<Muint32>((const char*)m_pageBodyPtr - (const char*)m_pageBody + PAGE_HEADER_SIZE);
       return (posOnPage << POSITION_OFFSET_SHIFT) | Muint32(m_currentPageIndex);
    }
 
@@ -203,6 +328,14 @@ private: // Services:
    // First position within the file, used to reset the contents
    //
    PositionType m_firstPosition;
+
+   // Session identifier of the current packet, or zero
+   //
+   Muint32 m_sessionId;
+
+   // Session which packets are read, or zero for all packets
+   //
+   Muint32 m_sessionFilter;
 };
 
 #endif // !M_NO_MCOM_MONITOR
@@ -4,6 +4,7 @@
 #include "MCOMExceptions.h"
 #include "LogFileWriter.h"
 #include "MonitorFile.h"
+#include <MCORE/MLzCodec.h>
 
 #if !M_NO_MCOM_MONITOR && !M_NO_MULTITHREADING && !M_NO_FILESYSTEM
 
@@ -23,31 +24,44 @@ void MLogFileWriter::Open(const MStdString& fileName, unsigned maxFileSizeKB)
 
    SetMaxFileSizeKB(maxFileSizeKB);
    bool wasFinished = DoOpen(fileName, false);
+   DoOpenIndex();
    if ( m_numberOfPages != 0 )
    {
       if ( wasFinished ) // otherwise there is no need to write the page 0
       {
          DoReadPage(0u);
          m_page.m_lastPageIndex = NIL; // by this tell the file is in process of being written
-         DoWritePage(0u, true); // nullify the last page field
+         DoRewritePage(0u); // nullify the last page field
       }
-      DoReadPage(m_lastPageIndex);        // go to the end of the log
+      DoReadPage(m_lastPageIndex);        // go to the end of the log, this also takes the compression from the last page
       m_pageCounter = m_page.m_pageCounter;
-      m_pageBodyPtr = m_page.m_body + m_page.m_firstMessageOffset;
-      char* bodyEnd = m_page.m_body + sizeof(m_page.m_body) - PACKET_HEADER_SIZE; // last packet on the page
+      m_pageBodyPtr = m_pageBody + m_page.m_firstMessageOffset;
+      char* bodyEnd = m_pageBodyEnd - PACKET_HEADER_SIZE; // last packet on the page
 
-      // Now find the last message on this page.
+      // Now find the last message on this page, and make the summary of the messages that start on it.
+      m_pageSummary.Clear();
+      m_messageStarts.clear();
       PacketHeader header;
       for ( ;; )
       {
          memcpy(&header, m_pageBodyPtr, PACKET_HEADER_SIZE);
          if ( header.m_length == 0 ) // end of the file
             break;
+         DoAddMessage(m_pageBodyPtr, header, (m_pageBodyPtr + SESSION_PREFIX_SIZE <= bodyEnd) ? m_pageBodyPtr + PACKET_HEADER_SIZE : NULL);
          char* nextPageBodyPtr = m_pageBodyPtr + header.m_length;
          if ( nextPageBodyPtr > bodyEnd ) // possibly, the file was corrupt, not finished; or simply the end packet is on the next page
             break;
          m_pageBodyPtr = nextPageBodyPtr;
       }
+      if ( m_page.IsCompressed() ) // continue collecting messages of the page beyond what was decompressed
+      {
+         unsigned limit = unsigned(m_pageBodyPtr - m_pageBody) + PAGE_BODY_SIZE;
+         if ( limit < m_expandedBodyLimit )
+            limit = m_expandedBodyLimit;
+         else if ( limit > PAGE_EXPANDED_BODY_SIZE )
+            limit = PAGE_EXPANDED_BODY_SIZE;
+         m_pageBodyEnd = m_pageBody + limit;
+      }
    }
    else // zero size, new file
    {
@@ -55,7 +69,8 @@ void MLogFileWriter::Open(const MStdString& fileName, unsigned maxFileSizeKB)
       M_ASSERT(m_lastPageIndex == 0);
       m_currentPageIndex = 0;
       m_pageCounter = 0;
-      DoInitNewPage();
+      m_messageStarts.clear();
+      DoInitNewPage(m_compress);
    }
 }
 
@@ -68,13 +83,30 @@ void MLogFileWriter::Close() M_NO_THROW
          // Write end-of-file actually, end-of-packets
          //
          static const PacketHeader s_zeroPacketHeader;
+         if ( m_page.IsCompressed() && m_pageBodyEnd - m_pageBodyPtr < PACKET_HEADER_SIZE )
+            DoNextPage(); // end-of-packets mark of a compressed page is not split between pages
+         DoStartMessage(s_zeroPacketHeader, NULL);
          unsigned last = m_currentPageIndex; // save current index in a temporary, the tail can be on another page
-         DoSetFirstMessageOffset();
          DoWriteBytes((const char*)&s_zeroPacketHeader, PACKET_HEADER_SIZE);
+         if ( m_page.IsCompressed() ) // write all collected messages, and finish with the page that has the end-of-packets mark
+         {
+            for ( ;; )
+            {
+               const unsigned used = unsigned(m_pageBodyPtr - m_pageBody);
+               const unsigned markOffset = used - PACKET_HEADER_SIZE;
+               unsigned consumed = DoCompressPage(used);
+               if ( consumed == used )
+                  break;
+               if ( consumed > markOffset ) // the end-of-packets mark goes to the next page entirely
+                  consumed = DoCompressPage(markOffset);
+               DoAdvancePage(consumed, true);
+            }
+            last = m_currentPageIndex;
+         }
          DoWritePage(m_currentPageIndex);
          DoReadPage(0u);
          m_page.m_lastPageIndex = last;
-         DoWritePage(0u, true);
+         DoRewritePage(0u);
       }
       catch ( ... ) // avoid exception flown from Close
       {
@@ -97,33 +129,33 @@ void MLogFileWriter::SetMaxFileSizeKB(unsigned size)
 
 void MLogFileWriter::WriteMessage(const char* data, size_t dataSize)
 {
-   DoSetFirstMessageOffset();
+   PacketHeader header;
+   memcpy(&header, data, PACKET_HEADER_SIZE); // fix memory alignment on ARM
+   DoStartMessage(header, data + PACKET_HEADER_SIZE);
    DoWriteBytes(data, static_cast<unsigned>(dataSize));
 }
 
 void MLogFileWriter::WriteMessage(const MLogFile::PacketHeader& header, const char* data)
 {
-   DoSetFirstMessageOffset();
+   DoStartMessage(header, data);
    DoWriteBytes((const char*)&header, PACKET_HEADER_SIZE);
    unsigned dataSize = header.GetPacketBodyLength();
    if ( dataSize != 0 )
       DoWriteBytes(data, dataSize);
 }
 
-void MLogFileWriter::WriteMessage(unsigned code, const char* data, unsigned length)
+void MLogFileWriter::WriteMessage(unsigned code, const char* message, unsigned length)
 {
-   DoSetFirstMessageOffset();
    PacketHeader header(Muint32(length), code);
+   DoStartMessage(header, message);
    DoWriteBytes((const char*)&header, PACKET_HEADER_SIZE);
    if ( length != 0 )
-      DoWriteBytes(data, length);
+      DoWriteBytes(message, length);
 }
 
-void MLogFileWriter::WriteMultipleMessages(const MByteString& messagesBuffer)
+void MLogFileWriter::WriteMultipleMessages(const char* data, unsigned size)
 {
-   const char* data = messagesBuffer.data();
-   unsigned size = M_64_CAST(unsigned, messagesBuffer.size());
-   unsigned remainingLen = unsigned(m_page.m_body + sizeof(m_page.m_body) - m_pageBodyPtr);
+   unsigned remainingLen = unsigned(m_pageBodyEnd - m_pageBodyPtr);
    if ( remainingLen >= size ) // a lot faster way is if the whole message fits within the remaining page
    {
       #if M_DEBUG   // check for validity of the buffer, it has to contain complete messages only
@@ -145,6 +177,13 @@ void MLogFileWriter::WriteMultipleMessages(const MByteString& messagesBuffer)
       #endif
 
       DoSetFirstMessageOffset();
+      for ( const char* packet = data; packet < data + size; )
+      {
+         PacketHeader hdr;
+         memcpy(&hdr, packet, PACKET_HEADER_SIZE); // fix memory alignment on ARM
+         DoAddMessage(m_pageBodyPtr + (packet - data), hdr, packet + PACKET_HEADER_SIZE);
+         packet += hdr.m_length;
+      }
       memcpy(m_pageBodyPtr, data, size);
       m_pageBodyPtr += size;
    }
@@ -154,9 +193,9 @@ void MLogFileWriter::WriteMultipleMessages(const MByteString& messagesBuffer)
       const PacketHeader* lastPacket = (PacketHeader*)(data + size);
       while ( packet < lastPacket )
       {
-         DoSetFirstMessageOffset();
          PacketHeader hdr;
          memcpy(&hdr, packet, PACKET_HEADER_SIZE); // fix memory alignment on ARM
+         DoStartMessage(hdr, (const char*)packet + PACKET_HEADER_SIZE);
          DoWriteBytes((const char*)packet, hdr.m_length);
          packet = (PacketHeader*)((const char*)packet + hdr.m_length);
       }
@@ -166,11 +205,10 @@ void MLogFileWriter::WriteMultipleMessages(const MByteString& messagesBuffer)
 void MLogFileWriter::DoWriteBytes(const char* buff, unsigned length)
 {
    M_ASSERT(length > 0);
-   const char* const pageEnd = m_page.m_body + sizeof(m_page.m_body);
-   M_ASSERT(m_pageBodyPtr >= m_page.m_body && m_pageBodyPtr <= pageEnd);
+   M_ASSERT(m_pageBodyPtr >= m_pageBody && m_pageBodyPtr <= m_pageBodyEnd);
    for ( ;; )
    {
-      unsigned remainingLen = unsigned(pageEnd - m_pageBodyPtr);
+      unsigned remainingLen = unsigned(m_pageBodyEnd - m_pageBodyPtr); // the end is different for every compressed page
       if ( remainingLen >= length ) // if the remaining buffer will fit in the current page
          break;
       if ( remainingLen > 0 )
@@ -180,51 +218,245 @@ void MLogFileWriter::DoWriteBytes(const char* buff, unsigned length)
          buff += remainingLen;
          length -= remainingLen;
       }
-      DoWritePage(m_currentPageIndex);
-      if ( m_currentPageIndex >= m_maxNumberOfPages ) // we have to start from the zero page
-         m_currentPageIndex = 0;
-      else
-         ++m_currentPageIndex;
-      m_lastPageIndex = m_currentPageIndex;
-      DoInitNewPage();
-      // notify listener
-      if ( m_listener != NULL )
-         m_listener->OnPageBoundHit();
-      M_ASSERT(m_pageBodyPtr == m_page.m_body);
+      DoNextPage();
    }
    memcpy(m_pageBodyPtr, buff, length);
    m_pageBodyPtr += length;
 }
 
-void MLogFileWriter::DoInitNewPage() M_NO_THROW
+void MLogFileWriter::DoNextPage()
+{
+   unsigned used = unsigned(m_pageBodyPtr - m_pageBody);
+   if ( !m_page.IsCompressed() )
+   {
+      DoAdvancePage(used, m_compress);
+      return;
+   }
+
+   unsigned consumed = DoCompressPage(used);
+   if ( !m_compress ) // compression is switched off, the messages collected still go to compressed pages
+   {
+      while ( consumed < used )
+      {
+         DoAdvancePage(consumed, true);
+         used -= consumed;
+         consumed = DoCompressPage(used);
+      }
+   }
+   DoAdvancePage(consumed, m_compress);
+}
+
+void MLogFileWriter::DoAdvancePage(unsigned consumed, bool compressed)
+{
+   const unsigned used = unsigned(m_pageBodyPtr - m_pageBody);
+   M_ASSERT(consumed <= used);
+   M_ASSERT(consumed == used || (compressed && m_page.IsCompressed()));
+   if ( m_page.IsCompressed() )
+   {
+      // Collect as many messages for the next page as it is likely to fit after compression
+      //
+      unsigned limit = (consumed < used) ? consumed + consumed / 16 : used * 2;
+      if ( limit < used - consumed + PAGE_BODY_SIZE )
+         limit = used - consumed + PAGE_BODY_SIZE;
+      m_expandedBodyLimit = (limit < PAGE_EXPANDED_BODY_SIZE) ? limit : PAGE_EXPANDED_BODY_SIZE;
+
+      std::vector<MessageStart>::iterator it = m_messageStarts.begin();
+      while ( it != m_messageStarts.end() && it->m_offset < consumed )
+         ++it;
+      m_messageStarts.erase(m_messageStarts.begin(), it);
+      for ( it = m_messageStarts.begin(); it != m_messageStarts.end(); ++it )
+         it->m_offset -= consumed;
+   }
+
+   DoWritePage(m_currentPageIndex);
+   if ( m_currentPageIndex >= m_maxNumberOfPages ) // we have to start from the zero page
+      m_currentPageIndex = 0;
+   else
+      ++m_currentPageIndex;
+   m_lastPageIndex = m_currentPageIndex;
+   DoInitNewPage(compressed);
+   if ( consumed < used ) // carry the rest of the messages, both buffers are the same
+   {
+      const unsigned carried = used - consumed;
+      memmove(m_pageBody, m_pageBody + consumed, carried);
+      m_pageBodyPtr += carried;
+   }
+   // notify listener
+   if ( m_listener != NULL )
+      m_listener->OnPageBoundHit();
+}
+
+unsigned MLogFileWriter::DoCompressPage(unsigned size) M_NO_THROW
+{
+   M_ASSERT(m_page.IsCompressed());
+   const unsigned available = PAGE_BODY_SIZE - COMPRESSED_BODY_PREFIX_SIZE;
+   unsigned consumed = size;
+   const unsigned compressedSize = MLzCodec::CompressBuffer(m_pageBody, consumed, m_page.m_body + COMPRESSED_BODY_PREFIX_SIZE, available);
+   const Muint16 sizes [ 2 ] = { static_cast<Muint16>(compressedSize), static_cast<Muint16>(consumed) };
+   memcpy(m_page.m_body, sizes, COMPRESSED_BODY_PREFIX_SIZE);
+   memset(m_page.m_body + COMPRESSED_BODY_PREFIX_SIZE + compressedSize, 0, available - compressedSize); // nullify the rest of the page
+
+   m_page.m_firstMessageOffset = NIL;
+   m_pageSummary.Clear();
+   std::vector<MessageStart>::const_iterator it = m_messageStarts.begin();
+   std::vector<MessageStart>::const_iterator itEnd = m_messageStarts.end();
+   for ( ; it != itEnd && it->m_offset < consumed; ++it )
+   {
+      if ( m_page.m_firstMessageOffset == NIL )
+         m_page.m_firstMessageOffset = it->m_offset;
+      if ( it->m_counted )
+         m_pageSummary.Add(it->m_timeStamp, it->m_code);
+   }
+   return consumed;
+}
+
+void MLogFileWriter::DoStartMessage(const PacketHeader& header, const char* body)
+{
+   if ( m_pageBodyPtr == m_pageBodyEnd ) // the message starts on the next page
+      DoNextPage();
+   DoSetFirstMessageOffset();
+   DoAddMessage(m_pageBodyPtr, header, body);
+}
+
+void MLogFileWriter::DoAddMessage(const char* start, const PacketHeader& header, const char* body)
+{
+   if ( m_page.IsCompressed() ) // the page summary is made at compression, when it is known which messages fit
+   {
+      MessageStart messageStart;
+      messageStart.m_offset = Muint32(start - m_pageBody);
+      messageStart.m_timeStamp = header.m_timeStamp;
+      messageStart.m_code = DoGetMessageCode(header, body);
+      messageStart.m_counted = header.m_length != 0;
+      m_messageStarts.push_back(messageStart);
+   }
+   else if ( header.m_length != 0 ) // end-of-packets mark is not a message
+      m_pageSummary.Add(header.m_timeStamp, DoGetMessageCode(header, body));
+}
+
+unsigned MLogFileWriter::DoGetMessageCode(const PacketHeader& header, const char* body)
+{
+   if ( header.m_code == MMonitor::MESSAGE_SESSION_PACKET && body != NULL && header.GetPacketBodyLength() >= SESSION_PREFIX_SIZE )
+   {
+      Muint16 code;
+      memcpy(&code, body + sizeof(Muint32), sizeof(code)); // fix memory alignment on ARM
+      return code;
+   }
+   return header.m_code;
+}
+
+void MLogFileWriter::DoInitNewPage(bool compressed) M_NO_THROW
 {
    M_ASSERT(IsOpen());
    ++m_numberOfPages;
-   m_pageBodyPtr = (char*)m_page.m_body;
-   m_page.m_signature = m_obfuscate ? PAGE_OBFUSCATED_HEADER_SIGNATURE : PAGE_HEADER_SIGNATURE;
+   if ( compressed )
+   {
+      DoReserveExpandedBody();
+      m_pageBody = &m_expandedBody[0];
+      m_pageBodyEnd = m_pageBody + m_expandedBodyLimit;
+      m_page.m_signature = m_obfuscate ? PAGE_COMPRESSED_OBFUSCATED_HEADER_SIGNATURE : PAGE_COMPRESSED_HEADER_SIGNATURE;
+   }
+   else
+   {
+      m_pageBody = m_page.m_body;
+      m_pageBodyEnd = m_pageBody + PAGE_BODY_SIZE;
+      m_page.m_signature = m_obfuscate ? PAGE_OBFUSCATED_HEADER_SIGNATURE : PAGE_HEADER_SIGNATURE;
+   }
+   m_pageBodyPtr = m_pageBody;
    m_page.m_lastPageIndex = NIL;
    m_page.m_firstMessageOffset = NIL; // by default, no valid messages exist in the page
+   m_pageSummary.Clear();
   // m_page.m_pageCounter will be initialized on page write
 }
 
-void MLogFileWriter::DoWritePage(unsigned index, bool doNotNullifyUnusedSpace)
+void MLogFileWriter::DoWritePage(unsigned index)
 {
-   M_ASSERT(IsOpen());
-   M_ASSERT(m_page.m_signature == (unsigned)PAGE_HEADER_SIGNATURE || m_page.m_signature == (unsigned)PAGE_OBFUSCATED_HEADER_SIGNATURE);
-   M_ASSERT(index <= m_numberOfPages);
-
-   if ( !doNotNullifyUnusedSpace )
+   if ( !m_page.IsCompressed() ) // compressed page is prepared by DoCompressPage
    {
       int diff = int((const char*)m_page.m_body + sizeof(m_page.m_body) - m_pageBodyPtr);
       if ( diff > 0 )
          memset(m_pageBodyPtr, 0, diff); // nullify the rest of the page
    }
+   DoWritePageBytes(index);
+   DoWritePageSummary(index);
+}
+
+void MLogFileWriter::DoRewritePage(unsigned index)
+{
+   const Muint32 previousCounter = DoWritePageBytes(index);
+   DoUpdatePageSummaryCounter(index, previousCounter);
+}
 
+Muint32 MLogFileWriter::DoWritePageBytes(unsigned index)
+{
+   M_ASSERT(IsOpen());
+   M_ASSERT(index <= m_numberOfPages);
+
+   const Muint32 previousCounter = m_page.m_pageCounter;
    m_page.m_pageCounter = ++m_pageCounter;
    m_page.OnceBeforeWrite();
 
    m_file.SetPosition(long(index * PAGE_TOTAL_SIZE));
    m_file.WriteBytes((char*)&m_page, PAGE_TOTAL_SIZE);
+   return previousCounter;
+}
+
+void MLogFileWriter::DoOpenIndex() M_NO_THROW
+{
+   try
+   {
+      m_indexFile.Open(GetIndexFileName(m_fileName), MStreamFile::FlagCreate | MStreamFile::FlagReadWrite, MStreamFile::SharingAllowRead);
+      Muint32 header [ 2 ];
+      if ( m_indexFile.ReadAvailableBytes((char*)header, INDEX_HEADER_SIZE) != INDEX_HEADER_SIZE ||
+           header[0] != Muint32(INDEX_HEADER_SIGNATURE) || header[1] != Muint32(INDEX_RECORD_SIZE) )
+      {
+         header[0] = INDEX_HEADER_SIGNATURE;
+         header[1] = INDEX_RECORD_SIZE;
+         m_indexFile.SetPosition(0);
+         m_indexFile.WriteBytes((const char*)header, INDEX_HEADER_SIZE); // records of another format will not match page counters
+      }
+   }
+   catch ( ... ) // the log is useful without the index
+   {
+      m_indexFile.Close();
+   }
+}
+
+void MLogFileWriter::DoWritePageSummary(unsigned index) M_NO_THROW
+{
+   if ( !m_indexFile.IsOpen() )
+      return;
+   try
+   {
+      m_pageSummary.m_pageCounter = m_pageCounter;
+      m_indexFile.SetPosition(long(INDEX_HEADER_SIZE + index * INDEX_RECORD_SIZE));
+      m_indexFile.WriteBytes((const char*)&m_pageSummary, INDEX_RECORD_SIZE);
+   }
+   catch ( ... ) // the log is useful without the index
+   {
+      m_indexFile.Close();
+   }
+}
+
+void MLogFileWriter::DoUpdatePageSummaryCounter(unsigned index, Muint32 previousCounter) M_NO_THROW
+{
+   if ( !m_indexFile.IsOpen() )
+      return;
+   try
+   {
+      const long position = long(INDEX_HEADER_SIZE + index * INDEX_RECORD_SIZE);
+      Muint32 counter;
+      m_indexFile.SetPosition(position);
+      if ( m_indexFile.ReadAvailableBytes((char*)&counter, sizeof(counter)) == sizeof(counter) && counter == previousCounter )
+      {
+         counter = m_pageCounter;
+         m_indexFile.SetPosition(position);
+         m_indexFile.WriteBytes((const char*)&counter, sizeof(counter));
+      }
+   }
+   catch ( ... ) // the log is useful without the index
+   {
+      m_indexFile.Close();
+   }
 }
 
 #endif // !M_NO_MCOM_MONITOR
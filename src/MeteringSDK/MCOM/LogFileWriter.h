@@ -14,6 +14,21 @@
 ///
 class MCOM_CLASS MLogFileWriter : public MLogFile
 {
+   enum
+   {
+      INITIAL_EXPANDED_BODY_LIMIT = PAGE_BODY_SIZE * 4 // messages collected for the first compressed page, before the compression ratio is known
+   };
+
+   // Start of the message within the stream of messages of a compressed page
+   //
+   struct MessageStart
+   {
+      Muint32 m_offset;
+      Muint32 m_timeStamp;
+      unsigned m_code;
+      bool m_counted; // whether the message is accounted in the page summary, false for the end-of-packets mark
+   };
+
 public: // Constructor and destructor:
 
    /// Constructor that creates an uninitialized log file object.
@@ -22,8 +37,11 @@ public: // Constructor and destructor:
    :
       MLogFile(),
       m_maxFileSizeKB(0),
-      m_maxNumberOfPages(0)
+      m_maxNumberOfPages(0),
+      m_expandedBodyLimit(INITIAL_EXPANDED_BODY_LIMIT),
+      m_messageStarts()
    {
+      m_pageSummary.Clear();
    }
 
    /// Constructor that creates a writable log file with the given file name.
@@ -36,8 +54,11 @@ public: // Constructor and destructor:
    :
       MLogFile(),
       m_maxFileSizeKB(0),
-      m_maxNumberOfPages(0)
+      m_maxNumberOfPages(0),
+      m_expandedBodyLimit(INITIAL_EXPANDED_BODY_LIMIT),
+      m_messageStarts()
    {
+      m_pageSummary.Clear();
       Open(fileName, maxFileSizeKB);
    }
 
@@ -115,13 +136,69 @@ public: // Services:
    /// with this service, only a number of complete messages. There is a debug check
    /// for a format error. Also, any file write-related exception can be thrown.
    ///
-   void WriteMultipleMessages(const MByteString& messages);
+   void WriteMultipleMessages(const MByteString& messages)
+   {
+      WriteMultipleMessages(messages.data(), M_64_CAST(unsigned, messages.size()));
+   }
+
+   /// Send several messages formatted as a buffer containing packets, given by pointer and size.
+   ///
+   /// \pre Messages have a valid format, no part of a message can be written
+   /// with this service, only a number of complete messages. There is a debug check
+   /// for a format error. Also, any file write-related exception can be thrown.
+   ///
+   void WriteMultipleMessages(const char* data, unsigned size);
 
 private: // Services:
 
    // Initialize the data in the page so it appears cleared.
+   // The page is compressed if requested, otherwise it is a plain page.
+   //
+   void DoInitNewPage(bool compressed) M_NO_THROW;
+
+   // Write the current page, and start the next one.
+   // If the current page is compressed, the messages that did not fit into it are carried to the next page.
+   //
+   // \pre Any file write-related exception can be thrown.
+   //
+   void DoNextPage();
+
+   // Write the current page, of which the given number of bytes of the stream of messages is consumed,
+   // and start the next page. The bytes not consumed are carried to the next page, which has to be compressed.
+   //
+   // \pre Any file write-related exception can be thrown.
    //
-   void DoInitNewPage() M_NO_THROW;
+   void DoAdvancePage(unsigned consumed, bool compressed);
+
+   // Compress as much of the given number of bytes from the stream of messages of the current page as fits into the page.
+   // Set the first message offset and the page summary according to the messages compressed.
+   // Return the number of bytes compressed.
+   //
+   unsigned DoCompressPage(unsigned size) M_NO_THROW;
+
+   // Account the message with the given header and body, which starts at the given place of the current page.
+   //
+   void DoAddMessage(const char* start, const PacketHeader& header, const char* body);
+
+   // Called before the packet with the given header and body is written,
+   // set the first message offset if necessary and account the packet in the page summary.
+   // If the current page is full, the packet starts on the next page.
+   //
+   void DoStartMessage(const PacketHeader& header, const char* body);
+
+   // Open or create the page index file that corresponds to the log file.
+   // Errors are not reported, the log is written without the index in this case.
+   //
+   void DoOpenIndex() M_NO_THROW;
+
+   // Write the summary of the current page, which has the given index, into the page index file.
+   //
+   void DoWritePageSummary(unsigned index) M_NO_THROW;
+
+   // The page with the given index is the same, but it got a new page counter.
+   // Update the counter in the page index file, but only if the summary there was valid for the previous page counter.
+   //
+   void DoUpdatePageSummaryCounter(unsigned index, Muint32 previousCounter) M_NO_THROW;
 
    // Write the chunk of data to the pages.
    //
@@ -129,12 +206,23 @@ private: // Services:
    //
    void DoWriteBytes(const char* body, unsigned length);
 
-   // Write m_page into the given index.
+   // Write the current page m_page into the given index, nullify its unused space, and write its summary.
    //
    // \pre The read operation has to be successful, or a file exception takes place.
    // The index has to be within range, there is a debug check.
    //
-   void DoWritePage(unsigned index, bool doNotNullifyUnusedSpace = false);
+   void DoWritePage(unsigned index);
+
+   // Write back m_page, read from the given index to change its header.
+   // The body is written as is, and the page summary is kept, as m_pageSummary belongs to the current page.
+   //
+   // \pre The read operation has to be successful, or a file exception takes place.
+   //
+   void DoRewritePage(unsigned index);
+
+   // Give m_page the next page counter, and write it into the given index, return its previous page counter.
+   //
+   Muint32 DoWritePageBytes(unsigned index);
 
    // Called internally before writing the message to set the offset of message
    // which appears first in the page.
@@ -145,9 +233,15 @@ private: // Services:
    void DoSetFirstMessageOffset()
    {
       if ( m_page.m_firstMessageOffset == (Muint32)-1 ) // if the page does not have a first message yet
-         m_page.m_firstMessageOffset = Muint32(m_pageBodyPtr - m_page.m_body); // initialize it
+         m_page.m_firstMessageOffset = Muint32(m_pageBodyPtr - m_pageBody); // initialize it
    }
 
+   // Code of the message by which it is accounted in the page summary,
+   // the original message code for session packets.
+   // Body can be NULL if it is not available, in which case the code of the header is returned.
+   //
+   static unsigned DoGetMessageCode(const PacketHeader& header, const char* body);
+
 private: // Data members:
 
    // Maximum file size in kilobytes, or zero if the file size is not restrained, in which case
@@ -158,6 +252,18 @@ private: // Data members:
    // Maximum number of pages that correspond to the maximum file size
    //
    unsigned m_maxNumberOfPages;
+
+   // Summary of the messages that start on the current page
+   //
+   PageSummary m_pageSummary;
+
+   // How many bytes of messages to collect for the next compressed page, adapts to the compression ratio
+   //
+   unsigned m_expandedBodyLimit;
+
+   // Starts of the messages collected for the current compressed page, not used for plain pages
+   //
+   std::vector<MessageStart> m_messageStarts;
 };
 
 #endif // !M_NO_MCOM_MONITOR
@@ -14,16 +14,23 @@
 #include <MCOM/ChannelModemCallback.h>
 #include <MCOM/ChannelSocket.h>
 #include <MCOM/ChannelSocketCallback.h>
+#include <MCOM/ChannelSocketListener.h>
 #include <MCOM/ChannelSocketUdp.h>
 #include <MCOM/ChannelSocketUdpCallback.h>
+#include <MCOM/ChannelLoopback.h>
+#include <MCOM/ChannelReplay.h>
+#include <MCOM/LatencyHistogram.h>
+#include <MCOM/SessionTrace.h>
 #include <MCOM/ProtocolC1218.h>
 #include <MCOM/ProtocolC1221.h>
 #include <MCOM/ProtocolC1222.h>
 #include <MCOM/Monitor.h>
 #include <MCOM/MonitorSocket.h>
+#include <MCOM/MonitorFileSession.h>
 #include <MCOM/MonitorSyslog.h>
 #include <MCOM/LogFile.h>
 #include <MCOM/LogFileWriter.h>
 #include <MCOM/LogFileReader.h>
+#include <MCOM/LogFileMappedReader.h>
 
 #endif
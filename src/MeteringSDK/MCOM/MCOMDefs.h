@@ -78,6 +78,38 @@
    #error "MCOM: Handling of peer disconnect is a socket channel feature that requires multithreading"
 #endif
 
+/// Whether or not to include MChannelSocketListener, multithreaded server of incoming socket connections.
+///
+#ifndef M_NO_MCOM_CHANNEL_SOCKET_LISTENER
+   #define M_NO_MCOM_CHANNEL_SOCKET_LISTENER (M_NO_MCOM_CHANNEL_SOCKET || M_NO_MULTITHREADING)
+#elif !M_NO_MCOM_CHANNEL_SOCKET_LISTENER && (M_NO_MCOM_CHANNEL_SOCKET || M_NO_MULTITHREADING)
+   #error "MCOM: Socket listener requires socket channel and multithreading"
+#endif
+
+
+/// Whether or not to include MChannelLoopback, in-process pair of channels, included by default.
+///
+#ifndef M_NO_MCOM_CHANNEL_LOOPBACK
+   #define M_NO_MCOM_CHANNEL_LOOPBACK M_NO_MULTITHREADING
+#elif !M_NO_MCOM_CHANNEL_LOOPBACK && M_NO_MULTITHREADING
+   #error "MCOM: Loopback channel requires multithreading"
+#endif
+
+/// Whether or not to include MChannelReplay, replay of sessions recorded by monitor file, included by default.
+///
+#ifndef M_NO_MCOM_CHANNEL_REPLAY
+   #define M_NO_MCOM_CHANNEL_REPLAY (M_NO_MCOM_MONITOR || M_NO_MULTITHREADING || M_NO_FILESYSTEM)
+#elif !M_NO_MCOM_CHANNEL_REPLAY && (M_NO_MCOM_MONITOR || M_NO_MULTITHREADING || M_NO_FILESYSTEM)
+   #error "MCOM: Replay channel requires monitor, multithreading and file system"
+#endif
+
+/// Whether or not to include MLogFileMappedReader, memory mapped reader of monitor log files, included by default.
+///
+#ifndef M_NO_MCOM_LOG_FILE_MAPPED_READER
+   #define M_NO_MCOM_LOG_FILE_MAPPED_READER (M_NO_MCOM_MONITOR || M_NO_MULTITHREADING || M_NO_FILESYSTEM)
+#elif !M_NO_MCOM_LOG_FILE_MAPPED_READER && (M_NO_MCOM_MONITOR || M_NO_MULTITHREADING || M_NO_FILESYSTEM)
+   #error "MCOM: Mapped log file reader requires monitor, multithreading and file system"
+#endif
 
 /// Whether or not to include MCOM ChannelModem feature, included by default.
 ///
@@ -142,6 +174,24 @@
 #endif
 
 
+/// Whether or not to collect latency histograms of protocol services and link layer packets.
+///
+/// By default, latency histograms are collected.
+///
+#ifndef M_NO_MCOM_LATENCY_HISTOGRAMS
+   #define M_NO_MCOM_LATENCY_HISTOGRAMS 0
+#endif
+
+
+/// Whether or not to have session tracing, timeline of protocol services, packets and channel operations.
+///
+/// By default, session tracing is included, but it has to be enabled at runtime with MSessionTrace.
+///
+#ifndef M_NO_MCOM_SESSION_TRACE
+   #define M_NO_MCOM_SESSION_TRACE 0
+#endif
+
+
 /// Whether or not to have protocol method Protocol.IdentifyMeter and related.
 ///
 /// By default, include Protocol.IdentifyMeter.
@@ -229,6 +279,15 @@ class MCOM_CLASS MChannel;
    class MCOM_CLASS MChannelSocket;
    class MCOM_CLASS MChannelSocketCallback;
 #endif
+#if !M_NO_MCOM_CHANNEL_SOCKET_LISTENER
+   class MCOM_CLASS MChannelSocketListener;
+#endif
+#if !M_NO_MCOM_CHANNEL_LOOPBACK
+   class MCOM_CLASS MChannelLoopback;
+#endif
+#if !M_NO_MCOM_CHANNEL_REPLAY
+   class MCOM_CLASS MChannelReplay;
+#endif
 #if !M_NO_MCOM_CHANNEL_SOCKET_UDP
    class MCOM_CLASS MChannelSocketUdp;
    class MCOM_CLASS MChannelSocketUdpCallback;
@@ -258,6 +317,7 @@ class MCOM_CLASS MProtocol;
 #if !M_NO_MCOM_MONITOR
    class MCOM_CLASS MMonitor;
    class MCOM_CLASS MMonitorFile;
+   class MCOM_CLASS MMonitorFileSession;
    class MCOM_CLASS MMonitorSocket;
    class MCOM_CLASS MLogFile;
    class MCOM_CLASS MLogFileWriter;
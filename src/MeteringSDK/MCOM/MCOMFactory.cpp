@@ -46,74 +46,120 @@ M_END_CLASS(COMFactory, Object)
       }
    #endif
 
-MChannel* MCOMFactory::CreateChannelByName(const MStdString& channelName)
+   template
+      <class Channel>
+   static MChannel* DoNewChannel()
+   {
+      return M_NEW Channel();
+   }
+
+   template
+      <class Protocol>
+   static MProtocol* DoNewProtocol(MChannel* channel)
+   {
+      return M_NEW Protocol(channel);
+   }
+
+MCOMFactory::ChannelCreatorType MCOMFactory::DoFindChannelCreator(const MStdString& channelName)
 {
 #if !M_NO_MCOM_CHANNEL_SOCKET
    if ( MChannelSocket::GetStaticClass()->MatchesClassOrTypeName(channelName) )
-      return SetMonitor(M_NEW MChannelSocket());
+      return DoNewChannel<MChannelSocket>;
    if ( MChannelSocketCallback::GetStaticClass()->MatchesClassOrTypeName(channelName) )
-      return SetMonitor(M_NEW MChannelSocketCallback());
+      return DoNewChannel<MChannelSocketCallback>;
 #endif
 
 #if !M_NO_MCOM_CHANNEL_SOCKET_UDP
    if ( MChannelSocketUdp::GetStaticClass()->MatchesClassOrTypeName(channelName) )
-      return SetMonitor(M_NEW MChannelSocketUdp());
+      return DoNewChannel<MChannelSocketUdp>;
    if ( MChannelSocketUdpCallback::GetStaticClass()->MatchesClassOrTypeName(channelName) )
-      return SetMonitor(M_NEW MChannelSocketUdpCallback());
+      return DoNewChannel<MChannelSocketUdpCallback>;
 #endif
 
 #if !M_NO_SERIAL_PORT
    if ( MChannelOpticalProbe::GetStaticClass()->MatchesClassOrTypeName(channelName) )
-      return SetMonitor(M_NEW MChannelOpticalProbe());
+      return DoNewChannel<MChannelOpticalProbe>;
    if ( MChannelSerialPort::GetStaticClass()->MatchesClassOrTypeName(channelName) )
-      return SetMonitor(M_NEW MChannelSerialPort());
+      return DoNewChannel<MChannelSerialPort>;
    if ( MChannelCurrentLoop::GetStaticClass()->MatchesClassOrTypeName(channelName) )
-      return SetMonitor(M_NEW MChannelCurrentLoop());
+      return DoNewChannel<MChannelCurrentLoop>;
 #endif
 
 #if !M_NO_MCOM_CHANNEL_MODEM
    if ( MChannelModem::GetStaticClass()->MatchesClassOrTypeName(channelName) )
-      return SetMonitor(M_NEW MChannelModem());
+      return DoNewChannel<MChannelModem>;
    if ( MChannelModemCallback::GetStaticClass()->MatchesClassOrTypeName(channelName) )
-      return SetMonitor(M_NEW MChannelModemCallback());
+      return DoNewChannel<MChannelModemCallback>;
+#endif
+
+#if !M_NO_MCOM_CHANNEL_LOOPBACK
+   if ( MChannelLoopback::GetStaticClass()->MatchesClassOrTypeName(channelName) )
+      return DoNewChannel<MChannelLoopback>;
+#endif
+
+#if !M_NO_MCOM_CHANNEL_REPLAY
+   if ( MChannelReplay::GetStaticClass()->MatchesClassOrTypeName(channelName) )
+      return DoNewChannel<MChannelReplay>;
 #endif
 
-   MCOMException::Throw(M_ERR_UNKNOWN_CHANNEL_S1, "Channel '%s' is unknown", channelName.c_str());
-   M_ENSURED_ASSERT(0); // we are never here
    return NULL;
 }
 
-MChannel* MCOMFactory::CreateChannel(const MStdString& channelSource)
+MChannel* MCOMFactory::CreateChannelByName(const MStdString& channelName)
 {
-   MDictionary properties(channelSource);
-   MVariant* val = properties.GetValue(MCOMObject::s_typeString);
+   ChannelCreatorType creator = DoFindChannelCreator(channelName);
+   if ( creator == NULL )
+   {
+      MCOMException::Throw(M_ERR_UNKNOWN_CHANNEL_S1, "Channel '%s' is unknown", channelName.c_str());
+      M_ENSURED_ASSERT(0); // we are never here
+   }
+   return SetMonitor(creator());
+}
+
+MStdString MCOMFactory::DoGetTypeName(const MDictionary& properties, const MStdString& source)
+{
+   const MVariant* val = properties.GetValue(MCOMObject::s_typeString);
    if ( val == NULL )
       val = properties.GetValue(MCOMObject::s_typeCamelcaseString);
-   const MStdString channelName = (val != NULL) ? val->AsString() : channelSource;
-   MUniquePtr<MChannel> channel(CreateChannelByName(channelName));
+   return (val != NULL) ? val->AsString() : source;
+}
+
+MChannel* MCOMFactory::CreateChannel(const MStdString& channelSource)
+{
+   MDictionary properties(channelSource);
+   MUniquePtr<MChannel> channel(CreateChannelByName(DoGetTypeName(properties, channelSource)));
    channel->SetPropertyValues(properties);
 
 
    return channel.release();
 }
 
-MProtocol* MCOMFactory::CreateProtocolByName(MChannel* channel, const MStdString& protocolName)
+MCOMFactory::ProtocolCreatorType MCOMFactory::DoFindProtocolCreator(const MStdString& protocolName)
 {
 #if !M_NO_MCOM_PROTOCOL_C1218
    if ( MProtocolC1218::GetStaticClass()->MatchesClassOrTypeName(protocolName) )
-      return M_NEW MProtocolC1218(channel);
+      return DoNewProtocol<MProtocolC1218>;
 #endif
 #if !M_NO_MCOM_PROTOCOL_C1221
    if ( MProtocolC1221::GetStaticClass()->MatchesClassOrTypeName(protocolName) )
-      return M_NEW MProtocolC1221(channel);
+      return DoNewProtocol<MProtocolC1221>;
 #endif
 #if !M_NO_MCOM_PROTOCOL_C1222
    if ( MProtocolC1222::GetStaticClass()->MatchesClassOrTypeName(protocolName) )
-      return M_NEW MProtocolC1222(channel);
+      return DoNewProtocol<MProtocolC1222>;
 #endif
-   MCOMException::Throw(M_ERR_UNKNOWN_PROTOCOL_S1, "Protocol '%s' is unknown", protocolName.c_str());
-   M_ENSURED_ASSERT(0); // we are never here
-   return 0;
+   return NULL;
+}
+
+MProtocol* MCOMFactory::CreateProtocolByName(MChannel* channel, const MStdString& protocolName)
+{
+   ProtocolCreatorType creator = DoFindProtocolCreator(protocolName);
+   if ( creator == NULL )
+   {
+      MCOMException::Throw(M_ERR_UNKNOWN_PROTOCOL_S1, "Protocol '%s' is unknown", protocolName.c_str());
+      M_ENSURED_ASSERT(0); // we are never here
+   }
+   return creator(channel);
 }
 
 MProtocol* MCOMFactory::CreateProtocol(const MVariant& channelObjectOrSource, const MStdString& protocolSource)
@@ -142,11 +188,7 @@ MProtocol* MCOMFactory::CreateProtocolWithoutChannel(const MStdString& protocolS
 MProtocol* MCOMFactory::DoCreateProtocol(MChannel* channel, const MStdString& protocolSource)
 {
    MDictionary properties(protocolSource);
-   MVariant* val = properties.GetValue(MCOMObject::s_typeString);
-   if ( val == NULL )
-      val = properties.GetValue(MCOMObject::s_typeCamelcaseString);
-   const MStdString protocolName = (val != NULL) ? val->AsString() : protocolSource;
-   MUniquePtr<MProtocol> protocol(CreateProtocolByName(channel, protocolName));
+   MUniquePtr<MProtocol> protocol(CreateProtocolByName(channel, DoGetTypeName(properties, protocolSource)));
    protocol->SetPropertyValues(properties);
 
 
@@ -182,6 +224,14 @@ MStdStringVector MCOMFactory::GetAllAvailableChannels()
    DoPushBackClass(result, MChannelSocketUdpCallback::GetStaticClass());
 #endif
 
+#if !M_NO_MCOM_CHANNEL_LOOPBACK
+   DoPushBackClass(result, MChannelLoopback::GetStaticClass());
+#endif
+
+#if !M_NO_MCOM_CHANNEL_REPLAY
+   DoPushBackClass(result, MChannelReplay::GetStaticClass());
+#endif
+
    return result;
 }
 
@@ -224,4 +274,142 @@ MStdStringVector MCOMFactory::GetIdentifyStrings(const MStdString& complexIdenti
 }
 #endif // !M_NO_MCOM_IDENTIFY_METER
 
+   // Whether the property is TYPE, which is checked at compilation, but not set to every created object
+   //
+   inline bool DoIsTypeProperty(const MPropertyDefinition* def)
+   {
+      return m_strcmp(def->m_name, MCOMObject::s_typeCamelcaseString.c_str()) == 0;
+   }
+
+void MCOMObjectTemplate::DoCompile(MCOMObject* prototype, const MDictionary& properties)
+{
+   const MClass* cls = prototype->GetClass();
+   const MVariant::VariantVector& names = properties.GetAllKeys();
+   m_settings.clear();
+   m_settings.reserve(names.size());
+   for ( MVariant::VariantVector::const_iterator it = names.begin(); it != names.end(); ++it )
+   {
+      const MStdString& propertyName = it->AsString();
+      Setting setting;
+      setting.m_definition = cls->GetPropertyDefinition(propertyName);
+      setting.m_value = properties[propertyName].AsString();
+
+      // Convert the value once to what the setter would convert it on every call, collections and variants are passed as is
+      //
+      switch ( setting.m_definition->m_type )
+      {
+      case MVariant::VAR_BOOL:
+         setting.m_value = setting.m_value.AsBool();
+         break;
+      case MVariant::VAR_BYTE:
+         setting.m_value = setting.m_value.AsByte();
+         break;
+      case MVariant::VAR_CHAR:
+         setting.m_value = setting.m_value.AsChar();
+         break;
+      case MVariant::VAR_INT:
+         setting.m_value = setting.m_value.AsInt();
+         break;
+      case MVariant::VAR_UINT:
+         setting.m_value = setting.m_value.AsUInt();
+         break;
+      case MVariant::VAR_DOUBLE:
+         setting.m_value = setting.m_value.AsDouble();
+         break;
+      case MVariant::VAR_BYTE_STRING:
+         setting.m_value.AssignByteString(setting.m_value.AsByteString());
+         break;
+      default:
+         break;
+      }
+
+      prototype->SetPropertyByDefinition(setting.m_definition, setting.m_value); // the setter validates the value
+      if ( !DoIsTypeProperty(setting.m_definition) )
+         m_settings.push_back(setting);
+   }
+}
+
+void MCOMObjectTemplate::DoApply(MCOMObject* object) const
+{
+   for ( SettingVector::const_iterator it = m_settings.begin(); it != m_settings.end(); ++it )
+      object->SetPropertyByDefinition(it->m_definition, it->m_value);
+}
+
+MChannelTemplate::MChannelTemplate(const MStdString& channelSource)
+:
+   m_creator(NULL)
+{
+   MDictionary properties(channelSource);
+   const MStdString channelName = MCOMFactory::DoGetTypeName(properties, channelSource);
+   MCOMFactory::ChannelCreatorType creator = MCOMFactory::DoFindChannelCreator(channelName);
+   if ( creator == NULL )
+   {
+      MCOMException::Throw(M_ERR_UNKNOWN_CHANNEL_S1, "Channel '%s' is unknown", channelName.c_str());
+      M_ENSURED_ASSERT(0); // we are never here
+   }
+   MUniquePtr<MChannel> prototype(creator());
+   DoCompile(prototype.get(), properties);
+   m_creator = creator;
+}
+
+MChannel* MChannelTemplate::CreateChannel() const
+{
+   if ( m_creator == NULL )
+      return NULL;
+   MUniquePtr<MChannel> channel(SetMonitor(m_creator()));
+   DoApply(channel.get());
+   return channel.release();
+}
+
+MProtocolTemplate::MProtocolTemplate(const MStdString& protocolSource)
+:
+   m_channelTemplate(),
+   m_creator(NULL)
+{
+   DoCompileProtocol(protocolSource);
+}
+
+MProtocolTemplate::MProtocolTemplate(const MStdString& channelSource, const MStdString& protocolSource)
+:
+   m_channelTemplate(),
+   m_creator(NULL)
+{
+   if ( !channelSource.empty() )
+      m_channelTemplate = MChannelTemplate(channelSource);
+   DoCompileProtocol(protocolSource);
+}
+
+void MProtocolTemplate::DoCompileProtocol(const MStdString& protocolSource)
+{
+   MDictionary properties(protocolSource);
+   const MStdString protocolName = MCOMFactory::DoGetTypeName(properties, protocolSource);
+   MCOMFactory::ProtocolCreatorType creator = MCOMFactory::DoFindProtocolCreator(protocolName);
+   if ( creator == NULL )
+   {
+      MCOMException::Throw(M_ERR_UNKNOWN_PROTOCOL_S1, "Protocol '%s' is unknown", protocolName.c_str());
+      M_ENSURED_ASSERT(0); // we are never here
+   }
+   MUniquePtr<MProtocol> prototype(creator(NULL));
+   DoCompile(prototype.get(), properties);
+   m_creator = creator;
+}
+
+MProtocol* MProtocolTemplate::CreateProtocol() const
+{
+   M_ASSERT(m_creator != NULL);
+   MUniquePtr<MChannel> channel(m_channelTemplate.CreateChannel());
+   MUniquePtr<MProtocol> protocol(m_creator(channel.get()));
+   channel.release(); // the protocol owns the channel now
+   DoApply(protocol.get());
+   return protocol.release();
+}
+
+MProtocol* MProtocolTemplate::CreateProtocol(MChannel* channel) const
+{
+   M_ASSERT(m_creator != NULL);
+   MUniquePtr<MProtocol> protocol(m_creator(channel));
+   DoApply(protocol.get());
+   return protocol.release();
+}
+
 #endif // !M_NO_MCOM_FACTORY
@@ -10,6 +10,8 @@
 
 #if !M_NO_MCOM_FACTORY // Note that factory is not available without reflection
 
+class M_CLASS MDictionary;
+
 /// Factory that is capable of creating MCOM objects.
 /// This is a singleton class. No instances are required,
 /// the services are available through static reference syntax.
@@ -17,6 +19,9 @@
 class MCOM_CLASS MCOMFactory : public MObject
 {
    friend class MCOM_CLASS MCOMObject;
+   friend class MCOM_CLASS MCOMObjectTemplate;
+   friend class MCOM_CLASS MChannelTemplate;
+   friend class MCOM_CLASS MProtocolTemplate;
 
 public: // Services:
 
@@ -239,6 +244,20 @@ private: // Constructor and destructor:
 
    static MProtocol* DoCreateProtocol(MChannel* channel, const MStdString& protocolSource);
 
+   // Functions that create a channel or a protocol of a concrete type
+   //
+   typedef MChannel* (*ChannelCreatorType)();
+   typedef MProtocol* (*ProtocolCreatorType)(MChannel* channel);
+
+   // Find the function that creates a channel or a protocol by its known name, return NULL if the name is unknown
+   //
+   static ChannelCreatorType DoFindChannelCreator(const MStdString& channelName);
+   static ProtocolCreatorType DoFindProtocolCreator(const MStdString& protocolName);
+
+   // Get the name of the object from the parsed source string, which is the value of TYPE, or the whole source if there is no TYPE
+   //
+   static MStdString DoGetTypeName(const MDictionary& properties, const MStdString& source);
+
 #if !M_NO_MCOM_MONITOR
 public:
    /// \cond SHOW_INTERNAL
@@ -251,6 +270,176 @@ private:
    M_DECLARE_CLASS(COMFactory)
 };
 
+/// \cond SHOW_INTERNAL
+/// Common part of \ref MChannelTemplate and \ref MProtocolTemplate,
+/// the list of property settings resolved at compilation.
+///
+class MCOM_CLASS MCOMObjectTemplate
+{
+protected: // Types:
+
+   // Property setting with the resolved property definition and the value converted to the property type
+   //
+   struct Setting
+   {
+      const MPropertyDefinition* m_definition;
+      MVariant m_value;
+   };
+
+   typedef std::vector<Setting>
+      SettingVector;
+
+protected: // Services:
+
+   // Resolve all properties of the parsed source string for the given prototype object,
+   // and set them to the prototype, so all errors in the source are reported at compilation.
+   //
+   void DoCompile(MCOMObject* prototype, const MDictionary& properties);
+
+   // Set the compiled properties to the newly created object in the order they were compiled
+   //
+   void DoApply(MCOMObject* object) const;
+
+protected: // Data:
+
+   // Compiled property settings, the type property is not among them
+   //
+   SettingVector m_settings;
+};
+/// \endcond SHOW_INTERNAL
+
+/// Channel configuration compiled once from its source string, which creates configured channels.
+///
+/// Parsing of the source, lookup of the channel type and of every property by name happens only once
+/// at construction, and the channels are then created without any string processing.
+/// This is the way to create many channels with the same configuration:
+/// \code
+///     MChannelTemplate channelTemplate("TYPE=CHANNEL_SOCKET;PEER_ADDRESS=10.0.0.1;PEER_PORT=1153");
+///     for ( ... every meter ... )
+///     {
+///         MUniquePtr<MChannel> channel(channelTemplate.CreateChannel());
+///         ...
+///     }
+/// \endcode
+///
+/// \see MCOMFactory::CreateChannel for the format of the source string.
+///
+class MCOM_CLASS MChannelTemplate : public MCOMObjectTemplate
+{
+public: // Constructor:
+
+   /// Constructor that creates an empty template, one that creates no channel.
+   ///
+   MChannelTemplate()
+   :
+      m_creator(NULL)
+   {
+   }
+
+   /// Constructor that compiles the channel source string given.
+   ///
+   /// \pre The source shall be correct for \ref MCOMFactory::CreateChannel, and the same exception is thrown otherwise.
+   ///
+   explicit MChannelTemplate(const MStdString& channelSource);
+
+public: // Services:
+
+   /// Whether the template is empty, so it creates no channel.
+   ///
+   bool IsEmpty() const
+   {
+      return m_creator == NULL;
+   }
+
+   /// Create a new channel configured as given by the source at construction.
+   ///
+   /// \return MChannel. Null object is returned only if the template is empty.
+   ///
+   MChannel* CreateChannel() const;
+
+private: // Data:
+
+   // Function that creates the channel of the compiled type, or NULL for an empty template
+   //
+   MCOMFactory::ChannelCreatorType m_creator;
+};
+
+/// Protocol configuration compiled once from its source string, possibly together with its channel,
+/// which creates configured protocols.
+///
+/// Parsing of the sources, lookup of the types and of every property by name happens only once
+/// at construction, and the protocols are then created without any string processing:
+/// \code
+///     MProtocolTemplate protocolTemplate("TYPE=CHANNEL_SOCKET;PEER_PORT=1153", "TYPE=PROTOCOL_ANSI_C12_18;SESSION_BAUD=28800");
+///     for ( ... every meter ... )
+///     {
+///         MUniquePtr<MProtocol> protocol(protocolTemplate.CreateProtocol());
+///         ...
+///     }
+/// \endcode
+///
+/// \see MCOMFactory::CreateProtocol for the format of the source strings.
+///
+class MCOM_CLASS MProtocolTemplate : public MCOMObjectTemplate
+{
+public: // Constructors:
+
+   /// Constructor that compiles the protocol source string given, with no channel.
+   ///
+   /// \pre The source shall be correct for \ref MCOMFactory::CreateProtocolWithoutChannel, and the same exception is thrown otherwise.
+   ///
+   explicit MProtocolTemplate(const MStdString& protocolSource);
+
+   /// Constructor that compiles the channel and protocol source strings given.
+   ///
+   /// \pre The sources shall be correct for \ref MCOMFactory::CreateProtocol, and the same exception is thrown otherwise.
+   /// An empty channel source means no channel.
+   ///
+   MProtocolTemplate(const MStdString& channelSource, const MStdString& protocolSource);
+
+public: // Services:
+
+   /// Create a new protocol configured as given by the source at construction.
+   ///
+   /// If the template was compiled with a channel source, the new protocol owns a new channel
+   /// created from it, otherwise the protocol has no channel.
+   ///
+   /// \return MProtocol. Null object is never returned.
+   ///
+   MProtocol* CreateProtocol() const;
+
+   /// Create a new protocol configured as given by the protocol source at construction, with the channel given.
+   ///
+   /// The channel source, if it was given to the template, is not used.
+   ///
+   /// \param channel The channel to be assigned to and owned by the protocol, can be null.
+   ///
+   /// \return MProtocol. Null object is never returned.
+   ///
+   MProtocol* CreateProtocol(MChannel* channel) const;
+
+   /// Template of the channel, empty if the protocol is created without channel.
+   ///
+   const MChannelTemplate& GetChannelTemplate() const
+   {
+      return m_channelTemplate;
+   }
+
+private: // Services:
+
+   void DoCompileProtocol(const MStdString& protocolSource);
+
+private: // Data:
+
+   // Template of the channel created together with every protocol, possibly empty
+   //
+   MChannelTemplate m_channelTemplate;
+
+   // Function that creates the protocol of the compiled type
+   //
+   MCOMFactory::ProtocolCreatorType m_creator;
+};
+
 #endif // !M_NO_MCOM_FACTORY
 
 ///@}
@@ -28,6 +28,49 @@
       {
          return M_NEW MMonitor();
       }
+
+      // Services of the reflected client, indexes of their bits in m_clientServices
+      //
+      enum
+      {
+         CLIENT_SERVICE_ATTACH        = 0,
+         CLIENT_SERVICE_DETACH        = 1,
+         CLIENT_SERVICE_WRITE         = 2,
+         CLIENT_SERVICE_ON_MESSAGE    = 3,
+         CLIENT_SERVICE_ON_CONNECT    = 4,
+         CLIENT_SERVICE_ON_DISCONNECT = 5,
+         CLIENT_SERVICE_ON_BYTE_RX    = 6,
+         CLIENT_SERVICE_ON_BYTE_TX    = 7
+      };
+
+      static const char* const s_clientServiceNames[] =
+      {
+         "Attach",
+         "Detach",
+         "Write",
+         "OnMessage",
+         "OnConnect",
+         "OnDisconnect",
+         "OnByteRX",
+         "OnByteTX"
+      };
+
+      static const unsigned s_clientServiceNumbersOfParameters[] =
+      {
+         1, // Attach
+         0, // Detach
+         1, // Write
+         2, // OnMessage
+         0, // OnConnect
+         0, // OnDisconnect
+         1, // OnByteRX
+         1  // OnByteTX
+      };
+
+      static bool DoIsClientServicePresent(unsigned services, unsigned service)
+      {
+         return (services & (1u << service)) != 0;
+      }
    #endif
 
 M_START_PROPERTIES(Monitor)
@@ -72,14 +115,80 @@ MMonitor::MMonitor()
       M_SHARED_POINTER_CLASS_INIT,
    #endif
    m_listening(0), // we start by not listening, wait until attach is called
-   m_client(NULL)
+   m_client(NULL),
+   m_clientServices(0),
+   m_nativeClient(NULL)
 {
+   #if !M_NO_REFLECTION
+      memset(m_clientServiceDefinitions, 0, sizeof(m_clientServiceDefinitions));
+   #endif
 }
 
 MMonitor::~MMonitor()
 {
 }
 
+MMonitor::NativeClient::~NativeClient()
+{
+}
+
+void MMonitor::NativeClient::OnMessage(MessageType, const char*, int)
+{
+}
+
+void MMonitor::NativeClient::OnConnect()
+{
+}
+
+void MMonitor::NativeClient::OnDisconnect()
+{
+}
+
+void MMonitor::NativeClient::OnByteRX(const char*, int)
+{
+}
+
+void MMonitor::NativeClient::OnByteTX(const char*, int)
+{
+}
+
+void MMonitor::SetClient(MObject* client)
+{
+   unsigned services = 0;
+   #if !M_NO_REFLECTION
+      M_COMPILED_ASSERT(M_NUMBER_OF_ARRAY_ELEMENTS(s_clientServiceNames) == NUMBER_OF_CLIENT_SERVICES);
+      M_COMPILED_ASSERT(M_NUMBER_OF_ARRAY_ELEMENTS(s_clientServiceNumbersOfParameters) == NUMBER_OF_CLIENT_SERVICES);
+      for ( unsigned i = 0; i < NUMBER_OF_CLIENT_SERVICES; ++i )
+      {
+         m_clientServiceDefinitions[i] = NULL;
+         if ( client != NULL && client->IsServicePresent(s_clientServiceNames[i]) )
+         {
+            services |= 1u << i;
+            const MServiceDefinition* def = client->GetClass()->GetServiceDefinitionOrNull(s_clientServiceNames[i], s_clientServiceNumbersOfParameters[i]);
+            if ( def != NULL && def->m_objectMethod != NULL ) // otherwise the service is dynamic or static, and it is called by name
+               m_clientServiceDefinitions[i] = def;
+         }
+      }
+   #endif
+   if ( client != NULL )
+      m_listening = 1;
+   m_clientServices = services;
+   m_client = client;
+}
+
+#if !M_NO_REFLECTION
+void MMonitor::DoCallClient(unsigned service, const MVariant* params, unsigned numberOfParameters)
+{
+   M_ASSERT(service < NUMBER_OF_CLIENT_SERVICES && DoIsClientServicePresent(m_clientServices, service));
+   M_ASSERT(numberOfParameters == s_clientServiceNumbersOfParameters[service]);
+   const MServiceDefinition* def = m_clientServiceDefinitions[service];
+   if ( def != NULL )
+      m_client->CallByDefinition(def, params, numberOfParameters);
+   else
+      m_client->CallV(s_clientServiceNames[service], MVariant::VariantVector(params, params + numberOfParameters));
+}
+#endif
+
 void MMonitor::OnDataLinkLayerSuccess()
 {
    // nothing to do
@@ -149,16 +258,19 @@ void MMonitor::Attach(const MStdString& mediaIdentification)
 {
    OnMessage(MessageChannelAttach, mediaIdentification.data(), M_64_CAST(int, mediaIdentification.size()));
    #if !M_NO_REFLECTION
-      if ( m_client != NULL && m_client->IsServicePresent("Attach") )
-         m_client->Call1("Attach", mediaIdentification);
+      if ( DoIsClientServicePresent(m_clientServices, CLIENT_SERVICE_ATTACH) )
+      {
+         const MVariant param(mediaIdentification);
+         DoCallClient(CLIENT_SERVICE_ATTACH, &param, 1);
+      }
    #endif
 }
 
 void MMonitor::Detach()
 {
    #if !M_NO_REFLECTION
-      if ( m_client != NULL && m_client->IsServicePresent("Detach") )
-         m_client->Call0("Detach");
+      if ( DoIsClientServicePresent(m_clientServices, CLIENT_SERVICE_DETACH) )
+         DoCallClient(CLIENT_SERVICE_DETACH, NULL, 0);
    #endif
 }
 
@@ -166,16 +278,24 @@ void MMonitor::Write(const MStdString& message)
 {
    OnMessage(MessageUser, message.data(), M_64_CAST(int, message.size()));
 #if !M_NO_REFLECTION
-   if ( m_client != NULL && m_client->IsServicePresent("Write") )
-      m_client->Call1("Write", message);
+   if ( DoIsClientServicePresent(m_clientServices, CLIENT_SERVICE_WRITE) )
+   {
+      const MVariant param(message);
+      DoCallClient(CLIENT_SERVICE_WRITE, &param, 1);
+   }
 #endif
 }
 
 void MMonitor::OnMessage(MessageType type, const char* text, int size)
 {
+   if ( m_nativeClient != NULL )
+      m_nativeClient->OnMessage(type, text, size);
 #if !M_NO_REFLECTION
-   if ( m_client != NULL && m_client->IsServicePresent("OnMessage") )
-      m_client->Call2("OnMessage", static_cast<int>(type), MVariant(text, size));
+   if ( DoIsClientServicePresent(m_clientServices, CLIENT_SERVICE_ON_MESSAGE) )
+   {
+      const MVariant params [ 2 ] = { MVariant(static_cast<int>(type)), MVariant(text, size) };
+      DoCallClient(CLIENT_SERVICE_ON_MESSAGE, params, 2);
+   }
 #endif
 }
 
@@ -183,36 +303,50 @@ void MMonitor::OnConnect()
 {
    OnMessage(MessageChannelConnect, "", 0);
    #if !M_NO_REFLECTION
-      if ( m_client != NULL && m_client->IsServicePresent("OnConnect") )
-         m_client->Call0("OnConnect");
+      if ( DoIsClientServicePresent(m_clientServices, CLIENT_SERVICE_ON_CONNECT) )
+         DoCallClient(CLIENT_SERVICE_ON_CONNECT, NULL, 0);
    #endif
+   if ( m_nativeClient != NULL )
+      m_nativeClient->OnConnect();
 }
 
 void MMonitor::OnDisconnect()
 {
    OnMessage(MessageChannelDisconnect, "", 0);
    #if !M_NO_REFLECTION
-      if ( m_client != NULL && m_client->IsServicePresent("OnDisconnect") )
-         m_client->Call0("OnDisconnect");
+      if ( DoIsClientServicePresent(m_clientServices, CLIENT_SERVICE_ON_DISCONNECT) )
+         DoCallClient(CLIENT_SERVICE_ON_DISCONNECT, NULL, 0);
    #endif
+   if ( m_nativeClient != NULL )
+      m_nativeClient->OnDisconnect();
 }
 
 void MMonitor::OnByteRX(const char* data, int length)
 {
    OnMessage(MessageChannelByteRx, data, length);
    #if !M_NO_REFLECTION
-      if ( m_client != NULL && m_client->IsServicePresent("OnByteRX") )
-         m_client->Call1("OnByteRX", MVariant(MByteString(data, length), MVariant::ACCEPT_BYTE_STRING));
+      if ( DoIsClientServicePresent(m_clientServices, CLIENT_SERVICE_ON_BYTE_RX) )
+      {
+         const MVariant param(MByteString(data, length), MVariant::ACCEPT_BYTE_STRING);
+         DoCallClient(CLIENT_SERVICE_ON_BYTE_RX, &param, 1);
+      }
    #endif
+   if ( m_nativeClient != NULL )
+      m_nativeClient->OnByteRX(data, length);
 }
 
 void MMonitor::OnByteTX(const char* data, int length)
 {
    OnMessage(MessageChannelByteTx, data, length);
    #if !M_NO_REFLECTION
-      if ( m_client != NULL && m_client->IsServicePresent("OnByteTX") )
-         m_client->Call1("OnByteTX", MVariant(MByteString(data, length), MVariant::ACCEPT_BYTE_STRING));
+      if ( DoIsClientServicePresent(m_clientServices, CLIENT_SERVICE_ON_BYTE_TX) )
+      {
+         const MVariant param(MByteString(data, length), MVariant::ACCEPT_BYTE_STRING);
+         DoCallClient(CLIENT_SERVICE_ON_BYTE_TX, &param, 1);
+      }
    #endif
+   if ( m_nativeClient != NULL )
+      m_nativeClient->OnByteTX(data, length);
 }
 
 #endif
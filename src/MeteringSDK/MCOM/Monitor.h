@@ -216,6 +216,10 @@ public: // Types:
       // User message sent to the monitor, unicode doublebyte version.
       // User message in UNICODE is specified as parameter.
       MESSAGE_PROTOCOL_USER_MESSAGE_UNICODE = 0x61,
+
+      // Message of a session written into a monitor file shared by many channels.
+      // The body starts with a 32-bit session identifier and 16-bit code of the message, followed by the message body.
+      MESSAGE_SESSION_PACKET = 0x70,
    };
 
 /// \endcond SHOW_INTERNAL
@@ -234,6 +238,42 @@ public: // Types:
 
 #endif
 
+   /// Interface of a C++ client that receives monitor events by direct virtual calls.
+   ///
+   /// Unlike \refprop{GetClient,Client}, which is called through reflection by service name,
+   /// this interface involves no name lookup and no variant conversion of the data,
+   /// which matters for received and transmitted bytes, as they are reported for every read and write of the channel.
+   /// All services do nothing by default, so the client overrides only those it needs.
+   ///
+   class MCOM_CLASS NativeClient
+   {
+   public:
+
+      /// Destructor.
+      ///
+      virtual ~NativeClient();
+
+      /// Called on every monitor message, the text is not zero terminated.
+      ///
+      virtual void OnMessage(MessageType type, const char* text, int size);
+
+      /// Called when the channel is connected.
+      ///
+      virtual void OnConnect();
+
+      /// Called when the channel is disconnected.
+      ///
+      virtual void OnDisconnect();
+
+      /// Called when the channel receives bytes.
+      ///
+      virtual void OnByteRX(const char* data, int length);
+
+      /// Called when the channel transmits bytes.
+      ///
+      virtual void OnByteTX(const char* data, int length);
+   };
+
 public: 
 
    /// Object constructor.
@@ -408,20 +448,47 @@ protected: // Services:
    ///
    void OnMessageWithText(MessageType code, const MStdString& text);
 
+#if !M_NO_REFLECTION
+   // Call the service of the reflected client with the index given, which shall be present.
+   //
+   void DoCallClient(unsigned service, const MVariant* params, unsigned numberOfParameters);
+#endif
+
 public:
 
    ///@{
    /// Client that supports monitor messages through reflection.
    ///
+   /// The services of the client are looked up once, when the client is set,
+   /// so the events the client does not handle cost nothing.
+   /// Therefore, the client shall not change the set of its services after it is given to the monitor.
+   ///
    MObject* GetClient() const
    {
       return m_client;
    }
-   void SetClient(MObject* client)
+   void SetClient(MObject* client);
+   ///@}
+
+   ///@{
+   /// C++ client that gets monitor events through direct virtual calls.
+   ///
+   /// The native client is called in addition to \refprop{GetClient,Client}.
+   /// The monitor does not own the native client, which shall outlive the monitor or be reset to NULL.
+   ///
+   /// \if CPP
+   /// \default_value NULL
+   /// \endif
+   ///
+   NativeClient* GetNativeClient() const
+   {
+      return m_nativeClient;
+   }
+   void SetNativeClient(NativeClient* client)
    {
       if ( client != NULL )
          m_listening = 1;
-      m_client = client;
+      m_nativeClient = client;
    }
    ///@}
 
@@ -437,6 +504,26 @@ protected: // Data members:
    //
    MObject* m_client;
 
+   // Bit mask of reflected services present in the client, looked up at SetClient
+   //
+   unsigned m_clientServices;
+
+#if !M_NO_REFLECTION
+   enum
+   {
+      NUMBER_OF_CLIENT_SERVICES = 8
+   };
+
+   // Definitions of the reflected services of the client, resolved at SetClient, so the services are called directly.
+   // The definition is NULL if the client does not have the service, or if the client handles it dynamically.
+   //
+   const MServiceDefinition* m_clientServiceDefinitions [ NUMBER_OF_CLIENT_SERVICES ];
+#endif
+
+   // Pointer to C++ client object, called directly
+   //
+   NativeClient* m_nativeClient;
+
 /// \endcond SHOW_INTERNAL
 
    M_DECLARE_CLASS(Monitor)
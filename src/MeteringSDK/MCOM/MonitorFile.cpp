@@ -2,6 +2,7 @@
 #include "MCOMExtern.h"
 #include "MCOMExceptions.h"
 #include "MonitorFile.h"
+#include "MonitorFileSession.h"
 #include "MonitorFilePrivateThread.h"
 #include <MCORE/MTime.h>
 
@@ -31,6 +32,7 @@
 M_START_PROPERTIES(MonitorFile)
    M_OBJECT_PROPERTY_UINT           (MonitorFile, MaxFileSizeKB)
    M_OBJECT_PROPERTY_BOOL           (MonitorFile, Obfuscate)
+   M_OBJECT_PROPERTY_BOOL           (MonitorFile, Compress)
    M_OBJECT_PROPERTY_STRING         (MonitorFile, FileName, ST_constMStdStringA_X, ST_X_constMStdStringA)
 M_START_METHODS(MonitorFile)
    M_OBJECT_SERVICE                 (MonitorFile, DeleteFile,     ST_X)
@@ -41,14 +43,27 @@ M_END_CLASS(MonitorFile, Monitor)
 MMonitorFile::MMonitorFile(const MStdString& fileName)
 :
    m_foregroundThreadBufferLock(),
+   m_ringReaderLock(),
    m_fileLock(),
+   m_ring(M_NEW RingPage[RING_NUMBER_OF_PAGES]),
+   m_ringHead(0),
+   m_ringTail(0),
+   m_ringReadOffset(0),
+   m_ringWriters(0),
+   m_isOverflowing(0),
    m_foregroundThreadBuffer(),
    m_maxFileSizeKB(0u),
    m_fileName(),
    m_logFile(NULL),
    m_syncMessagePosted(false),
+   m_lastSessionId(0),
+   m_sessionsLock(),
+   m_sessions(NULL),
+   m_sessionsBuffer(),
+   m_sessionsSendBuffer(),
    m_isFinished(false),
    m_obfuscate(false),
+   m_compress(false),
    m_fileWasDeleted(false)
 {
    SetFileName(fileName);
@@ -60,6 +75,7 @@ MMonitorFile::~MMonitorFile()
    DoFinish();
    DoFileDetach();
    delete m_logFile;
+   delete [] m_ring;
 }
 
 void MMonitorFile::SetMaxFileSizeKB(unsigned size)
@@ -90,6 +106,7 @@ void MMonitorFile::SetFileName(const MStdString& name)
          if ( m_logFile == NULL )
             m_logFile = M_NEW MLogFileWriter;
          m_logFile->SetObfuscate(m_obfuscate);
+         m_logFile->SetCompress(m_compress);
          m_logFile->Open(name, m_maxFileSizeKB); // it is okay if the object is created, but the exception is thrown
          m_listening = -1;
       }
@@ -103,6 +120,13 @@ void MMonitorFile::SetObfuscate(bool yes)
       m_logFile->SetObfuscate(m_obfuscate);
 }
 
+void MMonitorFile::SetCompress(bool yes)
+{
+   m_compress = yes;
+   if ( m_logFile != NULL )
+      m_logFile->SetCompress(m_compress);
+}
+
 void MMonitorFile::DoFileDetach()
 {
    MCriticalSection::Locker lock(m_fileLock);
@@ -118,6 +142,9 @@ void MMonitorFile::DeleteFile()
    {
       DoFileDetach();
       MUtilities::DeleteFile(m_fileName); // this will report a good error if the file was not deleted for some reason
+      const MStdString indexFileName = MLogFile::GetIndexFileName(m_fileName);
+      if ( MUtilities::IsPathExisting(indexFileName) )
+         MUtilities::DeleteFile(indexFileName);
       m_fileWasDeleted = true;
    }
 }
@@ -138,7 +165,11 @@ void MMonitorFile::Detach()
 void MMonitorFile::OnMessage(MMonitor::MessageType code, const char* data, int length)
 {
    MMonitor::OnMessage(code, data, length);
+   DoWriteMessage(NULL, code, data, length);
+}
 
+void MMonitorFile::DoWriteMessage(MMonitorFileSession* session, MMonitor::MessageType code, const char* data, int length)
+{
    if ( m_fileWasDeleted && !m_fileName.empty() )
    {
       try
@@ -164,10 +195,25 @@ void MMonitorFile::OnMessage(MMonitor::MessageType code, const char* data, int l
    header.m_timeStamp = Muint32(currentTimestamp);
    header.m_code = Muint16(code);
 
+   if ( session != NULL ) // wrap the message into a session packet, and stage it in the buffer of the session
+   {
+      char prefix [ MLogFile::SESSION_PREFIX_SIZE ];
+      memcpy(prefix, &session->m_sessionId, sizeof(Muint32));
+      memcpy(prefix + sizeof(Muint32), &header.m_code, sizeof(Muint16));
+      header.m_length += MLogFile::SESSION_PREFIX_SIZE;
+      header.m_code = Muint16(MESSAGE_SESSION_PACKET);
+
+      MCriticalSection::Locker lock(session->m_stagingLock); // only the background thread can compete for it
+      session->m_staging.append((const char*)&header, MLogFile::PACKET_HEADER_SIZE);
+      session->m_staging.append(prefix, MLogFile::SESSION_PREFIX_SIZE);
+      session->m_staging.append(data, length);
+   }
+   else if ( !DoRingWrite(header, data, static_cast<unsigned>(length)) )
    {
       MCriticalSection::Locker lock(m_foregroundThreadBufferLock);
       m_foregroundThreadBuffer.append((const char*)&header,  MLogFile::PACKET_HEADER_SIZE);
       m_foregroundThreadBuffer.append(data, length);
+      m_isOverflowing = 1; // the messages that follow go here too, until the background thread takes them
    }
 
    // send synchronize message
@@ -175,6 +221,48 @@ void MMonitorFile::OnMessage(MMonitor::MessageType code, const char* data, int l
       PostSyncMessage();
 }
 
+bool MMonitorFile::DoRingWrite(const MLogFile::PacketHeader& header, const char* data, unsigned length)
+{
+   const unsigned packetSize = header.m_length;
+   if ( packetSize > MLogFile::PAGE_TOTAL_SIZE || m_isOverflowing != 0 )
+      return false;
+   if ( ++m_ringWriters != 1 ) // another thread writes into the ring, or the reader is flushing the overflow
+   {
+      --m_ringWriters;
+      return false;
+   }
+
+   bool result = false;
+   if ( m_isOverflowing == 0 ) // check again after the ring is taken
+   {
+      const int head = m_ringHead;
+      RingPage* page = &m_ring[static_cast<unsigned>(head) % RING_NUMBER_OF_PAGES];
+      unsigned size = static_cast<unsigned>(static_cast<int>(page->m_size));
+      if ( size + packetSize > MLogFile::PAGE_TOTAL_SIZE ) // finish this page and go to the next one
+      {
+         if ( static_cast<unsigned>(head + 1 - m_ringTail) < RING_NUMBER_OF_PAGES )
+         {
+            page = &m_ring[static_cast<unsigned>(head + 1) % RING_NUMBER_OF_PAGES];
+            page->m_size = 0;
+            ++m_ringHead; // now the reader knows the previous page is complete
+            size = 0;
+         }
+         else
+            page = NULL; // the reader is behind, all pages are taken
+      }
+      if ( page != NULL )
+      {
+         memcpy(page->m_bytes + size, &header, MLogFile::PACKET_HEADER_SIZE);
+         if ( length != 0 )
+            memcpy(page->m_bytes + size + MLogFile::PACKET_HEADER_SIZE, data, length);
+         page->m_size += static_cast<int>(packetSize); // publish the complete packet to the reader
+         result = true;
+      }
+   }
+   --m_ringWriters;
+   return result;
+}
+
 void MMonitorFile::OnPageBoundHit()
 {
    m_syncMessagePosted = false;
@@ -194,21 +282,55 @@ void MMonitorFile::OnIdle() M_NO_THROW
 {
    try
    {
-      MByteString backgroundThreadBuffer;
+      MCriticalSection::Locker readerLock(m_ringReaderLock);
 
+      // When there are messages in the overflow buffer, the ring is taken from the writers,
+      // so that everything in the ring is sent before the overflow buffer.
+      // The writers do not wait, they keep adding to the overflow buffer in the meantime.
+      //
+      const bool isOverflowing = m_isOverflowing != 0;
+      if ( isOverflowing )
       {
-         // Do this operation in a separate scope to minimize locking
-         MCriticalSection::Locker lock(m_foregroundThreadBufferLock);
-         m_foregroundThreadBuffer.swap(backgroundThreadBuffer);
-         m_foregroundThreadBuffer.clear();
+         while ( ++m_ringWriters != 1 )
+         {
+            --m_ringWriters;
+            MUtilities::Sleep(0);
+         }
       }
 
-      if ( m_listening != 0 && !backgroundThreadBuffer.empty() )
+      for ( ;; )
       {
-         unsigned result = DoSendBackgroundBuffer(backgroundThreadBuffer);
-         if ( result == 0 && m_client == NULL ) // only in this case reset `m_listening`
-            m_listening = 0;
+         const int tail = m_ringTail;
+         const int head = (m_ringHead += 0); // read head before the size, so the size of a finished page is final
+         RingPage& page = m_ring[static_cast<unsigned>(tail) % RING_NUMBER_OF_PAGES];
+         const unsigned size = static_cast<unsigned>(page.m_size += 0);
+         if ( size > m_ringReadOffset )
+         {
+            DoSendBytes(page.m_bytes + m_ringReadOffset, size - m_ringReadOffset);
+            m_ringReadOffset = size;
+         }
+         if ( tail == head ) // the writer is still on this page
+            break;
+         m_ringReadOffset = 0;
+         ++m_ringTail; // give the page back to the writer
       }
+
+      if ( isOverflowing )
+      {
+         MByteString backgroundThreadBuffer;
+         {
+            // Do this operation in a separate scope to minimize locking
+            MCriticalSection::Locker lock(m_foregroundThreadBufferLock);
+            m_foregroundThreadBuffer.swap(backgroundThreadBuffer);
+            m_foregroundThreadBuffer.clear();
+            m_isOverflowing = 0;
+         }
+         --m_ringWriters;
+         if ( !backgroundThreadBuffer.empty() )
+            DoSendBytes(backgroundThreadBuffer.data(), M_64_CAST(unsigned, backgroundThreadBuffer.size()));
+      }
+
+      DoSendSessions();
    }
    catch ( ... )
    {
@@ -217,7 +339,61 @@ void MMonitorFile::OnIdle() M_NO_THROW
    }
 }
 
-unsigned MMonitorFile::DoSendBackgroundBuffer(const MByteString& backgroundThreadBuffer)
+void MMonitorFile::DoAddSession(MMonitorFileSession* session)
+{
+   MCriticalSection::Locker lock(m_sessionsLock);
+   session->m_previousSession = NULL;
+   session->m_nextSession = m_sessions;
+   if ( m_sessions != NULL )
+      m_sessions->m_previousSession = session;
+   m_sessions = session;
+}
+
+void MMonitorFile::DoRemoveSession(MMonitorFileSession* session)
+{
+   MCriticalSection::Locker lock(m_sessionsLock);
+   m_sessionsBuffer += session->m_staging; // no other thread can write into the session that is being destroyed
+   if ( session->m_previousSession != NULL )
+      session->m_previousSession->m_nextSession = session->m_nextSession;
+   else
+      m_sessions = session->m_nextSession;
+   if ( session->m_nextSession != NULL )
+      session->m_nextSession->m_previousSession = session->m_previousSession;
+}
+
+void MMonitorFile::DoSendSessions()
+{
+   {
+      MCriticalSection::Locker lock(m_sessionsLock);
+      for ( MMonitorFileSession* session = m_sessions; session != NULL; session = session->m_nextSession )
+      {
+         MCriticalSection::Locker stagingLock(session->m_stagingLock);
+         if ( !session->m_staging.empty() )
+         {
+            m_sessionsBuffer += session->m_staging;
+            session->m_staging.clear(); // the capacity stays with the session
+         }
+      }
+      m_sessionsBuffer.swap(m_sessionsSendBuffer);
+   }
+   if ( !m_sessionsSendBuffer.empty() )
+   {
+      DoSendBytes(m_sessionsSendBuffer.data(), M_64_CAST(unsigned, m_sessionsSendBuffer.size()));
+      m_sessionsSendBuffer.clear();
+   }
+}
+
+void MMonitorFile::DoSendBytes(const char* data, unsigned size)
+{
+   if ( m_listening != 0 )
+   {
+      unsigned result = DoSendBackgroundBuffer(data, size);
+      if ( result == 0 && m_client == NULL && m_nativeClient == NULL ) // only in this case reset `m_listening`
+         m_listening = 0;
+   }
+}
+
+unsigned MMonitorFile::DoSendBackgroundBuffer(const char* data, unsigned size)
 {
    MCriticalSection::Locker lock(m_fileLock);
    if ( m_logFile != NULL && m_logFile->IsOpen() )
@@ -226,7 +402,7 @@ unsigned MMonitorFile::DoSendBackgroundBuffer(const MByteString& backgroundThrea
       {
          // set listener
          m_logFile->SetListener(this);
-         m_logFile->WriteMultipleMessages(backgroundThreadBuffer);
+         m_logFile->WriteMultipleMessages(data, size);
          // unset listener (helpful for debug)
          m_logFile->SetListener(NULL);
          return (unsigned)-1; // success, we are interested in data
@@ -17,6 +17,7 @@
 /// therefore, each channel should have its own monitor object.
 /// The monitor is registered with the client channel object using the service
 /// \refprop{MChannel::SetMonitor,MChannel::Monitor}.
+/// To log many channels into a single file, give each channel its own MMonitorFileSession of this monitor.
 ///
 /// \if CPP
 /// Note that when M_NO_MCOM_MONITOR_SHARED_POINTER=0
@@ -32,6 +33,7 @@ class MCOM_CLASS MMonitorFile : public MMonitor
 {
    friend class MMonitorFilePrivateThread;
    friend class MMonitorSocketConnectionHandler;
+   friend class MMonitorFileSession;
 
 public: // Constructor and destructor:
 
@@ -108,6 +110,19 @@ public: // Services (property getters and setters):
    void SetObfuscate(bool yes);
    ///@}
 
+   ///@{
+   /// Whether or not the pages of the file shall be compressed, so the file of the same size holds more history.
+   ///
+   /// When an existing file is appended, its last page tells whether the pages that follow are compressed.
+   /// Compressed files are read by the same reader, but they cannot be read by earlier versions of the library.
+   ///
+   bool GetCompress() const
+   {
+      return m_compress;
+   }
+   void SetCompress(bool yes);
+   ///@}
+
 public: // Services:
 
    /// Tell that the application is starting a sequence of events that it would like
@@ -173,10 +188,13 @@ protected: // Services:
    /// of monitoring the events. Typically they will call the parent implementation,
    /// and return nonzero unconditionally if the parent returned nonzero.
    ///
+   /// The buffer has one or more complete messages, and it points directly into the page
+   /// where the messages were collected, so it is valid only during the call.
+   ///
    /// \pre Called from the Run procedure of the background thread.
    /// No check is done for such precondition.
    ///
-   virtual unsigned DoSendBackgroundBuffer(const MByteString& backgroundThreadBuffer);
+   virtual unsigned DoSendBackgroundBuffer(const char* data, unsigned size);
 
    /// Background worker thread callable function which implements monitor communication.
    /// Note it is not currently virtual.
@@ -190,23 +208,99 @@ protected: // Services:
    ///
    void PostSyncMessage();
 
+private: // Services:
+
+   // Write the message of this monitor into the ring, or, if the session is given,
+   // wrap it into a session packet and append to the staging buffer of the session
+   //
+   void DoWriteMessage(MMonitorFileSession* session, MessageType code, const char* data, int length);
+
+   // Add the session to the list of sessions of this monitor, or remove it from the list.
+   // Bytes staged by the removed session are kept for the background thread.
+   //
+   void DoAddSession(MMonitorFileSession* session);
+   void DoRemoveSession(MMonitorFileSession* session);
+
+   // Take the bytes staged by all sessions and send them, called by the background thread
+   //
+   void DoSendSessions();
+
+   // Append the packet to the current page of the ring, return false if this cannot be done without waiting
+   //
+   bool DoRingWrite(const MLogFile::PacketHeader& header, const char* data, unsigned length);
+
+   // Send the given bytes with DoSendBackgroundBuffer, if the monitor is still listening
+   //
+   void DoSendBytes(const char* data, unsigned size);
+
 protected: // Data members:
 /// \cond SHOW_INTERNAL
 
-   // Mutual exclusion object to protect foreground buffer from accessing
+   // Number of pages in the ring of each monitor, power of two
+   //
+   enum
+   {
+      RING_NUMBER_OF_PAGES = 8
+   };
+
+   // Page of the ring where the foreground thread collects messages
+   //
+   struct RingPage
+   {
+      // Complete packets, headers with bodies
+      //
+      char m_bytes [ MLogFile::PAGE_TOTAL_SIZE ];
+
+      // Number of bytes in m_bytes that have complete packets, only the writer increments it
+      //
+      MInterlocked m_size;
+   };
+
+   // Mutual exclusion object to protect the overflow buffer from accessing
    // it with two threads simultaneously.
    //
    MCriticalSection m_foregroundThreadBufferLock;
 
+   // Mutual exclusion object that allows only one thread to take messages from the ring,
+   // the background thread or the foreground thread that flushes the monitor by hand.
+   //
+   MCriticalSection m_ringReaderLock;
+
    // Mutual exclusion object to exclude the possibility for a file operation to be executed
    // from multiple threads at the same time. Note that m_foregroundThreadBufferLock and
    // m_fileLock are intentionally separated into two locks.
    //
    MCriticalSection m_fileLock;
 
-   // Protected foreground send buffer, which is used by the foreground thread
-   // to supply data to the background buffer. The background buffer uses
-   // the foreground buffer to copy data to its own unprotected background buffer.
+   // Ring of pages, the foreground thread appends packets to the page m_ringHead,
+   // and the background thread writes them into the file from page m_ringTail.
+   // The pages are swapped without locking or copying, the counters are free running,
+   // and a page is not reused until the background thread has written it.
+   //
+   RingPage* m_ring;
+
+   // Number of pages the writer has finished, the index of the current page the writer appends to
+   //
+   MInterlocked m_ringHead;
+
+   // Number of pages the reader has finished, the index of the current page the reader takes from
+   //
+   MInterlocked m_ringTail;
+
+   // Offset within the page m_ringTail of the bytes not yet taken by the reader
+   //
+   unsigned m_ringReadOffset;
+
+   // Nonzero while a thread is appending to the ring, the other threads go to the overflow buffer
+   //
+   MInterlocked m_ringWriters;
+
+   // Nonzero if there are messages in the overflow buffer, then all new messages go there to keep the order
+   //
+   MInterlocked m_isOverflowing;
+
+   // Protected foreground send buffer, used when the ring is full, the message does not fit in a page,
+   // or another thread is already writing into the ring.
    //
    MByteString m_foregroundThreadBuffer;
 
@@ -230,6 +324,28 @@ protected: // Data members:
    //
    bool m_syncMessagePosted;
 
+   // Last session identifier given to MMonitorFileSession of this monitor
+   //
+   MInterlocked m_lastSessionId;
+
+   // Guards the list of sessions and m_sessionsBuffer.
+   // Every session stages its packets in its own buffer, so the sessions do not contend with each other,
+   // and the lock is only taken to create or destroy a session, and by the background thread.
+   //
+   MCriticalSection m_sessionsLock;
+
+   // First session in the list of sessions of this monitor
+   //
+   MMonitorFileSession* m_sessions;
+
+   // Bytes taken from the sessions, not yet sent, including the ones of the destroyed sessions
+   //
+   MByteString m_sessionsBuffer;
+
+   // Buffer of the background thread through which the bytes of the sessions are sent, its capacity is reused
+   //
+   MByteString m_sessionsSendBuffer;
+
 /// \endcond SHOW_INTERNAL
 private: // Properties:
 
@@ -241,6 +357,10 @@ private: // Properties:
    //
    bool m_obfuscate;
 
+   // Whether to compress the pages of the file.
+   //
+   bool m_compress;
+
    // Whether the file was deleted by this class, and needs to be recreated.
    //
    bool m_fileWasDeleted;
@@ -0,0 +1,56 @@
+// File MCOM/MonitorFileSession.cpp
+
+#include "MCOMExtern.h"
+#include "MCOMExceptions.h"
+#include "MonitorFileSession.h"
+
+#if !M_NO_MCOM_MONITOR && !M_NO_MULTITHREADING && !M_NO_FILESYSTEM
+
+   #if !M_NO_REFLECTION
+
+      /// Create a session of the given shared file monitor.
+      ///
+      /// \pre The object given shall be a file monitor, or an exception is thrown.
+      ///
+      static MMonitorFileSession* DoNew1(MObject* sharedMonitor)
+      {
+         return M_NEW MMonitorFileSession(M_DYNAMIC_CAST_WITH_THROW(MMonitorFile, sharedMonitor));
+      }
+
+   #endif
+
+M_START_PROPERTIES(MonitorFileSession)
+   M_OBJECT_PROPERTY_READONLY_OBJECT(MonitorFileSession, SharedMonitor)
+   M_OBJECT_PROPERTY_READONLY_UINT  (MonitorFileSession, SessionId)
+M_START_METHODS(MonitorFileSession)
+   M_CLASS_FRIEND_SERVICE           (MonitorFileSession, New, DoNew1, ST_MObjectP_S_MObjectP)
+M_END_CLASS(MonitorFileSession, Monitor)
+
+MMonitorFileSession::MMonitorFileSession(MMonitorFile* sharedMonitor)
+:
+   MMonitor(),
+   m_sharedMonitor(sharedMonitor),
+   m_sessionId(0),
+   m_staging(),
+   m_stagingLock(),
+   m_nextSession(NULL),
+   m_previousSession(NULL)
+{
+   M_ASSERT(sharedMonitor != NULL);
+   m_sessionId = static_cast<Muint32>(++sharedMonitor->m_lastSessionId);
+   m_listening = 1;
+   sharedMonitor->DoAddSession(this);
+}
+
+MMonitorFileSession::~MMonitorFileSession()
+{
+   GetSharedMonitor()->DoRemoveSession(this);
+}
+
+void MMonitorFileSession::OnMessage(MessageType code, const char* message, int length)
+{
+   MMonitor::OnMessage(code, message, length);
+   GetSharedMonitor()->DoWriteMessage(this, code, message, length);
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef MCOM_MONITORFILESESSION_H
+#define MCOM_MONITORFILESESSION_H
+/// \addtogroup MCOM
+///@{
+/// \file MCOM/MonitorFileSession.h
+
+#include <MCOM/MCOMDefs.h>
+#include <MCOM/MonitorFile.h>
+
+#if !M_NO_MCOM_MONITOR && !M_NO_MULTITHREADING
+
+/// Monitor of a single channel that writes into a monitor file shared by many channels.
+///
+/// A server or a collector that talks to thousands of meters at once would need
+/// thousands of MMonitorFile objects, each with its own file and its own page buffers.
+/// Instead, the application creates one MMonitorFile, and gives every channel its own
+/// session monitor of that file. All sessions are written into the single file,
+/// by the single background thread, and the file size limit of the shared monitor
+/// makes the file a rotating log of all sessions together.
+///
+/// Every message of the session is written as a session packet, which carries
+/// the session identifier and the original message code. MLogFileReader unwraps
+/// session packets transparently, tells the session of every packet with
+/// \ref MLogFileReader::GetPacketSessionId, and can skip all packets but those of a given session
+/// with \ref MLogFileReader::SetSessionFilter.
+/// The session identifiers are given by the shared monitor in order of creation of the sessions, starting from one.
+/// Media identification given to Attach is written into the file, so the session can be told from the log.
+///
+/// Sessions can be created and destroyed by many threads at once,
+/// but each session, like any other monitor, shall be used by a single channel.
+/// Every session stages its messages in its own buffer, which the background thread of the shared monitor
+/// takes into the file, so the channels do not wait for one another.
+/// The order of messages is kept within the session, but not across sessions.
+/// Attach and Detach of the session do not open or close the shared file.
+///
+/// \if CPP
+/// The session holds a reference to the shared monitor, so the shared monitor lives at least as long as its sessions.
+/// \endif
+///
+class MCOM_CLASS MMonitorFileSession : public MMonitor
+{
+   friend class MMonitorFile;
+
+public: // Constructor and destructor:
+
+   /// Create a session of the given shared monitor.
+   ///
+   /// \pre The shared monitor shall not be NULL.
+   /// The object should be created on a heap with operator new,
+   /// and handled with a shared pointer, otherwise the behavior is undefined.
+   ///
+   MMonitorFileSession(MMonitorFile* sharedMonitor);
+
+   /// Object destructor.
+   ///
+   virtual ~MMonitorFileSession();
+
+public: // Properties:
+
+   /// Shared monitor that writes the file.
+   ///
+   MMonitorFile* GetSharedMonitor() const
+   {
+      return static_cast<MMonitorFile*>(static_cast<MMonitor*>(m_sharedMonitor));
+   }
+
+   /// Session identifier, unique within the shared monitor, never zero.
+   ///
+   unsigned GetSessionId() const
+   {
+      return m_sessionId;
+   }
+
+public: // Services:
+
+   /// Write the message of the session into the shared file.
+   ///
+   virtual void OnMessage(MessageType code, const char* message, int length);
+
+private: // Data:
+
+   // Shared monitor, with the reference that keeps it alive
+   //
+   MMonitor::Pointer m_sharedMonitor;
+
+   // Identifier of this session in the shared file
+   //
+   Muint32 m_sessionId;
+
+   // Packets of this session not yet taken by the background thread of the shared monitor
+   //
+   MByteString m_staging;
+
+   // Guards m_staging from the channel thread and the background thread
+   //
+   MCriticalSection m_stagingLock;
+
+   // Neighbors in the list of sessions of the shared monitor
+   //
+   MMonitorFileSession* m_nextSession;
+   MMonitorFileSession* m_previousSession;
+
+   M_DECLARE_CLASS(MonitorFileSession)
+};
+
+#endif // !M_NO_MCOM_MONITOR && !M_NO_MULTITHREADING
+
+///@}
+#endif
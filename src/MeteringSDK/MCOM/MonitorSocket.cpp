@@ -128,14 +128,14 @@ void MMonitorSocket::Detach()
       }
    };
 
-unsigned MMonitorSocket::DoSendBackgroundBuffer(const MByteString& backgroundThreadBuffer)
+unsigned MMonitorSocket::DoSendBackgroundBuffer(const char* data, unsigned size)
 {
-   unsigned ret = MMonitorFile::DoSendBackgroundBuffer(backgroundThreadBuffer);
+   unsigned ret = MMonitorFile::DoSendBackgroundBuffer(data, size);
 
    M_ASSERT(m_listening != 0);
    try
    {
-      m_socket.Write(backgroundThreadBuffer);
+      m_socket.WriteBytes(data, size);
    }
    catch ( MException& ex )
    {
@@ -156,7 +156,7 @@ unsigned MMonitorSocket::DoSendBackgroundBuffer(const MByteString& backgroundThr
          Attach(m_mediaIdentification); // resend the media information
          if ( !m_syncMessagePosted )
             PostSyncMessage();
-         m_socket.Write(backgroundThreadBuffer);
+         m_socket.WriteBytes(data, size);
          return (unsigned)-1; // Success, we are interested in data...
       }
       catch ( MException& ex )
@@ -92,7 +92,7 @@ protected: // Protected services:
    /// \pre Called from the OnIdle procedure of the background thread.
    /// No check is done for such precondition.
    ///
-   virtual unsigned DoSendBackgroundBuffer(const MByteString& backgroundThreadBuffer);
+   virtual unsigned DoSendBackgroundBuffer(const char* data, unsigned size);
 
 /// \endcond SHOW_INTERNAL
 private: // Data members:
@@ -7,6 +7,7 @@
 #include "ChannelModem.h"
 #include "MCOMExceptions.h"
 #include "MCOMFactory.h"
+#include "SessionTrace.h"
 #include <MCORE/MStreamMemory.h>
 
 M_START_PROPERTIES(Protocol)
@@ -21,6 +22,15 @@ M_START_PROPERTIES(Protocol)
    M_OBJECT_PROPERTY_READONLY_UINT         (Protocol, MaximumRoundTripTime)
    M_OBJECT_PROPERTY_READONLY_UINT         (Protocol, MinimumRoundTripTime)
    M_OBJECT_PROPERTY_READONLY_UINT         (Protocol, AverageRoundTripTime)
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+   M_CLASS_ENUMERATION                     (Protocol, LatencyLogon)
+   M_CLASS_ENUMERATION                     (Protocol, LatencySecurity)
+   M_CLASS_ENUMERATION                     (Protocol, LatencyRead)
+   M_CLASS_ENUMERATION                     (Protocol, LatencyPartialRead)
+   M_CLASS_ENUMERATION                     (Protocol, LatencyWrite)
+   M_CLASS_ENUMERATION                     (Protocol, LatencyProcedure)
+   M_CLASS_ENUMERATION                     (Protocol, LatencyLinkLayerPacket)
+#endif
    M_OBJECT_PROPERTY_READONLY_BOOL_EXACT   (Protocol, IsConnected)
    M_OBJECT_PROPERTY_READONLY_BOOL_EXACT   (Protocol, IsInSession)
    M_OBJECT_PROPERTY_OBJECT                (Protocol, Channel)
@@ -53,6 +63,10 @@ M_START_METHODS(Protocol)
    M_OBJECT_SERVICE           (Protocol, CalculateCRC16,                     ST_unsigned_X_constMByteStringA)
    M_OBJECT_SERVICE           (Protocol, GetNumberOfDataLinkPackets,         ST_unsigned_X_unsigned_unsigned) // SWIG_HIDE
    M_OBJECT_SERVICE           (Protocol, WriteCountsToMonitor,               ST_X)
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+   M_OBJECT_SERVICE_OVERLOADED(Protocol, GetLatencyHistogram, DoGetLatencyHistogramAsVariant, 1, ST_MVariant_X_int)
+   M_OBJECT_SERVICE           (Protocol, GetLatencyPercentile,               ST_unsigned_X_unsigned_unsigned)
+#endif
 #if !M_NO_MCOM_IDENTIFY_METER
    M_OBJECT_SERVICE_OVERLOADED(Protocol, IdentifyMeter, IdentifyMeter,    1, ST_MStdString_X_bool)
    M_OBJECT_SERVICE_OVERLOADED(Protocol, IdentifyMeter, DoIdentifyMeter0, 0, ST_MStdString_X)  // SWIG_HIDE
@@ -89,6 +103,7 @@ M_START_METHODS(Protocol)
 #endif
    M_OBJECT_SERVICE_OVERLOADED(Protocol, QCommit, QCommit,                1, ST_X_bool)
    M_OBJECT_SERVICE_OVERLOADED(Protocol, QCommit, DoQCommit0,             0, ST_X) // SWIG_HIDE
+   M_OBJECT_SERVICE           (Protocol, QResetResponses,                    ST_X)
    M_OBJECT_SERVICE           (Protocol, QWriteToMonitor,                    ST_X_constMStdStringA)
    M_OBJECT_SERVICE           (Protocol, QAbort,                             ST_X)
 #endif
@@ -372,8 +387,34 @@ void MProtocol::ResetCounts()
    m_minimumRoundTripTime = 0u;
    m_sumRoundTripTime = 0.0;
    m_roundTripCounter = 0.0;
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+   for ( int i = 0; i < LatencyNumberOfTypes; ++i )
+      m_latencyHistograms[i].Clear();
+#endif
 }
 
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+const MLatencyHistogram& MProtocol::GetLatencyHistogram(unsigned type) const
+{
+   MENumberOutOfRange::CheckNamedUnsignedRange(0, LatencyNumberOfTypes - 1, type, M_OPT_STR("LatencyType"));
+   return m_latencyHistograms[type];
+}
+
+void MProtocol::MergeLatencyHistograms(const MProtocol& other)
+{
+   M_ASSERT(&other != this); // it makes no sense to merge histograms of a protocol to itself
+   for ( int i = 0; i < LatencyNumberOfTypes; ++i )
+      m_latencyHistograms[i].Merge(other.m_latencyHistograms[i]);
+}
+
+   #if !M_NO_REFLECTION
+MVariant MProtocol::DoGetLatencyHistogramAsVariant(int type) const
+{
+   return GetLatencyHistogram(static_cast<unsigned>(type)).AsVariant();
+}
+   #endif
+#endif
+
 #if !M_NO_VERBOSE_ERROR_INFORMATION
 void MProtocol::DoBuildComplexServiceName(MChars fullServiceName, MConstChars serviceName, MCOMNumberConstRef number, int par1, int par2) M_NO_THROW
 {
@@ -381,6 +422,16 @@ void MProtocol::DoBuildComplexServiceName(MChars fullServiceName, MConstChars se
    try
    {
 #if !M_NO_VARIANT
+      unsigned value;
+      if ( (number.GetType() == MVariant::VAR_UINT || number.GetType() == MVariant::VAR_INT) && number.GetUnsignedIfInteger(value) ) // avoid string conversions for plain numbers
+      {
+         size_t fullServiceNameSize = ( par1 == -1 && par2 == -1 )
+               ? MFormat(fullServiceName, MAXIMUM_SERVICE_NAME_STRING_SIZE, "%s(%u)", serviceName, value)
+               : MFormat(fullServiceName, MAXIMUM_SERVICE_NAME_STRING_SIZE, "%s(%u, %d, %d)", serviceName, value, par1, par2);
+         M_ASSERT(fullServiceNameSize > 0 && fullServiceNameSize < MAXIMUM_SERVICE_NAME_STRING_SIZE); // Check if MAXIMUM_SERVICE_NAME_STRING_SIZE is big enough
+         M_USED_VARIABLE(fullServiceNameSize);
+         return;
+      }
       numberString = number.AsEscapedString();
       size_t len = numberString.size();
       if ( len > MAXIMUM_NUMBER_STRING_SIZE - 1 )
@@ -487,6 +538,10 @@ void MProtocol::DoQCommit()
    if ( size == 0 )
       return; // nothing to be done
 
+#if !M_NO_MCOM_SESSION_TRACE
+   MSessionTraceSpan span("protocol", "QCommit");
+#endif
+
 #if !M_NO_PROGRESS_MONITOR
    double totalProgress = 0.0;
    for ( size_t i = 0; i < size; ++i )
@@ -540,13 +595,17 @@ void MProtocol::DoQCommit()
          break;
 #endif
       case MCommunicationCommand::CommandRead:
-         cmd->SetResponse(TableRead(cmd->GetNumber(), cmd->GetLength()));
+         cmd->ResetResponse(); // response is read in place, this way the buffer of the recycled command is reused
+         DoTableReadService(cmd->GetNumber(), cmd->m_response, cmd->GetLength());
+         cmd->m_responsePresent = true;
          break;
       case MCommunicationCommand::CommandWrite:
          TableWrite(cmd->GetNumber(), cmd->GetRequest());
          break;
       case MCommunicationCommand::CommandReadPartial:
-         cmd->SetResponse(TableReadPartial(cmd->GetNumber(), cmd->GetOffset(), cmd->GetLength()));
+         cmd->ResetResponse();
+         DoTableReadPartialService(cmd->GetNumber(), cmd->m_response, cmd->GetOffset(), cmd->GetLength());
+         cmd->m_responsePresent = true;
          break;
       case MCommunicationCommand::CommandWritePartial:
          TableWritePartial(cmd->GetNumber(), cmd->GetRequest(), cmd->GetOffset());
@@ -558,10 +617,14 @@ void MProtocol::DoQCommit()
          FunctionExecuteRequest(cmd->GetNumber(), cmd->GetRequest());
          break;
       case MCommunicationCommand::CommandExecuteResponse:
-         cmd->SetResponse(FunctionExecuteResponse(cmd->GetNumber()));
+         cmd->ResetResponse();
+         DoFunctionExecuteResponseService(cmd->GetNumber(), cmd->m_response);
+         cmd->m_responsePresent = true;
          break;
       case MCommunicationCommand::CommandExecuteRequestResponse:
-         cmd->SetResponse(FunctionExecuteRequestResponse(cmd->GetNumber(), cmd->GetRequest()));
+         cmd->ResetResponse();
+         DoFunctionExecuteRequestResponseService(cmd->GetNumber(), cmd->GetRequest(), cmd->m_response);
+         cmd->m_responsePresent = true;
          break;
       default:
          M_ASSERT(0); // warn on debug, ignore on release -- possibility of a new command
@@ -576,6 +639,9 @@ void MProtocol::DoQCommit()
 #if !M_NO_PROGRESS_MONITOR
    action->Complete();
 #endif
+#if !M_NO_MCOM_SESSION_TRACE
+   span.SetSucceeded();
+#endif
 }
 
 void MProtocol::QCommit(bool asynchronously)
@@ -626,6 +692,19 @@ void MProtocol::QCommit(bool asynchronously)
 #endif
 }
 
+void MProtocol::QResetResponses()
+{
+#if !M_NO_MCOM_PROTOCOL_THREAD
+   if ( m_backgroundCommunicationIsProgressing )
+   {
+      MCOMException::ThrowInvalidOperationInForeground();
+      M_ENSURED_ASSERT(0);
+   }
+#endif
+   m_queue.ResetResponses();
+   m_commitDone = false; // next commit executes the queue again, and new commands are appended to it
+}
+
 void MProtocol::DoAddCommandToQueue(MCommunicationCommand* command)
 {
    try
@@ -649,41 +728,41 @@ void MProtocol::DoAddCommandToQueue(MCommunicationCommand* command)
 
 void MProtocol::QWriteToMonitor(const MStdString& message)
 {
-   MCommunicationCommand* command = MCommunicationCommand::New(MCommunicationCommand::CommandWriteToMonitor);
+   MCommunicationCommand* command = m_queue.NewCommand(MCommunicationCommand::CommandWriteToMonitor);
    command->SetRequest(message);
    DoAddCommandToQueue(command);
 }
 
 void MProtocol::QConnect()
 {
-   DoAddCommandToQueue(MCommunicationCommand::New(MCommunicationCommand::CommandConnect));
+   DoAddCommandToQueue(m_queue.NewCommand(MCommunicationCommand::CommandConnect));
 }
 
 void MProtocol::QDisconnect()
 {
-   DoAddCommandToQueue(MCommunicationCommand::New(MCommunicationCommand::CommandDisconnect));
+   DoAddCommandToQueue(m_queue.NewCommand(MCommunicationCommand::CommandDisconnect));
 }
 
 #if !M_NO_MCOM_IDENTIFY_METER
 void MProtocol::QIdentifyMeter()
 {
-   DoAddCommandToQueue(MCommunicationCommand::New(MCommunicationCommand::CommandIdentifyMeter));
+   DoAddCommandToQueue(m_queue.NewCommand(MCommunicationCommand::CommandIdentifyMeter));
 }
 #endif
 
 void MProtocol::QStartSession()
 {
-   DoAddCommandToQueue(MCommunicationCommand::New(MCommunicationCommand::CommandStartSession));
+   DoAddCommandToQueue(m_queue.NewCommand(MCommunicationCommand::CommandStartSession));
 }
 
 void MProtocol::QEndSession()
 {
-   DoAddCommandToQueue(MCommunicationCommand::New(MCommunicationCommand::CommandEndSession));
+   DoAddCommandToQueue(m_queue.NewCommand(MCommunicationCommand::CommandEndSession));
 }
 
 void MProtocol::QEndSessionNoThrow()
 {
-   DoAddCommandToQueue(MCommunicationCommand::New(MCommunicationCommand::CommandEndSessionNoThrow));
+   DoAddCommandToQueue(m_queue.NewCommand(MCommunicationCommand::CommandEndSessionNoThrow));
 }
 
    static void DoCheckTableOffsetRange(int offset)
@@ -699,7 +778,7 @@ void MProtocol::QEndSessionNoThrow()
 void MProtocol::QTableRead(MCOMNumberConstRef number, unsigned expectedSize, int id)
 {
    DoCheckTableLengthRange(expectedSize);
-   MCommunicationCommand* command = MCommunicationCommand::New(MCommunicationCommand::CommandRead);
+   MCommunicationCommand* command = m_queue.NewCommand(MCommunicationCommand::CommandRead);
    command->SetNumber(number);
    command->SetDataId(id);
    command->SetLength(expectedSize);
@@ -708,7 +787,7 @@ void MProtocol::QTableRead(MCOMNumberConstRef number, unsigned expectedSize, int
 
 void MProtocol::QTableWrite(MCOMNumberConstRef number, const MByteString& data)
 {
-   MCommunicationCommand* command = MCommunicationCommand::New(MCommunicationCommand::CommandWrite);
+   MCommunicationCommand* command = m_queue.NewCommand(MCommunicationCommand::CommandWrite);
    command->SetNumber(number);
    command->SetRequest(data);
    DoAddCommandToQueue(command);
@@ -718,7 +797,7 @@ void MProtocol::QTableReadPartial(MCOMNumberConstRef number, int offset, int siz
 {
    DoCheckTableOffsetRange(offset);
    DoCheckTableLengthRange(size);
-   MCommunicationCommand* command = MCommunicationCommand::New(MCommunicationCommand::CommandReadPartial);
+   MCommunicationCommand* command = m_queue.NewCommand(MCommunicationCommand::CommandReadPartial);
    command->SetNumber(number);
    command->SetOffset(offset);
    command->SetLength(size);
@@ -729,7 +808,7 @@ void MProtocol::QTableReadPartial(MCOMNumberConstRef number, int offset, int siz
 void MProtocol::QTableWritePartial(MCOMNumberConstRef number, const MByteString& data, int offset)
 {
    DoCheckTableOffsetRange(offset);
-   MCommunicationCommand* command = MCommunicationCommand::New(MCommunicationCommand::CommandWritePartial);
+   MCommunicationCommand* command = m_queue.NewCommand(MCommunicationCommand::CommandWritePartial);
    command->SetNumber(number);
    command->SetRequest(data);
    command->SetOffset(offset);
@@ -738,14 +817,14 @@ void MProtocol::QTableWritePartial(MCOMNumberConstRef number, const MByteString&
 
 void MProtocol::QFunctionExecute(MCOMNumberConstRef number)
 {
-   MCommunicationCommand* command = MCommunicationCommand::New(MCommunicationCommand::CommandExecute);
+   MCommunicationCommand* command = m_queue.NewCommand(MCommunicationCommand::CommandExecute);
    command->SetNumber(number);
    DoAddCommandToQueue(command);
 }
 
 void MProtocol::QFunctionExecuteRequest(MCOMNumberConstRef number, const MByteString& request)
 {
-   MCommunicationCommand* command = MCommunicationCommand::New(MCommunicationCommand::CommandExecuteRequest);
+   MCommunicationCommand* command = m_queue.NewCommand(MCommunicationCommand::CommandExecuteRequest);
    command->SetNumber(number);
    command->SetRequest(request);
    DoAddCommandToQueue(command);
@@ -767,7 +846,7 @@ void MProtocol::DoQFunctionExecuteRequestResponse(MCOMNumberConstRef number, con
 
 void MProtocol::QFunctionExecuteResponse(MCOMNumberConstRef number, int id, unsigned estimatedResponseLength)
 {
-   MCommunicationCommand* command = MCommunicationCommand::New(MCommunicationCommand::CommandExecuteResponse);
+   MCommunicationCommand* command = m_queue.NewCommand(MCommunicationCommand::CommandExecuteResponse);
    command->SetNumber(number);
    command->SetDataId(id);
    command->SetLength(estimatedResponseLength);
@@ -776,7 +855,7 @@ void MProtocol::QFunctionExecuteResponse(MCOMNumberConstRef number, int id, unsi
 
 void MProtocol::QFunctionExecuteRequestResponse(MCOMNumberConstRef number, const MByteString& request, int id, unsigned estimatedResponseLength)
 {
-   MCommunicationCommand* command = MCommunicationCommand::New(MCommunicationCommand::CommandExecuteRequestResponse);
+   MCommunicationCommand* command = m_queue.NewCommand(MCommunicationCommand::CommandExecuteRequestResponse);
    command->SetNumber(number);
    command->SetDataId(id);
    command->SetRequest(request);
@@ -926,6 +1005,13 @@ void MProtocol::WriteCountsToMonitor()
          if ( m_countLinkLayerPacketsSuccessful != 0 || m_countLinkLayerPacketsFailed != 0 ) // link layer could be absent in protocol
             m_channel->WriteToMonitor(MGetStdString("Link Layer successes/retries/failures: %d/%d/%d", m_countLinkLayerPacketsSuccessful, m_countLinkLayerPacketsRetried, m_countLinkLayerPacketsFailed));
          m_channel->WriteToMonitor(MGetStdString("Round trip milliseconds maximum/average/minimum: %d/%d/%d", m_maximumRoundTripTime, GetAverageRoundTripTime(), m_minimumRoundTripTime));
+         #if !M_NO_MCOM_LATENCY_HISTOGRAMS
+            static const char* const s_latencyNames[ LatencyNumberOfTypes ] =
+               { "Logon", "Security", "Read", "Partial read", "Write", "Procedure", "Link layer packet" };
+            for ( int i = 0; i < LatencyNumberOfTypes; ++i )
+               if ( m_latencyHistograms[i].GetCount() != 0 )
+                  m_channel->WriteToMonitor(MGetStdString("%s latency milliseconds: %s", s_latencyNames[i], m_latencyHistograms[i].AsString().c_str()));
+         #endif
       }
    #endif
 }
@@ -977,8 +1063,14 @@ void MProtocol::EndSessionNoThrow() M_NO_THROW
 
 MByteString MProtocol::TableRead(MCOMNumberConstRef number, unsigned expectedSize)
 {
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("TableRead"), number, -1, -1);
    MByteString data;
+   DoTableReadService(number, data, expectedSize);
+   return data;
+}
+
+void MProtocol::DoTableReadService(MCOMNumberConstRef number, MByteString& data, unsigned expectedSize)
+{
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("TableRead"), number, -1, -1, LatencyRead);
    try
    {
       DoTableRead(number, data, expectedSize);
@@ -988,14 +1080,13 @@ MByteString MProtocol::TableRead(MCOMNumberConstRef number, unsigned expectedSiz
       wrapper.HandleFailureAndRethrow(ex);
       M_ENSURED_ASSERT(0);
    }
-   return data;
 }
 
 MByteString MProtocol::TableReadNoThrow(MCOMNumberConstRef number, MException** ppException, unsigned expectedSize)
 {
    M_ASSERT(ppException != NULL);
    *ppException = NULL;
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("TableReadNoThrow"), number, -1, -1);
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("TableReadNoThrow"), number, -1, -1, LatencyRead);
    MByteString data;
    try
    {
@@ -1049,7 +1140,7 @@ void MProtocol::TableReadBuffer(MCOMNumberConstRef number, void* buff, unsigned
 
 void MProtocol::TableWrite(MCOMNumberConstRef number, const MByteString& data)
 {
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("TableWrite"), number, -1, -1);
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("TableWrite"), number, -1, -1, LatencyWrite);
    try
    {
       MChannel::UninterruptibleCommunication protect(m_channel);
@@ -1070,8 +1161,14 @@ void MProtocol::TableWriteBuffer(MCOMNumberConstRef number, const void* buff, un
 
 MByteString MProtocol::TableReadPartial(MCOMNumberConstRef number, int offset, int size)
 {
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("TableReadPartial"), number, offset, size);
    MByteString data;
+   DoTableReadPartialService(number, data, offset, size);
+   return data;
+}
+
+void MProtocol::DoTableReadPartialService(MCOMNumberConstRef number, MByteString& data, int offset, int size)
+{
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("TableReadPartial"), number, offset, size, LatencyPartialRead);
    try
    {
       DoCheckTableOffsetRange(offset);
@@ -1084,7 +1181,6 @@ MByteString MProtocol::TableReadPartial(MCOMNumberConstRef number, int offset, i
       wrapper.HandleFailureAndRethrow(ex);
       M_ENSURED_ASSERT(0);
    }
-   return data;
 }
 
 void MProtocol::TableReadPartialBuffer(MCOMNumberConstRef number, int offset, void* buff, unsigned size)
@@ -1096,7 +1192,7 @@ void MProtocol::TableReadPartialBuffer(MCOMNumberConstRef number, int offset, vo
 
 void MProtocol::TableWritePartial(MCOMNumberConstRef number, const MByteString& data, int offset)
 {
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("TableWritePartial"), number, offset, M_64_CAST(int, data.size()));
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("TableWritePartial"), number, offset, M_64_CAST(int, data.size()), LatencyWrite);
    try
    {
       MChannel::UninterruptibleCommunication protect(m_channel);
@@ -1118,7 +1214,7 @@ void MProtocol::TableWritePartialBuffer(MCOMNumberConstRef number, int offset, c
 
 void MProtocol::FunctionExecute(MCOMNumberConstRef number)
 {
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("FunctionExecute"), number, -1, -1);
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("FunctionExecute"), number, -1, -1, LatencyProcedure);
    try
    {
       DoFunctionExecute(number);
@@ -1132,7 +1228,7 @@ void MProtocol::FunctionExecute(MCOMNumberConstRef number)
 
 void MProtocol::FunctionExecuteRequest(MCOMNumberConstRef number, const MByteString& request)
 {
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("FunctionExecuteRequest"), number, -1, -1);
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("FunctionExecuteRequest"), number, -1, -1, LatencyProcedure);
    try
    {
       DoFunctionExecuteRequest(number, request);
@@ -1147,7 +1243,13 @@ void MProtocol::FunctionExecuteRequest(MCOMNumberConstRef number, const MByteStr
 MByteString MProtocol::FunctionExecuteResponse(MCOMNumberConstRef number)
 {
    MByteString response;
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("FunctionExecuteResponse"), number, -1, -1);
+   DoFunctionExecuteResponseService(number, response);
+   return response;
+}
+
+void MProtocol::DoFunctionExecuteResponseService(MCOMNumberConstRef number, MByteString& response)
+{
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("FunctionExecuteResponse"), number, -1, -1, LatencyProcedure);
    try
    {
       DoFunctionExecuteResponse(number, response);
@@ -1157,13 +1259,18 @@ MByteString MProtocol::FunctionExecuteResponse(MCOMNumberConstRef number)
       wrapper.HandleFailureAndRethrow(ex);
       M_ENSURED_ASSERT(0);
    }
-   return response;
 }
 
 MByteString MProtocol::FunctionExecuteRequestResponse(MCOMNumberConstRef number, const MByteString& request)
 {
    MByteString response;
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("FunctionExecuteRequestResponse"), number, -1, -1);
+   DoFunctionExecuteRequestResponseService(number, request, response);
+   return response;
+}
+
+void MProtocol::DoFunctionExecuteRequestResponseService(MCOMNumberConstRef number, const MByteString& request, MByteString& response)
+{
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("FunctionExecuteRequestResponse"), number, -1, -1, LatencyProcedure);
    try
    {
       DoFunctionExecuteRequestResponse(number, request, response);
@@ -1173,7 +1280,6 @@ MByteString MProtocol::FunctionExecuteRequestResponse(MCOMNumberConstRef number,
       wrapper.HandleFailureAndRethrow(ex);
       M_ENSURED_ASSERT(0);
    }
-   return response;
 }
 
 
@@ -1410,9 +1516,12 @@ void MProtocol::DoAddCounts(MProtocol& from)
    
    m_sumRoundTripTime += from.m_sumRoundTripTime;
    m_roundTripCounter += from.m_roundTripCounter;
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+   MergeLatencyHistograms(from);
+#endif
 }
 
-unsigned MProtocol::DoConvertNumberToUnsigned(MCOMNumberConstRef number, unsigned upperValue)
+unsigned MProtocol::DoConvertGenericNumberToUnsigned(MCOMNumberConstRef number, unsigned upperValue)
 {
 #if !M_NO_VARIANT
    try
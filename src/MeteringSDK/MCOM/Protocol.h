@@ -8,6 +8,7 @@
 #include <MCOM/Channel.h>
 #include <MCOM/CommunicationCommand.h>
 #include <MCOM/SessionKeeper.h>
+#include <MCOM/LatencyHistogram.h>
 
 /// Abstraction of a communication protocol.
 ///
@@ -26,6 +27,7 @@ class MCOM_CLASS MProtocol : public MCOMObject
 {
    friend class MProtocolThread;
    friend class MProtocolC1222;
+   friend class MProtocolLayerWrapper;
    friend class MProtocolServiceWrapper;
    friend class MSessionKeeper;
    friend class MServerProtocol;
@@ -33,6 +35,22 @@ class MCOM_CLASS MProtocol : public MCOMObject
 
 public: // Types:
 
+   /// Type of the service or packet, which latencies are collected into a separate histogram.
+   ///
+   /// \see GetLatencyHistogram
+   ///
+   enum LatencyType
+   {
+      LatencyLogon,           ///< Logon service, part of the session start.
+      LatencySecurity,        ///< Security or authenticate service, part of the session start.
+      LatencyRead,            ///< Table read service.
+      LatencyPartialRead,     ///< Partial table read service.
+      LatencyWrite,           ///< Table write service, full or partial.
+      LatencyProcedure,       ///< Function execute service, together with its request and response variants.
+      LatencyLinkLayerPacket, ///< Link layer packet, request and response with retries, if the protocol has a link layer.
+      LatencyNumberOfTypes    ///< Number of latency types, not a type itself.
+   };
+
    enum
    {
       /// Maximum string size allowed for a Number, used in representing a number by the monitoring
@@ -94,6 +112,26 @@ public: // Types:
       {
       }
 
+#if !M_NO_RVALUE_REFERENCES
+      /// Constructor that takes the data given without copying it.
+      ///
+      TableRawData(MCOMNumberConstRef number, MByteString&& data)
+      :
+         m_number(number),
+         m_data(std::move(data))
+      {
+      }
+
+      /// Move constructor, the data of the other entry are taken without copying.
+      ///
+      TableRawData(TableRawData&& other)
+      :
+         m_number(std::move(other.m_number)),
+         m_data(std::move(other.m_data))
+      {
+      }
+#endif
+
       /// Destructor.
       ///
       ~TableRawData()
@@ -112,6 +150,20 @@ public: // Types:
          return *this;
       }
 
+#if !M_NO_RVALUE_REFERENCES
+      /// Move assignment operator, the data of the other entry are taken without copying.
+      ///
+      TableRawData& operator=(TableRawData&& other)
+      {
+         if ( &other != this )
+         {
+            m_number = std::move(other.m_number);
+            m_data = std::move(other.m_data);
+         }
+         return *this;
+      }
+#endif
+
       /// Get the table number from the table raw data entry.
       ///
       MCOMNumberConstRef GetNumber() const
@@ -430,6 +482,43 @@ public: // Attribute accessors and manipulators:
       return 0u;
    }
 
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+   /// Histogram of latencies of the successful services or link layer packets of the given type.
+   ///
+   /// The latency of a service is the time in milliseconds from the start of the service to its successful end,
+   /// including the link layer retries. Failed services are only counted by \ref GetCountApplicationLayerServicesFailed.
+   /// The histograms are nullified when the protocol is created, or when \ref ResetCounts is issued.
+   ///
+   /// From the reflection, the histogram is returned as a map, where the keys are upper bounds
+   /// of nonempty histogram buckets in milliseconds, and the values are the counts of latencies in those buckets.
+   ///
+   /// \param type Latency type, one of \ref LatencyType values.
+   ///
+   /// \pre The type shall be in range, or an exception is thrown.
+   ///
+   const MLatencyHistogram& GetLatencyHistogram(unsigned type) const;
+
+   /// Latency at the given percentile for the successful services or link layer packets of the given type.
+   ///
+   /// This is a convenience shortcut to the percentile of \ref GetLatencyHistogram.
+   ///
+   /// \param type Latency type, one of \ref LatencyType values.
+   /// \param perMille Percentile in tenths of percent, such as 500 for the median, or 999 for 99.9 percentile.
+   ///
+   /// \pre The type shall be in range, or an exception is thrown.
+   ///
+   unsigned GetLatencyPercentile(unsigned type, unsigned perMille) const
+   {
+      return GetLatencyHistogram(type).GetPercentile(perMille / 10.0);
+   }
+
+   /// Add the latency histograms of the given protocol to the histograms of this protocol.
+   ///
+   /// This way the latencies of many connections can be looked at together.
+   ///
+   void MergeLatencyHistograms(const MProtocol& other);
+#endif
+
    ///@{
    /// Channel associated with this protocol.
    ///
@@ -1182,6 +1271,32 @@ public: // Queue services:
    ///
    virtual void QCommit(bool asynchronously = false);
 
+   /// Prepare the queue that was committed for another commit of the same commands.
+   ///
+   /// The responses of the previous commit are discarded, but the commands, their parameters and buffers are kept,
+   /// so the next \ref QCommit executes the same queue again. This is the way to poll the same set of tables repeatedly
+   /// without building the queue every time:
+   /// \code
+   ///        protocol.QConnect();
+   ///        protocol.QStartSession();
+   ///        protocol.QTableRead(23, 0, 0);
+   ///        protocol.QEndSession();
+   ///        protocol.QDisconnect();
+   ///        for ( ;; )
+   ///        {
+   ///            protocol.QCommit();
+   ///            data = protocol.QGetTableData(23, 0);
+   ///            ... use data, wait for the next poll ...
+   ///            protocol.QResetResponses();
+   ///        }
+   /// \endcode
+   /// Adding any command after QResetResponses starts building a new queue only if \ref QCommit was called since then,
+   /// otherwise the command is added to the end of the queue being reset.
+   ///
+   /// \pre There shall be no background communication in progress, otherwise an exception is thrown.
+   ///
+   void QResetResponses();
+
    /// Fetch the table data after the table read has been successfully performed by QCommit.
    ///
    /// The data remains available after commit has performed, but until the next queue starts to be built.
@@ -1998,6 +2113,20 @@ protected: // Implementation services:
    ///
    virtual void DoFunctionExecuteRequestResponse(MCOMNumberConstRef number, const MByteString& request, MByteString& response);
 
+   ///@{
+   /// Counted versions of the read and function services that place the result into the buffer given.
+   ///
+   /// These do the same statistics, monitor handling and error message formatting as the public
+   /// TableRead, TableReadPartial, FunctionExecuteResponse and FunctionExecuteRequestResponse,
+   /// but the capacity of the buffer is reused, so no heap allocation is necessary
+   /// when the buffer is big enough already. Used by the queue to fill the responses of recycled commands.
+   ///
+   void DoTableReadService(MCOMNumberConstRef number, MByteString& data, unsigned expectedSize);
+   void DoTableReadPartialService(MCOMNumberConstRef number, MByteString& data, int offset, int size);
+   void DoFunctionExecuteResponseService(MCOMNumberConstRef number, MByteString& response);
+   void DoFunctionExecuteRequestResponseService(MCOMNumberConstRef number, const MByteString& request, MByteString& response);
+   ///@}
+
 #if !M_NO_MCOM_IDENTIFY_METER
    /// Identify the meter if the protocol is known (note this is not an ANSI Identify protocol command).
    /// This protected service is indeed the one,
@@ -2071,6 +2200,12 @@ public: // Semi-public services (for those who know):
    //
    void DoAddCounts(MProtocol& from);
 
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS && !M_NO_REFLECTION
+   // Reflected GetLatencyHistogram, which returns the histogram as a map.
+   //
+   MVariant DoGetLatencyHistogramAsVariant(int type) const;
+#endif
+
    // Set the channel baud ratio, if it is applicable to the channel type.
    // The baud adjustment is applicable only for protocols only with the optical probe channel.
    //
@@ -2178,7 +2313,19 @@ public: // Methods:
    //
    // \pre The number should be convertible to a number, and fit into range.
    //
-   static unsigned DoConvertNumberToUnsigned(MCOMNumberConstRef number, unsigned upperValue = 0xFFFFu);
+   static unsigned DoConvertNumberToUnsigned(MCOMNumberConstRef number, unsigned upperValue = 0xFFFFu)
+   {
+   #if !M_NO_VARIANT
+      unsigned value;
+      if ( number.GetUnsignedIfInteger(value) && value <= upperValue ) // by far the most probable case
+         return value;
+   #endif
+      return DoConvertGenericNumberToUnsigned(number, upperValue);
+   }
+
+   // Generic version of DoConvertNumberToUnsigned, which handles all types and throws errors
+   //
+   static unsigned DoConvertGenericNumberToUnsigned(MCOMNumberConstRef number, unsigned upperValue);
 
    // Update round trip time statistics from the next milliseconds value of round trip time
    //
@@ -2317,6 +2464,12 @@ protected: // Attributes:
    //
    double m_roundTripCounter;
 
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+   // Latencies of successful services and link layer packets, by LatencyType
+   //
+   MLatencyHistogram m_latencyHistograms [ LatencyNumberOfTypes ];
+#endif
+
 #if !M_NO_PROGRESS_MONITOR
    MProgressMonitor* m_progressMonitor;
 #endif
@@ -149,7 +149,9 @@ bool MProtocolC12::DoBuildComplexC12ServiceName(MChars fullServiceName, MConstCh
    {
       try
       {
-         unsigned num = number.AsDWord(); // avoid signed/unsigned differences
+         unsigned num;
+         if ( !number.GetUnsignedIfInteger(num) ) // handle the most probable case inline
+            num = number.AsDWord(); // avoid signed/unsigned differences
          char  prefix [ 4 ];
          char* prefixPtr = prefix;
          if ( (num & ~0xFFFF) == 0 ) // not a service, etc
@@ -435,7 +437,7 @@ void MProtocolC12::DoFunctionExecuteRequestResponse(MCOMNumberConstRef number, c
 
 void MProtocolC12::Logon()
 {
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("Logon"), MProtocolServiceWrapper::ServiceNotQueueable | MProtocolServiceWrapper::ServiceStartsSessionKeeping);
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("Logon"), MProtocolServiceWrapper::ServiceNotQueueable | MProtocolServiceWrapper::ServiceStartsSessionKeeping, MProtocol::LatencyLogon);
    try
    {
       M_ASSERT(m_user.size() <= 10);
@@ -456,7 +458,7 @@ void MProtocolC12::Logon()
 
 void MProtocolC12::Security()
 {
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("Security"), MProtocolServiceWrapper::ServiceNotQueueable);
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("Security"), MProtocolServiceWrapper::ServiceNotQueueable, MProtocol::LatencySecurity);
    try
    {
       DoTryPasswordOrPasswordList(); // Try the password outside of retry loop
@@ -187,8 +187,7 @@ void MProtocolC1218::DoApplicationLayerRequestForIdentify()
       MProtocolLinkLayerWrapper wrapper(this);
       for ( int retries = m_linkLayerRetries; ; --retries )
       {
-         MCOMException ex(M_CODE_STR(MErrorEnum::ReceivedPacketToggleBitFailure, M_I("Packet was likely produced by a previous session")));
-         wrapper.NotifyOrThrowRetry(ex, retries);
+         wrapper.NotifyOrThrowRetry(M_CODE_STR(MErrorEnum::ReceivedPacketToggleBitFailure, M_I("Packet was likely produced by a previous session")), retries);
 
          m_applicationLayerIncoming.Clear();
          m_receiveToggleBitKnown = false;
@@ -619,6 +618,13 @@ MEC12NokResponse::ResponseCode MProtocolC1218::DoFullApplicationLayerRead()
             crc = MToAlignedUINT16(packet + packetSizeWithNoCRC);
             if ( crc != StaticCalculateCRC16FromBuffer(packet, packetSizeWithNoCRC) && !retryAppLayer ) // if we retry app layer, acknowledge everything
             {
+               if ( retries != 0 ) // most frequent failure of a noisy link, retry without throwing
+               {
+                  Sleep(m_turnAroundDelay);
+                  m_channel->WriteByte(CHAR_NAK); // <NAK>, the packet was not received
+                  wrapper.NotifyOrThrowRetry(M_CODE_STR(MErrorEnum::CrcCheckFailed, M_I("CRC check failed")), retries);
+                  continue;
+               }
                MCOMException::Throw(M_CODE_STR(MErrorEnum::CrcCheckFailed, M_I("CRC check failed")));
                M_ENSURED_ASSERT(0);
             }
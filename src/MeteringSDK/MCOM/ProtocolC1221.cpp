@@ -352,7 +352,7 @@ void MProtocolC1221::Authenticate()
 #if !M_NO_MCOM_PASSWORD_AND_KEY_LIST
    m_authenticationKeyListSuccessfulEntry = -1;
 #endif
-   MProtocolServiceWrapper wrapper(this, M_OPT_STR("Authenticate"), MProtocolServiceWrapper::ServiceNotQueueable);
+   MProtocolServiceWrapper wrapper(this, M_OPT_STR("Authenticate"), MProtocolServiceWrapper::ServiceNotQueueable, MProtocol::LatencySecurity);
    try
    {
       if ( !m_canAuthenticate )
@@ -638,6 +638,11 @@ void MProtocolC1221::DoApplicationLayerRequest(char command, const MByteString*
                      doNotSendOutgoingPacket = true;
                      m_channel->WriteByte(CHAR_NAK); // <NAK>, the packet was not received
                   }
+                  if ( linkRetryCount != 0 ) // most frequent failure of a noisy link, retry without throwing
+                  {
+                     wrapper.NotifyOrThrowRetry(M_CODE_STR(MErrorEnum::CrcCheckFailed, M_I("CRC check failed")), linkRetryCount);
+                     continue;
+                  }
                   MCOMException::Throw(M_CODE_STR(MErrorEnum::CrcCheckFailed, M_I("CRC check failed")));
                   M_ENSURED_ASSERT(0);
                }
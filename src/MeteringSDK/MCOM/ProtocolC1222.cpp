@@ -119,6 +119,11 @@ MProtocolC1222::~MProtocolC1222()
 #if !M_NO_MCOM_PASSWORD_AND_KEY_LIST
    MAes::DestroySecureData(m_securityKeyList);
 #endif
+
+   std::vector<void*>::iterator it = m_queuedServiceWrapperStorage.begin();
+   std::vector<void*>::iterator itEnd = m_queuedServiceWrapperStorage.end();
+   for ( ; it != itEnd; ++it )
+      ::operator delete(*it);
 }
 
 void MProtocolC1222::SetResponseControl(ResponseControlEnum c)
@@ -1061,14 +1066,19 @@ void MProtocolC1222::SendService(char command)
 }
 
 void MProtocolC1222::SendServiceWithData(char command, const MByteString& data)
+{
+   DoSendServiceWithData(command, data.data(), static_cast<unsigned>(data.size()));
+}
+
+void MProtocolC1222::DoSendServiceWithData(char command, const char* data, unsigned size)
 {
    char buff [ 8 ];
-   unsigned len = static_cast<unsigned>(data.size()) + 1;// +1 to add command byte size
+   unsigned len = size + 1;// +1 to add command byte size
    unsigned dataLen = MIso8825::EncodeLengthIntoBuffer(len, buff);
    M_ASSERT(dataLen <= 5);
    buff[dataLen++] = command;
    m_outgoingApdu.Append(buff, dataLen);
-   m_outgoingApdu.Append(data);
+   m_outgoingApdu.Append(data, size);
 }
 
 unsigned MProtocolC1222::ReceiveServiceLength()
@@ -1127,7 +1137,7 @@ void MProtocolC1222::ReceiveLogon()
 
 void MProtocolC1222::Logon()
 {
-   MProtocolServiceWrapper wrapper(m_wrapperProtocol, M_OPT_STR("Logon"), MProtocolServiceWrapper::ServiceNotQueueable | MProtocolServiceWrapper::ServiceStartsSessionKeeping);
+   MProtocolServiceWrapper wrapper(m_wrapperProtocol, M_OPT_STR("Logon"), MProtocolServiceWrapper::ServiceNotQueueable | MProtocolServiceWrapper::ServiceStartsSessionKeeping, MProtocol::LatencyLogon);
    for ( unsigned appRetryCount = m_applicationLayerRetries; ; --appRetryCount )
    {
       try
@@ -1160,40 +1170,38 @@ void MProtocolC1222::Logon()
    }
 }
 
-   static MByteString DoGetEffectivePassword(MProtocolC1222* self)
-   {
-      MByteString password;
+void MProtocolC1222::SendSecurity()
+{
+   const MByteString* password = &m_password;
 #if !M_NO_MCOM_PASSWORD_AND_KEY_LIST
-      int entry = self->GetPasswordListSuccessfulEntry();
-      if ( entry >= 0 && self->GetPasswordList().size() >= (size_t)entry + 1 )
-         password = self->GetPasswordList()[entry];
-      else
+   if ( m_passwordListSuccessfulEntry >= 0 && m_passwordList.size() >= (size_t)m_passwordListSuccessfulEntry + 1 )
+      password = &m_passwordList[m_passwordListSuccessfulEntry];
 #endif // !M_NO_MCOM_PASSWORD_AND_KEY_LIST
-      {
-         password = self->GetPassword();
-      }
 
-      unsigned diff = 20 - unsigned(password.size());
-      if ( diff > 0 )
-         password.append(diff, ' '); // fill the rest of the password with blanks
-      M_ASSERT(password.size() == 20);
-      return password;
-   }
-
-void MProtocolC1222::SendSecurity()
-{
-   MByteString password = DoGetEffectivePassword(this);
-   M_ASSERT(password.size() == 20);
+   char body [ 22 ]; // the body is built on stack, so the password is not copied into heap
+   unsigned size = static_cast<unsigned>(password->size());
+   M_ASSERT(size <= 20);
+   if ( size > 20 )
+      size = 20;
+   memcpy(body, password->data(), size);
+   memset(body + size, ' ', 20 - size); // fill the rest of the password with blanks
 
+   unsigned bodySize = 20;
    if ( m_sessionless ) // when sessionless, password shall be followed by USER_ID, otherwise USER_ID is provided by Logon service
    {
-      MByteString body = password;
-      Muint16 userId = MToBigEndianUINT16(m_userId);
-      body.append((const char*)&userId, sizeof(userId));
-      SendServiceWithData('\x51', body);
+      MToBigEndianUINT16(m_userId, body + 20);
+      bodySize = 22;
    }
-   else
-      SendServiceWithData('\x51', password);
+   try
+   {
+      DoSendServiceWithData('\x51', body, bodySize);
+   }
+   catch ( ... )
+   {
+      MAes::DestroySecureData(body, sizeof(body));
+      throw;
+   }
+   MAes::DestroySecureData(body, sizeof(body));
 }
 
 void MProtocolC1222::ReceiveSecurity()
@@ -1426,6 +1434,13 @@ void MProtocolC1222::DoFunctionSend(MCOMNumberConstRef number, const MByteString
 MByteString MProtocolC1222::DoFunctionReceive(MCOMNumberConstRef number, const MByteString& request, bool expectResponse)
 {
    MByteString response;
+   DoFunctionReceive(number, request, expectResponse, response);
+   return response;
+}
+
+void MProtocolC1222::DoFunctionReceive(MCOMNumberConstRef number, const MByteString& request, bool expectResponse, MByteString& response)
+{
+   response.clear(); // keep the capacity of the buffer
    unsigned num = DoConvertNumberToUnsigned(number, 0x100FFu); // allow for protocol services tagged with 0x10000
    if ( num & 0x10000 ) // Protocol Services called
    {
@@ -1444,11 +1459,11 @@ MByteString MProtocolC1222::DoFunctionReceive(MCOMNumberConstRef number, const M
 #endif
       if ( !doSkip )
       {
-         response = ReceiveTableRead(8);
+         ReceiveServiceCodeIgnoreLength(); // signal error, if any
+         DoAppendTableReadResponse(response);
          DoHandleFunctionResponseTable8Read(response);
       }
    }
-   return response;
 }
 
 void MProtocolC1222::DoStartSession()
@@ -1505,7 +1520,7 @@ void MProtocolC1222::DoStartSession()
                FullLogin();
             else
             {
-               MProtocolServiceWrapper wrapper(this, M_OPT_STR("Security"), MProtocolServiceWrapper::ServiceNotQueueable);
+               MProtocolServiceWrapper wrapper(this, M_OPT_STR("Security"), MProtocolServiceWrapper::ServiceNotQueueable, MProtocol::LatencySecurity);
                try
                {
                   DoTryPasswordEntry(m_passwordList[m_passwordListSuccessfulEntry]);
@@ -1989,7 +2004,8 @@ void MProtocolC1222::DoQCommitSubrange(MCommunicationQueue::iterator& start, MCo
 
    MCommunicationQueue::iterator localStart = start;
    MCommunicationQueue::iterator i = localStart;
-   MCommunicationQueue localQueue;
+   MCommunicationQueue& localQueue = m_apduQueue;
+   localQueue.clear(); // commands left by a failed commit are recycled
    unsigned maximumOutgoingHeaderSize = DoGetMaximumApduHeaderSize();
    unsigned maximumIncomingHeaderSize = maximumOutgoingHeaderSize;
    if ( m_sessionless )
@@ -2127,12 +2143,12 @@ void MProtocolC1222::DoQCommitSubrange(MCommunicationQueue::iterator& start, MCo
                case MCommunicationCommand::CommandEndSession:
                case MCommunicationCommand::CommandEndSessionNoThrow:
                   M_ASSERT(!m_sessionless); // otherwise we are never here
-                  localQueue.push_back(cmd->NewClone());
+                  localQueue.push_back(localQueue.NewClone(*cmd));
                   break;
                case MCommunicationCommand::CommandRead:
                case MCommunicationCommand::CommandReadPartial:
                   if ( estimatedEpsemResponseSize + responseSize < maximumEpsemSizeIncoming ) // possible case when after the flashing the queue the size starts to fit in
-                     localQueue.push_back(cmd->NewClone()); // start entering a new function
+                     localQueue.push_back(localQueue.NewClone(*cmd)); // start entering a new function
                   else
                   {
                      unsigned offset = ((cmd->m_type & MCommunicationCommand::FeatureOffsetPresent) == 0) ? 0 : cmd->GetOffset();
@@ -2149,7 +2165,7 @@ void MProtocolC1222::DoQCommitSubrange(MCommunicationQueue::iterator& start, MCo
                case MCommunicationCommand::CommandWrite:
                case MCommunicationCommand::CommandWritePartial:
                   if ( estimatedEpsemRequestSize + requestSize < maximumEpsemSizeOutgoing ) // possible case when after the flashing the queue the size starts to fit in
-                     localQueue.push_back(cmd->NewClone()); // start entering a new function
+                     localQueue.push_back(localQueue.NewClone(*cmd)); // start entering a new function
                   else
                   {
                      unsigned offset = ((cmd->m_type & MCommunicationCommand::FeatureOffsetPresent) == 0) ? 0 : cmd->GetOffset();
@@ -2167,7 +2183,7 @@ void MProtocolC1222::DoQCommitSubrange(MCommunicationQueue::iterator& start, MCo
                case MCommunicationCommand::CommandExecuteRequest:
                case MCommunicationCommand::CommandExecuteResponse:
                case MCommunicationCommand::CommandExecuteRequestResponse:
-                  localQueue.push_back(cmd->NewClone()); // start entering a new function
+                  localQueue.push_back(localQueue.NewClone(*cmd)); // start entering a new function
                   break;
                default:
                   M_ASSERT(0); // warn on debug, ignore on release -- possibility of a new command
@@ -2177,7 +2193,7 @@ void MProtocolC1222::DoQCommitSubrange(MCommunicationQueue::iterator& start, MCo
             {
                estimatedEpsemRequestSize += requestSize;
                estimatedEpsemResponseSize += responseSize;
-               localQueue.push_back(cmd->NewClone());
+               localQueue.push_back(localQueue.NewClone(*cmd));
             }
          }
          DoQCommitAtomicQueue(localQueue, action, (localActionWeight + previousLocalActionWeight) / 2.0);
@@ -2207,6 +2223,112 @@ void MProtocolC1222::DoQCommitSubrange(MCommunicationQueue::iterator& start, MCo
    }
 }
 
+// Deletes the service wrapper of a queue command at the end of scope, keeping its storage for reuse
+//
+class MProtocolC1222::QueuedServiceWrapperPtr
+{
+public:
+
+   QueuedServiceWrapperPtr(MProtocolC1222* protocol, MProtocolServiceWrapper* wrapper) M_NO_THROW
+   :
+      m_protocol(protocol),
+      m_wrapper(wrapper)
+   {
+   }
+
+   ~QueuedServiceWrapperPtr() M_NO_THROW
+   {
+      m_protocol->DoDeleteQueuedServiceWrapper(m_wrapper);
+   }
+
+   MProtocolServiceWrapper* operator->() const M_NO_THROW
+   {
+      return m_wrapper;
+   }
+
+private:
+
+   QueuedServiceWrapperPtr(const QueuedServiceWrapperPtr&);
+   QueuedServiceWrapperPtr& operator=(const QueuedServiceWrapperPtr&);
+
+private: // Data:
+
+   MProtocolC1222* m_protocol;
+   MProtocolServiceWrapper* m_wrapper;
+};
+
+void* MProtocolC1222::DoTakeQueuedServiceWrapperStorage()
+{
+   if ( m_queuedServiceWrapperStorage.empty() )
+      return ::operator new(sizeof(MProtocolServiceWrapper));
+   void* storage = m_queuedServiceWrapperStorage.back();
+   m_queuedServiceWrapperStorage.pop_back();
+   return storage;
+}
+
+void MProtocolC1222::DoReturnQueuedServiceWrapperStorage(void* storage) M_NO_THROW
+{
+   try
+   {
+      m_queuedServiceWrapperStorage.push_back(storage);
+   }
+   catch ( ... )
+   {
+      ::operator delete(storage); // no memory to keep it
+   }
+}
+
+MProtocolServiceWrapper* MProtocolC1222::DoNewQueuedServiceWrapper(MConstChars serviceName, unsigned flags)
+{
+   void* storage = DoTakeQueuedServiceWrapperStorage();
+   try
+   {
+      return new(storage) MProtocolServiceWrapper(m_wrapperProtocol, serviceName, flags);
+   }
+   catch ( ... )
+   {
+      DoReturnQueuedServiceWrapperStorage(storage);
+      throw;
+   }
+}
+
+MProtocolServiceWrapper* MProtocolC1222::DoNewQueuedServiceWrapper(MConstChars serviceName, MCOMNumberConstRef number, int i1, int i2)
+{
+   void* storage = DoTakeQueuedServiceWrapperStorage();
+   try
+   {
+      return new(storage) MProtocolServiceWrapper(m_wrapperProtocol, serviceName, number, i1, i2);
+   }
+   catch ( ... )
+   {
+      DoReturnQueuedServiceWrapperStorage(storage);
+      throw;
+   }
+}
+
+void MProtocolC1222::DoDeleteQueuedServiceWrapper(MProtocolServiceWrapper* wrapper) M_NO_THROW
+{
+   wrapper->~MProtocolServiceWrapper();
+   DoReturnQueuedServiceWrapperStorage(wrapper);
+}
+
+void MProtocolC1222::DoReceiveTableReadIntoCommand(MCommunicationCommand* command)
+{
+   MByteString& response = command->m_response;
+   const MByteString::size_type previousSize = response.size();
+   try
+   {
+      ReceiveServiceCodeIgnoreLength(); // signal error, if any
+      DoAppendTableReadResponse(response);
+   }
+   catch ( ... )
+   {
+      response.resize(previousSize); // do not leave a partially received piece
+      throw;
+   }
+   command->m_responsePresent = true;
+}
+
 void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
                                       #if !M_NO_PROGRESS_MONITOR
                                           , MProgressAction* action, double progress
@@ -2260,7 +2382,7 @@ void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
             {
                M_ASSERT(i == q.begin()); // a retried function is always the first command
                SendTableRead(8);
-               M_NEW MProtocolServiceWrapper(m_wrapperProtocol, M_OPT_STR("FunctionExecuteRetried"), cmd->GetNumber(), -1, -1);
+               DoNewQueuedServiceWrapper(M_OPT_STR("FunctionExecuteRetried"), cmd->GetNumber(), -1, -1);
             }
             else
             {
@@ -2269,55 +2391,55 @@ void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
                case MCommunicationCommand::CommandStartSession:
                   M_ASSERT(!m_sessionless);
                   DoSendStartSession();
-                  M_NEW MProtocolServiceWrapper(m_wrapperProtocol, M_OPT_STR("StartSession"), MProtocolServiceWrapper::ServiceStartsSessionKeeping);
+                  DoNewQueuedServiceWrapper(M_OPT_STR("StartSession"), MProtocolServiceWrapper::ServiceStartsSessionKeeping);
                   break;
                case MCommunicationCommand::CommandEndSession:
                case MCommunicationCommand::CommandEndSessionNoThrow:
                   M_ASSERT(!m_sessionless);
                   DoSendEndSession();
-                  M_NEW MProtocolServiceWrapper(m_wrapperProtocol, M_OPT_STR("EndSession"), MProtocolServiceWrapper::ServiceEndsSessionKeeping);
+                  DoNewQueuedServiceWrapper(M_OPT_STR("EndSession"), MProtocolServiceWrapper::ServiceEndsSessionKeeping);
                   break;
                case MCommunicationCommand::CommandRead:
                   if ( m_alwaysUsePartial && cmd->GetLength() != 0 )
                      SendTableReadPartial(cmd->GetNumber(), 0, cmd->GetLength());
                   else
                      SendTableRead(cmd->GetNumber());
-                  M_NEW MProtocolServiceWrapper(m_wrapperProtocol, M_OPT_STR("TableRead"), cmd->GetNumber(), -1, -1);
+                  DoNewQueuedServiceWrapper(M_OPT_STR("TableRead"), cmd->GetNumber(), -1, -1);
                   break;
                case MCommunicationCommand::CommandWrite:
                   if ( m_alwaysUsePartial )
                      SendTableWritePartial(cmd->GetNumber(), cmd->GetRequest(), 0);
                   else
                      SendTableWrite(cmd->GetNumber(), cmd->GetRequest());
-                  M_NEW MProtocolServiceWrapper(m_wrapperProtocol, M_OPT_STR("TableWrite"), cmd->GetNumber(), -1, -1);
+                  DoNewQueuedServiceWrapper(M_OPT_STR("TableWrite"), cmd->GetNumber(), -1, -1);
                   break;
                case MCommunicationCommand::CommandReadPartial:
                   SendTableReadPartial(cmd->GetNumber(), cmd->GetOffset(), cmd->GetLength());
-                  M_NEW MProtocolServiceWrapper(m_wrapperProtocol, M_OPT_STR("TableReadPartial"), cmd->GetNumber(), cmd->GetOffset(), cmd->GetLength());
+                  DoNewQueuedServiceWrapper(M_OPT_STR("TableReadPartial"), cmd->GetNumber(), cmd->GetOffset(), cmd->GetLength());
                   break;
                case MCommunicationCommand::CommandWritePartial:
                   SendTableWritePartial(cmd->GetNumber(), cmd->GetRequest(), cmd->GetOffset());
-                  M_NEW MProtocolServiceWrapper(m_wrapperProtocol, M_OPT_STR("TableWritePartial"), cmd->GetNumber(), cmd->GetOffset(), (int)cmd->GetRequest().size());
+                  DoNewQueuedServiceWrapper(M_OPT_STR("TableWritePartial"), cmd->GetNumber(), cmd->GetOffset(), (int)cmd->GetRequest().size());
                   break;
                case MCommunicationCommand::CommandExecute:
                   m_meterIsLittleEndian = cmd->GetLittleEndian(); // do it only at function data send
                   FunctionExecuteSend(cmd->GetNumber());
-                  M_NEW MProtocolServiceWrapper(m_wrapperProtocol, M_OPT_STR("FunctionExecute"), cmd->GetNumber(), -1, -1);
+                  DoNewQueuedServiceWrapper(M_OPT_STR("FunctionExecute"), cmd->GetNumber(), -1, -1);
                   break;
                case MCommunicationCommand::CommandExecuteRequest:
                   m_meterIsLittleEndian = cmd->GetLittleEndian(); // do it only at function data send
                   FunctionExecuteRequestSend(cmd->GetNumber(), cmd->GetRequest());
-                  M_NEW MProtocolServiceWrapper(m_wrapperProtocol, M_OPT_STR("FunctionExecuteRequest"), cmd->GetNumber(), -1, -1);
+                  DoNewQueuedServiceWrapper(M_OPT_STR("FunctionExecuteRequest"), cmd->GetNumber(), -1, -1);
                   break;
                case MCommunicationCommand::CommandExecuteResponse:
                   m_meterIsLittleEndian = cmd->GetLittleEndian(); // do it only at function data send
                   FunctionExecuteResponseSend(cmd->GetNumber());
-                  M_NEW MProtocolServiceWrapper(m_wrapperProtocol, M_OPT_STR("FunctionExecuteResponse"), cmd->GetNumber(), -1, -1);
+                  DoNewQueuedServiceWrapper(M_OPT_STR("FunctionExecuteResponse"), cmd->GetNumber(), -1, -1);
                   break;
                case MCommunicationCommand::CommandExecuteRequestResponse:
                   m_meterIsLittleEndian = cmd->GetLittleEndian(); // do it only at function data send
                   FunctionExecuteRequestResponseSend(cmd->GetNumber(), cmd->GetRequest());
-                  M_NEW MProtocolServiceWrapper(m_wrapperProtocol, M_OPT_STR("FunctionExecuteRequestResponse"), cmd->GetNumber(), -1, -1);
+                  DoNewQueuedServiceWrapper(M_OPT_STR("FunctionExecuteRequestResponse"), cmd->GetNumber(), -1, -1);
                   break;
                case MCommunicationCommand::CommandWriteToMonitor:
                   #if !M_NO_MCOM_MONITOR
@@ -2375,10 +2497,7 @@ void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
                      DoReceiveEndSession();
                      break;
                   case MCommunicationCommand::CommandRead:
-                     if ( m_alwaysUsePartial && cmd->GetLength() != 0 )
-                        m_queue.GetResponseCommand(cmd->m_type, num, id)->AppendResponse(ReceiveTableReadPartial(num, 0, cmd->GetLength()));
-                     else
-                        m_queue.GetResponseCommand(cmd->m_type, num, id)->AppendResponse(ReceiveTableRead(num));
+                     DoReceiveTableReadIntoCommand(m_queue.GetResponseCommand(cmd->m_type, num, id)); // full and partial responses are the same
                      break;
                   case MCommunicationCommand::CommandWrite:
                      if ( m_alwaysUsePartial )
@@ -2387,7 +2506,7 @@ void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
                         ReceiveTableWrite(num, cmd->GetRequest());
                      break;
                   case MCommunicationCommand::CommandReadPartial:
-                     m_queue.GetResponseCommand(cmd->m_type, num, id)->AppendResponse(ReceiveTableReadPartial(num, cmd->GetOffset(), cmd->GetLength()));
+                     DoReceiveTableReadIntoCommand(m_queue.GetResponseCommand(cmd->m_type, num, id));
                      break;
                   case MCommunicationCommand::CommandWritePartial:
                      ReceiveTableWritePartial(num, cmd->GetRequest(), cmd->GetOffset());
@@ -2399,10 +2518,15 @@ void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
                      FunctionExecuteRequestReceive(num, cmd->GetRequest());
                      break;
                   case MCommunicationCommand::CommandExecuteResponse:
-                     m_queue.GetResponseCommand(cmd->m_type, num, id)->SetResponse(FunctionExecuteResponseReceive(num));
-                     break;
                   case MCommunicationCommand::CommandExecuteRequestResponse:
-                     m_queue.GetResponseCommand(cmd->m_type, num, id)->SetResponse(FunctionExecuteRequestResponseReceive(num, cmd->GetRequest()));
+                     {
+                        MCommunicationCommand* responseCommand = m_queue.GetResponseCommand(cmd->m_type, num, id);
+                        if ( cmd->m_type == MCommunicationCommand::CommandExecuteResponse )
+                           DoFunctionReceive(num, MByteString(), true, responseCommand->m_response); // response is read in place
+                        else
+                           DoFunctionReceive(num, cmd->GetRequest(), true, responseCommand->m_response);
+                        responseCommand->m_responsePresent = true;
+                     }
                      break;
                   case MCommunicationCommand::CommandWriteToMonitor:
                      doNotDeleteWrapper = true;
@@ -2414,7 +2538,7 @@ void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
                if ( !doNotDeleteWrapper )
                {
                   M_ASSERT(firstWrapper < m_wrapperProtocol->m_serviceWrappers.size());
-                  delete m_wrapperProtocol->m_serviceWrappers[firstWrapper];
+                  DoDeleteQueuedServiceWrapper(m_wrapperProtocol->m_serviceWrappers[firstWrapper]);
                }
                ++successCount;
             }
@@ -2425,7 +2549,7 @@ void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
             for ( MCommunicationQueue::iterator j = q.begin(); j != q.end(); ++j )
             {
                M_ASSERT(firstWrapper < m_wrapperProtocol->m_serviceWrappers.size());
-               delete m_wrapperProtocol->m_serviceWrappers[firstWrapper];
+               DoDeleteQueuedServiceWrapper(m_wrapperProtocol->m_serviceWrappers[firstWrapper]);
                ++successCount;
             }
          }
@@ -2462,7 +2586,7 @@ void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
                   successCount = 0;
                   while ( m_wrapperProtocol->m_serviceWrappers.size() > firstWrapper )
                   {
-                     MUniquePtr<MProtocolServiceWrapper> curr(m_wrapperProtocol->m_serviceWrappers[m_wrapperProtocol->m_serviceWrappers.size() - 1]); // delete at the end
+                     QueuedServiceWrapperPtr curr(this, m_wrapperProtocol->m_serviceWrappers[m_wrapperProtocol->m_serviceWrappers.size() - 1]); // delete at the end
                      if ( m_wrapperProtocol->m_serviceWrappers.size() == firstWrapper + 1 )
                         curr->NotifyOrThrowRetry(ex, procRetryCount); // will never throw, as the retry count is nonzero
                      curr->HandleFailureSilently();
@@ -2482,7 +2606,7 @@ void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
             {
                while ( m_wrapperProtocol->m_serviceWrappers.size() > firstWrapper )
                {
-                  MUniquePtr<MProtocolServiceWrapper> curr(m_wrapperProtocol->m_serviceWrappers[m_wrapperProtocol->m_serviceWrappers.size() - 1]); // delete at the end
+                  QueuedServiceWrapperPtr curr(this, m_wrapperProtocol->m_serviceWrappers[m_wrapperProtocol->m_serviceWrappers.size() - 1]); // delete at the end
                   curr->HandleFailureSilently();
                }
 
@@ -2499,7 +2623,7 @@ void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
                   successCount = 0;
                   while ( m_wrapperProtocol->m_serviceWrappers.size() > firstWrapper )
                   {
-                     MUniquePtr<MProtocolServiceWrapper> curr(m_wrapperProtocol->m_serviceWrappers[m_wrapperProtocol->m_serviceWrappers.size() - 1]); // delete at the end
+                     QueuedServiceWrapperPtr curr(this, m_wrapperProtocol->m_serviceWrappers[m_wrapperProtocol->m_serviceWrappers.size() - 1]); // delete at the end
                      if ( m_wrapperProtocol->m_serviceWrappers.size() == firstWrapper + 1 )
                         curr->NotifyOrThrowRetry(ex, appRetryCount); // will never throw, as the retry count is nonzero
                      curr->HandleFailureSilently();
@@ -2528,7 +2652,7 @@ void MProtocolC1222::DoQCommitAtomicQueue(MCommunicationQueue& q
 
          while ( m_wrapperProtocol->m_serviceWrappers.size() > firstWrapper )
          {
-            MUniquePtr<MProtocolServiceWrapper> curr(m_wrapperProtocol->m_serviceWrappers[m_wrapperProtocol->m_serviceWrappers.size() - 1]); // delete at the end
+            QueuedServiceWrapperPtr curr(this, m_wrapperProtocol->m_serviceWrappers[m_wrapperProtocol->m_serviceWrappers.size() - 1]); // delete at the end
             if ( m_wrapperProtocol->m_serviceWrappers.size() == firstWrapper + 1 )
             {
                curr->HandleFailureAndRethrow(ex);
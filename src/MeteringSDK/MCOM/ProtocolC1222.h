@@ -1211,6 +1211,11 @@ protected: // Services:
 #endif
    void        DoFunctionSend(MCOMNumberConstRef number, const MByteString& request, bool expectResponse);
    MByteString DoFunctionReceive(MCOMNumberConstRef number, const MByteString& request, bool expectResponse);
+   void        DoFunctionReceive(MCOMNumberConstRef number, const MByteString& request, bool expectResponse, MByteString& response);
+
+   // Send service with command and data given as buffer, same as SendServiceWithData.
+   //
+   void DoSendServiceWithData(char command, const char* data, unsigned size);
 
    void DoReceiveStartHeader();
    void DoParseStartHeader();
@@ -1329,6 +1334,22 @@ protected: // Services:
    void DoQCommitSubrange(MCommunicationQueue::iterator& start, MCommunicationQueue::iterator end);
    void DoQCommitAtomicQueue(MCommunicationQueue& q);
 #endif
+
+   // Receive table read or partial table read response into the response of a given queue command.
+   // The response is appended in place, so the buffer capacity of the recycled command is reused.
+   // At failure, the response is restored to its previous size.
+   //
+   void DoReceiveTableReadIntoCommand(MCommunicationCommand* command);
+
+   // Service wrappers of the queue commands that are committed within a single APDU.
+   // Storage of the deleted wrappers is kept, and reused by the next commits.
+   //
+   class QueuedServiceWrapperPtr;
+   MProtocolServiceWrapper* DoNewQueuedServiceWrapper(MConstChars serviceName, unsigned flags);
+   MProtocolServiceWrapper* DoNewQueuedServiceWrapper(MConstChars serviceName, MCOMNumberConstRef number, int i1, int i2);
+   void DoDeleteQueuedServiceWrapper(MProtocolServiceWrapper* wrapper) M_NO_THROW;
+   void* DoTakeQueuedServiceWrapperStorage();
+   void DoReturnQueuedServiceWrapperStorage(void* storage) M_NO_THROW;
    void DoResetNegotiatedMaximumApduSizes();
    void DoResetSessionSpecificProperties();
    void DoResetIncomingProperties();
@@ -1514,6 +1535,15 @@ protected: // Attributes:
    Muint8              m_incomingEpsemControl;
    MProtocol*          m_wrapperProtocol;
 
+   // Commands of a single APDU, copied from the protocol queue at commit.
+   // The queue is kept between commits, so the copies are recycled.
+   //
+   MCommunicationQueue m_apduQueue;
+
+   // Storage of the deleted service wrappers of the queue commands, ready for reuse
+   //
+   std::vector<void*> m_queuedServiceWrapperStorage;
+
 #if !M_NO_MCOM_PASSWORD_AND_KEY_LIST
 
    // Protocol application level password list. Takes rule over m_password, if not empty.
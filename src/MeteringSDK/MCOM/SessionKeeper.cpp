@@ -4,6 +4,7 @@
 #include "Protocol.h"
 #include "SessionKeeper.h"
 #include "MCOMExceptions.h"
+#include "SessionTrace.h"
 
 MProtocolLayerWrapper::MProtocolLayerWrapper(MProtocol* proto)
 :
@@ -12,6 +13,9 @@ MProtocolLayerWrapper::MProtocolLayerWrapper(MProtocol* proto)
    m_monitor(NULL), // nullify so there is no problem if an error is thrown
 #endif
    m_failed(true) // at start assume the service failed to start (this will be overwritten later)
+#if !M_NO_MCOM_SESSION_TRACE
+   , m_traceStart(0)
+#endif
 {
    m_protocol->DoCheckChannel(true); // check the channel is present, but do not verify there is no background communication
    MChannel* chan = m_protocol->GetChannel();
@@ -51,6 +55,14 @@ void MProtocolLayerWrapper::DoThrowIfNotRetryable(MException& ex, bool communica
    }
 }
 
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+void MProtocolLayerWrapper::DoAddLatency(int latencyType) M_NO_THROW
+{
+   M_ASSERT(latencyType >= 0 && latencyType < MProtocol::LatencyNumberOfTypes);
+   m_protocol->m_latencyHistograms[latencyType].Add(MUtilities::GetTickCount() - m_startTick);
+}
+#endif
+
 void MProtocolLayerWrapper::HandleFailureSilently()
 {
    m_failed = true;
@@ -76,6 +88,13 @@ MProtocolLinkLayerWrapper::MProtocolLinkLayerWrapper(MProtocol* proto)
 //      if ( m_monitor != NULL )
 //         m_monitor->OnDataLinkLayerStart();
 //   #endif
+   #if !M_NO_MCOM_LATENCY_HISTOGRAMS
+      m_startTick = MUtilities::GetTickCount();
+   #endif
+   #if !M_NO_MCOM_SESSION_TRACE
+      if ( MSessionTrace::GetEnabled() )
+         m_traceStart = MSessionTrace::GetMicroseconds();
+   #endif
    m_failed = false; // created wrapper successfully
 }
 
@@ -86,6 +105,9 @@ MProtocolLinkLayerWrapper::~MProtocolLinkLayerWrapper() M_NO_THROW
       try
       {
          m_protocol->IncrementCountLinkLayerPacketsSuccessful();
+         #if !M_NO_MCOM_LATENCY_HISTOGRAMS
+            DoAddLatency(MProtocol::LatencyLinkLayerPacket);
+         #endif
          #if !M_NO_MCOM_MONITOR
             if ( m_monitor != NULL )
                m_monitor->OnDataLinkLayerSuccess();
@@ -96,6 +118,10 @@ MProtocolLinkLayerWrapper::~MProtocolLinkLayerWrapper() M_NO_THROW
          M_ASSERT(0);
       }
    }
+   #if !M_NO_MCOM_SESSION_TRACE
+      if ( m_traceStart != 0 )
+         MSessionTrace::AddSpan("link", "LinkLayerPacket", m_traceStart, m_failed);
+   #endif
 }
 
 void MProtocolLinkLayerWrapper::HandleFailureNoThrow(MException& ex) M_NO_THROW
@@ -129,13 +155,76 @@ void MProtocolLinkLayerWrapper::NotifyOrThrowRetry(MException& reasonException,
       M_ENSURED_ASSERT(0);
    }
    else
+   {
+      #if !M_NO_MCOM_SESSION_TRACE
+         MSessionTrace::AddInstant("link", "LinkLayerRetry");
+      #endif
       NotifyRetry(reasonException);
+   }
+}
+
+#if !M_NO_VERBOSE_ERROR_INFORMATION
+void MProtocolLinkLayerWrapper::NotifyOrThrowRetry(MErrorEnum::Type code, MConstLocalChars str, unsigned retries)
+#else
+void MProtocolLinkLayerWrapper::NotifyOrThrowRetry(MErrorEnum::Type code, unsigned retries)
+#endif
+{
+   if ( retries == 0 )
+   {
+      MCOMException ex(M_CODE_STR(code, str));
+      NotifyOrThrowRetry(ex, retries);
+      M_ENSURED_ASSERT(0);
+   }
+   #if !M_NO_MCOM_SESSION_TRACE
+      MSessionTrace::AddInstant("link", "LinkLayerRetry");
+   #endif
+   #if !M_NO_VERBOSE_ERROR_INFORMATION
+      try
+      {
+         m_protocol->IncrementCountLinkLayerPacketsRetried();
+         #if !M_NO_MCOM_MONITOR
+            if ( m_monitor != NULL )
+               m_monitor->OnDataLinkLayerRetry(MGetStdString(str));
+         #endif
+      }
+      catch ( ... )
+      {
+         M_ASSERT(0);
+      }
+   #endif
 }
 
 #if !M_NO_VERBOSE_ERROR_INFORMATION
 void MProtocolLinkLayerWrapper::NotifyRetry(const MException& reasonException) M_NO_THROW
 {
-   NotifyRetry(reasonException.AsString());
+   try
+   {
+      m_protocol->IncrementCountLinkLayerPacketsRetried();
+      #if !M_NO_MCOM_MONITOR
+         if ( m_monitor != NULL  )
+            m_monitor->OnDataLinkLayerRetry(reasonException.AsString()); // the message is formatted only when it is shown
+      #endif
+   }
+   catch ( ... )
+   {
+      M_ASSERT(0);
+   }
+}
+
+void MProtocolLinkLayerWrapper::NotifyRetry(MConstChars str) M_NO_THROW
+{
+   try
+   {
+      m_protocol->IncrementCountLinkLayerPacketsRetried();
+      #if !M_NO_MCOM_MONITOR
+         if ( m_monitor != NULL  )
+            m_monitor->OnDataLinkLayerRetry(str);
+      #endif
+   }
+   catch ( ... )
+   {
+      M_ASSERT(0);
+   }
 }
 
 void MProtocolLinkLayerWrapper::NotifyRetry(const MStdString& str) M_NO_THROW
@@ -155,41 +244,57 @@ void MProtocolLinkLayerWrapper::NotifyRetry(const MStdString& str) M_NO_THROW
 }
 #endif // !M_NO_VERBOSE_ERROR_INFORMATION
 
-MProtocolServiceWrapper::MProtocolServiceWrapper(MProtocol* proto, MConstChars name, unsigned flags)
+#if !M_NO_VERBOSE_ERROR_INFORMATION
+   M_COMPILED_ASSERT(static_cast<int>(MProtocolServiceWrapper::MAXIMUM_NAME_SIZE) == static_cast<int>(MProtocol::MAXIMUM_SERVICE_NAME_STRING_SIZE));
+#endif
+
+MProtocolServiceWrapper::MProtocolServiceWrapper(MProtocol* proto, MConstChars name, unsigned flags, int latencyType)
 :
    MProtocolLayerWrapper(proto),
    m_flags(flags),
    m_dropSessionAfterFailure(false)
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+   , m_latencyType(latencyType)
+#endif
 {
 #if !M_NO_VERBOSE_ERROR_INFORMATION
    if ( name != NULL )
    {
       M_ASSERT(name[0] != '\0');
-      m_name = name;
+      M_ASSERT(strlen(name) < MAXIMUM_NAME_SIZE);
+      m_strncpy(m_name, name, MAXIMUM_NAME_SIZE - 1);
+      m_name[MAXIMUM_NAME_SIZE - 1] = '\0';
+   }
+   else
+   {
+      m_name[0] = '\0';
+   #if !M_NO_MCOM_MONITOR
+      m_monitor = NULL; // do not show anything on monitor if service has no name
+   #endif
    }
 #else
    M_ASSERT(name == NULL);
-#endif
-#if !M_NO_MCOM_MONITOR
-   else
+   #if !M_NO_MCOM_MONITOR
       m_monitor = NULL; // do not show anything on monitor if service has no name
+   #endif
 #endif
    DoInit();
 }
 
-MProtocolServiceWrapper::MProtocolServiceWrapper(MProtocol* proto, MConstChars serviceName, MCOMNumberConstRef number, int i1, int i2)
+MProtocolServiceWrapper::MProtocolServiceWrapper(MProtocol* proto, MConstChars serviceName, MCOMNumberConstRef number, int i1, int i2, int latencyType)
 :
    MProtocolLayerWrapper(proto),
    m_flags(ServiceOrdinary),
    m_dropSessionAfterFailure(false)
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+   , m_latencyType(latencyType)
+#endif
 {
 #if !M_NO_VERBOSE_ERROR_INFORMATION
    M_ASSERT(serviceName != NULL && serviceName[0] != '\0');
 
-   char name [ MProtocol::MAXIMUM_SERVICE_NAME_STRING_SIZE ];
-   m_protocol->DoBuildComplexServiceName(name, serviceName, number, i1, i2);
-   m_name = name;
-   M_ASSERT(m_name.size() < MProtocol::MAXIMUM_SERVICE_NAME_STRING_SIZE); // Check if MAXIMUM_SERVICE_NAME_STRING_SIZE is big enough
+   m_protocol->DoBuildComplexServiceName(m_name, serviceName, number, i1, i2);
+   M_ASSERT(strlen(m_name) < MProtocol::MAXIMUM_SERVICE_NAME_STRING_SIZE); // Check if MAXIMUM_SERVICE_NAME_STRING_SIZE is big enough
 #else
    M_ASSERT(serviceName == NULL);
 #endif
@@ -220,8 +325,8 @@ void MProtocolServiceWrapper::DoInit()
          // Only then notify the start of the service
          if ( m_monitor != NULL )
          {
-            M_ASSERT(!m_name.empty());
-            m_monitor->OnApplicationLayerStart(m_name);
+            M_ASSERT(m_name[0] != '\0');
+            m_monitor->OnApplicationLayerStart(MStdString(m_name));
          }
       #endif
    }
@@ -230,6 +335,13 @@ void MProtocolServiceWrapper::DoInit()
       m_protocol->m_isInSession = false; // in case of any exception at the init stage ensure we are not in session
       throw;
    }
+   #if !M_NO_MCOM_LATENCY_HISTOGRAMS
+      m_startTick = MUtilities::GetTickCount();
+   #endif
+   #if !M_NO_MCOM_SESSION_TRACE
+      if ( MSessionTrace::GetEnabled() )
+         m_traceStart = MSessionTrace::GetMicroseconds();
+   #endif
    m_failed = false; // service is successfully started
 
    // Last, register this service with protocol
@@ -261,13 +373,17 @@ MProtocolServiceWrapper::~MProtocolServiceWrapper() M_NO_THROW
    {
       m_protocol->m_isInSession = ((m_flags & ServiceEndsSessionKeeping) == 0);
       m_protocol->IncrementCountApplicationLayerServicesSuccessful();
+      #if !M_NO_MCOM_LATENCY_HISTOGRAMS
+         if ( m_latencyType >= 0 )
+            DoAddLatency(m_latencyType);
+      #endif
       #if !M_NO_MCOM_MONITOR
          if ( m_monitor != NULL )
          {
-            M_ASSERT(!m_name.empty());
+            M_ASSERT(m_name[0] != '\0');
             try
             {
-               m_monitor->OnApplicationLayerSuccess(m_name);
+               m_monitor->OnApplicationLayerSuccess(MStdString(m_name));
             }
             catch ( ... )
             {
@@ -277,6 +393,17 @@ MProtocolServiceWrapper::~MProtocolServiceWrapper() M_NO_THROW
       #endif
    }
 
+   #if !M_NO_MCOM_SESSION_TRACE
+      if ( m_traceStart != 0 )
+      {
+         #if !M_NO_VERBOSE_ERROR_INFORMATION
+            MSessionTrace::AddSpan("service", m_name[0] == '\0' ? "Service" : m_name, m_traceStart, m_failed);
+         #else
+            MSessionTrace::AddSpan("service", "Service", m_traceStart, m_failed);
+         #endif
+      }
+   #endif
+
    #if !M_NO_MCOM_KEEP_SESSION_ALIVE
       // At last (and always) notify the session keeper we are about to end the service
       m_protocol->m_sessionKeeper.LeaveService();
@@ -305,12 +432,12 @@ void MProtocolServiceWrapper::HandleFailureNoThrow(MException& ex) M_NO_THROW
          m_dropSessionAfterFailure = true;
 
 #if !M_NO_VERBOSE_ERROR_INFORMATION
-      if ( !m_name.empty() )
+      if ( m_name[0] != '\0' )
       {
          // We have to make sure we do not append the string twice
          //
          MStdString str = ex.AsString();
-         MStdString app = MGetStdString(M_I(" in %s"), m_name.c_str());
+         MStdString app = MGetStdString(M_I(" in %s"), m_name);
          int startPos = int(str.size()) - int(app.size());
          if ( startPos < 0 || m_strncmp(str.c_str() + startPos, app.c_str(), app.size()) != 0 )
             ex.Append(app);
@@ -376,6 +503,9 @@ void MProtocolServiceWrapper::StaticNotifyOrThrowRetry(MProtocol* proto, MExcept
    }
    else
    {
+      #if !M_NO_MCOM_SESSION_TRACE
+         MSessionTrace::AddInstant("service", "ServiceRetry");
+      #endif
       proto->IncrementCountApplicationLayerServicesRetried();
       #if !M_NO_MCOM_MONITOR
          if ( proto->GetChannel()->GetMonitor() != NULL )
@@ -404,6 +534,9 @@ void MProtocolServiceWrapper::NotifyOrThrowRetry(MException& ex, unsigned retrie
    }
    else
    {
+      #if !M_NO_MCOM_SESSION_TRACE
+         MSessionTrace::AddInstant("service", "ServiceRetry");
+      #endif
       m_protocol->IncrementCountApplicationLayerServicesRetried();
       #if !M_NO_MCOM_MONITOR
          if ( m_monitor != NULL )
@@ -54,6 +54,12 @@ protected:
    //
    static void DoThrowIfNotRetryable(MException& ex, bool communicationErrorIsRetryable);
 
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+   // Add the time passed since the start of the wrapper to the protocol latency histogram of the given type.
+   //
+   void DoAddLatency(int latencyType) M_NO_THROW;
+#endif
+
 private: // Copying preventors:
 
    MProtocolLayerWrapper();
@@ -77,6 +83,18 @@ protected: // Data:
    // Service failed, NotifyFailure was called
    //
    bool m_failed;
+
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+   // Tick count at which the wrapped service or packet has started
+   //
+   unsigned m_startTick;
+#endif
+
+#if !M_NO_MCOM_SESSION_TRACE
+   // Microseconds at which the wrapped service or packet has started, or zero if it is not traced
+   //
+   Muint64 m_traceStart;
+#endif
 };
 
 // Class that facilitates handling of protocol link layers.
@@ -101,6 +119,17 @@ public: // Constructor, destructor:
    //
    void NotifyOrThrowRetry(MException& reasonException, unsigned retries);
 
+   // Notify a link layer retry with the reason given as error code and message, as in M_CODE_STR.
+   // No exception object is created unless the retries are expired, in which case the exception is thrown.
+   // The message is formatted only if there is a monitor to show it.
+   // This is the path for retry loops that detect the failure themselves, such as a bad CRC.
+   //
+#if !M_NO_VERBOSE_ERROR_INFORMATION
+   void NotifyOrThrowRetry(MErrorEnum::Type code, MConstLocalChars str, unsigned retries);
+#else
+   void NotifyOrThrowRetry(MErrorEnum::Type code, unsigned retries);
+#endif
+
 #if !M_NO_VERBOSE_ERROR_INFORMATION
    // Notify a link layer retry, using exception as a reason.
    //
@@ -109,6 +138,7 @@ public: // Constructor, destructor:
    // Notify about link layer event, not a retry.
    //
    void NotifyRetry(const MStdString& str) M_NO_THROW;
+   void NotifyRetry(MConstChars str) M_NO_THROW;
 #else
    void NotifyRetry(const MException&)
    {
@@ -116,6 +146,9 @@ public: // Constructor, destructor:
    void NotifyRetry(const MStdString&)
    {
    }
+   void NotifyRetry(MConstChars)
+   {
+   }
 #endif // !M_NO_VERBOSE_ERROR_INFORMATION
 
    // Throw a given exception if it is not of the kind that can be retried.
@@ -148,19 +181,26 @@ public: // Types:
    typedef std::vector<MProtocolServiceWrapper*>
       Stack;
 
+   enum
+   {
+      MAXIMUM_NAME_SIZE = 128 // Size of the service name buffer, equal to MProtocol::MAXIMUM_SERVICE_NAME_STRING_SIZE
+   };
+
 public: // Constructor and destructor:
 
    // Constructor for application layer wrapper. Takes the protocol that is to be kept protected.
    // Service name, if no string, means the service will not be reported on the monitor.
    // If endsSession is true, this service does not continue session.
+   // Latency type is MProtocol::LatencyType of the service, or -1 if the service latency is not accounted.
    //
-   MProtocolServiceWrapper(MProtocol* proto, MConstChars serviceName = NULL, unsigned flags = ServiceOrdinary);
+   MProtocolServiceWrapper(MProtocol* proto, MConstChars serviceName = NULL, unsigned flags = ServiceOrdinary, int latencyType = -1);
 
    // Constructor for application layer wrapper. Takes the protocol that is to be kept protected.
    // Service name, number and two extra parameters are used to build service signature.
    // FlagsMask is always ServiceOrdinary for this service.
+   // Latency type is MProtocol::LatencyType of the service, or -1 if the service latency is not accounted.
    //
-   MProtocolServiceWrapper(MProtocol* proto, MConstChars serviceName, MCOMNumberConstRef number, int i1, int i2);
+   MProtocolServiceWrapper(MProtocol* proto, MConstChars serviceName, MCOMNumberConstRef number, int i1, int i2, int latencyType = -1);
 
    // Destructor. Unlocks the resource and sets the timer.
    //
@@ -206,9 +246,10 @@ private: // Methods:
 private: // Data:
 
 #if !M_NO_VERBOSE_ERROR_INFORMATION
-   // Service name
+   // Service name, empty if the service is not reported.
+   // Fixed size buffer is used so no heap allocation is made per service call.
    //
-   MStdString m_name;
+   char m_name [ MAXIMUM_NAME_SIZE ];
 #endif
 
    // Flags for this service
@@ -218,6 +259,12 @@ private: // Data:
    // Whether after the failure the protocol should be set to be outside session
    //
    bool m_dropSessionAfterFailure;
+
+#if !M_NO_MCOM_LATENCY_HISTOGRAMS
+   // MProtocol::LatencyType of the service, or -1 if the latency is not accounted
+   //
+   int m_latencyType;
+#endif
 };
 
 #if !M_NO_MCOM_KEEP_SESSION_ALIVE
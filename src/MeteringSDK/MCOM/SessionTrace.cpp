@@ -0,0 +1,364 @@
+// File MCOM/SessionTrace.cpp
+
+#include "MCOMExtern.h"
+#include "SessionTrace.h"
+
+#if !M_NO_MCOM_SESSION_TRACE
+
+M_START_PROPERTIES(SessionTrace)
+   M_CLASS_PROPERTY_BOOL(SessionTrace, Enabled)
+M_START_METHODS(SessionTrace)
+   M_CLASS_SERVICE(SessionTrace, Clear,           ST_S)
+   M_CLASS_SERVICE(SessionTrace, GetChromeTrace,  ST_MStdString_S)
+#if !M_NO_FILESYSTEM
+   M_CLASS_SERVICE(SessionTrace, SaveChromeTrace, ST_S_constMStdStringA)
+#endif
+M_END_CLASS(SessionTrace, Object)
+
+   const unsigned EVENT_FLAG_FAILED  = 1;
+   const unsigned EVENT_FLAG_INSTANT = 2;
+
+   struct MSessionTraceEvent
+   {
+      Muint64 m_start;     // microseconds
+      Muint32 m_duration;  // microseconds, zero for instant events
+      Muint32 m_flags;     // EVENT_FLAG_ masks
+      MConstChars m_category;
+      char m_name [ MSessionTrace::EVENT_NAME_SIZE ];
+   };
+
+   // Ring of events of a single thread.
+   // Only the owning thread writes the events, so recording needs no lock.
+   // When the thread ends, its buffer is kept until its events are dumped or cleared,
+   // and then it goes to the list of free buffers to be taken by a new thread.
+   //
+   struct MSessionTraceBuffer
+   {
+      MSessionTraceEvent m_events [ MSessionTrace::EVENTS_PER_THREAD ];
+      volatile Muint32 m_written;  // total number of events written by the thread
+      volatile Muint32 m_first;    // events before this one are cleared
+      unsigned m_threadNumber;     // sequential number, used as thread identifier in the trace
+      bool m_isFinished;           // the thread has ended, guarded by the lock of buffers
+      MSessionTraceBuffer* m_next; // next buffer in the list of all buffers, or in the list of free buffers
+   };
+
+   static MSessionTraceBuffer* s_buffers = NULL;     // buffers of the threads, the latest thread first
+   static MSessionTraceBuffer* s_freeBuffers = NULL; // buffers of the ended threads, ready for the new threads
+   static unsigned s_numberOfBuffers = 0;            // buffers allocated, never more than MAXIMUM_NUMBER_OF_BUFFERS
+   static unsigned s_numberOfThreads = 0;
+
+#if !M_NO_MULTITHREADING
+   static MCriticalSection s_buffersLock; // guards the lists of buffers, but not the recording
+   static M_THREAD_LOCAL_POINTER(MSessionTraceBuffer) s_threadBuffer;
+#else
+   static MSessionTraceBuffer* s_threadBuffer = NULL;
+#endif
+
+#if M_NO_MULTITHREADING
+   #define M__SESSION_TRACE_WATCHES_THREAD_END 0
+#elif (M_OS & M_OS_WINDOWS) != 0
+   #define M__SESSION_TRACE_WATCHES_THREAD_END ((M_OS & M_OS_WIN32_CE) == 0) // fiber local storage calls back at thread end
+#else
+   #define M__SESSION_TRACE_WATCHES_THREAD_END ((M_OS & M_OS_POSIX) != 0) // destructor of the thread specific key
+#endif
+
+#if M__SESSION_TRACE_WATCHES_THREAD_END
+
+   // Called by the ending thread that recorded into the buffer given
+   //
+   static void DoOnThreadEnd(void* buffer)
+   {
+      if ( buffer == NULL )
+         return;
+      #if !M_NO_MULTITHREADING
+         MCriticalSection::Locker lock(s_buffersLock);
+      #endif
+      static_cast<MSessionTraceBuffer*>(buffer)->m_isFinished = true;
+      s_threadBuffer = NULL; // events recorded by the thread after this point take another buffer
+   }
+
+#endif
+
+#if M__SESSION_TRACE_WATCHES_THREAD_END && (M_OS & M_OS_WINDOWS) != 0
+
+   static DWORD s_threadEndIndex = FLS_OUT_OF_INDEXES;
+
+   static void WINAPI DoOnThreadEndCallback(void* buffer)
+   {
+      DoOnThreadEnd(buffer);
+   }
+
+   // Have DoOnThreadEnd called with the buffer given when the current thread ends, shall be called within the lock of buffers
+   //
+   static void DoWatchThreadEnd(MSessionTraceBuffer* buffer)
+   {
+      if ( s_threadEndIndex == FLS_OUT_OF_INDEXES )
+         s_threadEndIndex = ::FlsAlloc(DoOnThreadEndCallback);
+      if ( s_threadEndIndex != FLS_OUT_OF_INDEXES )
+         ::FlsSetValue(s_threadEndIndex, buffer);
+   }
+
+#elif M__SESSION_TRACE_WATCHES_THREAD_END
+
+   static pthread_key_t s_threadEndKey;
+   static bool s_isThreadEndKeyCreated = false;
+
+   // Have DoOnThreadEnd called with the buffer given when the current thread ends, shall be called within the lock of buffers
+   //
+   static void DoWatchThreadEnd(MSessionTraceBuffer* buffer)
+   {
+      if ( !s_isThreadEndKeyCreated )
+         s_isThreadEndKeyCreated = pthread_key_create(&s_threadEndKey, DoOnThreadEnd) == 0;
+      if ( s_isThreadEndKeyCreated )
+         pthread_setspecific(s_threadEndKey, buffer);
+   }
+
+#else
+
+   // The end of the thread is not watched, and the buffers of the ended threads are not reused
+   //
+   static void DoWatchThreadEnd(MSessionTraceBuffer*)
+   {
+   }
+
+#endif
+
+   // Take a buffer for the current thread, shall be called within the lock of buffers.
+   // Return NULL if there is no memory, or all the buffers allowed are taken by the threads that still run.
+   //
+   static MSessionTraceBuffer* DoTakeBuffer()
+   {
+      MSessionTraceBuffer* buffer = s_freeBuffers;
+      if ( buffer != NULL )
+         s_freeBuffers = buffer->m_next;
+      else if ( s_numberOfBuffers < MSessionTrace::MAXIMUM_NUMBER_OF_BUFFERS )
+      {
+         buffer = M_NEW MSessionTraceBuffer;
+         ++s_numberOfBuffers;
+      }
+      else // take the buffer of the ended thread with the oldest events, even though they were not dumped
+      {
+         MSessionTraceBuffer** oldest = NULL;
+         for ( MSessionTraceBuffer** it = &s_buffers; *it != NULL; it = &(*it)->m_next )
+            if ( (*it)->m_isFinished )
+               oldest = it;
+         if ( oldest == NULL )
+            return NULL;
+         buffer = *oldest;
+         *oldest = buffer->m_next;
+      }
+      buffer->m_written = 0;
+      buffer->m_first = 0;
+      buffer->m_isFinished = false;
+      buffer->m_threadNumber = ++s_numberOfThreads;
+      buffer->m_next = s_buffers;
+      s_buffers = buffer;
+      DoWatchThreadEnd(buffer);
+      return buffer;
+   }
+
+   // Move the buffer of the ended thread to the list of free buffers, shall be called within the lock of buffers
+   //
+   static void DoFreeBuffer(MSessionTraceBuffer** it)
+   {
+      MSessionTraceBuffer* buffer = *it;
+      M_ASSERT(buffer->m_isFinished);
+      *it = buffer->m_next;
+      buffer->m_next = s_freeBuffers;
+      s_freeBuffers = buffer;
+   }
+
+   // Read the number of written events with a full barrier,
+   // so the events counted are seen complete, and the copies of events done before are not reordered after it
+   //
+   inline Muint32 DoLoadWritten(const MSessionTraceBuffer* buffer)
+   {
+      volatile int* written = reinterpret_cast<volatile int*>(const_cast<volatile Muint32*>(&buffer->m_written));
+      return static_cast<Muint32>(MInterlocked::CompareAndExchange(written, 0, 0));
+   }
+
+   static void DoAppendJsonString(MStdString& result, MConstChars str)
+   {
+      result += '\"';
+      for ( ; *str != '\0'; ++str )
+      {
+         const char c = *str;
+         if ( c == '\"' || c == '\\' )
+         {
+            result += '\\';
+            result += c;
+         }
+         else if ( static_cast<Muint8>(c) < 0x20 )
+            result += MGetStdString("\\u%04X", unsigned(static_cast<Muint8>(c)));
+         else
+            result += c;
+      }
+      result += '\"';
+   }
+
+volatile bool MSessionTrace::s_enabled = false;
+
+void MSessionTrace::SetEnabled(bool enabled)
+{
+   s_enabled = enabled;
+}
+
+void MSessionTrace::Clear()
+{
+   #if !M_NO_MULTITHREADING
+      MCriticalSection::Locker lock(s_buffersLock);
+   #endif
+   MSessionTraceBuffer** it = &s_buffers;
+   while ( *it != NULL )
+   {
+      if ( (*it)->m_isFinished )
+         DoFreeBuffer(it);
+      else
+      {
+         (*it)->m_first = (*it)->m_written;
+         it = &(*it)->m_next;
+      }
+   }
+}
+
+MStdString MSessionTrace::GetChromeTrace()
+{
+   MStdString result("{\"traceEvents\":[");
+   bool isFirst = true;
+   {
+      #if !M_NO_MULTITHREADING
+         MCriticalSection::Locker lock(s_buffersLock);
+      #endif
+      MSessionTraceBuffer** it = &s_buffers;
+      while ( *it != NULL )
+      {
+         const MSessionTraceBuffer* buffer = *it;
+         const Muint32 written = DoLoadWritten(buffer);
+         Muint32 first = buffer->m_first;
+         if ( written - first >= EVENTS_PER_THREAD ) // the oldest events were overwritten, and the oldest slot can be written by the owner right now
+            first = written - EVENTS_PER_THREAD + 1;
+         const MStdString thread = MToStdString(buffer->m_threadNumber);
+         if ( !isFirst )
+            result += ',';
+         isFirst = false;
+         result += "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+         result += thread;
+         result += ",\"args\":{\"name\":\"Thread ";
+         result += thread;
+         result += "\"}}";
+         for ( Muint32 i = first; i != written; ++i )
+         {
+            const MSessionTraceEvent event = buffer->m_events[i % EVENTS_PER_THREAD];
+            if ( DoLoadWritten(buffer) - i >= EVENTS_PER_THREAD ) // the owner started to overwrite the event while it was copied
+               continue;
+            result += ",\n{\"name\":";
+            DoAppendJsonString(result, event.m_name);
+            result += ",\"cat\":";
+            DoAppendJsonString(result, event.m_category);
+            if ( (event.m_flags & EVENT_FLAG_INSTANT) != 0 )
+               result += ",\"ph\":\"i\",\"s\":\"t\",\"ts\":";
+            else
+               result += ",\"ph\":\"X\",\"ts\":";
+            result += MToStdString(event.m_start);
+            if ( (event.m_flags & EVENT_FLAG_INSTANT) == 0 )
+            {
+               result += ",\"dur\":";
+               result += MToStdString(event.m_duration);
+            }
+            result += ",\"pid\":1,\"tid\":";
+            result += thread;
+            if ( (event.m_flags & EVENT_FLAG_FAILED) != 0 )
+               result += ",\"args\":{\"failed\":true}";
+            result += '}';
+         }
+         if ( buffer->m_isFinished ) // the events of the ended thread are taken, its buffer can serve another thread
+            DoFreeBuffer(it);
+         else
+            it = &(*it)->m_next;
+      }
+   }
+   result += "\n],\"displayTimeUnit\":\"ms\"}\n";
+   return result;
+}
+
+#if !M_NO_FILESYSTEM
+void MSessionTrace::SaveChromeTrace(const MStdString& fileName)
+{
+   const MStdString trace = GetChromeTrace();
+   MStreamFile file(fileName, MStreamFile::FlagWriteOnly | MStreamFile::FlagCreate | MStreamFile::FlagTruncate, MStreamFile::SharingAllowNone);
+   file.WriteBytes(trace.data(), M_64_CAST(unsigned, trace.size()));
+   file.Close();
+}
+#endif
+
+Muint64 MSessionTrace::GetMicroseconds() M_NO_THROW
+{
+   #if (M_OS & M_OS_WINDOWS) != 0
+      static LARGE_INTEGER s_frequency = {0};
+      if ( s_frequency.QuadPart == 0 ) // benign race, all threads compute the same value
+         QueryPerformanceFrequency(&s_frequency);
+      LARGE_INTEGER counter;
+      QueryPerformanceCounter(&counter);
+      const Muint64 ticks = static_cast<Muint64>(counter.QuadPart);
+      const Muint64 frequency = static_cast<Muint64>(s_frequency.QuadPart);
+      return ticks / frequency * 1000000u + ticks % frequency * 1000000u / frequency;
+   #elif (M_OS & M_OS_CMX)
+      return MTimer::GetTickCount64() * 1000u;
+   #else
+      struct timespec tv;
+      clock_gettime(CLOCK_MONOTONIC, &tv);
+      return static_cast<Muint64>(tv.tv_sec) * 1000000u + static_cast<Muint64>(tv.tv_nsec) / 1000u;
+   #endif
+}
+
+void MSessionTrace::AddSpan(MConstChars category, MConstChars name, Muint64 start, bool failed) M_NO_THROW
+{
+   DoAddEvent(category, name, start, GetMicroseconds(), failed ? EVENT_FLAG_FAILED : 0u);
+}
+
+void MSessionTrace::AddInstant(MConstChars category, MConstChars name) M_NO_THROW
+{
+   if ( s_enabled )
+   {
+      const Muint64 now = GetMicroseconds();
+      DoAddEvent(category, name, now, now, EVENT_FLAG_INSTANT);
+   }
+}
+
+void MSessionTrace::DoAddEvent(MConstChars category, MConstChars name, Muint64 start, Muint64 end, unsigned flags) M_NO_THROW
+{
+   MSessionTraceBuffer* buffer = s_threadBuffer;
+   if ( buffer == NULL ) // first event of this thread
+   {
+      try
+      {
+         #if !M_NO_MULTITHREADING
+            MCriticalSection::Locker lock(s_buffersLock);
+         #endif
+         buffer = DoTakeBuffer();
+      }
+      catch ( ... )
+      {
+      }
+      if ( buffer == NULL )
+         return; // tracing is best effort, no memory or no free buffer means no event
+      s_threadBuffer = buffer;
+   }
+
+   const Muint32 written = buffer->m_written;
+   MSessionTraceEvent& event = buffer->m_events[written % EVENTS_PER_THREAD];
+   event.m_start = start;
+   const Muint64 duration = end - start;
+   event.m_duration = duration > 0xFFFFFFFFu ? 0xFFFFFFFFu : static_cast<Muint32>(duration);
+   event.m_flags = flags;
+   event.m_category = category;
+   if ( name == NULL )
+      name = "";
+   m_strncpy(event.m_name, name, EVENT_NAME_SIZE - 1);
+   event.m_name[EVENT_NAME_SIZE - 1] = '\0';
+   // Publish the event only after it is filled, the barrier keeps the stores to the event before the counter.
+   // Only this thread writes the counter, so the exchange always succeeds.
+   MInterlocked::CompareAndExchange(reinterpret_cast<volatile int*>(&buffer->m_written), static_cast<int>(written), static_cast<int>(written + 1));
+}
+
+#endif // !M_NO_MCOM_SESSION_TRACE
@@ -0,0 +1,171 @@
+#ifndef MCOM_SESSIONTRACE_H
+#define MCOM_SESSIONTRACE_H
+/// \addtogroup MCOM
+///@{
+/// \file MCOM/SessionTrace.h
+
+#include <MCOM/MCOMDefs.h>
+
+#if !M_NO_MCOM_SESSION_TRACE
+
+/// Timeline of protocol services, link layer packets and channel operations, exported in Chrome trace event format.
+///
+/// When tracing is enabled, the protocol queue commit, every protocol service, every link layer packet,
+/// channel connect, reads and writes record spans with their start time and duration in microseconds.
+/// Coalesced channel writes are recorded when the staged bytes are actually sent.
+/// Link layer retries are recorded as instant events. The trace shows where the time of a slow session went,
+/// and it can be loaded into chrome://tracing, Perfetto, or any other viewer of the trace event format.
+///
+/// Every thread records into its own ring buffer of \ref EVENTS_PER_THREAD events, without any locking,
+/// and when the ring is full, the oldest events of the thread are overwritten.
+/// The buffer of the ended thread is reused by a new thread once its events are taken by \ref GetChromeTrace
+/// or discarded by \ref Clear. At most \ref MAXIMUM_NUMBER_OF_BUFFERS buffers are allocated, and when all of them
+/// are taken, the buffer of the ended thread is reused even if its events were not taken,
+/// while the new threads record nothing if all the threads that own the buffers still run.
+/// When tracing is disabled, which is the default, the cost of every traced place is a check of a static flag.
+///
+/// The class has only static methods, no instances of MSessionTrace are possible.
+///
+class MCOM_CLASS MSessionTrace : public MObject
+{
+public: // Constants:
+
+   enum
+   {
+      EVENTS_PER_THREAD = 4096, ///< Number of the latest events kept for every thread.
+      EVENT_NAME_SIZE = 40,     ///< Size of the event name buffer, longer names are truncated.
+      MAXIMUM_NUMBER_OF_BUFFERS = 64 ///< Maximum number of event buffers, one per thread.
+   };
+
+public: // Services:
+
+   ///@{
+   /// Whether tracing is enabled, false by default.
+   ///
+   /// Spans that started before the tracing was enabled are not recorded.
+   ///
+   static bool GetEnabled()
+   {
+      return s_enabled;
+   }
+   static void SetEnabled(bool enabled);
+   ///@}
+
+   /// Discard all events recorded so far by all threads.
+   ///
+   /// The buffers of the ended threads become free for the new threads.
+   ///
+   static void Clear();
+
+   /// Events recorded so far by all threads as a JSON text in Chrome trace event format.
+   ///
+   /// The trace can be taken while the tracing goes on.
+   /// The events that the threads overwrite while the trace is taken are left out of it,
+   /// so every event in the trace is complete.
+   ///
+   static MStdString GetChromeTrace();
+
+#if !M_NO_FILESYSTEM
+   /// Save the events recorded so far by all threads into the file given, in Chrome trace event format.
+   ///
+   /// \pre The file shall be writable, or a file exception is thrown.
+   ///
+   static void SaveChromeTrace(const MStdString& fileName);
+#endif
+
+   /// Current time of the monotonic clock in microseconds since some unspecified moment.
+   ///
+   static Muint64 GetMicroseconds() M_NO_THROW;
+
+   /// Record a span of the given category and name, which started at the time given and ends now.
+   ///
+   /// \param category Category of the event, such as "service". It shall be a static string, as only the pointer is kept.
+   /// \param name Name of the event, which is copied, and truncated if it is longer than \ref EVENT_NAME_SIZE.
+   /// \param start Start time of the span as returned by \ref GetMicroseconds.
+   /// \param failed Whether the traced operation failed.
+   ///
+   static void AddSpan(MConstChars category, MConstChars name, Muint64 start, bool failed = false) M_NO_THROW;
+
+   /// Record an instant event of the given category and name, such as a retry.
+   ///
+   /// \param category Category of the event. It shall be a static string, as only the pointer is kept.
+   /// \param name Name of the event, which is copied, and truncated if it is longer than \ref EVENT_NAME_SIZE.
+   ///
+   static void AddInstant(MConstChars category, MConstChars name) M_NO_THROW;
+
+private: // Services:
+
+   // Record an event into the buffer of the current thread, allocating the buffer if this is the first event of the thread.
+   //
+   static void DoAddEvent(MConstChars category, MConstChars name, Muint64 start, Muint64 end, unsigned flags) M_NO_THROW;
+
+private: // Data:
+
+   // Whether tracing is enabled
+   //
+   static volatile bool s_enabled;
+
+   M_DECLARE_CLASS(SessionTrace)
+};
+
+/// Span of the session trace that starts at construction, and is recorded at destruction.
+///
+/// If the tracing is disabled at construction, nothing is recorded.
+/// The span is recorded as failed unless \ref SetSucceeded is called before its end,
+/// this way the spans that end by an exception are seen as failed.
+/// \code
+///     MSessionTraceSpan span("channel", "Connect");
+///     ... traced code ...
+///     span.SetSucceeded();
+/// \endcode
+///
+class MSessionTraceSpan
+{
+public:
+
+   /// Constructor that starts the span with the given category and name, both static strings.
+   ///
+   MSessionTraceSpan(MConstChars category, MConstChars name)
+   :
+      m_category(category),
+      m_name(name),
+      m_start(MSessionTrace::GetEnabled() ? MSessionTrace::GetMicroseconds() : 0),
+      m_failed(true) // at start assume the operation failed (this will be overwritten later)
+   {
+   }
+
+   /// Destructor that records the span, if the tracing was enabled at construction.
+   ///
+   ~MSessionTraceSpan()
+   {
+      if ( m_start != 0 )
+         MSessionTrace::AddSpan(m_category, m_name, m_start, m_failed);
+   }
+
+   /// Tell the traced operation succeeded, called at the end of the operation.
+   ///
+   void SetSucceeded()
+   {
+      m_failed = false;
+   }
+
+private: // Data:
+
+   // Category and name of the span, static strings
+   //
+   MConstChars m_category;
+   MConstChars m_name;
+
+   // Start time of the span in microseconds, or zero if the tracing was disabled at construction
+   //
+   Muint64 m_start;
+
+   // Whether the traced operation failed
+   //
+   bool m_failed;
+};
+
+#endif // !M_NO_MCOM_SESSION_TRACE
+
+///@}
+#endif
@@ -26,6 +26,7 @@
 #include <MCORE/MSerialPort.h>
 #include <MCORE/MDynamicLibrary.h>
 #include <MCORE/MMD5Checksum.h>
+#include <MCORE/MLzCodec.h>
 
 #include <MCORE/MStreamSocket.h>
 #include <MCORE/MStreamSocketUdp.h>
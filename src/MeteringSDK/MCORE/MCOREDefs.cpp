@@ -23,6 +23,7 @@ using namespace std;
    #endif
    M_LINK_THE_CLASS_IN(MErrorEnum)
    M_LINK_THE_CLASS_IN(MMD5Checksum)
+   M_LINK_THE_CLASS_IN(MLzCodec)
    M_LINK_THE_CLASS_IN(MGuid)
    M_LINK_THE_CLASS_IN(MMath)
 
@@ -744,6 +744,22 @@
 #endif
 ///@}
 
+///@{
+/// Tells whether the compiler lacks rvalue references of C++11, which are used for move constructors and move assignments.
+///
+/// If this is zero, the classes that hold big buffers, such as MVariant, get move semantics,
+/// and their buffers are handed from temporaries without copying or reference counting.
+/// If this value is not defined, it is determined from the version of the compiler.
+///
+#ifndef M_NO_RVALUE_REFERENCES
+   #if  (__cplusplus > 199711) || (defined(_MSC_VER) && _MSC_VER >= 1600)   // if this is C++11 or later or this is Visual C++ 2010 or later
+      #define M_NO_RVALUE_REFERENCES 0
+   #else
+      #define M_NO_RVALUE_REFERENCES 1
+   #endif
+#endif
+///@}
+
 ///@{
 /// Tells whether the processor can handle unaligned data.
 ///
@@ -2176,6 +2192,7 @@ class M_CLASS MObject;
 #if !M_NO_REFLECTION
    class M_CLASS MPropertyDefinition;
    class M_CLASS MServiceDefinition;
+   struct MClassIndex;
 #endif
 
 #if !M_NO_VARIANT
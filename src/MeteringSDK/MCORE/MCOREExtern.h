@@ -293,6 +293,7 @@
 #include <deque>
 #include <typeinfo>
 #include <limits>
+#include <utility>
 
 #include <iostream>
 #if !(M_OS & M_OS_WIN32_CE) && !(M_OS & M_OS_CMX)
@@ -6,6 +6,7 @@
 #include "MException.h"
 #include "MAlgorithm.h"
 #include "MCriticalSection.h"
+#include "MInterlocked.h"
 
 bool MClass::IsKindOf(const MClass* cls) const
 {
@@ -49,6 +50,23 @@ M_NORETURN_FUNC void MClass::DoThrowCannotConvert(const MObject* from, const MCl
    static const MClass* s_applicationClasses [ MAXIMUM_NUMBER_OF_CLASSES ];
    static const MClass** s_applicationClassesLast = s_applicationClasses;
 
+   // Hash table of the registered classes by name, with linear probing.
+   // It is filled at registration, so the lookup of a class by name needs no lock.
+   //
+   const unsigned CLASS_TABLE_SIZE = MAXIMUM_NUMBER_OF_CLASSES * 2; // power of two, at most half full
+   static const MClass* s_classTable [ CLASS_TABLE_SIZE ];
+
+   inline unsigned DoHashClassName(const char* name, size_t size)
+   {
+      unsigned hash = 2166136261u; // FNV-1a
+      for ( ; size > 0; --size, ++name )
+      {
+         hash ^= static_cast<unsigned char>(*name);
+         hash *= 16777619u;
+      }
+      return hash;
+   }
+
 #if !M_NO_FULL_REFLECTION // if we offer extensive information on service parameters
 
    static const MVariant::Type s_type_null[1] = {(MVariant::Type)0xFF};
@@ -128,6 +146,18 @@ MClass::RegisterClassHelper::RegisterClassHelper(const MClass* self)
    M_ASSERT(s_applicationClassesLast >= s_applicationClasses);
    M_ASSERT(s_applicationClassesLast < (s_applicationClasses + MAXIMUM_NUMBER_OF_CLASSES));
    *s_applicationClassesLast++ = self;
+
+   for ( unsigned i = DoHashClassName(self->m_name, strlen(self->m_name)); ; ++i )
+   {
+      const MClass*& slot = s_classTable[i & (CLASS_TABLE_SIZE - 1)];
+      if ( slot == NULL )
+      {
+         slot = self;
+         break;
+      }
+      if ( m_strcmp(slot->m_name, self->m_name) == 0 )
+         break; // when several classes have the same name, the one registered first is found
+   }
 }
 
 const MClass* MClass::GetParentClass(const MStdString& className) const
@@ -140,13 +170,12 @@ const MClass* MClass::GetParentClass(const MStdString& className) const
 
 const MClass* MClass::GetClass(const MStdString& name)
 {
-   for ( const MClass** it = s_applicationClasses; it != s_applicationClassesLast; ++it )
+   for ( unsigned i = DoHashClassName(name.data(), name.size()); ; ++i )
    {
-      const MClass* cls = *it;
-      if ( name == cls->m_name )
+      const MClass* cls = s_classTable[i & (CLASS_TABLE_SIZE - 1)];
+      if ( cls == NULL || name == cls->m_name )
          return cls;
    }
-   return NULL;
 }
 
 const MClass* MClass::GetExistingClass(const MStdString& className)
@@ -174,172 +203,319 @@ const MServiceDefinition* MClass::GetServiceDefinition(const MStdString& name, i
    return def;
 }
 
-const MServiceDefinition* MClass::GetServiceDefinitionOrNull(const MStdString& name, int expectedNumberOfParameters) const
-{
-   // The below algorithm is optimized for fast searches of a string in array
-   // It tries to compare integers, and also does a search for the first couple of bytes horizontally
-   // The algorithm uses the restriction that all our services are at least 3 characters long
-
-   M_COMPILED_ASSERT(sizeof(unsigned) <= 4); // otherwise would not work
-
-   int dataSizeMinusUnsigned = (int)(name.size() + 1) * sizeof(char) - (int)sizeof(unsigned); // +1 to watch for the trailing zero (otherwise Read and ReadPartial would match)
-
-   const char* data = (const char*)name.data();
-   unsigned nameFirstU;
-#if M_LITTLE_ENDIAN
-   nameFirstU  = (unsigned)*data++;         // Data is not aligned for the majority of basic_string implementations...
-   nameFirstU |= (unsigned)*data++ << 8;    // This way we can not use casting, should assemble the value with shifts
-   nameFirstU |= (unsigned)*data++ << 16;   // to avoid alignment problem.
-   nameFirstU |= (unsigned)*data++ << 24;   // The alternative: const unsigned nameFirstU = *(const unsigned*)data;
-#else
-   nameFirstU  = (unsigned)*data++ << 24;   // Data is not aligned for the majority of basic_string implementations...
-   nameFirstU |= (unsigned)*data++ << 16;   // This way we can not use casting, should assemble the value with shifts
-   nameFirstU |= (unsigned)*data++ << 8;    // to avoid alignment problem.
-   nameFirstU |= (unsigned)*data++;         // The alternative: const unsigned nameFirstU = *(const unsigned*)data;
-#endif
-
-   for ( const MClass* cl = this; cl != NULL; cl = cl->m_parent )
+   // Name of the property in MCOM syntax, which is uppercased with words separated by underscores,
+   // such as READ_TIMEOUT for ReadTimeout. Empty string is returned if the name has no such syntax,
+   // which is the case when its second character is not a lowercase letter.
+   //
+   static MStdString DoGetPropertyNameInMcomSyntax(MConstChars name)
    {
-      if ( cl->m_services == NULL )
-         continue;
-      for ( const MServiceDefinition* def = cl->m_services; ; ++def )
+      MStdString result;
+      if ( name[0] != '\0' && m_toupper(name[1]) != name[1] )
       {
-         const unsigned* candidate = (const unsigned*)def->m_name;
-         M_ASSERT((reinterpret_cast<size_t>(candidate) & 0x3) == 0); // the algorithm assumes the data are aligned by doubleword
-         const unsigned candidateFirstU = *candidate;
-         if ( candidateFirstU == 0u ) // end of list
-            break;
-         if ( candidateFirstU == nameFirstU ) // matched first couple characters
-         {                                    // try the rest
-            if ( dataSizeMinusUnsigned <= 0 ) // service 3 or 4 characters long
+         result += name[0];
+         result += static_cast<char>(m_toupper(name[1]));
+         for ( MConstChars c = name + 2; *c != '\0'; ++c )
+         {
+            if ( m_isupper(*c) )
             {
-               if ( def->m_overloadedNumberOfParameters < 0 ||                           // if this is not an overloaded procedure
-                    def->m_overloadedNumberOfParameters == expectedNumberOfParameters || // or if the number of parameters is the same
-                    expectedNumberOfParameters < 0 )                                     // or if we do not care about number of parameters
-               {
-                  return def;
-               }
+               result += '_';
+               result += *c;
             }
             else
-            {
-               ++candidate; // as we looked at first couple of bytes already...
-               if ( memcmp(data, candidate, dataSizeMinusUnsigned) == 0 &&
-                    (def->m_overloadedNumberOfParameters < 0 ||                           // if this is not an overloaded procedure
-                     def->m_overloadedNumberOfParameters == expectedNumberOfParameters || // or if the number of parameters is the same
-                     expectedNumberOfParameters < 0) )                                    // or if we do not care about number of parameters
-               {
-                  return def;
-               }
-            }
+               result += static_cast<char>(m_toupper(*c));
          }
       }
+      return result;
    }
-   return NULL; // we are never here...
-}
 
-
-   // Tell if the given property name matches the candidate given.
-   // This particular implementation does comparison with respect to MCOM syntax of
-   // properties, which are all uppercased with word separation done with underscores.
+   // Whether the exact property name match is preferred over the match of the property name in MCOM syntax,
+   // which is the case when there is a lowercase letter among the first four characters of the name given.
    //
-   // PRECONDITION: None
+   inline bool DoIsExactPropertyMatchPreferred(const MStdString& name)
+   {
+      if ( name.size() <= 2 )
+         return false;
+      const char* chars = name.c_str();
+      return ((chars[0] | chars[1] | chars[2] | chars[3]) & 0x20) != 0; // chars[3] is a trailing zero for names of three characters
+   }
+
+   // Lookup index of properties and services of a class together with its parents.
    //
-   // POSTCONDITION: true is returned if two strings are the same names of the property.
+   // The index is built at the first lookup of a class property or service by name.
+   // Both arrays are sorted by name, and each has a hash table of the first entries of every name,
+   // so the lookup is a single hash probe instead of a walk through the whole class hierarchy.
    //
-   inline bool DoComparePropertyNames(MConstChars name, MConstChars candidate)
+   struct MClassIndex
    {
-      M_ASSERT(name != NULL && *name != '\0' && candidate != NULL);
+      struct PropertyEntry
+      {
+         MStdString m_name;                  // exact name of a property, or the name in MCOM syntax
+         const MPropertyDefinition* m_exact; // first property in the class hierarchy with exactly this name, or NULL
+         const MPropertyDefinition* m_any;   // first property in the class hierarchy that has this name in either syntax
+      };
 
-      // first proceed with the exact match until it works
-      MConstChars c = name;
-      for ( ; ;  ++c, ++candidate )
+      struct ServiceEntry
       {
-         if ( *c == '\0' )
-            return *candidate == '\0'; // possible exact match (if candidate also ends)
-         if ( *c != *candidate )
-            break; // exact mismatch failed
-      }
+         MStdString m_name;                  // name of the service
+         const MServiceDefinition* m_def;    // service, overloaded services have several entries in the order of lookup
+      };
 
-      // Now see whether the mismatch is in the second char, and it is only in the case of the letter.
-      // If it is, we need to proceed with MCOM syntax for properties
-      //
-      if ( c - 1 != name || m_toupper(*c) != *candidate )
-         return false; // no match
+      std::vector<PropertyEntry> m_properties;
+      std::vector<ServiceEntry> m_services;
 
-      // Otherwise we have MCOM property name (which is case sensitive, but the matching is funny)
+      // Hash tables with linear probing, a slot has the position of the entry plus one, or zero if the slot is free
       //
-      ++c;
-      ++candidate;
-      for ( ; *c != '\0'; ++c, ++candidate )
+      std::vector<unsigned> m_propertyTable;
+      std::vector<unsigned> m_serviceTable;
+   };
+
+   struct MClassIndexPropertyCandidate
+   {
+      MStdString m_name;
+      const MPropertyDefinition* m_def;
+      unsigned m_order;
+      bool m_isExact;
+
+      bool operator<(const MClassIndexPropertyCandidate& other) const
       {
-         if ( m_isupper(*c) )
-         {
-            if ( *candidate++ != '_' || *candidate != *c ) // cures the case when *candidate == '\0'
-               return false;
-         }
-         else if ( m_toupper(*c) != *candidate )
-            return false;
+         const int result = m_name.compare(other.m_name);
+         return result < 0 || (result == 0 && m_order < other.m_order);
       }
-      return *candidate == '\0';
+   };
+
+   inline unsigned DoHashMemberName(const MStdString& name)
+   {
+      return MSharedString::static_hash(name.data(), static_cast<unsigned>(name.size()));
    }
 
-const MPropertyDefinition* MClass::GetPropertyDefinitionOrNull(const MStdString& name) const
-{
-   // The below algorithm is optimized for fast searches of a string in array
-   // It tries to compare integers, and also does a search for the first couple of bytes horizontally
-   // The algorithm uses the restriction that all our services are at least 3 characters long
-
-   M_COMPILED_ASSERT(sizeof(unsigned) == 4); // otherwise would not work, needs change
-
-   const char* chars = name.c_str();
-   unsigned dataSize = unsigned(name.size()); // valid property names are not 64-bit length
-   if ( dataSize > 2 )
-   {
-      int dataSizeMinusUnsigned = (int)(dataSize + 1) * sizeof(char) - (int)sizeof(unsigned);   // +1 to watch for trailing zero (otherwise a User and UserId would match)
- 
-      const char* data = chars;
-      unsigned nameFirstU = (unsigned)*data++; // Data is not aligned for the majority of basic_string implementations...
-      nameFirstU |= (unsigned)*data++ << 8;    // This way we cannot use casting, should assemble the value with shifts
-      nameFirstU |= (unsigned)*data++ << 16;   // to avoid alignment problem.
-      nameFirstU |= (unsigned)*data++ << 24;   // The alternative: const unsigned nameFirstU = *(const unsigned*)data;
-
-      if ( (nameFirstU & 0x20202020u) != 0 )   // This could be machine-dependent in a rare case if this is not ASCII...
-      {                                        // This checks if there is any lowercase letter among first four characters.
-                                               // In this case we can apply a much faster search algorithm of exact match search.
-                                               // The speed improvement is four times, worth doing.
-         for ( const MClass* cl = this; cl != NULL; cl = cl->m_parent )
+   template
+      <class Entry>
+   static void DoBuildHashTable(const std::vector<Entry>& entries, std::vector<unsigned>& table)
+   {
+      unsigned size = 4;
+      while ( size < entries.size() * 2 ) // keep the table at most half full
+         size <<= 1;
+      table.assign(size, 0u);
+      const unsigned mask = size - 1;
+      const unsigned count = static_cast<unsigned>(entries.size());
+      for ( unsigned i = 0; i < count; ++i )
+      {
+         if ( i > 0 && entries[i - 1].m_name == entries[i].m_name )
+            continue; // only the first entry of every name is in the table
+         unsigned h = DoHashMemberName(entries[i].m_name) & mask;
+         while ( table[h] != 0 )
+            h = (h + 1) & mask;
+         table[h] = i + 1;
+      }
+   }
+
+   // Find the first entry with the given name, and return its position, or -1 if there is no such entry
+   //
+   template
+      <class Entry>
+   static int DoFindInHashTable(const std::vector<Entry>& entries, const std::vector<unsigned>& table, const MStdString& name)
+   {
+      const unsigned mask = static_cast<unsigned>(table.size()) - 1;
+      for ( unsigned h = DoHashMemberName(name) & mask; ; h = (h + 1) & mask )
+      {
+         const unsigned slot = table[h];
+         if ( slot == 0 )
+            return -1;
+         if ( entries[slot - 1].m_name == name )
+            return static_cast<int>(slot - 1);
+      }
+   }
+
+   inline bool DoCompareServiceEntries(const MClassIndex::ServiceEntry& left, const MClassIndex::ServiceEntry& right)
+   {
+      return left.m_name < right.m_name;
+   }
+
+   static MClassIndex* DoBuildClassIndex(const MClass* cls)
+   {
+      MClassIndex* index = M_NEW MClassIndex;
+
+      std::vector<MClassIndexPropertyCandidate> candidates;
+      unsigned order = 0;
+      for ( const MClass* cl = cls; cl != NULL; cl = cl->m_parent )
+      {
+         if ( cl->m_properties == NULL )
+            continue;
+         for ( const MPropertyDefinition* def = cl->m_properties; def->m_name[0] != '\0'; ++def )
          {
-            if ( cl->m_properties == NULL )
-               continue;
-            for ( const MPropertyDefinition* def = cl->m_properties; ; ++def )
+            MClassIndexPropertyCandidate candidate;
+            candidate.m_name = def->m_name;
+            candidate.m_def = def;
+            candidate.m_order = order++;
+            candidate.m_isExact = true;
+            candidates.push_back(candidate);
+            candidate.m_name = DoGetPropertyNameInMcomSyntax(def->m_name);
+            if ( !candidate.m_name.empty() )
             {
-               const unsigned* candidate = (const unsigned*)def->m_name;
-               M_ASSERT((reinterpret_cast<size_t>(candidate) & 0x3) == 0); // the algorithm assumes the data are aligned by doubleword
-               const unsigned candidateFirstU = *candidate;
-               if ( candidateFirstU == 0u ) // end of list
-                  break;
-               if ( candidateFirstU == nameFirstU ) // matched first couple characters
-               {                                    // try the rest
-                  if ( dataSizeMinusUnsigned <= 0 ) // service 3 or 4 characters long
-                     return def;
-                  ++candidate; // as we looked at first couple of bytes already...
-                  if ( memcmp(data, candidate, dataSizeMinusUnsigned) == 0 )
-                     return def;
-               }
+               candidate.m_isExact = false;
+               candidates.push_back(candidate);
             }
          }
       }
+      std::sort(candidates.begin(), candidates.end());
+      index->m_properties.reserve(candidates.size());
+      for ( std::vector<MClassIndexPropertyCandidate>::const_iterator it = candidates.begin(); it != candidates.end(); ++it )
+      {
+         if ( index->m_properties.empty() || index->m_properties.back().m_name != it->m_name )
+         {
+            MClassIndex::PropertyEntry entry;
+            entry.m_name = it->m_name;
+            entry.m_exact = it->m_isExact ? it->m_def : NULL;
+            entry.m_any = it->m_def; // candidates of the same name are sorted in the order of lookup
+            index->m_properties.push_back(entry);
+         }
+         else if ( index->m_properties.back().m_exact == NULL && it->m_isExact )
+            index->m_properties.back().m_exact = it->m_def;
+      }
+
+      for ( const MClass* cl = cls; cl != NULL; cl = cl->m_parent )
+      {
+         if ( cl->m_services == NULL )
+            continue;
+         for ( const MServiceDefinition* def = cl->m_services; def->m_name[0] != '\0'; ++def )
+         {
+            MClassIndex::ServiceEntry entry;
+            entry.m_name = def->m_name;
+            entry.m_def = def;
+            index->m_services.push_back(entry);
+         }
+      }
+      std::stable_sort(index->m_services.begin(), index->m_services.end(), DoCompareServiceEntries); // keep the order of lookup for overloaded services
+
+      DoBuildHashTable(index->m_properties, index->m_propertyTable);
+      DoBuildHashTable(index->m_services, index->m_serviceTable);
+      return index;
    }
 
-   // otherwise compare by the algorithm, which assumes that "SomeProperty" is the same as "SAME_PROPERTY"
+#if !M_NO_MULTITHREADING
+   static MCriticalSection& DoGetClassIndexLock()
+   {
+      static MCriticalSection s_lock; // local static, as the index can be built during the initialization of statics
+      return s_lock;
+   }
+#endif
+
+   // Hash table of the built class indexes by class, with linear probing.
+   // Slots are only added under the lock, and the index of the slot is set before its class,
+   // so the lookup of an already built index needs no lock.
    //
-   for ( const MClass* cl = this; cl != NULL; cl = cl->m_parent )
-      for ( const MPropertyDefinition* def = cl->m_properties; def->m_name[0] != '\0'; ++def )
-         if ( DoComparePropertyNames(def->m_name, chars) )
-            return def;
+   struct MClassIndexSlot
+   {
+      const MClass* volatile m_class;
+      const MClassIndex* volatile m_index;
+   };
+   static MClassIndexSlot s_classIndexes [ CLASS_TABLE_SIZE ];
+
+   // Reading the class with acquire semantics guarantees the index of the slot is seen complete
+   //
+   inline const MClass* DoLoadSlotClass(const MClassIndexSlot& slot)
+   {
+      return static_cast<const MClass*>(MInterlocked::LoadPointerAcquire(reinterpret_cast<void* const volatile*>(const_cast<MClass* const volatile*>(&slot.m_class))));
+   }
+
+   // Publish the class of the slot with a full barrier, after its index is set
+   //
+   inline void DoPublishSlotClass(MClassIndexSlot& slot, const MClass* cls)
+   {
+      MInterlocked::CompareAndExchangePointer(reinterpret_cast<void* volatile*>(const_cast<MClass* volatile*>(&slot.m_class)), NULL, const_cast<MClass*>(cls));
+   }
+
+   inline unsigned DoHashClassPointer(const MClass* cls)
+   {
+      return static_cast<unsigned>(reinterpret_cast<size_t>(cls) / sizeof(void*)) * 2654435761u;
+   }
+
+   // Deletes the indexes of all classes when the application exits.
+   // If a lookup happens later, such as from a destructor of a static object, the index is built again.
+   //
+   struct MClassIndexCleaner
+   {
+      ~MClassIndexCleaner()
+      {
+         for ( unsigned i = 0; i < CLASS_TABLE_SIZE; ++i )
+         {
+            MClassIndexSlot& slot = s_classIndexes[i];
+            const MClassIndex* index = slot.m_index;
+            slot.m_class = NULL;
+            slot.m_index = NULL;
+            delete index;
+         }
+      }
+   };
+
+const MClassIndex* MClass::DoGetIndex() const
+{
+   unsigned i = DoHashClassPointer(this);
+   for ( ; ; ++i )
+   {
+      const MClassIndexSlot& slot = s_classIndexes[i & (CLASS_TABLE_SIZE - 1)];
+      const MClass* cls = DoLoadSlotClass(slot);
+      if ( cls == this )
+         return slot.m_index;
+      if ( cls == NULL )
+         break; // index of this class is not built yet
+   }
+
+   #if !M_NO_MULTITHREADING
+      MCriticalSection::Locker lock(DoGetClassIndexLock());
+   #endif
+   static MClassIndexCleaner s_cleaner;
+   for ( ; ; ++i ) // continue from the free slot, other threads could have taken it while this one waited for the lock
+   {
+      MClassIndexSlot& slot = s_classIndexes[i & (CLASS_TABLE_SIZE - 1)];
+      const MClass* cls = slot.m_class;
+      if ( cls == this )
+         return slot.m_index; // built by the other thread
+      if ( cls == NULL )
+      {
+         const MClassIndex* index = DoBuildClassIndex(this);
+         slot.m_index = index;
+         DoPublishSlotClass(slot, this);
+         return index;
+      }
+   }
+}
+
+const MServiceDefinition* MClass::GetServiceDefinitionOrNull(const MStdString& name, int expectedNumberOfParameters) const
+{
+   const MClassIndex* index = DoGetIndex();
+   const std::vector<MClassIndex::ServiceEntry>& services = index->m_services;
+   int i = DoFindInHashTable(services, index->m_serviceTable, name);
+   if ( i < 0 )
+      return NULL;
+   for ( std::vector<MClassIndex::ServiceEntry>::const_iterator it = services.begin() + i; it != services.end() && it->m_name == name; ++it )
+   {
+      const MServiceDefinition* def = it->m_def;
+      if ( def->m_overloadedNumberOfParameters < 0 ||                           // if this is not an overloaded procedure
+           def->m_overloadedNumberOfParameters == expectedNumberOfParameters || // or if the number of parameters is the same
+           expectedNumberOfParameters < 0 )                                     // or if we do not care about number of parameters
+      {
+         return def;
+      }
+   }
    return NULL;
 }
 
+const MPropertyDefinition* MClass::GetPropertyDefinitionOrNull(const MStdString& name) const
+{
+   // Property "SomeProperty" can also be accessed as "SOME_PROPERTY", and the exact match is preferred
+   // when the name given has lowercase letters among the first four characters.
+   //
+   const MClassIndex* index = DoGetIndex();
+   int i = DoFindInHashTable(index->m_properties, index->m_propertyTable, name);
+   if ( i < 0 )
+      return NULL;
+   const MClassIndex::PropertyEntry& entry = index->m_properties[i];
+   if ( entry.m_exact != NULL && DoIsExactPropertyMatchPreferred(name) )
+      return entry.m_exact;
+   return entry.m_any;
+}
+
 MStdStringVector MClass::GetAllClassNames()
 {
    MStdStringVector result;
@@ -439,13 +615,17 @@ MVariant MClass::GetPersistentPropertyDefaultValue(const MStdString& name) const
 }
 
 MVariant MClass::GetProperty(const MStdString& name) const
+{
+   return GetPropertyByDefinition(GetPropertyDefinition(name));
+}
+
+MVariant MClass::GetPropertyByDefinition(const MPropertyDefinition* def) const
 {
    MVariant result;
-   const MPropertyDefinition* def = GetPropertyDefinition(name);
    M_ENSURED_ASSERT(def != 0);
    if ( def->m_getObjectMethod != 0 )
    {
-      MException::Throw(MException::ErrorSoftware, M_ERR_OBJECT_PROPERTY_S1_CANNOT_BE_GOT_FROM_A_CLASS_WITHOUT_OBJECT, "Object property '%s' cannot be got from a class, without object", name.c_str());
+      MException::Throw(MException::ErrorSoftware, M_ERR_OBJECT_PROPERTY_S1_CANNOT_BE_GOT_FROM_A_CLASS_WITHOUT_OBJECT, "Object property '%s' cannot be got from a class, without object", def->m_name);
       M_ENSURED_ASSERT(0);
    }
    if ( def->m_getClassMethod != 0 )
@@ -552,7 +732,11 @@ MVariant MClass::GetProperty(const MStdString& name) const
 
 void MClass::SetProperty(const MStdString& name, const MVariant& value) const
 {
-   const MPropertyDefinition* def = GetPropertyDefinition(name);
+   SetPropertyByDefinition(GetPropertyDefinition(name), value);
+}
+
+void MClass::SetPropertyByDefinition(const MPropertyDefinition* def, const MVariant& value) const
+{
    M_ENSURED_ASSERT(def != 0);
 
    if ( def->m_setClassMethod != 0 )
@@ -617,11 +801,11 @@ void MClass::SetProperty(const MStdString& name, const MVariant& value) const
    else
    {
       if ( def->m_getClassMethod != 0 )
-         MException::Throw(MException::ErrorSoftware, M_ERR_CANNOT_SET_READONLY_PROPERTY_S1, "Cannot set readonly property '%s'", name.c_str());
+         MException::Throw(MException::ErrorSoftware, M_ERR_CANNOT_SET_READONLY_PROPERTY_S1, "Cannot set readonly property '%s'", def->m_name);
       else if ( def->m_getObjectMethod != 0 )
-         MException::Throw(MException::ErrorSoftware, M_ERR_OBJECT_PROPERTY_S1_CANNOT_BE_SET_TO_A_CLASS_WITHOUT_OBJECT, "Object property '%s' cannot be set to a class, without object", name.c_str());
+         MException::Throw(MException::ErrorSoftware, M_ERR_OBJECT_PROPERTY_S1_CANNOT_BE_SET_TO_A_CLASS_WITHOUT_OBJECT, "Object property '%s' cannot be set to a class, without object", def->m_name);
       else
-         MException::Throw(MException::ErrorSoftware, M_ERR_ENUMERATION_S1_CANNOT_BE_ASSIGNED_TO, "Enumeration value '%s' cannot be assigned to", name.c_str());
+         MException::Throw(MException::ErrorSoftware, M_ERR_ENUMERATION_S1_CANNOT_BE_ASSIGNED_TO, "Enumeration value '%s' cannot be assigned to", def->m_name);
       M_ENSURED_ASSERT(0);
    }
 }
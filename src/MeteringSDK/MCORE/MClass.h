@@ -207,6 +207,7 @@ public:
    /// Get the constant definition of service (method) with the given name, or return NULL if such service does not exist.
    ///
    /// This is C++ only. Service, as used in the identifier, is another name for method.
+   /// Services of the class and its parents are looked up in the index of the class, built at the first lookup.
    ///
    /// \param name
    ///    Service name to get definition for. If service does not exist, NULL will be returned.
@@ -442,6 +443,11 @@ public:
 
    /// Get the constant definition of the property with the name specified, or NULL if such property does not exist.
    ///
+   /// Properties of the class and its parents are looked up in the index of the class, built at the first lookup.
+   /// The definition returned can be kept by the caller as a resolved handle of the property,
+   /// and given to \ref GetPropertyByDefinition, \ref SetPropertyByDefinition,
+   /// MObject::GetPropertyByDefinition or MObject::SetPropertyByDefinition, which do no lookup by name.
+   ///
    /// \param name
    ///    The name of the property.
    ///
@@ -506,6 +512,30 @@ public:
    ///
    void SetProperty(const MStdString& name, const MVariant& value) const;
 
+   /// Get the static class property value using the property definition resolved earlier.
+   ///
+   /// This is the same as \ref GetProperty, but without a lookup of the property by name.
+   ///
+   /// \param def
+   ///    Definition of the property of this class or its parent, as returned by \ref GetPropertyDefinition.
+   ///
+   /// \return
+   ///    Value of property is returned.
+   ///
+   MVariant GetPropertyByDefinition(const MPropertyDefinition* def) const;
+
+   /// Set the static class property value using the property definition resolved earlier.
+   ///
+   /// This is the same as \ref SetProperty, but without a lookup of the property by name.
+   ///
+   /// \param def
+   ///    Definition of the property of this class or its parent, as returned by \ref GetPropertyDefinition.
+   ///
+   /// \param value
+   ///    Value to assign to the property.
+   ///
+   void SetPropertyByDefinition(const MPropertyDefinition* def, const MVariant& value) const;
+
    /// Return the list of all publicly available classes.
    ///
    /// While this property is declared in MClass, it really belongs to global environment of the application.
@@ -581,6 +611,12 @@ public: ///  Semi-private services:
 
    static M_NORETURN_FUNC void DoThrowServiceDoesNotHaveNParameters(const MStdString& name, int parametersCount);
 
+#if !M_NO_REFLECTION
+   // Get the lookup index of the properties and services of this class and its parents, build it if this is the first call.
+   //
+   const MClassIndex* DoGetIndex() const;
+#endif
+
 public: // Attributes:
 
    /// Name of the class as string.
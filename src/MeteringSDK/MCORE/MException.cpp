@@ -64,6 +64,7 @@ MException::MException()
    m_kind(Error)
 #if !M_NO_VERBOSE_ERROR_INFORMATION
    , m_message()
+   , m_deferredFormat(NULL)
    , m_fileNameAndLineNumber()
    , m_stack()
 #endif
@@ -76,6 +77,7 @@ MException::MException(const MStdString& message, MErrorEnum::Type code, KindTyp
    m_code(code),
    m_kind(kind),
    m_message(message),
+   m_deferredFormat(NULL),
    m_fileNameAndLineNumber(),
    m_stack()
 {
@@ -88,10 +90,15 @@ MException::MException(const MException& ex)
    m_kind(ex.m_kind)
 #if !M_NO_VERBOSE_ERROR_INFORMATION
    , m_message(ex.m_message)
+   , m_deferredFormat(ex.m_deferredFormat)
    , m_fileNameAndLineNumber(ex.m_fileNameAndLineNumber)
    , m_stack(ex.m_stack)
 #endif
 {
+#if !M_NO_VERBOSE_ERROR_INFORMATION
+   if ( m_deferredFormat != NULL )
+      memcpy(m_deferredParameters, ex.m_deferredParameters, sizeof(m_deferredParameters));
+#endif
 }
 
 MException::~MException() M_NO_THROW
@@ -106,6 +113,9 @@ MException& MException::operator=(const MException& ex)
       m_kind = ex.m_kind;
 #if !M_NO_VERBOSE_ERROR_INFORMATION
       m_message = ex.m_message;
+      m_deferredFormat = ex.m_deferredFormat;
+      if ( m_deferredFormat != NULL )
+         memcpy(m_deferredParameters, ex.m_deferredParameters, sizeof(m_deferredParameters));
       m_fileNameAndLineNumber = ex.m_fileNameAndLineNumber;
       m_stack = ex.m_stack;
 #endif
@@ -125,12 +135,70 @@ void MException::InitAll(MException::KindType kind, MErrorEnum::Type code, const
    m_kind = kind;
    m_code = code;
    m_message = message;
+   m_deferredFormat = NULL;
    m_stack.clear();
 }
 
+   // Number of integer conversions in the printf format given, or -1 if the format has conversions of other types.
+   //
+   static int DoCountIntegerConversions(const char* format) M_NO_THROW
+   {
+      int count = 0;
+      for ( const char* p = format; *p != '\0'; ++p )
+      {
+         if ( *p != '%' )
+            continue;
+         ++p;
+         if ( *p == '%' )
+            continue;
+         while ( *p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' )
+            ++p;
+         while ( *p >= '0' && *p <= '9' )
+            ++p;
+         if ( *p == '.' )
+         {
+            ++p;
+            while ( *p >= '0' && *p <= '9' )
+               ++p;
+         }
+         switch ( *p )
+         {
+         case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+            ++count;
+            break;
+         default: // strings, floating point, length modifiers, star width, or bad format
+            return -1;
+         }
+      }
+      return count;
+   }
+
 void MException::InitVA(MException::KindType kind, MErrorEnum::Type code, MConstLocalChars str, va_list va) M_NO_THROW
 {
-   InitAll(kind, code, MGetStdStringVA(str, va));
+   const int count = DoCountIntegerConversions(reinterpret_cast<const char*>(str));
+   if ( count < 0 || count > DEFERRED_PARAMETERS_MAXIMUM )
+   {
+      InitAll(kind, code, MGetStdStringVA(str, va));
+      return;
+   }
+   m_kind = kind;
+   m_code = code;
+   m_message.clear();
+   m_stack.clear();
+   m_deferredFormat = str;
+   int i = 0;
+   for ( ; i < count; ++i )
+      m_deferredParameters[i] = va_arg(va, unsigned);
+   for ( ; i < DEFERRED_PARAMETERS_MAXIMUM; ++i )
+      m_deferredParameters[i] = 0;
+}
+
+void MException::DoFormatDeferredMessage() const M_NO_THROW
+{
+   M_ASSERT(m_deferredFormat != NULL && m_message.empty()); // all modifications of the message resolve it first
+   MConstLocalChars format = m_deferredFormat;
+   m_deferredFormat = NULL;
+   m_message = MGetStdString(format, m_deferredParameters[0], m_deferredParameters[1], m_deferredParameters[2], m_deferredParameters[3]); // excessive parameters are ignored
 }
 
 void MException::InitVA(MException::KindType kind, MErrorEnum::Type code, const char* str, va_list va) M_NO_THROW
@@ -447,6 +515,7 @@ MStdStringVector MException::GetCallStack() const
 
 MStdString MException::AsString() const
 {
+   DoResolveMessage();
    return m_message;
 }
 
@@ -485,6 +554,7 @@ MStdString MException::SimplifyMessageString(const MStdString& message)
 
 MStdString MException::AsSimplifiedString() const
 {
+   DoResolveMessage();
    return SimplifyMessageString(m_message);
 }
 
@@ -517,11 +587,13 @@ MStdString MException::GetKindAsStringStatic(KindType kind)
 
 void MException::Append(const MStdString& str) M_NO_THROW
 {
+   DoResolveMessage();
    m_message += str;
 }
 
 void MException::AppendToString(MConstLocalChars str, ...) M_NO_THROW
 {
+   DoResolveMessage();
    va_list va;
    va_start(va, str);
    m_message += MGetStdStringVA(str, va);
@@ -530,6 +602,7 @@ void MException::AppendToString(MConstLocalChars str, ...) M_NO_THROW
 
 void MException::AppendToString(const char* str, ...) M_NO_THROW
 {
+   DoResolveMessage();
    va_list va;
    va_start(va, str);
    m_message += MGetStdStringVA(str, va);
@@ -538,11 +611,13 @@ void MException::AppendToString(const char* str, ...) M_NO_THROW
 
 void MException::Prepend(const MStdString& str) M_NO_THROW
 {
+   DoResolveMessage();
    m_message = str + m_message;
 }
 
 void MException::PrependBeforeString(MConstLocalChars str, ...) M_NO_THROW
 {
+   DoResolveMessage();
    va_list va;
    va_start(va, str);
    m_message = MGetStdStringVA(str, va) + m_message;
@@ -551,6 +626,7 @@ void MException::PrependBeforeString(MConstLocalChars str, ...) M_NO_THROW
 
 void MException::PrependBeforeString(const char* str, ...) M_NO_THROW
 {
+   DoResolveMessage();
    va_list va;
    va_start(va, str);
    m_message = MGetStdStringVA(str, va) + m_message;
@@ -182,6 +182,11 @@ public: // Initialization, assignment:
    //@{
    /// Initialize the exception with the given message code from the VA list argument. 
    ///
+   /// When the localizable message has no parameters, or only integer parameters,
+   /// the parameters are saved, and the message is formatted only when it is requested.
+   /// This way the exceptions that are handled silently, such as the ones that cause retries,
+   /// do not pay for the message catalog lookup and formatting.
+   ///
    /// \pre The number of parameters and their types given 
    /// should correspond to the format of the message string within the resource. 
    /// Otherwise the behavior is undefined.
@@ -407,6 +412,7 @@ public: // Services:
    ///
    MStdString GetMessageString() const
    {
+      DoResolveMessage();
       return m_message;
    }
 
@@ -415,6 +421,7 @@ public: // Services:
    ///
    void SetMessageString(const MStdString& msg)
    {
+      m_deferredFormat = NULL;
       m_message = msg;
    }
 
@@ -677,6 +684,27 @@ public:
    static const char s_itemIsUnknownErrorString[];
 #endif
 
+#if !M_NO_VERBOSE_ERROR_INFORMATION
+private: // Methods:
+
+   // Format the deferred message into m_message, if the message is deferred.
+   //
+   void DoResolveMessage() const M_NO_THROW
+   {
+      if ( m_deferredFormat != NULL )
+         DoFormatDeferredMessage();
+   }
+
+   // Format the deferred message into m_message, called at the first request of the message.
+   //
+   void DoFormatDeferredMessage() const M_NO_THROW;
+
+   enum
+   {
+      DEFERRED_PARAMETERS_MAXIMUM = 4 // Messages with more parameters are formatted at once
+   };
+#endif
+
 protected: // Attributes:
 
    /// Message code for this exception.
@@ -690,8 +718,17 @@ protected: // Attributes:
 #if !M_NO_VERBOSE_ERROR_INFORMATION
 
    /// Message string that represents this exception.
+   /// While the message is deferred, it is empty, and it is formatted at the first request.
+   ///
+   mutable MStdString m_message;
+
+   /// Localizable format of the message that is not formatted yet, or NULL if m_message is ready.
+   ///
+   mutable MConstLocalChars m_deferredFormat;
+
+   /// Integer parameters of the deferred message format.
    ///
-   MStdString m_message;
+   unsigned m_deferredParameters [ DEFERRED_PARAMETERS_MAXIMUM ];
 
    /// File name and line number where the compile error took place.
    /// This can be zero, meaning no information is available.
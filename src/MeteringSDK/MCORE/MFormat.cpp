@@ -333,6 +333,326 @@ T* ConvP2(unsigned int value, int nbits, char format, T* end, size_t& stringLeng
    return DoConvP2(value, nbits, format, end, stringLength);
 }
 
+// Fast conversion of double into significant digits, which spares the bignum arithmetic and the locks of dtoa.
+// This is the counted digits variant of Grisu algorithm by Florian Loitsch, "Printing Floating-Point Numbers
+// Quickly and Accurately with Integers". It either gives the correctly rounded digits, exactly the ones of dtoa mode 2,
+// or it tells the result cannot be decided within the precision of 64-bit arithmetic, which happens rarely,
+// in which case dtoa is called.
+
+// Number given by 64-bit significand and binary exponent, value = f * 2^e
+//
+struct FDiyFp
+{
+   F_U64 f;
+   int e;
+};
+
+// Normalized cached power of ten, value = significand * 2^binaryExponent ~= 10^decimalExponent
+//
+struct FCachedPower
+{
+   F_U64 significand;
+   short binaryExponent;
+   short decimalExponent;
+};
+
+// Powers of ten from 10^-348 to 10^340 with step 8, significands rounded to nearest
+//
+const FCachedPower s_cachedPowers[] =
+{
+      { MUINT64C(0xFA8FD5A0081C0288), -1220, -348 },
+      { MUINT64C(0xBAAEE17FA23EBF76), -1193, -340 },
+      { MUINT64C(0x8B16FB203055AC76), -1166, -332 },
+      { MUINT64C(0xCF42894A5DCE35EA), -1140, -324 },
+      { MUINT64C(0x9A6BB0AA55653B2D), -1113, -316 },
+      { MUINT64C(0xE61ACF033D1A45DF), -1087, -308 },
+      { MUINT64C(0xAB70FE17C79AC6CA), -1060, -300 },
+      { MUINT64C(0xFF77B1FCBEBCDC4F), -1034, -292 },
+      { MUINT64C(0xBE5691EF416BD60C), -1007, -284 },
+      { MUINT64C(0x8DD01FAD907FFC3C),  -980, -276 },
+      { MUINT64C(0xD3515C2831559A83),  -954, -268 },
+      { MUINT64C(0x9D71AC8FADA6C9B5),  -927, -260 },
+      { MUINT64C(0xEA9C227723EE8BCB),  -901, -252 },
+      { MUINT64C(0xAECC49914078536D),  -874, -244 },
+      { MUINT64C(0x823C12795DB6CE57),  -847, -236 },
+      { MUINT64C(0xC21094364DFB5637),  -821, -228 },
+      { MUINT64C(0x9096EA6F3848984F),  -794, -220 },
+      { MUINT64C(0xD77485CB25823AC7),  -768, -212 },
+      { MUINT64C(0xA086CFCD97BF97F4),  -741, -204 },
+      { MUINT64C(0xEF340A98172AACE5),  -715, -196 },
+      { MUINT64C(0xB23867FB2A35B28E),  -688, -188 },
+      { MUINT64C(0x84C8D4DFD2C63F3B),  -661, -180 },
+      { MUINT64C(0xC5DD44271AD3CDBA),  -635, -172 },
+      { MUINT64C(0x936B9FCEBB25C996),  -608, -164 },
+      { MUINT64C(0xDBAC6C247D62A584),  -582, -156 },
+      { MUINT64C(0xA3AB66580D5FDAF6),  -555, -148 },
+      { MUINT64C(0xF3E2F893DEC3F126),  -529, -140 },
+      { MUINT64C(0xB5B5ADA8AAFF80B8),  -502, -132 },
+      { MUINT64C(0x87625F056C7C4A8B),  -475, -124 },
+      { MUINT64C(0xC9BCFF6034C13053),  -449, -116 },
+      { MUINT64C(0x964E858C91BA2655),  -422, -108 },
+      { MUINT64C(0xDFF9772470297EBD),  -396, -100 },
+      { MUINT64C(0xA6DFBD9FB8E5B88F),  -369,  -92 },
+      { MUINT64C(0xF8A95FCF88747D94),  -343,  -84 },
+      { MUINT64C(0xB94470938FA89BCF),  -316,  -76 },
+      { MUINT64C(0x8A08F0F8BF0F156B),  -289,  -68 },
+      { MUINT64C(0xCDB02555653131B6),  -263,  -60 },
+      { MUINT64C(0x993FE2C6D07B7FAC),  -236,  -52 },
+      { MUINT64C(0xE45C10C42A2B3B06),  -210,  -44 },
+      { MUINT64C(0xAA242499697392D3),  -183,  -36 },
+      { MUINT64C(0xFD87B5F28300CA0E),  -157,  -28 },
+      { MUINT64C(0xBCE5086492111AEB),  -130,  -20 },
+      { MUINT64C(0x8CBCCC096F5088CC),  -103,  -12 },
+      { MUINT64C(0xD1B71758E219652C),   -77,   -4 },
+      { MUINT64C(0x9C40000000000000),   -50,    4 },
+      { MUINT64C(0xE8D4A51000000000),   -24,   12 },
+      { MUINT64C(0xAD78EBC5AC620000),     3,   20 },
+      { MUINT64C(0x813F3978F8940984),    30,   28 },
+      { MUINT64C(0xC097CE7BC90715B3),    56,   36 },
+      { MUINT64C(0x8F7E32CE7BEA5C70),    83,   44 },
+      { MUINT64C(0xD5D238A4ABE98068),   109,   52 },
+      { MUINT64C(0x9F4F2726179A2245),   136,   60 },
+      { MUINT64C(0xED63A231D4C4FB27),   162,   68 },
+      { MUINT64C(0xB0DE65388CC8ADA8),   189,   76 },
+      { MUINT64C(0x83C7088E1AAB65DB),   216,   84 },
+      { MUINT64C(0xC45D1DF942711D9A),   242,   92 },
+      { MUINT64C(0x924D692CA61BE758),   269,  100 },
+      { MUINT64C(0xDA01EE641A708DEA),   295,  108 },
+      { MUINT64C(0xA26DA3999AEF774A),   322,  116 },
+      { MUINT64C(0xF209787BB47D6B85),   348,  124 },
+      { MUINT64C(0xB454E4A179DD1877),   375,  132 },
+      { MUINT64C(0x865B86925B9BC5C2),   402,  140 },
+      { MUINT64C(0xC83553C5C8965D3D),   428,  148 },
+      { MUINT64C(0x952AB45CFA97A0B3),   455,  156 },
+      { MUINT64C(0xDE469FBD99A05FE3),   481,  164 },
+      { MUINT64C(0xA59BC234DB398C25),   508,  172 },
+      { MUINT64C(0xF6C69A72A3989F5C),   534,  180 },
+      { MUINT64C(0xB7DCBF5354E9BECE),   561,  188 },
+      { MUINT64C(0x88FCF317F22241E2),   588,  196 },
+      { MUINT64C(0xCC20CE9BD35C78A5),   614,  204 },
+      { MUINT64C(0x98165AF37B2153DF),   641,  212 },
+      { MUINT64C(0xE2A0B5DC971F303A),   667,  220 },
+      { MUINT64C(0xA8D9D1535CE3B396),   694,  228 },
+      { MUINT64C(0xFB9B7CD9A4A7443C),   720,  236 },
+      { MUINT64C(0xBB764C4CA7A44410),   747,  244 },
+      { MUINT64C(0x8BAB8EEFB6409C1A),   774,  252 },
+      { MUINT64C(0xD01FEF10A657842C),   800,  260 },
+      { MUINT64C(0x9B10A4E5E9913129),   827,  268 },
+      { MUINT64C(0xE7109BFBA19C0C9D),   853,  276 },
+      { MUINT64C(0xAC2820D9623BF429),   880,  284 },
+      { MUINT64C(0x80444B5E7AA7CF85),   907,  292 },
+      { MUINT64C(0xBF21E44003ACDD2D),   933,  300 },
+      { MUINT64C(0x8E679C2F5E44FF8F),   960,  308 },
+      { MUINT64C(0xD433179D9C8CB841),   986,  316 },
+      { MUINT64C(0x9E19DB92B4E31BA9),  1013,  324 },
+      { MUINT64C(0xEB96BF6EBADF77D9),  1039,  332 },
+      { MUINT64C(0xAF87023B9BF0EE6B),  1066,  340 },
+};
+
+const int CACHED_POWERS_OFFSET = 348;   // minus decimal exponent of the first cached power
+const int CACHED_POWERS_DISTANCE = 8;   // difference of decimal exponents of the neighbor cached powers
+const int GRISU_MINIMAL_TARGET_EXPONENT = -60;
+const int GRISU_MAXIMAL_TARGET_EXPONENT = -32;
+const int GRISU_MAXIMUM_DIGITS = 17;    // more digits than this are never computed by Grisu
+
+// Product of two numbers, rounded to 64 bits
+//
+inline FDiyFp FDiyFpTimes(const FDiyFp& x, const FDiyFp& y)
+{
+   const F_U64 M32 = 0xFFFFFFFFu;
+   const F_U64 a = x.f >> 32;
+   const F_U64 b = x.f & M32;
+   const F_U64 c = y.f >> 32;
+   const F_U64 d = y.f & M32;
+   const F_U64 ac = a * c;
+   const F_U64 bc = b * c;
+   const F_U64 ad = a * d;
+   const F_U64 bd = b * d;
+   F_U64 tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+   tmp += F_U64(1) << 31; // round
+   FDiyFp result;
+   result.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+   result.e = x.e + y.e + 64;
+   return result;
+}
+
+// Round the digits with the rest, given in units of ten_kappa, and the error of the computation in the same units.
+// Returns false if it cannot be decided how the digits have to be rounded.
+//
+bool FRoundWeedCounted(char* buffer, int length, F_U64 rest, F_U64 tenKappa, F_U64 unit, int& kappa)
+{
+   M_ASSERT(rest < tenKappa);
+   if ( unit >= tenKappa || tenKappa - unit <= unit )
+      return false;
+   if ( tenKappa - rest > rest && tenKappa - 2 * rest >= 2 * unit ) // round down for sure
+      return true;
+   if ( rest > unit && tenKappa - (rest - unit) <= (rest - unit) ) // round up for sure
+   {
+      ++buffer[length - 1];
+      for ( int i = length - 1; i > 0; --i )
+      {
+         if ( buffer[i] != '0' + 10 )
+            break;
+         buffer[i] = '0';
+         ++buffer[i - 1];
+      }
+      if ( buffer[0] == '0' + 10 ) // all digits were nines
+      {
+         buffer[0] = '1';
+         ++kappa;
+      }
+      return true;
+   }
+   return false;
+}
+
+// Generate the requested number of digits of the number scaled into the range of Grisu target exponents.
+// The error of the scaled number is less than one unit of its last place.
+//
+bool FDigitGenCounted(const FDiyFp& w, int requestedDigits, char* buffer, int& length, int& kappa)
+{
+   M_ASSERT(GRISU_MINIMAL_TARGET_EXPONENT <= w.e && w.e <= GRISU_MAXIMAL_TARGET_EXPONENT);
+   F_U64 wError = 1;
+   const int oneShift = -w.e;
+   const F_U64 one = F_U64(1) << oneShift;
+   unsigned integrals = static_cast<unsigned>(w.f >> oneShift); // fits in 32 bits as the exponent is at most -32
+   F_U64 fractionals = w.f & (one - 1);
+
+   unsigned divisor = 1;
+   kappa = 1;
+   while ( divisor <= integrals / 10 )
+   {
+      divisor *= 10;
+      ++kappa;
+   }
+
+   length = 0;
+   while ( kappa > 0 )
+   {
+      buffer[length++] = static_cast<char>('0' + integrals / divisor);
+      integrals %= divisor;
+      --kappa;
+      if ( --requestedDigits == 0 )
+         break;
+      divisor /= 10;
+   }
+   if ( requestedDigits == 0 )
+   {
+      const F_U64 rest = (static_cast<F_U64>(integrals) << oneShift) + fractionals;
+      return FRoundWeedCounted(buffer, length, rest, static_cast<F_U64>(divisor) << oneShift, wError, kappa);
+   }
+
+   while ( requestedDigits > 0 && fractionals > wError )
+   {
+      fractionals *= 10;
+      wError *= 10;
+      buffer[length++] = static_cast<char>('0' + (fractionals >> oneShift));
+      fractionals &= one - 1;
+      --requestedDigits;
+      --kappa;
+   }
+   if ( requestedDigits != 0 )
+      return false;
+   return FRoundWeedCounted(buffer, length, fractionals, one, wError, kappa);
+}
+
+// Digits of a finite nonzero positive number, correctly rounded to the requested number of digits,
+// with the trailing zeros removed, same as dtoa mode 2 gives. Returns false if dtoa has to be called instead.
+//
+bool FGrisuCounted(double value, int requestedDigits, char* buffer, int& length, int& decpt)
+{
+   M_ASSERT(value > 0.0 && requestedDigits > 0 && requestedDigits <= GRISU_MAXIMUM_DIGITS);
+
+   F_U64 bits;
+   memcpy(&bits, &value, sizeof(bits));
+   const F_U64 hiddenBit = MUINT64C(0x0010000000000000);
+   const int biasedExponent = static_cast<int>(bits >> 52) & 0x7FF;
+   FDiyFp w;
+   w.f = bits & (hiddenBit - 1);
+   if ( biasedExponent == 0 ) // subnormal
+      w.e = 1 - 0x3FF - 52;
+   else
+   {
+      w.f += hiddenBit;
+      w.e = biasedExponent - 0x3FF - 52;
+   }
+   while ( (w.f & MUINT64C(0x8000000000000000)) == 0 ) // normalize
+   {
+      w.f <<= 1;
+      --w.e;
+   }
+
+   // Cached power that brings the exponent of the product into the Grisu target range
+   const int minimalExponent = GRISU_MINIMAL_TARGET_EXPONENT - (w.e + 64);
+   const int k = static_cast<int>(ceil((minimalExponent + 63) * 0.30102999566398114)); // log10(2)
+   const FCachedPower& power = s_cachedPowers[(CACHED_POWERS_OFFSET + k - 1) / CACHED_POWERS_DISTANCE + 1];
+   FDiyFp tenMk;
+   tenMk.f = power.significand;
+   tenMk.e = power.binaryExponent;
+
+   int kappa;
+   if ( !FDigitGenCounted(FDiyFpTimes(w, tenMk), requestedDigits, buffer, length, kappa) )
+      return false;
+   while ( length > 1 && buffer[length - 1] == '0' )
+   {
+      --length;
+      ++kappa;
+   }
+   decpt = length + kappa - power.decimalExponent;
+   return true;
+}
+
+// Significant digits of a double as dtoa mode 2 gives them, computed by Grisu when possible
+//
+class FDoubleDigits
+{
+public:
+
+   FDoubleDigits(double num, int ndigits)
+   {
+      F_U64 bits;
+      memcpy(&bits, &num, sizeof(bits));
+      const int sign = static_cast<int>(bits >> 63);
+      const double absnum = (sign != 0) ? -num : num;
+      if ( ndigits > 0 && ndigits <= GRISU_MAXIMUM_DIGITS && absnum <= DBL_MAX ) // false for infinity and NaN
+      {
+         int length = 1;
+         bool success = true;
+         if ( absnum == 0.0 )
+         {
+            m_buffer[0] = '0';
+            m_decpt = 1;
+         }
+         else
+            success = FGrisuCounted(absnum, ndigits, m_buffer, length, m_decpt);
+         if ( success )
+         {
+            m_buffer[length] = '\0';
+            m_digits = m_buffer;
+            m_end = m_buffer + length;
+            m_sign = sign;
+            return;
+         }
+      }
+      m_digits = meteringsdk_dtoa(num, 2, ndigits, &m_decpt, &m_sign, &m_end);
+   }
+
+   ~FDoubleDigits()
+   {
+      if ( m_digits != m_buffer )
+         meteringsdk_freedtoa(m_digits);
+   }
+
+   char* m_digits; // zero terminated
+   char* m_end;    // terminating zero of the digits
+   int m_decpt;    // position of the decimal point relative to the first digit
+   int m_sign;     // nonzero if the number is negative
+
+private:
+
+   char m_buffer [ GRISU_MAXIMUM_DIGITS + 1 ];
+};
+
 template <typename T>
 T* ConvFFp(double num, const FFlags& fflags, bool& isNeg, T* buf, size_t& stringLength)
 {
@@ -387,20 +707,18 @@ T* ConvEFp(double num, const FFlags& fflags, bool& isNeg, T* buf, size_t& string
    char tmp [ EXPONENT_LENGTH ];
    size_t tmpLen;
    bool expIsNeg;
-   int sign;
-   char* rve;
-   int decp;
    T* s = buf;
 
    int precision = int(fflags.adjustPrecision ? fflags.precision : FLOAT_DIGITS);
    ++precision;
-   char* localbuf = dtoa(num, 2, precision, &decp, &sign, &rve);
+   FDoubleDigits digits(num, precision);
+   int decp = digits.m_decpt;
 
-   int localbufLen = static_cast<int>(rve - localbuf);
-   M_ASSERT(localbufLen == static_cast<int>(strlen(localbuf)));
+   int localbufLen = static_cast<int>(digits.m_end - digits.m_digits);
+   M_ASSERT(localbufLen == static_cast<int>(strlen(digits.m_digits)));
    int extraZeros = precision - localbufLen;
-   char* p = localbuf;
-   isNeg = (sign != 0);
+   char* p = digits.m_digits;
+   isNeg = (digits.m_sign != 0);
 
    *s++ = *p++;
    if ( precision > 1 || fflags.alternateForm )
@@ -434,7 +752,6 @@ T* ConvEFp(double num, const FFlags& fflags, bool& isNeg, T* buf, size_t& string
       *s++ = '0';
    }
 
-   meteringsdk_freedtoa(localbuf);
    stringLength = s - buf;
    return buf;
 }
@@ -442,24 +759,21 @@ T* ConvEFp(double num, const FFlags& fflags, bool& isNeg, T* buf, size_t& string
 template <typename T>
 T* ConvGFp(double num, const FFlags& fflags, bool& isNeg, T *buf, size_t& stringLength)
 {
-   int sign;
-   char* rve;
    int i;
-   int decpt;
-
    int ndigits, savedndigits;
    if ( !fflags.adjustPrecision ) ndigits = FLOAT_DIGITS;
    else if ( fflags.precision == 0 ) ndigits = 1;
    else ndigits = static_cast<int>(fflags.precision);
    savedndigits = ndigits;
 
-   char* localbuf = meteringsdk_dtoa(num, 2, ndigits, &decpt, &sign, &rve);
-   isNeg = (sign != 0);
-   char* p1 = localbuf;
+   FDoubleDigits digits(num, ndigits);
+   int decpt = digits.m_decpt;
+   isNeg = (digits.m_sign != 0);
+   const char* p1 = digits.m_digits;
    T* p2 = buf;
 
-   ndigits = static_cast<int>(rve - localbuf);
-   M_ASSERT(ndigits == static_cast<int>(strlen(localbuf)));
+   ndigits = static_cast<int>(digits.m_end - digits.m_digits);
+   M_ASSERT(ndigits == static_cast<int>(strlen(digits.m_digits)));
    if ( (decpt >= 0 && decpt - savedndigits > 0) || decpt < -3 ) // use E-style
    {
       --decpt;
@@ -571,7 +885,6 @@ T* ConvGFp(double num, const FFlags& fflags, bool& isNeg, T *buf, size_t& string
          p2--;
    }
 
-   meteringsdk_freedtoa(localbuf);
    *p2 = '\0';
    stringLength = p2 - buf;
    return buf;
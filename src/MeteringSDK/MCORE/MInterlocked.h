@@ -13,7 +13,8 @@
 /// System independent lightweight synchronization object that
 /// synchronizes the access to one variable across multiple threads.
 ///
-/// At present, the only atomic operations supported are increment and decrement.
+/// At present, the atomic operations supported are increment, decrement, addition,
+/// compare-and-exchange of an integer or a pointer, and acquiring load of a pointer.
 ///
 /// Implementation note: On the majority of architectures, assignment
 /// to and from a properly aligned unsigned variable is an atomic operation.
@@ -151,6 +152,22 @@ public:
       return FetchAndDecrement(&m_value);
    }
 
+   /// Atomically add a value to this object and return result.
+   ///
+   /// This operation should be used in multithreaded environments in order to
+   /// prevent situations when multiple threads would fail to change the same value
+   /// in a consistent way. Adding zero is a way of reading the value with a memory barrier.
+   ///
+   /// \param delta
+   ///     Value to add, can be negative
+   ///
+   /// \return integer value that is the result of the operation.
+   ///
+   int operator+=(int delta)
+   {
+      return AddAndFetch(&m_value, delta);
+   }
+
 public: // Static methods:
 
    /// Static function that atomically increments an integer in the given pointer 
@@ -293,6 +310,149 @@ public: // Static methods:
       #endif
    }
 
+   /// Static function that atomically adds a value to an integer in the given pointer
+   /// and returns the new value.
+   ///
+   /// This operation should be used in multithreaded environments in order to
+   /// prevent situations when multiple threads would fail to change the same value
+   /// in a consistent way.
+   ///
+   /// \param v
+   ///     Volatile pointer to the integer to which the value should be added
+   ///
+   /// \param delta
+   ///     Value to add, can be negative
+   ///
+   /// \return integer value that is the result of the operation.
+   ///
+   static int AddAndFetch(volatile int* v, int delta)
+   {
+      #if (M_OS & M_OS_QNXNTO) != 0
+         return static_cast<int>(atomic_add_value(reinterpret_cast<volatile unsigned*>(v), static_cast<unsigned>(delta)) + static_cast<unsigned>(delta)); // returns previous value
+      #elif (M_OS & M_OS_WIN32_CE) != 0
+         return ::InterlockedExchangeAdd(const_cast<LONG*>(reinterpret_cast<volatile LONG*>(v)), delta) + delta;
+      #elif (M_OS & M_OS_WINDOWS) != 0
+         return ::InterlockedExchangeAdd(reinterpret_cast<volatile LONG*>(v), delta) + delta; // returns previous value
+      #elif (M_OS & M_OS_CMX) != 0 && defined(ewarm)
+         {
+            int o, n;
+            do
+            {
+               o = __LDREX((unsigned long*)v);
+               n = o + delta;
+            } while(__STREX(n, (unsigned long*)v));
+            return n;
+         }
+      #else // Otherwise assume GCC or compatibles
+         return __sync_add_and_fetch(v, delta);
+      #endif
+   }
+
+   /// Static function that atomically replaces an integer in the given pointer with the desired value,
+   /// but only if the integer is equal to the expected value, and returns the previous value.
+   ///
+   /// The replacement took place if the returned value is equal to the expected one.
+   /// The operation is a full memory barrier.
+   ///
+   /// \param v
+   ///     Volatile pointer to the integer that should be replaced
+   ///
+   /// \param expected
+   ///     Value that the integer should have for the replacement to happen
+   ///
+   /// \param desired
+   ///     New value of the integer
+   ///
+   /// \return integer value that had previously been in memory.
+   ///
+   static int CompareAndExchange(volatile int* v, int expected, int desired)
+   {
+      #if (M_OS & M_OS_WIN32_CE) != 0
+         return ::InterlockedCompareExchange(const_cast<LONG*>(reinterpret_cast<volatile LONG*>(v)), desired, expected);
+      #elif (M_OS & M_OS_WINDOWS) != 0
+         return ::InterlockedCompareExchange(reinterpret_cast<volatile LONG*>(v), desired, expected);
+      #elif (M_OS & M_OS_CMX) != 0 && defined(ewarm)
+         {
+            int o;
+            do
+            {
+               o = __LDREX((unsigned long*)v);
+               if ( o != expected )
+               {
+                  __CLREX();
+                  break;
+               }
+            } while(__STREX(desired, (unsigned long*)v));
+            return o;
+         }
+      #else // Otherwise assume GCC or compatibles, QNX included
+         return __sync_val_compare_and_swap(v, expected, desired);
+      #endif
+   }
+
+   /// Static function that atomically replaces a pointer with the desired value,
+   /// but only if the pointer is equal to the expected value, and returns the previous pointer.
+   ///
+   /// The replacement took place if the returned value is equal to the expected one.
+   /// The operation is a full memory barrier, so it can publish the data
+   /// pointed to by the desired value to the threads that read the pointer.
+   ///
+   /// \param v
+   ///     Volatile pointer to the pointer that should be replaced
+   ///
+   /// \param expected
+   ///     Value that the pointer should have for the replacement to happen
+   ///
+   /// \param desired
+   ///     New value of the pointer
+   ///
+   /// \return pointer value that had previously been in memory.
+   ///
+   static void* CompareAndExchangePointer(void* volatile* v, void* expected, void* desired)
+   {
+      #if (M_OS & M_OS_WIN32_CE) != 0
+         return ::InterlockedCompareExchangePointer(const_cast<PVOID*>(v), desired, expected);
+      #elif (M_OS & M_OS_WINDOWS) != 0
+         return ::InterlockedCompareExchangePointer(v, desired, expected);
+      #elif (M_OS & M_OS_CMX) != 0 && defined(ewarm)
+         M_COMPILED_ASSERT(sizeof(void*) == sizeof(int));
+         return reinterpret_cast<void*>(CompareAndExchange(reinterpret_cast<volatile int*>(v), reinterpret_cast<int>(expected), reinterpret_cast<int>(desired)));
+      #else // Otherwise assume GCC or compatibles, QNX included
+         return __sync_val_compare_and_swap(v, expected, desired);
+      #endif
+   }
+
+   /// Static function that reads a pointer with acquire semantics.
+   ///
+   /// Reads of the data pointed to by the returned value are not reordered before the load,
+   /// therefore the data published with \ref CompareAndExchangePointer is seen complete.
+   ///
+   /// \param v
+   ///     Volatile pointer to the pointer that should be read
+   ///
+   /// \return pointer value that is in memory.
+   ///
+   static void* LoadPointerAcquire(void* const volatile* v)
+   {
+      #if (M_OS & M_OS_WINDOWS) != 0 && (defined(_M_IX86) || defined(_M_X64) || defined(_M_AMD64))
+         return *v; // volatile reads have acquire semantics on x86
+      #elif (M_OS & M_OS_WINDOWS) != 0
+         void* p = *v;
+         ::MemoryBarrier();
+         return p;
+      #elif (M_OS & M_OS_CMX) != 0 && defined(ewarm)
+         void* p = *v;
+         __DMB();
+         return p;
+      #elif defined(__ATOMIC_ACQUIRE)
+         return __atomic_load_n(v, __ATOMIC_ACQUIRE);
+      #else // Otherwise assume older GCC or compatibles, QNX included
+         void* p = *v;
+         __sync_synchronize();
+         return p;
+      #endif
+   }
+
 private: // Data:
 
    // Value itself
@@ -0,0 +1,211 @@
+// File MCORE/MLzCodec.cpp
+
+#include "MCOREExtern.h"
+#include "MLzCodec.h"
+#include "MException.h"
+
+M_START_PROPERTIES(LzCodec)
+M_START_METHODS(LzCodec)
+   M_CLASS_SERVICE(LzCodec, Compress,   ST_MByteString_S_constMByteStringA)
+   M_CLASS_SERVICE(LzCodec, Decompress, ST_MByteString_S_constMByteStringA)
+M_END_CLASS(LzCodec, Object)
+
+   const unsigned HASH_BITS = 12;
+   const unsigned LENGTH_MASK = 0x0F;
+
+   inline Muint32 DoRead32(const Muint8* p)
+   {
+      Muint32 value;
+      memcpy(&value, p, sizeof(value)); // fix memory alignment on ARM
+      return value;
+   }
+
+   inline unsigned DoHash(Muint32 sequence)
+   {
+      return (sequence * 2654435761u) >> (32 - HASH_BITS);
+   }
+
+   // Number of extra bytes to encode the given length in a token field
+   //
+   inline unsigned DoGetExtraLengthSize(unsigned length)
+   {
+      return length < LENGTH_MASK ? 0 : (length - LENGTH_MASK) / 255 + 1;
+   }
+
+   inline Muint8* DoPutExtraLength(Muint8* out, unsigned length)
+   {
+      if ( length >= LENGTH_MASK )
+      {
+         for ( length -= LENGTH_MASK; length >= 255; length -= 255 )
+            *out++ = 255;
+         *out++ = static_cast<Muint8>(length);
+      }
+      return out;
+   }
+
+   inline bool DoGetExtraLength(const Muint8* in, unsigned inSize, unsigned& ip, unsigned& length)
+   {
+      if ( length == LENGTH_MASK )
+      {
+         Muint8 b;
+         do
+         {
+            if ( ip >= inSize || length > UINT_MAX - 255 ) // also prevents the overflow of length
+               return false;
+            b = in[ip++];
+            length += b;
+         } while ( b == 255 );
+      }
+      return true;
+   }
+
+MByteString MLzCodec::Compress(const MByteString& data)
+{
+   unsigned size = M_64_CAST(unsigned, data.size());
+   MByteString result;
+   result.resize(GetMaximumCompressedSize(size));
+   unsigned resultSize = CompressBuffer(data.data(), size, &result[0], M_64_CAST(unsigned, result.size()));
+   M_ASSERT(size == data.size()); // all data fits by definition of GetMaximumCompressedSize
+   result.resize(resultSize);
+   return result;
+}
+
+MByteString MLzCodec::Decompress(const MByteString& data)
+{
+   const unsigned size = M_64_CAST(unsigned, data.size());
+   unsigned resultSize;
+   MByteString result;
+   if ( DecompressBuffer(data.data(), size, NULL, 0, resultSize) )
+   {
+      result.resize(resultSize);
+      if ( resultSize == 0 || DecompressBuffer(data.data(), size, &result[0], resultSize, resultSize) )
+         return result;
+   }
+   MException::Throw(MErrorEnum::BadFileFormat, M_I("Compressed data is corrupt"));
+   M_ENSURED_ASSERT(0);
+   return result;
+}
+
+unsigned MLzCodec::CompressBuffer(const char* source, unsigned& sourceSize, char* destination, unsigned destinationSize) M_NO_THROW
+{
+   const Muint8* const in = reinterpret_cast<const Muint8*>(source);
+   Muint8* const out = reinterpret_cast<Muint8*>(destination);
+   const unsigned size = sourceSize;
+   unsigned ip = 0;
+   unsigned anchor = 0;   // start of the literals not yet written
+   unsigned op = 0;
+
+   if ( size > MINIMUM_MATCH_LENGTH )
+   {
+      unsigned table [ 1u << HASH_BITS ]; // positions plus one, zero is no position
+      memset(table, 0, sizeof(table));
+      const unsigned matchLimit = size - MINIMUM_MATCH_LENGTH; // last position from which a sequence can be read
+      while ( ip <= matchLimit )
+      {
+         const Muint32 sequence = DoRead32(in + ip);
+         const unsigned hash = DoHash(sequence);
+         const unsigned candidate = table[hash];
+         table[hash] = ip + 1;
+         if ( candidate == 0 || ip + 1 - candidate > MAXIMUM_MATCH_OFFSET || DoRead32(in + candidate - 1) != sequence )
+         {
+            ip += 1 + ((ip - anchor) >> 6); // skip faster through the data that does not compress
+            continue;
+         }
+
+         const unsigned reference = candidate - 1;
+         unsigned length = MINIMUM_MATCH_LENGTH;
+         while ( ip + length < size && in[reference + length] == in[ip + length] )
+            ++length;
+
+         const unsigned literals = ip - anchor;
+         const unsigned matchLength = length - MINIMUM_MATCH_LENGTH;
+         if ( op + 1 + DoGetExtraLengthSize(literals) + literals + 2 + DoGetExtraLengthSize(matchLength) > destinationSize )
+            break; // the rest is written as literals, as many as fit
+         Muint8* token = out + op;
+         Muint8* p = DoPutExtraLength(token + 1, literals);
+         memcpy(p, in + anchor, literals);
+         p += literals;
+         const unsigned offset = ip - reference;
+         *p++ = static_cast<Muint8>(offset);
+         *p++ = static_cast<Muint8>(offset >> 8);
+         p = DoPutExtraLength(p, matchLength);
+         *token = static_cast<Muint8>(((literals < LENGTH_MASK ? literals : LENGTH_MASK) << 4) | (matchLength < LENGTH_MASK ? matchLength : LENGTH_MASK));
+         op = unsigned(p - out);
+
+         ip += length;
+         anchor = ip;
+         if ( ip - 2 <= matchLimit ) // this improves the ratio of the long repetitions
+            table[DoHash(DoRead32(in + ip - 2))] = ip - 2 + 1;
+      }
+   }
+
+   // Last literals, as many as fit
+   //
+   unsigned literals = size - anchor;
+   if ( op < destinationSize )
+   {
+      const unsigned available = destinationSize - op - 1; // less the token
+      while ( DoGetExtraLengthSize(literals) + literals > available )
+      {
+         const unsigned excess = DoGetExtraLengthSize(literals) + literals - available;
+         literals = literals > excess ? literals - excess : 0;
+      }
+      Muint8* p = DoPutExtraLength(out + op + 1, literals);
+      memcpy(p, in + anchor, literals);
+      out[op] = static_cast<Muint8>((literals < LENGTH_MASK ? literals : LENGTH_MASK) << 4);
+      op = unsigned(p + literals - out);
+   }
+   else
+      literals = 0;
+   sourceSize = anchor + literals;
+   return op;
+}
+
+bool MLzCodec::DecompressBuffer(const char* source, unsigned sourceSize, char* destination, unsigned destinationSize, unsigned& resultSize) M_NO_THROW
+{
+   const Muint8* const in = reinterpret_cast<const Muint8*>(source);
+   Muint8* const out = reinterpret_cast<Muint8*>(destination);
+   if ( out == NULL )
+      destinationSize = UINT_MAX;
+   unsigned ip = 0;
+   unsigned op = 0;
+   while ( ip < sourceSize )
+   {
+      const unsigned token = in[ip++];
+      unsigned literals = token >> 4;
+      if ( !DoGetExtraLength(in, sourceSize, ip, literals) || literals > sourceSize - ip || literals > destinationSize - op )
+         return false;
+      if ( out != NULL )
+         memcpy(out + op, in + ip, literals);
+      ip += literals;
+      op += literals;
+      if ( ip == sourceSize ) // last token has no match
+         break;
+
+      if ( sourceSize - ip < 2 )
+         return false;
+      const unsigned offset = unsigned(in[ip]) | (unsigned(in[ip + 1]) << 8);
+      ip += 2;
+      unsigned length = token & LENGTH_MASK;
+      if ( offset == 0 || offset > op || !DoGetExtraLength(in, sourceSize, ip, length) )
+         return false;
+      length += MINIMUM_MATCH_LENGTH;
+      if ( length > destinationSize - op )
+         return false;
+      if ( out != NULL )
+      {
+         const Muint8* match = out + op - offset;
+         Muint8* p = out + op;
+         if ( offset >= length )
+            memcpy(p, match, length);
+         else
+         {
+            for ( unsigned i = 0; i < length; ++i ) // overlapping copy repeats the pattern
+               p[i] = match[i];
+         }
+      }
+      op += length;
+   }
+   resultSize = op;
+   return true;
+}
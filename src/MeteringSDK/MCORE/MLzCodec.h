@@ -0,0 +1,86 @@
+#ifndef MCORE_MLZCODEC_H
+#define MCORE_MLZCODEC_H
+/// \addtogroup MCORE
+///@{
+/// \file MCORE/MLzCodec.h
+
+#include <MCORE/MObject.h>
+
+/// Fast dictionary compression of the LZ77 family, good for repetitive data such as communication logs.
+///
+/// The class has only static methods, no instances of MLzCodec are possible.
+/// The compression favors speed over ratio, it is a single pass with a small hash table of recent positions.
+///
+/// The compressed data is a sequence of tokens. Every token is a byte, which upper four bits
+/// are the number of literal bytes that follow the token, and lower four bits are the length
+/// of the match that follows the literals, less four. The value 15 in either of the fields
+/// means the length continues in the subsequent bytes, each adding its value, until a byte is not 255.
+/// Literals are followed by two bytes of the match offset, least significant byte first,
+/// except in the last token, where the data ends right after the literals.
+///
+class M_CLASS MLzCodec : public MObject
+{
+public: // Constants:
+
+   enum
+   {
+      MINIMUM_MATCH_LENGTH = 4,     ///< Shortest match that is encoded as a reference to previous data.
+      MAXIMUM_MATCH_OFFSET = 0xFFFF ///< Farthest distance to the match within the previous data.
+   };
+
+public: // Services:
+
+   /// Compress the given bytes.
+   ///
+   /// \param data Bytes to compress.
+   /// \return Compressed bytes, which can be given to \ref Decompress.
+   ///
+   static MByteString Compress(const MByteString& data);
+
+   /// Decompress the bytes compressed by \ref Compress.
+   ///
+   /// \param data Compressed bytes.
+   /// \return Original bytes.
+   ///
+   /// \pre The data has to be a valid compressed data, or a bad format exception is thrown.
+   ///
+   static MByteString Decompress(const MByteString& data);
+
+   /// Maximum size of the compressed data for the given uncompressed size.
+   ///
+   static unsigned GetMaximumCompressedSize(unsigned size)
+   {
+      return size + size / 255 + 16;
+   }
+
+   /// Compress as many of the given bytes as fit into the destination buffer.
+   ///
+   /// \param source Bytes to compress.
+   /// \param sourceSize On entry, the number of bytes to compress.
+   ///     On return, the number of bytes compressed, which is less than the one given
+   ///     only if the compressed data does not fit into the destination buffer.
+   ///     All bytes are compressed if the destination size is at least \ref GetMaximumCompressedSize of the source size.
+   /// \param destination Buffer where to put the compressed data.
+   /// \param destinationSize Size of the destination buffer.
+   /// \return Size of the compressed data placed into the destination buffer.
+   ///
+   static unsigned CompressBuffer(const char* source, unsigned& sourceSize, char* destination, unsigned destinationSize) M_NO_THROW;
+
+   /// Decompress the data into the given buffer.
+   ///
+   /// \param source Compressed data.
+   /// \param sourceSize Size of the compressed data.
+   /// \param destination Buffer where to put the decompressed data, or NULL to only determine the size.
+   /// \param destinationSize Size of the destination buffer, ignored if the destination is NULL.
+   /// \param resultSize Size of the decompressed data, set on success.
+   /// \return True if the data is decompressed, false if it is corrupt, or the destination buffer is too small.
+   ///
+   static bool DecompressBuffer(const char* source, unsigned sourceSize, char* destination, unsigned destinationSize, unsigned& resultSize) M_NO_THROW;
+
+private:
+
+   M_DECLARE_CLASS(LzCodec)
+};
+
+///@}
+#endif
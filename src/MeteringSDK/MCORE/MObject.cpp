@@ -58,9 +58,13 @@ bool MObject::IsServicePresent(const MStdString& name) const
 }
 
 MVariant MObject::GetProperty(const MStdString& name) const
+{
+   return GetPropertyByDefinition(GetClass()->GetPropertyDefinition(name));
+}
+
+MVariant MObject::GetPropertyByDefinition(const MPropertyDefinition* def) const
 {
    MVariant result;
-   const MPropertyDefinition* def = GetClass()->GetPropertyDefinition(name);
    M_ASSERT(def != 0);
    if ( def->m_getObjectMethod != 0 )
    {
@@ -155,13 +159,17 @@ MVariant MObject::GetProperty(const MStdString& name) const
       }
    }
    else      // Otherwise marshal the class property or enumeration to the class
-      result.DoAssignToEmpty(GetClass()->GetProperty(name));
+      result.DoAssignToEmpty(GetClass()->GetPropertyByDefinition(def));
    return result;
 }
 
 void MObject::SetProperty(const MStdString& name, const MVariant& value)
 {
-   const MPropertyDefinition* def = GetClass()->GetPropertyDefinition(name);
+   SetPropertyByDefinition(GetClass()->GetPropertyDefinition(name), value);
+}
+
+void MObject::SetPropertyByDefinition(const MPropertyDefinition* def, const MVariant& value)
+{
    M_ASSERT(def != 0);
 
    if ( def->m_setObjectMethod != 0 )
@@ -233,10 +241,10 @@ void MObject::SetProperty(const MStdString& name, const MVariant& value)
       }
    }
    if ( def->m_getObjectMethod == 0 ) // if we are dealing with the object property...
-      GetClass()->SetProperty(name, value); // marshal to the class property
+      GetClass()->SetPropertyByDefinition(def, value); // marshal to the class property
    else
    {
-      MException::Throw(MException::ErrorSoftware, M_ERR_CANNOT_SET_READONLY_PROPERTY_S1, "Cannot set readonly property '%s'", name.c_str());
+      MException::Throw(MException::ErrorSoftware, M_ERR_CANNOT_SET_READONLY_PROPERTY_S1, "Cannot set readonly property '%s'", def->m_name);
       M_ENSURED_ASSERT(0);
    }
 }
@@ -371,13 +379,20 @@ MVariant MObject::Call(const MStdString& name, const MVariant& params)
 
 MVariant MObject::CallV(const MStdString& name, const MVariant::VariantVector& p)
 {
-   MVariant result;
    const MClass* cl = GetClass();
-   int parametersCount = int(p.size());
-   const MServiceDefinition* def = cl->GetServiceDefinition(name, parametersCount);
+   const MServiceDefinition* def = cl->GetServiceDefinition(name, int(p.size()));
    M_ENSURED_ASSERT(def != 0);
    if ( def->m_objectMethod == 0 )
-      result = cl->CallV(name, p);
+      return cl->CallV(name, p);
+   return CallByDefinition(def, p.empty() ? NULL : &p[0], static_cast<unsigned>(p.size()));
+}
+
+MVariant MObject::CallByDefinition(const MServiceDefinition* def, const MVariant* p, unsigned parametersCount)
+{
+   MVariant result;
+   M_ASSERT(def != 0);
+   if ( def->m_objectMethod == 0 )
+      result = GetClass()->CallV(def->m_name, MVariant::VariantVector(p, p + parametersCount));
    else
    {
       switch ( parametersCount )
@@ -389,7 +404,7 @@ MVariant MObject::CallV(const MStdString& name, const MVariant::VariantVector& p
             #define _M_FUNCTION0(st, type, call, par, ret) case MClass::st: call; break;
             #include "MObjectMethods.inc"
          default:
-            MClass::DoThrowServiceDoesNotHaveNParameters(name, parametersCount);
+            MClass::DoThrowServiceDoesNotHaveNParameters(def->m_name, parametersCount);
             M_ENSURED_ASSERT(0);
          }
          break;
@@ -400,7 +415,7 @@ MVariant MObject::CallV(const MStdString& name, const MVariant::VariantVector& p
             #define _M_FUNCTION1(st, type, call, par, ret) case MClass::st: call; break;
             #include "MObjectMethods.inc"
          default:
-            MClass::DoThrowServiceDoesNotHaveNParameters(name, parametersCount);
+            MClass::DoThrowServiceDoesNotHaveNParameters(def->m_name, parametersCount);
             M_ENSURED_ASSERT(0);
          }
          break;
@@ -411,7 +426,7 @@ MVariant MObject::CallV(const MStdString& name, const MVariant::VariantVector& p
             #define _M_FUNCTION2(st, type, call, par, ret) case MClass::st: call; break;
             #include "MObjectMethods.inc"
          default:
-            MClass::DoThrowServiceDoesNotHaveNParameters(name, parametersCount);
+            MClass::DoThrowServiceDoesNotHaveNParameters(def->m_name, parametersCount);
             M_ENSURED_ASSERT(0);
          }
          break;
@@ -422,7 +437,7 @@ MVariant MObject::CallV(const MStdString& name, const MVariant::VariantVector& p
             #define _M_FUNCTION3(st, type, call, par, ret) case MClass::st: call; break;
             #include "MObjectMethods.inc"
          default:
-            MClass::DoThrowServiceDoesNotHaveNParameters(name, parametersCount);
+            MClass::DoThrowServiceDoesNotHaveNParameters(def->m_name, parametersCount);
             M_ENSURED_ASSERT(0);
          }
          break;
@@ -433,7 +448,7 @@ MVariant MObject::CallV(const MStdString& name, const MVariant::VariantVector& p
             #define _M_FUNCTION4(st, type, call, par, ret) case MClass::st: call; break;
             #include "MObjectMethods.inc"
          default:
-            MClass::DoThrowServiceDoesNotHaveNParameters(name, parametersCount);
+            MClass::DoThrowServiceDoesNotHaveNParameters(def->m_name, parametersCount);
             M_ENSURED_ASSERT(0);
          }
          break;
@@ -444,7 +459,7 @@ MVariant MObject::CallV(const MStdString& name, const MVariant::VariantVector& p
             #define _M_FUNCTION5(st, type, call, par, ret) case MClass::st: call; break;
             #include "MObjectMethods.inc"
          default:
-            MClass::DoThrowServiceDoesNotHaveNParameters(name, parametersCount);
+            MClass::DoThrowServiceDoesNotHaveNParameters(def->m_name, parametersCount);
             M_ENSURED_ASSERT(0);
          }
          break;
@@ -455,12 +470,12 @@ MVariant MObject::CallV(const MStdString& name, const MVariant::VariantVector& p
             #define _M_FUNCTION6(st, type, call, par, ret) case MClass::st: call; break;
             #include "MObjectMethods.inc"
          default:
-            MClass::DoThrowServiceDoesNotHaveNParameters(name, parametersCount);
+            MClass::DoThrowServiceDoesNotHaveNParameters(def->m_name, parametersCount);
             M_ENSURED_ASSERT(0);
          }
          break;
       default:
-         MClass::DoThrowServiceDoesNotHaveNParameters(name, parametersCount);
+         MClass::DoThrowServiceDoesNotHaveNParameters(def->m_name, parametersCount);
          M_ENSURED_ASSERT(0);
       }
    }
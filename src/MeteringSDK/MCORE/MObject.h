@@ -335,6 +335,19 @@ public: // Types:
    ///
    virtual MVariant CallV(const MStdString& name, const MVariant::VariantVector& params);
 
+   /// Call the object service using the service definition resolved earlier.
+   ///
+   /// This is a C++ only call, a fast alternative to \ref CallV for the code that calls the same service many times.
+   /// The definition is resolved once with MClass::GetServiceDefinition for the given number of parameters,
+   /// after which the service is called directly, without a lookup by name.
+   /// Different from \ref CallV, this call is not virtual, and it does not work for dynamic services.
+   ///
+   /// \pre The definition shall be of a service of the class of this object or its parent,
+   /// and it shall take the given number of parameters, or the behavior is undefined.
+   /// The preconditions of the particular service apply.
+   ///
+   MVariant CallByDefinition(const MServiceDefinition* def, const MVariant* params, unsigned numberOfParameters);
+
    /// Tell if the property with the given name exists.
    ///
    virtual bool IsPropertyPresent(const MStdString& name) const;
@@ -368,6 +381,34 @@ public: // Types:
    ///
    virtual void SetProperty(const MStdString& name, const MVariant& value);
 
+   /// Get the property value using the property definition resolved earlier.
+   ///
+   /// This is a C++ only call, a fast alternative to \ref GetProperty for the code that accesses the same property many times.
+   /// The definition is resolved once with MClass::GetPropertyDefinition, and kept as a handle of the property,
+   /// after which the property getter is called directly, without a lookup by name.
+   /// Different from \ref GetProperty, this call is not virtual, and it does not work for dynamic properties.
+   /// \code
+   ///     const MPropertyDefinition* readTimeout = channel->GetClass()->GetPropertyDefinition("ReadTimeout");
+   ///     ...
+   ///     MVariant value = channel->GetPropertyByDefinition(readTimeout);
+   /// \endcode
+   ///
+   /// \pre The definition shall be of a property of the class of this object or its parent, or the behavior is undefined.
+   /// The property value should be available at the time the service is called, or the value-related exception can be thrown.
+   ///
+   MVariant GetPropertyByDefinition(const MPropertyDefinition* def) const;
+
+   /// Set the property using the property definition resolved earlier, and value.
+   ///
+   /// This is a C++ only call, a fast alternative to \ref SetProperty for the code that accesses the same property many times.
+   /// Different from \ref SetProperty, this call is not virtual, and it does not work for dynamic properties.
+   ///
+   /// \pre The definition shall be of a property of the class of this object or its parent, or the behavior is undefined.
+   /// Any value-related or object-related exception can be thrown in case the given value has wrong type, or
+   /// it is invalid, or the value cannot be set at this moment.
+   ///
+   void SetPropertyByDefinition(const MPropertyDefinition* def, const MVariant& value);
+
    /// Return the list of publicly available properties, persistent or not.
    ///
    /// \see GetAllPersistentPropertyNames for persistent properties only
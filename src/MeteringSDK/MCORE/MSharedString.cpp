@@ -3,6 +3,8 @@
 #include "MCOREExtern.h"
 #include "MSharedString.h"
 #include "MCriticalSection.h"
+#include "MThread.h"
+#include "MThreadLocalPointer.h"
 #include "MTime.h"
 
 #if !M_NO_VARIANT
@@ -777,6 +779,25 @@ string string::_op_plus_left(const char* s, size_type len) const
 }
 
 // Support for string interning
+//
+// Interned strings are kept in shards selected by the upper bits of the hash.
+// Every shard is an open addressing table with its own lock, which is taken only to add a string.
+// Lookups of the strings that are interned already take no lock at all:
+// cells and tables are published with atomic operations, a collected string is marked by a negative reference count,
+// and the memory of retired tables and of collected strings is freed only after all lookups that could see it are over.
+// A table grows incrementally, the new table takes a few cells of the previous one at every addition,
+// and until all are taken, the lookups visit both tables.
+// On top of that, every thread caches the latest interned literals, keyed by their address.
+
+#if M_NO_MULTITHREADING
+    #define M__INTERN_THREAD_CACHE 1
+    #define M__INTERN_THREAD_LOCAL
+#elif M__USE_THREAD_LOCAL_POINTER
+    #define M__INTERN_THREAD_CACHE 1
+    #define M__INTERN_THREAD_LOCAL M_THREAD_LOCAL_STORAGE_VARIABLE
+#else
+    #define M__INTERN_THREAD_CACHE 0 // no efficient thread local storage, no cache
+#endif
 
 class _intern_holder
 {
@@ -786,28 +807,121 @@ public: // Constants:
     //
     static const int hashtable_secondary_shift = 1;
 
-    // Default size of the hash table
+    // Default size of the hash table of a shard
+    //
+    static const int hashtable_default_size = 64;
+
+    // Number of shards, a power of two, and the number of upper hash bits that select the shard
+    //
+    static const unsigned shard_count = 16;
+    static const unsigned shard_bits = 4;
+
+    // Number of cells of the previous table taken by the new table at every addition
+    //
+    static const int migration_step = 8;
+
+    // Number of counters of lookups in progress, each in its own cache line, and the number of bits to select one
+    //
+    static const unsigned lookup_slot_count = 16;
+    static const unsigned lookup_slot_bits = 4;
+
+    // Number of entries in the cache of every thread, a power of two
+    //
+    static const unsigned thread_cache_size = 64;
+
+private: // Types:
+
+    // Hash table of a shard, allocated with the cells that follow the header
+    //
+    struct _table
+    {
+        int _capacity;                 // power of two
+        int _count;                    // number of strings, including the ones in the previous table not yet taken
+        _table* volatile _previous;    // table that is being taken into this one, or NULL
+        int _migrated;                 // number of cells of the previous table taken already
+        bool _collected;               // table retired by collection, its strings with negative reference count are to be freed
+        _table* _next_retired;         // next table in the list of retired tables
+        string::_buffer_type* volatile _cells [ 1 ]; // fake size
+    };
+
+    struct _shard
+    {
+        _table* volatile _current;
+        _table* _retired;              // tables no longer visible to new lookups, to be freed after the lookups are over
+        MCriticalSection _lock;        // guards additions to the shard
+    };
+
+    struct _lookup_slot
+    {
+        volatile int _counts [ 2 ];    // number of lookups in progress for every parity
+        char _padding [ 64 - 2 * sizeof(int) ];
+    };
+
+    // Lookup in progress, counted in one of the slots, so the memory it can see is not freed
     //
-    static const int hashtable_default_size = 1024;
+    class _lookup
+    {
+    public:
+        _lookup(_intern_holder* holder)
+        {
+            int local; // stack page is different for every thread, its hash gives a slot that is likely not shared
+            const unsigned slot = (static_cast<unsigned>(reinterpret_cast<size_t>(&local) >> 12) * 2654435761u) >> (32 - lookup_slot_bits);
+            _count = &holder->_lookup_slots[slot]._counts[holder->_parity & 1];
+            MInterlocked::FetchAndIncrement(_count);
+        }
+        ~_lookup()
+        {
+            MInterlocked::FetchAndDecrement(_count);
+        }
+    private:
+        volatile int* _count;
+    };
+
+#if M__INTERN_THREAD_CACHE
+    struct _cache_entry
+    {
+        const char* _source;
+        unsigned _size;
+        int _epoch;
+        string::_buffer_type* _buffer;
+    };
+    static M__INTERN_THREAD_LOCAL _cache_entry s_cache [ thread_cache_size ];
+#endif
 
 public:
 
     _intern_holder()
         :
-          _capacity(0),
-          _count(0),
-          _buffers(NULL)
-    {}
+          _parity(0),
+          _epoch(0)
+    {
+        for (unsigned s = 0; s < shard_count; ++s)
+        {
+            _shards[s]._current = NULL;
+            _shards[s]._retired = NULL;
+        }
+        memset(_lookup_slots, 0, sizeof(_lookup_slots));
+    }
 
     ~_intern_holder()
     {
-        MCriticalSection::Locker lock(_lock);
-        string::_buffer_type** it = _buffers;
-        string::_buffer_type** itEnd = _buffers + _capacity;
-        for ( ; it != itEnd; ++it )
-            if ( *it != NULL )
-                (*it)->_ref_decrement();
-        delete [] _buffers;
+        MCriticalSection::Locker lock(_collect_lock);
+        for (unsigned s = 0; s < shard_count; ++s)
+        {
+            _shard& shard = _shards[s];
+            _table* t = shard._current;
+            if (t != NULL)
+            {
+                _table* p = t->_previous;
+                if (p != NULL) // strings not taken yet hold the references in the previous table
+                    _release_cells(p, t->_migrated, p->_capacity);
+                _release_cells(t, 0, t->_capacity);
+                if (p != NULL)
+                    _delete_table(p);
+                _delete_table(t);
+            }
+            _free_retired(shard._retired);
+        }
     }
 
     void add(string& str)
@@ -823,18 +937,15 @@ public:
             return; // empty string should not be interned into a hash table
         }
         SSTL_ASSERT(buff->_hash == 0); // otherwise we would not be here
-        buff->_hash = string::static_hash(buff->_bytes, buff->_size);
-
-        MCriticalSection::Locker lock(_lock);
-        string::_buffer_type** cell = find_cell_for_addition(buff->_hash, buff->_bytes, buff->_size);
-        if (*cell != NULL)
+        const unsigned hash = string::static_hash(buff->_bytes, buff->_size);
+        string::_buffer_type* found = _find(hash, buff->_bytes, buff->_size);
+        if (found == NULL)
+            found = _add_locked(hash, buff->_bytes, buff->_size, buff);
+        if (found != buff)
         {
             buff->_ref_decrement();
-            str._bytes = (*cell)->_bytes;
+            str._bytes = found->_bytes;
         }
-        else
-            *cell = buff;
-        (*cell)->_ref_increment();
     }
 
     string::_buffer_type* add(const char* str, unsigned size)
@@ -845,35 +956,77 @@ public:
             return &string::_empty_string_buffer; // special value, always interned
         }
 
-        unsigned hash = string::static_hash(str, size);
-
-        MCriticalSection::Locker lock(_lock);
-        string::_buffer_type** cell =  find_cell_for_addition(hash, str, size);
-        if (*cell == NULL)
+#if M__INTERN_THREAD_CACHE
+        _cache_entry& entry = s_cache[(static_cast<unsigned>(reinterpret_cast<size_t>(str) >> 2) ^ size) & (thread_cache_size - 1)];
+        if (entry._source == str && entry._size == size)
         {
-            string::_buffer_type* buff = string::_new_uninitialized_buffer(size, _adjust_capacity(size));
-            memcpy(buff->_bytes, str, size);
-            buff->_hash = hash;
-            *cell = buff;
+            _lookup lookup(this);
+            if (entry._epoch == _epoch) // otherwise the buffer could be collected
+            {
+                string::_buffer_type* b = entry._buffer;
+                if (memcmp(b->_bytes, str, size) == 0 && _try_acquire(b))
+                    return b;
+            }
         }
+#endif
 
-        (*cell)->_ref_increment();
-        return *cell;
+#if M__INTERN_THREAD_CACHE
+        const int epoch = _epoch; // taken before the reference is acquired, so the collection of the buffer changes it
+#endif
+        const unsigned hash = string::static_hash(str, size);
+        string::_buffer_type* result = _find(hash, str, size);
+        if (result == NULL)
+            result = _add_locked(hash, str, size, NULL);
+
+#if M__INTERN_THREAD_CACHE
+        entry._source = str;
+        entry._size = size;
+        entry._epoch = epoch;
+        entry._buffer = result;
+#endif
+        return result;
     }
 
     void OptimizeAndGarbageCollect()
     {
-        if (_count != 0)
+        MCriticalSection::Locker collectLock(_collect_lock);
+        _table* retired [ shard_count ];
+        for (unsigned s = 0; s < shard_count; ++s)
         {
-            MCriticalSection::Locker lock(_lock);
-            resize(_capacity);
+            _shard& shard = _shards[s];
+            MCriticalSection::Locker lock(shard._lock);
+            _table* t = shard._current;
+            if (t != NULL)
+            {
+                _migrate(shard, t, t->_capacity); // take all the cells of the previous table, if any
+
+                _table* n = _new_table(t->_capacity);
+                string::_buffer_type* const* it = const_cast<string::_buffer_type* const*>(t->_cells);
+                string::_buffer_type* const* itEnd = it + t->_capacity;
+                for (; it != itEnd; ++it)
+                {
+                    string::_buffer_type* buff = *it;
+                    if (buff == NULL)
+                        continue;
+                    SSTL_ASSERT(buff->_hash != 0);
+                    if (buff->_ref_count == 0 && MInterlocked::CompareAndExchange(&buff->_ref_count, 0, -1) == 0)
+                        continue; // orphaned item, collected, and it will be freed with the retired table
+                    _insert_cell(n, buff);
+                    ++n->_count;
+                }
+                MInterlocked::CompareAndExchangePointer(reinterpret_cast<void* volatile*>(&shard._current), t, n);
+                t->_collected = true;
+                _retire(shard, t);
+            }
+            retired[s] = shard._retired; // tables retired after this point can still be seen by the lookups
+            shard._retired = NULL;
         }
+        MInterlocked::FetchAndIncrement(&_epoch); // entries of thread caches can refer to the collected strings
+        _wait_for_lookups();
+        for (unsigned s = 0; s < shard_count; ++s)
+            _free_retired(retired[s]);
     }
 
-    void resize(int new_capacity);
-
-    string::_buffer_type** find_cell_for_addition(unsigned hash, const char* bytes, unsigned size);
-
     static _intern_holder* get_global()
     {
         static _intern_holder holder;
@@ -882,95 +1035,226 @@ public:
 
 private:
 
-    int _capacity; // has to be power of two
-    int _count;
-    string::_buffer_type** _buffers;
-    MCriticalSection _lock;
-};
+    _shard& _get_shard(unsigned hash)
+    {
+        return _shards[hash >> (32 - shard_bits)];
+    }
 
-string::_buffer_type** _intern_holder::find_cell_for_addition(unsigned hash, const char* bytes, unsigned size)
-{
-    if (_capacity <= (_count << 1))
-        resize(_capacity == 0 ? hashtable_default_size : _capacity + _capacity);
+    // Acquire a reference to the buffer, unless it is collected
+    //
+    static bool _try_acquire(string::_buffer_type* buff)
+    {
+        for (;;)
+        {
+            const int count = buff->_ref_count;
+            if (count < 0)
+                return false;
+            if (MInterlocked::CompareAndExchange(&buff->_ref_count, count, count + 1) == count)
+                return true;
+        }
+    }
+
+    static string::_buffer_type* _probe(const _table* t, unsigned hash, const char* bytes, unsigned size)
+    {
+        int index = static_cast<int>(hash & (t->_capacity - 1u)); // normalize hash into index
+        for (;;)
+        {
+            string::_buffer_type* b = t->_cells[index];
+            if (b == NULL)
+                return NULL;
+            if (b->_hash == hash && b->_size == size && memcmp(b->_bytes, bytes, size) == 0)
+                return b;
+
+            // Otherwise calculate the second-grade hash value, derivative from one given
+            index -= hashtable_secondary_shift;
+            if (index < 0) // assume proper overflow behavior...
+                index += t->_capacity;
+        }
+    }
+
+    // Lock-free lookup, return the interned buffer with reference acquired, or NULL
+    //
+    string::_buffer_type* _find(unsigned hash, const char* bytes, unsigned size)
+    {
+        _lookup lookup(this);
+        for (const _table* t = _get_shard(hash)._current; t != NULL; t = t->_previous)
+        {
+            string::_buffer_type* b = _probe(t, hash, bytes, size);
+            if (b != NULL)
+                return _try_acquire(b) ? b : NULL;
+        }
+        return NULL;
+    }
 
-    int index = static_cast<int>(hash & (_capacity - 1u)); // normalize hash into index
-    string::_buffer_type** bb;
-    for (;;)
+    // Lookup or addition under the shard lock, return the interned buffer with reference acquired.
+    // When the buffer is given, it is added to the table if there is no such string already.
+    //
+    string::_buffer_type* _add_locked(unsigned hash, const char* bytes, unsigned size, string::_buffer_type* buff)
     {
-        bb = &_buffers[index];
-        const string::_buffer_type* b = *bb;
-        if ( b == NULL )
+        _shard& shard = _get_shard(hash);
+        MCriticalSection::Locker lock(shard._lock);
+        _table* t = shard._current;
+        for (const _table* i = t; i != NULL; i = i->_previous)
+        {
+            string::_buffer_type* b = _probe(i, hash, bytes, size);
+            if (b != NULL)
+            {
+                SSTL_ASSERT(b->_ref_count >= 0); // collected strings are never in the current tables
+                b->_ref_increment();
+                return b;
+            }
+        }
+
+        if (t == NULL || t->_capacity <= ((t->_count + 1) << 1))
+        {
+            int capacity = hashtable_default_size;
+            if (t != NULL)
+            {
+                _migrate(shard, t, t->_capacity); // take the rest of the previous table, not likely to be there
+                capacity = t->_capacity + t->_capacity;
+            }
+            _table* n = _new_table(capacity);
+            if (t != NULL)
+            {
+                n->_count = t->_count;
+                n->_previous = t;
+            }
+            MInterlocked::CompareAndExchangePointer(reinterpret_cast<void* volatile*>(&shard._current), t, n);
+            t = n;
+        }
+
+        if (buff == NULL)
         {
-            ++_count;  // we know there will be a new item
-            return bb;  // empty place to add the new item
+            buff = string::_new_uninitialized_buffer(size, _adjust_capacity(size));
+            memcpy(buff->_bytes, bytes, size);
         }
-        if ( b->_hash == hash && b->_size == size && memcmp(b->_bytes, bytes, size) == 0 )
-            return bb;  // the same item is found
+        buff->_hash = hash;
+        buff->_ref_increment(); // the table holds one reference, and the result holds the other
+        _insert_cell(t, buff);
+        ++t->_count;
+        _migrate(shard, t, migration_step);
+        return buff;
+    }
 
-        // Otherwise calculate the second-grade hash value, derivative from one given
-        index -= hashtable_secondary_shift;
-        if ( index < 0 ) // assume proper overflow behavior...
-            index += _capacity;
+    // Publish the buffer in the first free cell of the table
+    //
+    static void _insert_cell(_table* t, string::_buffer_type* buff)
+    {
+        int index = static_cast<int>(buff->_hash & (t->_capacity - 1u)); // normalize hash into index
+        while (t->_cells[index] != NULL)
+        {
+            index -= hashtable_secondary_shift;
+            if (index < 0)
+                index += t->_capacity;
+        }
+        MInterlocked::CompareAndExchangePointer(reinterpret_cast<void* volatile*>(&t->_cells[index]), NULL, buff);
     }
-}
 
-void _intern_holder::resize(int new_capacity)
-{
-    SSTL_ASSERT(new_capacity >= _capacity);
-    SSTL_ASSERT((new_capacity & (new_capacity - 1)) == 0); // newCapacity is the power of two
+    // Take the given number of cells from the previous table, and retire it once all are taken
+    //
+    void _migrate(_shard& shard, _table* t, int cells)
+    {
+        _table* p = t->_previous;
+        if (p == NULL)
+            return;
+        int end = t->_migrated + cells;
+        if (end > p->_capacity)
+            end = p->_capacity;
+        for (int i = t->_migrated; i < end; ++i)
+        {
+            string::_buffer_type* buff = p->_cells[i];
+            if (buff != NULL)
+                _insert_cell(t, buff);
+        }
+        t->_migrated = end;
+        if (end == p->_capacity)
+        {
+            t->_previous = NULL;
+            _retire(shard, p);
+        }
+    }
 
-    string::_buffer_type** new_buffers = M_NEW string::_buffer_type*[new_capacity];
+    static _table* _new_table(int capacity)
+    {
+        SSTL_ASSERT((capacity & (capacity - 1)) == 0); // capacity is the power of two
+        const size_t table_sizeof = sizeof(_table) + (capacity - 1) * sizeof(string::_buffer_type*);
+        _table* t = reinterpret_cast<_table*>(M_NEW char[table_sizeof]);
+        memset(t, 0, table_sizeof);
+        t->_capacity = capacity;
+        return t;
+    }
 
-    string::_buffer_type** i = new_buffers;
-    string::_buffer_type** i_end = new_buffers + new_capacity;
-    for (; i != i_end; ++i)
-        *i = NULL;
+    static void _delete_table(_table* t)
+    {
+        delete [] reinterpret_cast<char*>(t);
+    }
 
-    if (_count != 0)
+    static void _release_cells(_table* t, int begin, int end)
     {
-        int new_count = 0;
-        i = _buffers;
-        i_end = _buffers + _capacity;
-        for (; i != i_end; ++i)
+        for (int i = begin; i < end; ++i)
         {
-            string::_buffer_type* buff = *i;
+            string::_buffer_type* buff = t->_cells[i];
             if (buff != NULL)
+                buff->_ref_decrement();
+        }
+    }
+
+    static void _retire(_shard& shard, _table* t)
+    {
+        t->_next_retired = shard._retired;
+        shard._retired = t;
+    }
+
+    // Free the list of retired tables, and the strings collected with them.
+    // This is only done when no lookup can see them.
+    //
+    static void _free_retired(_table* t)
+    {
+        while (t != NULL)
+        {
+            _table* next = t->_next_retired;
+            if (t->_collected)
             {
-                SSTL_ASSERT(buff->_hash != 0);
-                if (buff->_ref_count == 0) // orphaned item to garbage collect
-                    delete [] buff;
-                else
+                string::_buffer_type* const* it = const_cast<string::_buffer_type* const*>(t->_cells);
+                string::_buffer_type* const* itEnd = it + t->_capacity;
+                for (; it != itEnd; ++it)
+                    if (*it != NULL && (*it)->_ref_count < 0)
+                        delete [] reinterpret_cast<char*>(*it);
+            }
+            _delete_table(t);
+            t = next;
+        }
+    }
+
+    // Wait for all lookups that started before this call, the collection lock is held.
+    // Lookups are counted by parity, which flips twice, so the lookups that start during the wait do not delay it.
+    //
+    void _wait_for_lookups()
+    {
+        for (int flip = 0; flip < 2; ++flip)
+        {
+            const int parity = _parity;
+            MInterlocked::CompareAndExchange(&_parity, parity, parity ^ 1);
+            for (unsigned slot = 0; slot < lookup_slot_count; ++slot)
+                while (_lookup_slots[slot]._counts[parity & 1] != 0)
                 {
-                    SSTL_ASSERT(buff->_ref_count > 0);
-
-                    int index = static_cast<int>(buff->_hash & (_capacity - 1u)); // normalize hash into index
-                    string::_buffer_type** bb;
-                    for (;;)
-                    {
-                        bb = &_buffers[index];
-                        const string::_buffer_type* b = *bb;
-                        if (b == NULL)
-                        {
-                            *bb = buff; // relocate
-                            ++new_count;
-                            break;
-                        }
-
-                        // Otherwise calculate the second-grade hash value, derivative from one given
-                        index -= hashtable_secondary_shift;
-                        if ( index < 0 ) // assume proper overflow behavior...
-                            index += _capacity;
-                    }
+#if !M_NO_MULTITHREADING
+                    MThread::Relinquish();
+#endif
                 }
-            }
         }
-        SSTL_ASSERT(_count >= new_count);
-        _count = new_count;
     }
-    delete [] _buffers;
-    _buffers = new_buffers;
-    _capacity = new_capacity;
-}
+
+    _shard _shards [ shard_count ];
+    _lookup_slot _lookup_slots [ lookup_slot_count ];
+    volatile int _parity;      // parity of the counters for the new lookups
+    volatile int _epoch;       // incremented at every collection
+    MCriticalSection _collect_lock;
+};
+
+#if M__INTERN_THREAD_CACHE
+    M__INTERN_THREAD_LOCAL _intern_holder::_cache_entry _intern_holder::s_cache [ _intern_holder::thread_cache_size ];
+#endif
 
 void string::intern()
 {
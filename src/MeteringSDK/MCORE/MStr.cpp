@@ -8,6 +8,10 @@
 #include "MCriticalSection.h"
 #include "MMath.h"
 
+#ifndef M_USE_USTL
+   #include <cfloat>
+#endif
+
    #if !M_NO_REFLECTION
 
       inline bool IsTypeByte(const MVariant& s)
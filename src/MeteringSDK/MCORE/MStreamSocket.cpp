@@ -6,9 +6,14 @@
 #include "MUtilities.h"
 #include "MCriticalSection.h"
 #include "MAlgorithm.h"
+#include "MTimer.h"
 
 #if !M_NO_SOCKETS
 
+#if (M_OS & M_OS_POSIX) != 0
+   #include <sys/uio.h>
+#endif
+
 #if (M_OS & M_OS_ANDROID) != 0
 //   #include <ifaddrs.h>
    #include <sys/ioctl.h>
@@ -317,6 +322,7 @@ M_START_PROPERTIES(StreamSocket)
    M_OBJECT_PROPERTY_BOOL               (StreamSocket, NoDelay)
    M_OBJECT_PROPERTY_INT                (StreamSocket, SendBufferSize)
    M_OBJECT_PROPERTY_INT                (StreamSocket, ReceiveBufferSize)
+   M_CLASS_PROPERTY_UINT                (StreamSocket, AddressCacheTimeout)
 M_START_METHODS(StreamSocket)
    M_CLASS_FRIEND_SERVICE               (StreamSocket, New,                DoNew,                  ST_MObjectP_S)
    M_OBJECT_SERVICE                     (StreamSocket, Connect,                                    ST_X_unsigned_constMStdStringA)
@@ -329,6 +335,7 @@ M_START_METHODS(StreamSocket)
    M_OBJECT_SERVICE                     (StreamSocket, TimedAccept,                                ST_bool_X_MObjectP_unsigned)
    M_OBJECT_SERVICE                     (StreamSocket, Swap,                                       ST_X_MObjectP)
    M_OBJECT_SERVICE                     (StreamSocket, SetLinger,                                  ST_X_bool_int)
+   M_CLASS_SERVICE                      (StreamSocket, ClearAddressCache,                          ST_S)
 M_END_CLASS(StreamSocket, StreamSocketBase)
 
 MStreamSocket::MStreamSocket(SocketHandleType sockfd)
@@ -441,94 +448,349 @@ void MStreamSocket::Swap(MStreamSocket& other)
    std::swap(m_receiveTimeout, other.m_receiveTimeout);
 }
 
+namespace
+{
+
+   // Server address resolved by getaddrinfo, as kept in the address cache
+   //
+   struct ResolvedAddress
+   {
+      struct sockaddr_storage m_address;
+      socklen_t m_addressLength;
+      int m_family;
+      int m_socktype;
+      int m_protocol;
+   };
+   typedef std::vector<ResolvedAddress>
+      ResolvedAddressVector;
+
+   // Address cache entry, addresses of a single server and port
+   //
+   struct AddressCacheEntry
+   {
+      ResolvedAddressVector m_addresses;
+      Muint64 m_expirationTick;
+   };
+   typedef std::map<MStdString, AddressCacheEntry>
+      AddressCacheMap;
+
+   static MCriticalSection s_addressCacheCriticalSection;
+   static AddressCacheMap s_addressCache;
+   static unsigned s_addressCacheTimeout = MStreamSocket::AddressCacheTimeoutDefault;
+
+   // Numeric IP literals do not need to be resolved, and they are not cached.
+   // IPv6 literals always have a colon, which is never a part of a host name.
+   //
+   inline bool IsAddressNumeric(const MStdString& address)
+   {
+      return address.find(':') != MStdString::npos || address.find_first_not_of("0123456789.") == MStdString::npos;
+   }
+
+   inline MStdString MakeAddressCacheKey(const MStdString& address, const char* servname)
+   {
+      MStdString key = address;
+      key += '/';
+      key += servname;
+      return key;
+   }
+
+   bool DoFindCachedAddresses(const MStdString& key, ResolvedAddressVector& addresses)
+   {
+      MCriticalSection::Locker locker(s_addressCacheCriticalSection);
+      AddressCacheMap::iterator it = s_addressCache.find(key);
+      if ( it == s_addressCache.end() )
+         return false;
+      if ( static_cast<Mint64>(it->second.m_expirationTick - MTimer::GetTickCount64()) <= 0 )
+      {
+         s_addressCache.erase(it);
+         return false;
+      }
+      addresses = it->second.m_addresses;
+      return true;
+   }
+
+   void DoStoreCachedAddresses(const MStdString& key, const ResolvedAddressVector& addresses)
+   {
+      MCriticalSection::Locker locker(s_addressCacheCriticalSection);
+      if ( s_addressCacheTimeout != 0 )
+      {
+         AddressCacheEntry& entry = s_addressCache[key];
+         entry.m_addresses = addresses;
+         entry.m_expirationTick = MTimer::GetTickCount64() + static_cast<Muint64>(s_addressCacheTimeout) * 1000u;
+      }
+   }
+
+   // Move the address that was successfully connected to the front,
+   // so the next connection to the same server tries it first
+   //
+   void DoPromoteCachedAddress(const MStdString& key, const ResolvedAddress& address)
+   {
+      MCriticalSection::Locker locker(s_addressCacheCriticalSection);
+      AddressCacheMap::iterator it = s_addressCache.find(key);
+      if ( it != s_addressCache.end() )
+      {
+         ResolvedAddressVector& addresses = it->second.m_addresses;
+         for ( ResolvedAddressVector::iterator a = addresses.begin(); a != addresses.end(); ++a )
+         {
+            if ( a->m_addressLength == address.m_addressLength && memcmp(&a->m_address, &address.m_address, address.m_addressLength) == 0 )
+            {
+               std::rotate(addresses.begin(), a, a + 1);
+               break;
+            }
+         }
+      }
+   }
+
+   inline void DoEraseCachedAddresses(const MStdString& key)
+   {
+      MCriticalSection::Locker locker(s_addressCacheCriticalSection);
+      s_addressCache.erase(key);
+   }
+
+   // Reorder addresses so that address families alternate, starting from the family
+   // of the first address returned by the resolver, as recommended by RFC 8305
+   //
+   void DoInterleaveAddressFamilies(ResolvedAddressVector& addresses)
+   {
+      if ( addresses.size() > 2 )
+      {
+         ResolvedAddressVector preferred;
+         ResolvedAddressVector others;
+         const int preferredFamily = addresses[0].m_family;
+         for ( ResolvedAddressVector::const_iterator it = addresses.begin(); it != addresses.end(); ++it )
+         {
+            if ( it->m_family == preferredFamily )
+               preferred.push_back(*it);
+            else
+               others.push_back(*it);
+         }
+         if ( !others.empty() )
+         {
+            addresses.clear();
+            ResolvedAddressVector::const_iterator p = preferred.begin();
+            ResolvedAddressVector::const_iterator o = others.begin();
+            while ( p != preferred.end() || o != others.end() )
+            {
+               if ( p != preferred.end() )
+                  addresses.push_back(*p++);
+               if ( o != others.end() )
+                  addresses.push_back(*o++);
+            }
+         }
+      }
+   }
+
+}
+
+unsigned MStreamSocket::GetAddressCacheTimeout()
+{
+   MCriticalSection::Locker locker(s_addressCacheCriticalSection);
+   return s_addressCacheTimeout;
+}
+
+void MStreamSocket::SetAddressCacheTimeout(unsigned seconds)
+{
+   MCriticalSection::Locker locker(s_addressCacheCriticalSection);
+   s_addressCacheTimeout = seconds;
+   if ( seconds == 0 )
+      s_addressCache.clear();
+}
+
+void MStreamSocket::ClearAddressCache()
+{
+   MCriticalSection::Locker locker(s_addressCacheCriticalSection);
+   s_addressCache.clear();
+}
+
 void MStreamSocket::ConnectInterruptible(unsigned port, const MStdString& address, OperationHandler* oph)
 {
+   // Connection attempts that are in progress, closed on destruction
+   //
+   struct PendingAttempts
+   {
+      std::vector<SocketHandleType> m_handles;
+      std::vector<size_t> m_addressIndexes;
+
+      ~PendingAttempts()
+      {
+         for ( std::vector<SocketHandleType>::const_iterator it = m_handles.begin(); it != m_handles.end(); ++it )
+            MStreamSocketBase::DoOsClose(*it);
+      }
+
+      void Remove(size_t i)
+      {
+         m_handles.erase(m_handles.begin() + i);
+         m_addressIndexes.erase(m_addressIndexes.begin() + i);
+      }
+   };
+
    Close();
    M_ASSERT(InvalidSocket == m_socketHandle);
 
    DoStartOpen(FlagReadWrite);
 
-   struct addrinfo hints;
-   memset(&hints, 0, sizeof(hints));
-   hints.ai_socktype = SOCK_STREAM;
-   hints.ai_flags = AI_NUMERICSERV;
-
    try
    {
-      hints.ai_family = (address.empty() || IsAddressLocalIPv4(address))
-                      ? AF_INET
-                      : AF_UNSPEC;
-
-      const char* const hostname = address.c_str();
-
       char servname[NI_MAXSERV];
       MFormat(servname, sizeof(servname), "%d", port);
 
-      OsAddrinfoHolder aih;
-      DoOsGetaddrinfo(hostname, servname, &hints, &aih.m_pointer);
+      const bool cacheable = !IsAddressNumeric(address) && GetAddressCacheTimeout() != 0;
+      const MStdString key = cacheable ? MakeAddressCacheKey(address, servname) : MStdString();
 
-      bool rethrow = false;
-      for ( struct addrinfo* ai = aih.m_pointer; ai != NULL; ai = ai->ai_next )
+      ResolvedAddressVector addresses;
+      if ( !cacheable || !DoFindCachedAddresses(key, addresses) )
       {
-         try
+         struct addrinfo hints;
+         memset(&hints, 0, sizeof(hints));
+         hints.ai_socktype = SOCK_STREAM;
+         hints.ai_flags = AI_NUMERICSERV;
+         hints.ai_family = (address.empty() || IsAddressLocalIPv4(address))
+                         ? AF_INET
+                         : AF_UNSPEC;
+
+         OsAddrinfoHolder aih;
+         DoOsGetaddrinfo(address.c_str(), servname, &hints, &aih.m_pointer);
+         for ( struct addrinfo* ai = aih.m_pointer; ai != NULL; ai = ai->ai_next )
          {
-            OsSocketHandleHolder sh;
-
+            if ( ai->ai_addr == NULL || ai->ai_addrlen > sizeof(sockaddr_storage) )
+               continue;
             DoAdjustAddress(ai);
 
-            sh.m_socketHandle = DoOsSocket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
-            DoSetNonBlocking(sh.m_socketHandle, true);
+            ResolvedAddress resolved;
+            memset(&resolved.m_address, 0, sizeof(resolved.m_address));
+            memcpy(&resolved.m_address, ai->ai_addr, ai->ai_addrlen);
+            resolved.m_addressLength = static_cast<socklen_t>(ai->ai_addrlen);
+            resolved.m_family = ai->ai_family;
+            resolved.m_socktype = ai->ai_socktype;
+            resolved.m_protocol = ai->ai_protocol;
+            addresses.push_back(resolved);
+         }
+         DoInterleaveAddressFamilies(addresses);
+         if ( cacheable && !addresses.empty() )
+            DoStoreCachedAddresses(key, addresses);
+      }
+
+      PendingAttempts pending;
+      MUniquePtr<MException> lastError;
+      size_t nextAddressIndex = 0;
+      Muint64 nextAttemptTick = MTimer::GetTickCount64();
+      for ( ;; )
+      {
+         if ( oph != NULL )
+            oph->CheckIfCancelled();
 
-         #if M_OS & M_OS_POSIX
-         BEGIN:
-         #endif
-            const int res = ::connect(sh.m_socketHandle, ai->ai_addr, static_cast<socklen_t>(ai->ai_addrlen));
-            if ( SocketErrorStatus == res )
+         // Start the next attempt when it is time, or when there are no attempts in progress
+         //
+         const Muint64 now = MTimer::GetTickCount64();
+         if ( nextAddressIndex < addresses.size() && (pending.m_handles.empty() || now >= nextAttemptTick) )
+         {
+            const ResolvedAddress& resolved = addresses[nextAddressIndex];
+            try
             {
-         #if M_OS & M_OS_POSIX
-               if ( EINTR == errno )
-                  goto BEGIN;
-               if ( errno != EINPROGRESS )
-               {
-                  MESocketError::ThrowLastSocketError();
-                  M_ENSURED_ASSERT(0);
-               }
-         #else // windows
-               const int err = ::WSAGetLastError();
-               if ( WSAEWOULDBLOCK != err && WSAEINPROGRESS != err )
-               {
-                  MESocketError::ThrowLastSocketError();
-                  M_ENSURED_ASSERT(0);
-               }
-         #endif
-               while ( !DoNonBlockingConnectionWait(sh.m_socketHandle, 1000) )
+               OsSocketHandleHolder sh;
+               sh.m_socketHandle = DoOsSocket(resolved.m_family, resolved.m_socktype, resolved.m_protocol);
+               DoSetNonBlocking(sh.m_socketHandle, true);
+
+            #if M_OS & M_OS_POSIX
+            BEGIN:
+            #endif
+               const int res = ::connect(sh.m_socketHandle, reinterpret_cast<const struct sockaddr*>(&resolved.m_address), resolved.m_addressLength);
+               if ( SocketErrorStatus == res )
                {
-                  if ( oph )
+            #if M_OS & M_OS_POSIX
+                  if ( EINTR == errno )
+                     goto BEGIN;
+                  if ( errno != EINPROGRESS )
                   {
-                     try
-                     {
-                        oph->CheckIfCancelled();
-                     }
-                     catch ( ... )
-                     {
-                        rethrow = true;
-                        throw;
-                     }
+                     MESocketError::ThrowLastSocketError();
+                     M_ENSURED_ASSERT(0);
                   }
+            #else // windows
+                  const int err = ::WSAGetLastError();
+                  if ( WSAEWOULDBLOCK != err && WSAEINPROGRESS != err )
+                  {
+                     MESocketError::ThrowLastSocketError();
+                     M_ENSURED_ASSERT(0);
+                  }
+            #endif
                }
+               pending.m_handles.push_back(sh.m_socketHandle);
+               pending.m_addressIndexes.push_back(nextAddressIndex);
+               sh.m_socketHandle = InvalidSocket;
+            }
+            catch ( MException& ex )
+            {
+               lastError.reset(ex.NewClone());
             }
+            ++nextAddressIndex;
+            nextAttemptTick = now + ConnectionAttemptDelay;
+            continue; // check for cancellation, and possibly start another attempt immediately if this one failed
+         }
 
-            const struct linger option = {1, 60}; // linger for 60 seconds on close
-            DoOsSetsockopt(sh.m_socketHandle, SOL_SOCKET, SO_LINGER, &option, sizeof(option));
-            m_socketHandle = sh.m_socketHandle;
-            sh.m_socketHandle = InvalidSocket;
-            break;
+         if ( pending.m_handles.empty() ) // all addresses were tried, and all attempts failed
+         {
+            if ( cacheable )
+               DoEraseCachedAddresses(key);
+            if ( lastError.get() == NULL ) // resolver returned no usable addresses
+            {
+               DoThrowBadIpAddress();
+               M_ENSURED_ASSERT(0);
+            }
+            lastError->Rethrow();
+            M_ENSURED_ASSERT(0);
          }
-         catch ( ... )
+
+         // Wait for any of the pending attempts, but not longer than the next attempt is due
+         //
+         unsigned waitTime = 1000;
+         if ( nextAddressIndex < addresses.size() && nextAttemptTick - now < waitTime )
+            waitTime = static_cast<unsigned>(nextAttemptTick - now);
+
+         fd_set rfds, wfds, efds;
+         FD_ZERO(&rfds);
+         FD_ZERO(&wfds);
+         FD_ZERO(&efds);
+         int nfds = 0;
+         for ( std::vector<SocketHandleType>::const_iterator it = pending.m_handles.begin(); it != pending.m_handles.end(); ++it )
+         {
+            FD_SET(*it, &rfds);
+            FD_SET(*it, &wfds);
+            FD_SET(*it, &efds);
+            if ( static_cast<int>(*it) >= nfds )
+               nfds = static_cast<int>(*it) + 1;
+         }
+         if ( DoOsSelect(nfds, &rfds, &wfds, &efds, waitTime) == 0 )
+            continue;
+
+         for ( size_t i = 0; i < pending.m_handles.size(); )
          {
-            if ( ai->ai_next == NULL || rethrow )
-               throw;
+            const SocketHandleType handle = pending.m_handles[i];
+            bool connected = false;
+            try
+            {
+               connected = DoNonBlockingConnectionWait(handle, 0);
+            }
+            catch ( MException& ex )
+            {
+               lastError.reset(ex.NewClone());
+               DoOsClose(handle);
+               pending.Remove(i);
+               continue;
+            }
+            if ( connected )
+            {
+               const struct linger option = {1, 60}; // linger for 60 seconds on close
+               DoOsSetsockopt(handle, SOL_SOCKET, SO_LINGER, &option, sizeof(option));
+               m_socketHandle = handle;
+               if ( cacheable )
+                  DoPromoteCachedAddress(key, addresses[pending.m_addressIndexes[i]]);
+               pending.Remove(i); // the rest of attempts will be closed by the destructor
+               break;
+            }
+            ++i;
          }
+         if ( m_socketHandle != InvalidSocket )
+            break;
       }
    }
    catch ( ... )
@@ -837,6 +1099,120 @@ void MStreamSocket::DoWriteBytesImpl(const char* buf, unsigned len)
    }
 }
 
+void MStreamSocket::WriteBuffers(const Fragment* fragments, unsigned count, bool more)
+{
+#ifdef MSG_MORE
+   if ( m_processor != NULL || count == 0 || (count == 1 && !more) ) // a single fragment goes through sendmsg too when it needs MSG_MORE
+#else
+   if ( m_processor != NULL || count <= 1 ) // there is no hint to give, a single fragment is a plain write
+#endif
+   {
+      MStreamSocketBase::WriteBuffers(fragments, count, more);
+      return;
+   }
+
+   DoPrepareForOp(STREAMOP_WRITE);
+
+   // Fragments are sent in groups that fit into the local descriptor array,
+   // all groups except the last one are sent with a hint that more data follows.
+   //
+   const unsigned maximumGroupSize = 16u;
+#if (M_OS & M_OS_WINDOWS) != 0
+   WSABUF vector [ maximumGroupSize ];
+#else
+   iovec vector [ maximumGroupSize ];
+#endif
+   while ( count > 0 )
+   {
+      unsigned groupSize = count < maximumGroupSize ? count : maximumGroupSize;
+      for ( unsigned i = 0; i < groupSize; ++i )
+      {
+#if (M_OS & M_OS_WINDOWS) != 0
+         vector[i].buf = const_cast<CHAR*>(fragments[i].m_buffer);
+         vector[i].len = static_cast<ULONG>(fragments[i].m_size);
+#else
+         vector[i].iov_base = const_cast<char*>(fragments[i].m_buffer);
+         vector[i].iov_len = static_cast<size_t>(fragments[i].m_size);
+#endif
+      }
+      fragments += groupSize;
+      count -= groupSize;
+
+      int flags = 0;
+#ifdef MSG_MORE
+      if ( more || count > 0 )
+         flags |= MSG_MORE;
+#endif
+#ifdef MSG_NOSIGNAL // Linux
+      flags |= MSG_NOSIGNAL | MSG_DONTWAIT;
+#elif (M_OS & M_OS_LINUX) != 0 // something is wrong, Linux does not have MSG_NOSIGNAL
+      #error "Linux is expected to have MSG_NOSIGNAL"
+#endif
+
+      unsigned first = 0; // first descriptor in the group that still has bytes to send
+      while ( first < groupSize )
+      {
+#if (M_OS & M_OS_WINDOWS) != 0
+         DWORD sent = 0;
+         int res = ::WSASend(m_socketHandle, vector + first, static_cast<DWORD>(groupSize - first), &sent, static_cast<DWORD>(flags), NULL, NULL);
+         if ( res == 0 )
+            res = static_cast<int>(sent);
+#else
+         msghdr message;
+         memset(&message, 0, sizeof(message));
+         message.msg_iov = vector + first;
+         message.msg_iovlen = groupSize - first;
+         const ssize_t res = ::sendmsg(m_socketHandle, &message, flags);
+#endif
+         if ( res < 0 )
+         {
+            int err = MESocketError::GetLastGlobalSocketError();
+            if ( EWOULDBLOCK == err 
+#if (M_OS & M_OS_WINDOWS) != 0
+                 || WSAEWOULDBLOCK == err
+#endif
+               )
+            {
+               if ( WaitToSend(m_receiveTimeout) )
+                  continue;
+               MESocketError::ThrowSocketReadTimeout();
+               M_ENSURED_ASSERT(0);
+            }
+   #if M_OS & M_OS_POSIX
+            else if ( EINTR == err || EAGAIN == err )
+               continue;
+   #endif
+            MESocketError::ThrowLastSocketError();
+            M_ENSURED_ASSERT(0);
+         }
+
+         // Skip the descriptors sent completely, and adjust the one sent partially
+         //
+         size_t remaining = static_cast<size_t>(res);
+         for ( ; first < groupSize; ++first )
+         {
+#if (M_OS & M_OS_WINDOWS) != 0
+            size_t length = vector[first].len;
+#else
+            size_t length = vector[first].iov_len;
+#endif
+            if ( remaining < length )
+            {
+#if (M_OS & M_OS_WINDOWS) != 0
+               vector[first].buf += remaining;
+               vector[first].len -= static_cast<ULONG>(remaining);
+#else
+               vector[first].iov_base = static_cast<char*>(vector[first].iov_base) + remaining;
+               vector[first].iov_len -= remaining;
+#endif
+               break;
+            }
+            remaining -= length;
+         }
+      }
+   }
+}
+
 MStdString MStreamSocket::GetName() const
 {
    MStdString result;
@@ -48,6 +48,20 @@ public:
       virtual void CheckIfCancelled() = 0;
    };
 
+public:
+
+   /// Delay in milliseconds between staggered connection attempts made by ConnectInterruptible.
+   ///
+   /// When the server name resolves into multiple addresses, the next address is tried
+   /// if none of the previous attempts succeeded within this time. The previous attempts are not abandoned,
+   /// and the first connection to get established wins, as recommended by RFC 8305, Happy Eyeballs.
+   ///
+   static const unsigned ConnectionAttemptDelay = 250;
+
+   /// Default number of seconds the resolved server addresses are kept in the address cache.
+   ///
+   static const unsigned AddressCacheTimeoutDefault = 60;
+
 public:
 
    /// Constructor that creates socket based on existing socket handle.
@@ -155,6 +169,20 @@ public: // Properties:
    void SetReceiveBufferSize(int size);
    ///@}
 
+   ///@{
+   /// Number of seconds the server addresses resolved by Connect are kept in the address cache.
+   ///
+   /// The cache is shared by all sockets of the process, therefore, many connections
+   /// to the same server made within this time will resolve its name only once.
+   /// Addresses given as numeric IP literals are never cached.
+   /// Zero value disables the cache. The default is AddressCacheTimeoutDefault, 60 seconds.
+   ///
+   /// \see ClearAddressCache - discard all cached addresses.
+   ///
+   static unsigned GetAddressCacheTimeout();
+   static void SetAddressCacheTimeout(unsigned seconds);
+   ///@}
+
 public: // Methods:
 
    /// Create client socket that connects to the server.
@@ -183,10 +211,24 @@ public: // Methods:
    /// \param oph
    ///    Optional pointer to an operation handler that is capable of canceling the opening.
    ///
+   /// When the address resolves into multiple IP addresses, these are tried with alternating address families,
+   /// and a new attempt is started every ConnectionAttemptDelay milliseconds, or immediately
+   /// when the previous attempt fails. The first established connection wins, and the rest are closed.
+   /// If all attempts fail, the error of the last failed attempt is thrown.
+   ///
    /// \see ConnectWithProxy - Connect to a socket through SOCKS proxy.
+   /// \see GetAddressCacheTimeout - for how long the resolved addresses are reused.
    ///
    void ConnectInterruptible(unsigned port, const MStdString& address, OperationHandler* oph);
 
+   /// Discard all server addresses cached by the previous connections.
+   ///
+   /// The next connection to each server will resolve its name again.
+   ///
+   /// \see GetAddressCacheTimeout - for how long the resolved addresses are reused.
+   ///
+   static void ClearAddressCache();
+
 #if !M_NO_SOCKETS_SOCKS
 
    /// Create client socket that connects to the server through a SOCKS proxy.
@@ -337,6 +379,19 @@ public: // Methods:
    ///
    unsigned Send(const char* buffer, unsigned length, int flags);
 
+   /// Write several fragments of data through the socket with a single gathering system call.
+   ///
+   /// This is sendmsg on POSIX, and WSASend on Windows.
+   /// When the stream has a processor attached, fragments are concatenated and written through it.
+   ///
+   /// \param fragments Array of fragments to write, in order.
+   /// \param count Number of elements in the array.
+   /// \param more Hint that more data will follow shortly, maps to MSG_MORE where supported.
+   ///
+   /// \pre The connection is alive, otherwise the connection-specific exception is thrown.
+   ///
+   virtual void WriteBuffers(const Fragment* fragments, unsigned count, bool more = false);
+
    /// The number of bytes in the receive buffer that can be read immediately.
    ///
    /// Returns the number of bytes ready to be read from socket.
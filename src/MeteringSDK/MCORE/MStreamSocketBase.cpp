@@ -110,9 +110,11 @@ M_START_PROPERTIES(StreamSocketBase)
    M_OBJECT_PROPERTY_UINT               (StreamSocketBase, ReceiveTimeout)
    M_OBJECT_PROPERTY_READONLY_UINT      (StreamSocketBase, BytesReadyToRead)
    M_OBJECT_PROPERTY_READONLY_BOOL_EXACT(StreamSocketBase, IsInputBufferEmpty)
+   M_CLASS_PROPERTY_READONLY_BOOL_EXACT (StreamSocketBase, IsReusePortSupported)
 M_START_METHODS(StreamSocketBase)
    M_OBJECT_SERVICE_OVERLOADED          (StreamSocketBase, Bind,               Bind,                2, ST_X_unsigned_constMStdStringA)
    M_OBJECT_SERVICE_OVERLOADED          (StreamSocketBase, Bind,               DoBind1,             1, ST_X_unsigned)  // SWIG_HIDE
+   M_OBJECT_SERVICE                     (StreamSocketBase, BindShared,                                 ST_X_unsigned_constMStdStringA)
    M_OBJECT_SERVICE                     (StreamSocketBase, WaitToReceive,                              ST_bool_X_unsigned)
    M_OBJECT_SERVICE                     (StreamSocketBase, WaitToSend,                                 ST_bool_X_unsigned)
    M_CLASS_SERVICE                      (StreamSocketBase, AddressToBinary,                            ST_MByteString_S_constMStdStringA)
@@ -198,6 +200,25 @@ unsigned MStreamSocketBase::GetLocalSocketPort() const
 }
 
 void MStreamSocketBase::Bind(unsigned port, const MStdString& address)
+{
+   DoBind(port, address, false);
+}
+
+void MStreamSocketBase::BindShared(unsigned port, const MStdString& address)
+{
+   DoBind(port, address, true);
+}
+
+bool MStreamSocketBase::IsReusePortSupported()
+{
+#ifdef SO_REUSEPORT
+   return true;
+#else
+   return false;
+#endif
+}
+
+void MStreamSocketBase::DoBind(unsigned port, const MStdString& address, bool reusePort)
 {
    Close();
 
@@ -239,6 +260,12 @@ void MStreamSocketBase::Bind(unsigned port, const MStdString& address)
 
             const int reuseaddr = 1;
             DoOsSetsockopt(sh.m_socketHandle, SOL_SOCKET, SO_REUSEADDR, &reuseaddr, sizeof(reuseaddr));
+         #ifdef SO_REUSEPORT
+            if ( reusePort )
+               DoOsSetsockopt(sh.m_socketHandle, SOL_SOCKET, SO_REUSEPORT, &reuseaddr, sizeof(reuseaddr));
+         #else
+            M_USED_VARIABLE(reusePort);
+         #endif
 
             const int res = ::bind(sh.m_socketHandle, ai->ai_addr, static_cast<socklen_t>(ai->ai_addrlen));
             if ( res < 0 )
@@ -299,6 +326,23 @@ bool MStreamSocketBase::WaitToSend(unsigned timeout) const
 #endif
 }
 
+void MStreamSocketBase::WriteBuffers(const Fragment* fragments, unsigned count, bool)
+{
+   if ( count == 1 )
+      WriteBytes(fragments->m_buffer, fragments->m_size);
+   else if ( count > 1 )
+   {
+      unsigned size = 0;
+      for ( unsigned i = 0; i < count; ++i )
+         size += fragments[i].m_size;
+      MByteString buffer;
+      buffer.reserve(size);
+      for ( unsigned i = 0; i < count; ++i )
+         buffer.append(fragments[i].m_buffer, fragments[i].m_size);
+      Write(buffer);
+   }
+}
+
 MStdString MStreamSocketBase::GetLocalName()
 {
    OSInitSocketsLibrary(); // static service can be called without constructing any socket
@@ -68,6 +68,14 @@ public:
    ///
    static const unsigned TimeoutDefault  = 60000;
 
+   /// Fragment of data given to \ref WriteBuffers, an equivalent of the system iovec structure.
+   ///
+   struct Fragment
+   {
+      const char* m_buffer; ///< Pointer to the first byte of the fragment.
+      unsigned m_size;      ///< Number of bytes in the fragment.
+   };
+
 protected: // Types:
 /// \cond SHOW_INTERNAL
 
@@ -218,6 +226,31 @@ public: // Methods:
    ///
    void Bind(unsigned port, const MStdString& address = MVariant::s_emptyString);
 
+   /// Bind a server socket into a port that can be shared by other sockets.
+   ///
+   /// This is the same as \ref Bind, but it also sets SO_REUSEPORT socket option,
+   /// so many sockets can be bound into the same port and address.
+   /// For listening sockets, the operating system distributes incoming connections among them,
+   /// which allows accepting connections in many threads without contention.
+   /// On platforms that do not support SO_REUSEPORT this call is equivalent to \ref Bind,
+   /// and the second socket bound to the same port will fail.
+   ///
+   /// \param port
+   ///    The port to which to bind.
+   ///
+   /// \param address
+   ///     Address, such as "localhost". When not given, the bind is going to be made on all open interfaces.
+   ///
+   /// \see IsReusePortSupported - whether the current platform supports shared ports.
+   ///
+   void BindShared(unsigned port, const MStdString& address = MVariant::s_emptyString);
+
+   /// Whether the current platform supports binding many sockets into the same port.
+   ///
+   /// \see BindShared - bind a socket into a port that can be shared.
+   ///
+   static bool IsReusePortSupported();
+
    /// Waits the time given in milliseconds for the input data to arrive.
    ///
    /// Returns true if the data are available, or false if not. 
@@ -236,6 +269,21 @@ public: // Methods:
    ///
    bool WaitToSend(unsigned timeout = (unsigned)TimeoutInfinite) const;
 
+   /// Write several fragments of data through the socket as one sequence of bytes.
+   ///
+   /// Stream sockets send all fragments with a single gathering system call where possible,
+   /// so the message assembled from several buffers goes out in one segment.
+   /// The default implementation concatenates fragments and writes them with a single write.
+   ///
+   /// \param fragments Array of fragments to write, in order.
+   /// \param count Number of elements in the array.
+   /// \param more Hint that more data will follow shortly, so the system may hold the data
+   ///     to build a bigger segment. Where supported, this maps to MSG_MORE.
+   ///
+   /// \pre The connection is alive, otherwise the connection-specific exception is thrown.
+   ///
+   virtual void WriteBuffers(const Fragment* fragments, unsigned count, bool more = false);
+
    /// Clear the input buffer by reading all the available data from the socket, if any are there.
    ///
    /// \pre The socket is alive, other read-related errors possible.
@@ -406,6 +454,10 @@ protected: // Methods:
 
    static M_NORETURN_FUNC void DoThrowBadIpAddress();
 
+private: // Methods:
+
+   void DoBind(unsigned port, const MStdString& address, bool reusePort);
+
 protected: // Properties:
 
    // Implementation-specific socket handle.
@@ -44,7 +44,11 @@
 /// \see M_THREAD_LOCAL_POINTER the user level macro to declare the most portable and efficient thread local pointer.
 ///
 #ifndef M__USE_THREAD_LOCAL_POINTER
-   #define M__USE_THREAD_LOCAL_POINTER ((defined(__GNUC__) && M_GCC_VERSION >= 44300) || defined(__clang__))
+   #if (defined(__GNUC__) && M_GCC_VERSION >= 44300) || defined(__clang__)
+      #define M__USE_THREAD_LOCAL_POINTER 1
+   #else
+      #define M__USE_THREAD_LOCAL_POINTER 0
+   #endif
 #endif
 ///@}
 
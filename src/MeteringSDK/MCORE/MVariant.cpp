@@ -314,6 +314,8 @@ void MVariant::SetCount(int count)
          int prevCount = m_int32;
          if ( prevCount > count ) // shrink
          {
+            if ( m_type == VAR_MAP )
+               DoDropMapIndex();
             DoMakeCollectionUnique();
             do
             {
@@ -1214,6 +1216,227 @@ MVariant MVariant::GetItem(int index) const
    return result;
 }
 
+   // Maps with this many pairs or more get a hash index of their keys
+   //
+   const unsigned MAP_INDEX_MINIMUM_COUNT = 16;
+
+   // Signature of the map index header, its first byte is never a valid variant type
+   //
+   const Muint32 MAP_INDEX_SIGNATURE = 0x7A6D4958u;
+
+   enum MapKeyKindEnum
+   {
+      MAP_KEY_KIND_NONE,    // key is not hashed, such as double or object, or keys of the map are of different kinds
+      MAP_KEY_KIND_INTEGER, // byte, unsigned or integer
+      MAP_KEY_KIND_STRING   // string or byte string
+   };
+
+   // Header of the hash index of a big map, the last bytes of the map buffer.
+   //
+   // The buffer of an indexed map has the following layout, where count is m_int32 / 2:
+   //
+   //     [ count pairs of key and value ][ capacity - count zeroed pairs ][ Muint32 slots [ 1 << tableBits ] ][ header ]
+   //
+   // The slot is zero if it is free, or the index of the pair plus one, and collisions are resolved by linear probing.
+   // Only the keys of a single kind are hashed, as variants of different types can be equal, such as 1 and "1".
+   // Lookup by a key of a different kind goes through the pairs, the same way as for small maps.
+   // Any operation that changes the buffer without maintaining the index leaves it invalid,
+   // either by size or by count, and the index is then rebuilt by the next addition of a key.
+   //
+   struct MVariantMapIndexHeader
+   {
+      Muint32 m_signature; // MAP_INDEX_SIGNATURE
+      Muint32 m_count;     // number of pairs indexed
+      Muint32 m_capacity;  // number of pairs that fit before the slots
+      Muint8  m_tableBits; // binary logarithm of the number of slots, or zero if there are no slots
+      Muint8  m_keyKind;   // MapKeyKindEnum of all keys in the map
+      Muint16 m_reserved;
+   };
+
+   inline unsigned DoGetMapIndexTableSize(const MVariantMapIndexHeader* header)
+   {
+      return header->m_tableBits != 0 ? (1u << header->m_tableBits) : 0u;
+   }
+
+   // Get the valid index of the map buffer with the given number of pairs, or NULL
+   //
+   static MVariantMapIndexHeader* DoGetMapIndexHeader(const MSharedString& buffer, unsigned count)
+   {
+      const unsigned size = M_64_CAST(unsigned, buffer.size());
+      if ( size < count * 2 * sizeof(MVariant) + sizeof(MVariantMapIndexHeader) )
+         return NULL;
+      MVariantMapIndexHeader* header = reinterpret_cast<MVariantMapIndexHeader*>(const_cast<char*>(buffer.data()) + size - sizeof(MVariantMapIndexHeader));
+      if ( header->m_signature != MAP_INDEX_SIGNATURE || header->m_count != count || header->m_capacity < count ||
+           size != header->m_capacity * 2 * sizeof(MVariant) + DoGetMapIndexTableSize(header) * sizeof(Muint32) + sizeof(MVariantMapIndexHeader) )
+         return NULL;
+      return header;
+   }
+
+   inline unsigned DoGetMapKeyKind(const MVariant& key)
+   {
+      switch ( key.GetType() )
+      {
+      case MVariant::VAR_BYTE:
+      case MVariant::VAR_UINT:
+      case MVariant::VAR_INT:
+         return MAP_KEY_KIND_INTEGER;
+      case MVariant::VAR_BYTE_STRING:
+      case MVariant::VAR_STRING:
+         return MAP_KEY_KIND_STRING;
+      default:
+         return MAP_KEY_KIND_NONE;
+      }
+   }
+
+   inline Muint32 DoGetMapKeyHash(const MVariant& key, unsigned kind)
+   {
+      if ( kind == MAP_KEY_KIND_INTEGER )
+      {
+         // Integers are equal when their double values are equal, and double holds any of them exactly
+         const Muint64 value = static_cast<Muint64>(static_cast<Mint64>(key.AsDouble()));
+         return static_cast<Muint32>((value ^ (value >> 32)) * 2654435761u);
+      }
+      M_ASSERT(kind == MAP_KEY_KIND_STRING);
+      return MSharedString::static_hash(key.AsConstChars(), key.GetCount());
+   }
+
+   // Find the slot of the given key, or the free slot where the key can be added
+   //
+   static Muint32* DoFindMapSlot(const MVariant* pairs, const MVariantMapIndexHeader* header, const MVariant& key)
+   {
+      M_ASSERT(header->m_tableBits != 0);
+      const Muint32 mask = DoGetMapIndexTableSize(header) - 1u;
+      Muint32* slots = reinterpret_cast<Muint32*>(const_cast<MVariantMapIndexHeader*>(header)) - (mask + 1u);
+      for ( Muint32 i = DoGetMapKeyHash(key, header->m_keyKind) & mask; ; i = (i + 1u) & mask ) // table is at most half full
+      {
+         Muint32* slot = slots + i;
+         if ( *slot == 0 || pairs[(*slot - 1u) * 2u] == key )
+            return slot;
+      }
+   }
+
+int MVariant::DoFindMapItem(const MVariant& key) const
+{
+   M_ASSERT(m_type == VAR_MAP);
+   if ( m_uint32 >= MAP_INDEX_MINIMUM_COUNT * 2 )
+   {
+      const MVariantMapIndexHeader* header = DoGetMapIndexHeader(DoAccessSharedString(), m_uint32 >> 1);
+      if ( header != NULL && header->m_keyKind != MAP_KEY_KIND_NONE && header->m_keyKind == DoGetMapKeyKind(key) )
+      {
+         const Muint32 slot = *DoFindMapSlot(m_variants, header, key);
+         return slot == 0 ? -1 : static_cast<int>(slot - 1u) * 2;
+      }
+   }
+   for ( int i = m_int32 - 2; i >= 0; i -= 2 )
+      if ( DoAccessVariantItem(i) == key )
+         return i;
+   return -1;
+}
+
+MVariant& MVariant::DoAccessOrAddMapItem(const MVariant& key)
+{
+   M_ASSERT(m_type == VAR_MAP);
+   if ( m_int32 == 0 ) // easy case, optimize by not doing an auxiliary DoMakeCollectionUnique
+   {
+      m_int32 = 2;
+      DoAccessSharedString().resize(2 * sizeof(MVariant));
+      DoAccessVariantItem(0).DoAssignToEmpty(key);
+      return DoAccessVariantItem(1);
+   }
+
+   DoMakeCollectionUnique();
+   const unsigned count = m_uint32 >> 1;
+   if ( count < MAP_INDEX_MINIMUM_COUNT - 1 ) // small map, the one that reaches the minimum count gets the index below
+   {
+      const int i = DoFindMapItem(key);
+      if ( i >= 0 )
+         return DoAccessVariantItem(i + 1);
+      m_int32 += 2;
+      DoAccessSharedString().resize(m_int32 * sizeof(MVariant));
+      DoAccessVariantItem(m_int32 - 2).DoAssignToEmpty(key);
+      return DoAccessVariantItem(m_int32 - 1);
+   }
+
+   MVariantMapIndexHeader* header = DoGetMapIndexHeader(DoAccessSharedString(), count);
+   if ( header == NULL || header->m_count == header->m_capacity )
+   {
+      DoBuildMapIndex(count < MAP_INDEX_MINIMUM_COUNT ? MAP_INDEX_MINIMUM_COUNT * 2 : count * 2);
+      header = DoGetMapIndexHeader(DoAccessSharedString(), count);
+      M_ASSERT(header != NULL);
+   }
+
+   Muint32* slot = NULL;
+   if ( header->m_keyKind != MAP_KEY_KIND_NONE && header->m_keyKind == DoGetMapKeyKind(key) )
+   {
+      slot = DoFindMapSlot(m_variants, header, key);
+      if ( *slot != 0 )
+         return DoAccessVariantItem(static_cast<int>(*slot - 1u) * 2 + 1);
+   }
+   else
+   {
+      for ( int i = m_int32 - 2; i >= 0; i -= 2 )
+         if ( DoAccessVariantItem(i) == key )
+            return DoAccessVariantItem(i + 1);
+      header->m_keyKind = MAP_KEY_KIND_NONE; // keys are of different kinds from now on, so they are not hashed
+   }
+
+   // Add the new pair into the zeroed space that follows the existing pairs
+   DoAccessVariantItem(m_int32).DoAssignToEmpty(key);
+   m_int32 += 2;
+   ++header->m_count;
+   if ( slot != NULL )
+      *slot = count + 1u;
+   return DoAccessVariantItem(m_int32 - 1);
+}
+
+void MVariant::DoBuildMapIndex(unsigned capacity)
+{
+   M_ASSERT(m_type == VAR_MAP && !DoAccessSharedString().is_shared());
+   const unsigned count = m_uint32 >> 1;
+   M_ASSERT(capacity > count);
+
+   unsigned kind = count > 0 ? DoGetMapKeyKind(DoAccessVariantItem(0)) : static_cast<unsigned>(MAP_KEY_KIND_NONE);
+   for ( unsigned i = 1; i < count && kind != MAP_KEY_KIND_NONE; ++i )
+      if ( DoGetMapKeyKind(DoAccessVariantItem(i * 2)) != kind )
+         kind = MAP_KEY_KIND_NONE;
+   unsigned tableBits = 0;
+   if ( kind != MAP_KEY_KIND_NONE )
+      for ( tableBits = 1; (1u << tableBits) < capacity * 2; ++tableBits ) // keep the table at most half full
+         ;
+
+   MSharedString& buffer = DoAccessSharedString();
+   const unsigned pairsSize = count * 2 * sizeof(MVariant);
+   const unsigned size = capacity * 2 * sizeof(MVariant) + (tableBits != 0 ? (1u << tableBits) : 0u) * sizeof(Muint32) + sizeof(MVariantMapIndexHeader);
+   buffer.resize(size);
+   char* bytes = const_cast<char*>(buffer.data()); // the buffer is not shared
+   memset(bytes + pairsSize, 0, size - pairsSize); // free pairs, free slots, and also any previous index
+   MVariantMapIndexHeader* header = reinterpret_cast<MVariantMapIndexHeader*>(bytes + size - sizeof(MVariantMapIndexHeader));
+   header->m_signature = MAP_INDEX_SIGNATURE;
+   header->m_count = count;
+   header->m_capacity = capacity;
+   header->m_tableBits = static_cast<Muint8>(tableBits);
+   header->m_keyKind = static_cast<Muint8>(kind);
+   if ( kind != MAP_KEY_KIND_NONE )
+   {
+      for ( unsigned i = 0; i < count; ++i )
+      {
+         Muint32* slot = DoFindMapSlot(m_variants, header, DoAccessVariantItem(i * 2));
+         if ( *slot == 0 ) // keys are unique, but be careful
+            *slot = i + 1u;
+      }
+   }
+}
+
+void MVariant::DoDropMapIndex()
+{
+   M_ASSERT(m_type == VAR_MAP);
+   if ( m_int32 > 0 && DoAccessSharedString().size() != m_uint32 * sizeof(MVariant) )
+   {
+      DoMakeCollectionUnique();
+      DoAccessSharedString().resize(m_uint32 * sizeof(MVariant));
+   }
+}
+
 void MVariant::SetItem(const MVariant& index, const MVariant& value)
 {
    switch ( m_type )
@@ -1234,33 +1457,7 @@ void MVariant::SetItem(const MVariant& index, const MVariant& value)
       break;
 #endif
    case VAR_MAP:
-      if ( m_int32 == 0 ) // easy case, optimize by not doing an auxiliary DoMakeCollectionUnique
-      {
-         m_int32 = 2;
-         DoAccessSharedString().resize(2 * sizeof(MVariant));
-         DoAccessVariantItem(0).DoAssignToEmpty(index);
-         DoAccessVariantItem(1).DoAssignToEmpty(value);
-      }
-      else
-      {
-         DoMakeCollectionUnique();
-         for ( int i = m_int32 - 2; ; i -= 2 )
-         {
-            if ( i < 0 )
-            {
-               m_int32 += 2;
-               DoAccessSharedString().resize(m_int32 * sizeof(MVariant));
-               DoAccessVariantItem(m_int32 - 2).DoAssignToEmpty(index);
-               DoAccessVariantItem(m_int32 - 1).DoAssignToEmpty(value);
-               break;
-            }
-            if ( DoAccessVariantItem(i) == index )
-            {
-               DoAccessVariantItem(i + 1) = value;
-               break;
-            }
-         }
-      }
+      DoAccessOrAddMapItem(index) = value;
       break;
    default:
       SetItem(index.AsInt(), value);
@@ -1303,21 +1500,54 @@ void MVariant::SetItem(int index, const MVariant& value)
    }
 }
 
+#if !M_NO_RVALUE_REFERENCES
+void MVariant::SetItem(const MVariant& index, MVariant&& value)
+{
+   switch ( m_type )
+   {
+   case VAR_MAP:
+      DoAccessOrAddMapItem(index).MoveFrom(value);
+      break;
+   case VAR_STRING_COLLECTION:
+   case VAR_VARIANT_COLLECTION:
+      SetItem(index.AsInt(), std::move(value));
+      break;
+   default: // strings and objects take a copy
+      SetItem(index, static_cast<const MVariant&>(value));
+   }
+}
+
+void MVariant::SetItem(int index, MVariant&& value)
+{
+   switch ( m_type )
+   {
+   case VAR_STRING_COLLECTION:
+   case VAR_VARIANT_COLLECTION:
+      AdjustIndex(index, m_int32);
+      DoMakeCollectionUnique();
+      DoAccessVariantItem(index).MoveFrom(value);
+      break;
+   case VAR_MAP:
+      DoAccessOrAddMapItem(MVariant(index)).MoveFrom(value);
+      break;
+   default: // strings and objects take a copy
+      SetItem(index, static_cast<const MVariant&>(value));
+   }
+}
+#endif
+
 const MVariant& MVariant::AccessItem(const MVariant& idx) const
 {
    if ( m_type == VAR_MAP )
    {
-      for ( int i = m_int32 - 2; ; i -= 2 )
+      const int i = DoFindMapItem(idx);
+      if ( i < 0 )
       {
-         if ( i < 0 )
-         {
-            char buff [ MException::MaximumVisibleParameterLength ];
-            MException::Throw(MException::ErrorSoftware, M_CODE_STR_P1(M_ERR_ENTRY_NOT_FOUND, "Entry '%s' not found in the map", MException::VisualizeVariantParameter(buff, idx)));
-            M_ENSURED_ASSERT(0);
-         }
-         if ( DoAccessVariantItem(i) == idx )
-            return DoAccessVariantItem(i + 1);
+         char buff [ MException::MaximumVisibleParameterLength ];
+         MException::Throw(MException::ErrorSoftware, M_CODE_STR_P1(M_ERR_ENTRY_NOT_FOUND, "Entry '%s' not found in the map", MException::VisualizeVariantParameter(buff, idx)));
+         M_ENSURED_ASSERT(0);
       }
+      return DoAccessVariantItem(i + 1);
    }
    return AccessItem(idx.AsInt());
 }
@@ -1338,21 +1568,7 @@ const MVariant& MVariant::AccessItem(int index) const
 MVariant& MVariant::AccessItem(const MVariant& index)
 {
    if ( m_type == VAR_MAP )
-   {
-      DoMakeCollectionUnique();
-      for ( int i = m_int32 - 2; ; i -= 2 )
-      {
-         if ( i < 0 )
-         {
-            m_int32 += 2;
-            DoAccessSharedString().resize(m_int32 * sizeof(MVariant));
-            DoAccessVariantItem(m_int32 - 2).DoAssignToEmpty(index);
-            return DoAccessVariantItem(m_int32 - 1);
-         }
-         if ( DoAccessVariantItem(i) == index )
-            return DoAccessVariantItem(i + 1);
-      }
-   }
+      return DoAccessOrAddMapItem(index);
    return AccessItem(index.AsInt());
 }
 
@@ -1567,6 +1783,8 @@ void MVariant::SetSlice(int from, int to, const MVariant& values)
 
 bool MVariant::operator==(const MVariant& v) const
 {
+   if ( m_type == v.m_type && m_type >= VAR_BYTE && m_type <= VAR_INT ) // quite probable case, integers of the same type
+      return m_uint32 == v.m_uint32;
    switch ( (m_type > v.m_type) ? m_type : v.m_type )
    {
    case VAR_EMPTY: // both variables are empty, comparison gives true
@@ -2079,6 +2297,7 @@ MVariant& MVariant::operator-=(const MVariant& v)
             MVariant& key = DoAccessVariantItem(i);
             if ( key == v )
             {
+               DoDropMapIndex();
                DoMakeCollectionUnique();
                DoAccessVariantItem(i).MVariant::~MVariant();
                DoAccessVariantItem(i + 1).MVariant::~MVariant();
@@ -2425,9 +2644,8 @@ int MVariant::FindIndexOf(const MVariant& v, bool reverse) const
       {
          // For map, reverse does not apply, always do a reverse
          M_ASSERT((m_uint32 & 0x01) == 0);
-         for ( int i = static_cast<int>(m_uint32 >> 1) - 1; i >= 0; --i )
-            if ( GetMapKeyByIndex(i) == v )
-               return i;
+         const int i = DoFindMapItem(v);
+         return i < 0 ? -1 : (i >> 1);
       }
       else if ( reverse )
       {
@@ -2482,6 +2700,20 @@ void MVariant::AddToVariantCollection(const MVariant& v)
    DoAccessVariantItem(oldCount).DoAssignToEmpty(v);
 }
 
+#if !M_NO_RVALUE_REFERENCES
+void MVariant::AddToVariantCollection(MVariant&& v)
+{
+   if ( m_type != VAR_VARIANT_COLLECTION && m_type != VAR_STRING_COLLECTION )
+   {
+      MException::ThrowNotSupportedForThisType();
+      M_ENSURED_ASSERT(0);
+   }
+   int oldCount = m_int32;
+   SetCount(oldCount + 1);
+   DoAccessVariantItem(oldCount).MoveFrom(v);
+}
+#endif
+
 #if !M_NO_WCHAR_T
 
 void MVariant::DoAssignToEmpty(wchar_t c)
@@ -570,6 +570,21 @@ public: // Constructor and destructor:
       DoAssignToEmpty(other);
    }
 
+#if !M_NO_RVALUE_REFERENCES
+   /// Move constructor, which takes the value of the other variant without copying its buffer.
+   ///
+   /// The other variant becomes empty.
+   ///
+   /// \param other Variant from which to move the value.
+   ///
+   MVariant(MVariant&& other) M_NO_THROW
+   :
+      m_type(VAR_EMPTY)
+   {
+      MoveFrom(other);
+   }
+#endif
+
    /// Destroy the variant object, reclaim memory if necessary.
    ///
    ~MVariant() M_NO_THROW
@@ -614,6 +629,26 @@ public: // Services that work with type of the variant:
       return m_type > VAR_EMPTY && m_type <= VAR_DOUBLE;
    }
 
+   /// Get the value of the variant as unsigned integer, if it has an integer type that needs no conversion.
+   ///
+   /// The types are \ref MVariant::VAR_BYTE, \ref MVariant::VAR_CHAR, \ref MVariant::VAR_UINT,
+   /// and \ref MVariant::VAR_INT with a nonnegative value. This is an inline check intended for hot paths
+   /// where the value is almost always an integer, such as table numbers, and all other cases
+   /// are handled by the slower generic code like \ref AsUInt.
+   ///
+   /// \param value Receives the value of the variant if true is returned, otherwise not touched.
+   /// \return Whether the variant has one of the above types.
+   ///
+   bool GetUnsignedIfInteger(unsigned& value) const
+   {
+      if ( (m_type >= VAR_BYTE && m_type <= VAR_UINT) || (m_type == VAR_INT && m_int32 >= 0) )
+      {
+         value = m_uint32;
+         return true;
+      }
+      return false;
+   }
+
    /// Whether the variant can be indexed.
    ///
    /// This means that \ref GetCount(), \ref GetItem and \ref SetItem are callable,
@@ -835,6 +870,19 @@ public: // Assignment operators:
    ///
    MVariant& operator=(const MVariant& v);
 
+#if !M_NO_RVALUE_REFERENCES
+   /// Move assignment operator, which takes the value of the given variant without copying its buffer.
+   ///
+   /// The given variant becomes empty.
+   ///
+   MVariant& operator=(MVariant&& v) M_NO_THROW
+   {
+      if ( &v != this )
+         MoveFrom(v);
+      return *this;
+   }
+#endif
+
    /// Assignment operator that takes ObjectByValue stub, as handled by reflection.
    ///
    MVariant& operator=(const ObjectByValue& o);
@@ -1336,6 +1384,8 @@ public: // Conversion services:
    /// If an item is an object, it shall have a reflected service with the name SetItem.
    /// Otherwise the conversion exception is thrown.
    ///
+   /// The overloads that take an rvalue move the value into a collection or a map without copying its buffer.
+   ///
    void SetItem(const MVariant& index, const MVariant& value);
    void SetItem(int index, const MVariant& value);
    void SetItem(unsigned index, const MVariant& value)
@@ -1347,6 +1397,20 @@ public: // Conversion services:
    {
       SetItem(static_cast<int>(index), value);
    }
+#endif
+#if !M_NO_RVALUE_REFERENCES
+   void SetItem(const MVariant& index, MVariant&& value);
+   void SetItem(int index, MVariant&& value);
+   void SetItem(unsigned index, MVariant&& value)
+   {
+      SetItem(static_cast<int>(index), std::move(value));
+   }
+#if M_POINTER_BIT_SIZE == 64
+   void SetItem(size_t index, MVariant&& value)
+   {
+      SetItem(static_cast<int>(index), std::move(value));
+   }
+#endif
 #endif
    ///@}
 
@@ -1475,14 +1539,20 @@ public: // Conversion services:
    ///
    int FindIndexOf(const MVariant&, bool reverse = false) const;
 
+   ///@{
    /// Add the given variant as a whole to the collection.
    /// This call is different from operator+=, as it does not
    /// unroll the collection items if the given parameter is a collection.
+   /// The overload that takes an rvalue moves the given value into the collection.
    ///
    /// \pre The type of the variant shall be VARIANT_COLLECTION,
    /// there is a debug check.
    ///
    void AddToVariantCollection(const MVariant& v);
+#if !M_NO_RVALUE_REFERENCES
+   void AddToVariantCollection(MVariant&& v);
+#endif
+   ///@}
 
    /// Adjust a given index 
    /// so the negative index will mean counting from the end of the array.
@@ -2199,6 +2269,13 @@ private: // Methods:
 
    void DoMakeCollectionUnique();
 
+   // Map lookups, which use the hash index of the keys for big maps, see MVariant.cpp for the index layout.
+   //
+   int DoFindMapItem(const MVariant& key) const;
+   MVariant& DoAccessOrAddMapItem(const MVariant& key);
+   void DoBuildMapIndex(unsigned capacity);
+   void DoDropMapIndex();
+
    MVariant DoGetAllMapItems(bool returnValues) const;
    const MVariant& DoGetMapItemByIndex(bool returnValues, int i) const;
 